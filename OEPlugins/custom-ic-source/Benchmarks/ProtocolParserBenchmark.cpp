@@ -0,0 +1,281 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Throughput benchmark for ProtocolParser on a synthetic byte stream.
+
+    Usage: ProtocolParserBenchmark [numChannels] [bytesPerSample]
+
+    ------------------------------------------------------------------
+*/
+
+#include "../Source/ProtocolParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+// Count heap allocations so the steady state can be checked
+static std::atomic<long> allocationCount { 0 };
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+const int READ_SIZE = 4096;  // Size of the serial reads CustomICThread used to make
+const int BUFFER_SIZE = 1024;  // Samples per addToBuffer() call
+
+/** The parser before the receive buffer rewrite, kept as the baseline */
+class LegacyParser
+{
+public:
+    struct DataPacket
+    {
+        std::vector<float> samples;
+        int64_t timestamp;
+        bool valid;
+    };
+
+    LegacyParser(int channels, int bytes, float scale)
+        : numChannels(channels), bytesPerSample(bytes), scaleFactor(scale)
+    {
+        buffer.reserve(MAX_BUFFER_SIZE);
+    }
+
+    int getPacketSize() const { return 2 + numChannels * bytesPerSample + 1; }
+
+    std::vector<DataPacket> parse(const uint8_t* data, int numBytes)
+    {
+        std::vector<DataPacket> packets;
+
+        for (int i = 0; i < numBytes; i++)
+        {
+            buffer.push_back(data[i]);
+            if (buffer.size() > MAX_BUFFER_SIZE)
+                buffer.erase(buffer.begin());
+        }
+
+        int packetSize = getPacketSize();
+
+        while (buffer.size() >= (size_t)packetSize)
+        {
+            bool foundSync = false;
+            size_t syncPos = 0;
+
+            for (size_t i = 0; i <= buffer.size() - packetSize; i++)
+            {
+                if (buffer[i] == 0xA0 && buffer[i + 1] == 0x5A)
+                {
+                    foundSync = true;
+                    syncPos = i;
+                    break;
+                }
+            }
+
+            if (!foundSync)
+            {
+                if (buffer.size() > 2)
+                    buffer.erase(buffer.begin(), buffer.end() - 2);
+                break;
+            }
+
+            if (syncPos > 0)
+                buffer.erase(buffer.begin(), buffer.begin() + syncPos);
+
+            if (buffer.size() < (size_t)packetSize)
+                break;
+
+            uint8_t checksum = 0;
+            for (int i = 0; i < packetSize - 1; i++)
+                checksum ^= buffer[i];
+
+            if (checksum != buffer[packetSize - 1])
+            {
+                buffer.erase(buffer.begin());
+                continue;
+            }
+
+            DataPacket packet;
+            packet.samples.resize(numChannels);
+            packet.valid = true;
+            packet.timestamp = 0;
+
+            const uint8_t* samplePtr = buffer.data() + 2;
+
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                packet.samples[ch] = bytesToSample(samplePtr);
+                samplePtr += bytesPerSample;
+            }
+
+            packets.push_back(packet);
+            buffer.erase(buffer.begin(), buffer.begin() + packetSize);
+        }
+
+        return packets;
+    }
+
+private:
+    float bytesToSample(const uint8_t* bytes)
+    {
+        int32_t rawValue = 0;
+
+        switch (bytesPerSample)
+        {
+            case 2:
+                rawValue = (int16_t)((bytes[0] << 8) | bytes[1]);
+                break;
+            case 3:
+                rawValue = (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+                if (rawValue & 0x800000)
+                    rawValue |= 0xFF000000;
+                break;
+            case 4:
+                rawValue = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+                break;
+        }
+
+        return rawValue * scaleFactor;
+    }
+
+    int numChannels;
+    int bytesPerSample;
+    float scaleFactor;
+    std::vector<uint8_t> buffer;
+    static const size_t MAX_BUFFER_SIZE = 65536;
+};
+
+/** Packets with random samples, a corrupted checksum every 997th and noise bytes every 499th */
+std::vector<uint8_t> makeStream(int numChannels, int bytesPerSample, int numPackets, int& numValid)
+{
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> stream;
+    numValid = 0;
+
+    for (int p = 0; p < numPackets; p++)
+    {
+        size_t start = stream.size();
+        stream.push_back(0xA0);
+        stream.push_back(0x5A);
+
+        for (int i = 0; i < numChannels * bytesPerSample; i++)
+            stream.push_back((uint8_t)rng());
+
+        uint8_t checksum = 0;
+        for (size_t i = start; i < stream.size(); i++)
+            checksum ^= stream[i];
+
+        if (p % 997 == 996)
+            checksum ^= 0xFF;
+        else
+            numValid++;
+
+        stream.push_back(checksum);
+
+        if (p % 499 == 498)
+        {
+            for (int i = 0; i < 7; i++)
+                stream.push_back((uint8_t)rng());
+        }
+    }
+
+    return stream;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int numChannels = argc > 1 ? std::atoi(argv[1]) : 64;
+    const int bytesPerSample = argc > 2 ? std::atoi(argv[2]) : 3;
+    const int numPackets = 200000;
+
+    int numValid = 0;
+    std::vector<uint8_t> stream = makeStream(numChannels, bytesPerSample, numPackets, numValid);
+    std::vector<float> dataBuffer((size_t)numChannels * BUFFER_SIZE);
+
+    const double megabytes = stream.size() / (1024.0 * 1024.0);
+    std::printf("%d channels x %d bytes, %d packets, %.1f MB\n", numChannels, bytesPerSample, numPackets, megabytes);
+
+    // Legacy: vector of packets per read, copied into the channel-major buffer
+    double legacySeconds;
+    long legacyPackets = 0;
+    {
+        LegacyParser parser(numChannels, bytesPerSample, 0.195f);
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t offset = 0; offset < stream.size(); offset += READ_SIZE)
+        {
+            int n = (int)std::min((size_t)READ_SIZE, stream.size() - offset);
+            auto packets = parser.parse(stream.data() + offset, n);
+            int count = (int)packets.size();
+
+            for (int i = 0; i < count; i++)
+                for (int ch = 0; ch < numChannels; ch++)
+                    dataBuffer[(size_t)ch * count + i] = packets[i].samples[ch];
+
+            legacyPackets += count;
+        }
+
+        legacySeconds = secondsSince(start);
+    }
+
+    // Current: read into the parser's buffer, decode straight into dataBuffer
+    double seconds;
+    long parsedPackets = 0;
+    long allocations;
+    {
+        CustomIC::ProtocolParser parser;
+        parser.configure(numChannels, bytesPerSample, 0.195f);
+
+        allocationCount = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t offset = 0; offset < stream.size();)
+        {
+            int space = 0;
+            uint8_t* dest = parser.getWriteBuffer(space);
+            int n = (int)std::min({ (size_t)READ_SIZE, (size_t)space, stream.size() - offset });
+
+            std::memcpy(dest, stream.data() + offset, (size_t)n);  // Stands in for SerialPort::read
+            parser.commitWrite(n);
+            offset += (size_t)n;
+
+            int count;
+            while ((count = parser.parse(dataBuffer.data(), BUFFER_SIZE)) > 0)
+                parsedPackets += count;
+        }
+
+        seconds = secondsSince(start);
+        allocations = allocationCount;
+    }
+
+    std::printf("expected %d valid packets, legacy parsed %ld, parser parsed %ld\n", numValid, legacyPackets, parsedPackets);
+    std::printf("legacy  %8.1f MB/s  %10.0f packets/s\n", megabytes / legacySeconds, legacyPackets / legacySeconds);
+    std::printf("parser  %8.1f MB/s  %10.0f packets/s  (%.1fx)\n", megabytes / seconds, parsedPackets / seconds, legacySeconds / seconds);
+    std::printf("parser sustains %.1f Mbaud (10 bits/byte) at 100%% of one core\n", stream.size() * 10.0 / seconds / 1e6);
+    std::printf("heap allocations while parsing: %ld\n", allocations);
+
+    return (parsedPackets == numValid && allocations == 0) ? 0 : 1;
+}
@@ -47,6 +47,11 @@ CustomICEditor::CustomICEditor(GenericProcessor* parentNode, CustomICThread* t)
     baudSelector->addItem("230400", 6);
     baudSelector->addItem("460800", 7);
     baudSelector->addItem("921600", 8);
+    baudSelector->addItem("1000000", 9);
+    baudSelector->addItem("1500000", 10);
+    baudSelector->addItem("2000000", 11);
+    baudSelector->addItem("3000000", 12);
+    baudSelector->setEditableText(true); // Any other rate can be typed in
     baudSelector->setSelectedId(5); // Default: 115200
     baudSelector->addListener(this);
     addAndMakeVisible(baudSelector.get());
@@ -182,12 +187,19 @@ void CustomICEditor::comboBoxChanged(ComboBox* comboBox)
     else if (comboBox == baudSelector.get())
     {
         int baud = baudSelector->getText().getIntValue();
-        thread->setBaudRate(baud);
+        
+        if (baud > 0)
+            thread->setBaudRate(baud);
+        else
+            baudSelector->setText(String(thread->getBaudRate()), dontSendNotification);
+        
+        updateStatus();
     }
     else if (comboBox == formatSelector.get())
     {
         int bytes = formatSelector->getSelectedId();
         thread->setDataFormat(bytes);
+        updateStatus();
     }
 }
 
@@ -259,6 +271,70 @@ void CustomICEditor::labelTextChanged(Label* label)
         uint8_t sync2 = (uint8_t)sync2Value->getText().getHexValue32();
         thread->setSyncBytes(sync1, sync2);
     }
+    
+    updateStatus();
+}
+
+void CustomICEditor::startAcquisition()
+{
+    lastBytesReceived = 0;
+    lastPacketsReceived = 0;
+    lastUpdateTime = Time::getMillisecondCounterHiRes();
+    
+    startTimer(1000);
+}
+
+void CustomICEditor::stopAcquisition()
+{
+    stopTimer();
+    updateStatus();
+}
+
+void CustomICEditor::loadCustomParametersFromXml(XmlElement*)
+{
+    baudSelector->setText(String(thread->getBaudRate()), dontSendNotification);
+    updateStatus();
+}
+
+void CustomICEditor::timerCallback()
+{
+    const double now = Time::getMillisecondCounterHiRes();
+    const double seconds = (now - lastUpdateTime) * 0.001;
+    
+    if (seconds <= 0.0)
+        return;
+    
+    const int64 bytes = thread->getBytesReceived();
+    const int64 packets = thread->getPacketsReceived();
+    const int64 failures = thread->getChecksumFailures();
+    
+    const double bytesPerSecond = (bytes - lastBytesReceived) / seconds;
+    const double packetsPerSecond = (packets - lastPacketsReceived) / seconds;
+    
+    lastBytesReceived = bytes;
+    lastPacketsReceived = packets;
+    lastUpdateTime = now;
+    
+    if (thread->isSimulating())
+    {
+        statusLabel->setText(String(packetsPerSecond, 0) + " pkt/s (simulated)", dontSendNotification);
+        return;
+    }
+    
+    const double linkUse = bytesPerSecond / thread->getLinkBytesPerSecond();
+    
+    statusLabel->setText(String(bytesPerSecond / 1000.0, 1) + " kB/s, "
+                         + String(packetsPerSecond, 0) + " pkt/s, "
+                         + String(failures) + " bad",
+                         dontSendNotification);
+    
+    statusLabel->setTooltip("Link use: " + String(linkUse * 100.0, 0) + "% of "
+                            + String(thread->getBaudRate()) + " baud; expected "
+                            + String(thread->getSampleRate(), 0) + " pkt/s");
+    
+    // Falling short of the configured rate, or corruption, means the link doesn't fit
+    const bool keepingUp = packetsPerSecond >= 0.95 * thread->getSampleRate();
+    statusLabel->setColour(Label::textColourId, keepingUp && failures == 0 ? Colours::green : Colours::orange);
 }
 
 void CustomICEditor::updateStatus()
@@ -268,6 +344,14 @@ void CustomICEditor::updateStatus()
         statusLabel->setText("Simulation mode", dontSendNotification);
         statusLabel->setColour(Label::textColourId, Colours::yellow);
     }
+    else if (thread->getRequiredBytesPerSecond() > thread->getLinkBytesPerSecond())
+    {
+        // The configured channels, format and rate cannot fit through the baud rate
+        statusLabel->setText("Link too slow: needs " + String(thread->getRequiredBytesPerSecond() / 1000.0, 1)
+                             + " of " + String(thread->getLinkBytesPerSecond() / 1000.0, 1) + " kB/s",
+                             dontSendNotification);
+        statusLabel->setColour(Label::textColourId, Colours::orange);
+    }
     else if (thread->isConnected())
     {
         statusLabel->setText("Connected: " + thread->getPort(), dontSendNotification);
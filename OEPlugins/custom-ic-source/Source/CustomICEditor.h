@@ -27,11 +27,15 @@ class CustomICThread;
  * - Scale factor
  * - Sync bytes
  * - Simulation mode
+ * 
+ * While acquiring, the status line shows the measured link throughput
+ * (bytes/s, packets/s and checksum failures).
  */
 class CustomICEditor : public GenericEditor,
                        public ComboBox::Listener,
                        public Button::Listener,
-                       public Label::Listener
+                       public Label::Listener,
+                       public Timer
 {
 public:
     CustomICEditor(GenericProcessor* parentNode, CustomICThread* thread);
@@ -48,6 +52,18 @@ public:
     
     /** Label callback for text entry */
     void labelTextChanged(Label* label) override;
+    
+    /** Starts the throughput display */
+    void startAcquisition() override;
+    
+    /** Stops the throughput display */
+    void stopAcquisition() override;
+    
+    /** Refreshes the throughput display */
+    void timerCallback() override;
+    
+    /** Shows the loaded baud rate, which may not be one of the listed ones */
+    void loadCustomParametersFromXml(XmlElement* xml) override;
 
 private:
     CustomICThread* thread;
@@ -91,6 +107,11 @@ private:
     // Status
     std::unique_ptr<Label> statusLabel;
     
+    // Link totals at the previous timer tick
+    int64 lastBytesReceived = 0;
+    int64 lastPacketsReceived = 0;
+    double lastUpdateTime = 0.0;
+    
     /** Refresh the port list */
     void refreshPorts();
     
@@ -10,8 +10,18 @@
 
 #include "CustomICThread.h"
 #include "CustomICEditor.h"
+#include "SerialBaudRate.h"
 #include <cmath>
 
+#ifdef __linux__
+    #include <linux/serial.h>
+#endif
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <sys/select.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -82,7 +92,7 @@ bool SerialPort::open(const String& portName, int baudRate)
         return false;
     }
     
-    // Set timeouts for non-blocking reads
+    // Non-blocking reads until waitForData() sets a timeout
     COMMTIMEOUTS timeouts = {0};
     timeouts.ReadIntervalTimeout = MAXDWORD;
     timeouts.ReadTotalTimeoutMultiplier = 0;
@@ -91,9 +101,10 @@ bool SerialPort::open(const String& portName, int baudRate)
     timeouts.WriteTotalTimeoutConstant = 0;
     
     SetCommTimeouts(handle, &timeouts);
+    readTimeoutMs = 0;
     
-    // Set buffer sizes
-    SetupComm(handle, 4096, 4096);
+    // Set buffer sizes (a large receive queue lets each read drain more)
+    SetupComm(handle, 65536, 4096);
     
     LOGC("Serial port opened: ", portName.toStdString(), " at ", baudRate, " baud");
     return true;
@@ -133,6 +144,27 @@ int SerialPort::write(const uint8_t* data, int numBytes)
     return -1;
 }
 
+bool SerialPort::waitForData(int timeoutMs)
+{
+    if (!isOpen()) return false;
+    
+    // With ReadIntervalTimeout and ReadTotalTimeoutMultiplier at MAXDWORD,
+    // ReadFile returns as soon as any byte arrives, or empty after the
+    // constant timeout, so read() itself does the waiting
+    if (timeoutMs != readTimeoutMs)
+    {
+        COMMTIMEOUTS timeouts = {0};
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant = (DWORD)jmax(1, timeoutMs);
+        
+        if (SetCommTimeouts(handle, &timeouts))
+            readTimeoutMs = timeoutMs;
+    }
+    
+    return true;
+}
+
 int SerialPort::available()
 {
     if (!isOpen()) return 0;
@@ -188,6 +220,57 @@ StringArray SerialPort::getAvailablePorts()
 #else
 // Linux/macOS implementation
 
+/** Looks up the termios constant for a baud rate, if the platform has one */
+static bool getStandardSpeed(int baudRate, speed_t& speed)
+{
+    switch (baudRate)
+    {
+        case 9600:    speed = B9600;    return true;
+        case 19200:   speed = B19200;   return true;
+        case 38400:   speed = B38400;   return true;
+        case 57600:   speed = B57600;   return true;
+        case 115200:  speed = B115200;  return true;
+        case 230400:  speed = B230400;  return true;
+#ifdef B460800
+        case 460800:  speed = B460800;  return true;
+#endif
+#ifdef B500000
+        case 500000:  speed = B500000;  return true;
+#endif
+#ifdef B576000
+        case 576000:  speed = B576000;  return true;
+#endif
+#ifdef B921600
+        case 921600:  speed = B921600;  return true;
+#endif
+#ifdef B1000000
+        case 1000000: speed = B1000000; return true;
+#endif
+#ifdef B1152000
+        case 1152000: speed = B1152000; return true;
+#endif
+#ifdef B1500000
+        case 1500000: speed = B1500000; return true;
+#endif
+#ifdef B2000000
+        case 2000000: speed = B2000000; return true;
+#endif
+#ifdef B2500000
+        case 2500000: speed = B2500000; return true;
+#endif
+#ifdef B3000000
+        case 3000000: speed = B3000000; return true;
+#endif
+#ifdef B3500000
+        case 3500000: speed = B3500000; return true;
+#endif
+#ifdef B4000000
+        case 4000000: speed = B4000000; return true;
+#endif
+        default:      return false;
+    }
+}
+
 bool SerialPort::open(const String& portName, int baudRate)
 {
     close();
@@ -202,18 +285,13 @@ bool SerialPort::open(const String& portName, int baudRate)
     struct termios options;
     tcgetattr(fd, &options);
     
-    // Set baud rate
+    // Set baud rate. Rates without a Bxxx constant are applied after
+    // tcsetattr(), which would otherwise overwrite them.
     speed_t speed;
-    switch (baudRate)
-    {
-        case 9600:   speed = B9600;   break;
-        case 19200:  speed = B19200;  break;
-        case 38400:  speed = B38400;  break;
-        case 57600:  speed = B57600;  break;
-        case 115200: speed = B115200; break;
-        case 230400: speed = B230400; break;
-        default:     speed = B115200; break;
-    }
+    const bool standardRate = getStandardSpeed(baudRate, speed);
+    
+    if (!standardRate)
+        speed = B38400;
     
     cfsetispeed(&options, speed);
     cfsetospeed(&options, speed);
@@ -231,15 +309,35 @@ bool SerialPort::open(const String& portName, int baudRate)
     // Raw input
     options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
     options.c_iflag &= ~(IXON | IXOFF | IXANY);
+    options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL);
     options.c_oflag &= ~OPOST;
     
-    // Non-blocking read
+    // Non-blocking read (waitForData() does the waiting)
     options.c_cc[VMIN] = 0;
     options.c_cc[VTIME] = 0;
     
     tcsetattr(fd, TCSANOW, &options);
     
-    LOGC("Serial port opened: ", portName.toStdString());
+    if (!standardRate && !setCustomBaudRate(fd, baudRate))
+    {
+        LOGC("Baud rate ", baudRate, " is not supported on ", portName.toStdString());
+        close();
+        return false;
+    }
+    
+#ifdef __linux__
+    // Ask the driver to push received bytes to the tty immediately instead
+    // of batching them on a timer. Not every device supports it (USB CDC
+    // and pseudo-terminals don't), so failure is ignored.
+    struct serial_struct serialInfo;
+    if (ioctl(fd, TIOCGSERIAL, &serialInfo) == 0)
+    {
+        serialInfo.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &serialInfo);
+    }
+#endif
+    
+    LOGC("Serial port opened: ", portName.toStdString(), " at ", baudRate, " baud");
     return true;
 }
 
@@ -260,7 +358,18 @@ bool SerialPort::isOpen() const
 int SerialPort::read(uint8_t* buffer, int maxBytes)
 {
     if (!isOpen()) return -1;
-    return (int)::read(fd, buffer, maxBytes);
+    
+    ssize_t n = ::read(fd, buffer, maxBytes);
+    
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return 0;
+    
+    // Readable but empty means the device hung up (e.g. was unplugged)
+    if (n == 0 && dataReady && maxBytes > 0)
+        n = -1;
+    
+    dataReady = false;
+    return (int)n;
 }
 
 int SerialPort::write(const uint8_t* data, int numBytes)
@@ -269,6 +378,33 @@ int SerialPort::write(const uint8_t* data, int numBytes)
     return (int)::write(fd, data, numBytes);
 }
 
+bool SerialPort::waitForData(int timeoutMs)
+{
+    if (!isOpen()) return false;
+    
+#ifdef __APPLE__
+    // poll() does not support character devices on macOS
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
+    
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    
+    dataReady = select(fd + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+#else
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    
+    dataReady = ::poll(&pfd, 1, timeoutMs) > 0;
+#endif
+    
+    return dataReady;
+}
+
 int SerialPort::available()
 {
     if (!isOpen()) return 0;
@@ -310,153 +446,6 @@ StringArray SerialPort::getAvailablePorts()
 
 #endif
 
-// ============================================================================
-// ProtocolParser Implementation
-// ============================================================================
-
-ProtocolParser::ProtocolParser()
-{
-    buffer.reserve(MAX_BUFFER_SIZE);
-}
-
-void ProtocolParser::configure(int channels, int bytes, float scale)
-{
-    numChannels = channels;
-    bytesPerSample = bytes;
-    scaleFactor = scale;
-}
-
-void ProtocolParser::setSyncBytes(uint8_t sync1, uint8_t sync2)
-{
-    syncByte1 = sync1;
-    syncByte2 = sync2;
-}
-
-int ProtocolParser::getPacketSize() const
-{
-    // Sync(2) + Data(channels * bytesPerSample) + Checksum(1)
-    return 2 + (numChannels * bytesPerSample) + (useChecksum ? 1 : 0);
-}
-
-void ProtocolParser::reset()
-{
-    buffer.clear();
-}
-
-std::vector<DataPacket> ProtocolParser::parse(const uint8_t* data, int numBytes)
-{
-    std::vector<DataPacket> packets;
-    
-    // Add new data to buffer
-    for (int i = 0; i < numBytes; i++)
-    {
-        buffer.push_back(data[i]);
-        if (buffer.size() > MAX_BUFFER_SIZE)
-            buffer.erase(buffer.begin());
-    }
-    
-    int packetSize = getPacketSize();
-    
-    // Search for complete packets
-    while (buffer.size() >= (size_t)packetSize)
-    {
-        // Look for sync bytes
-        bool foundSync = false;
-        size_t syncPos = 0;
-        
-        for (size_t i = 0; i <= buffer.size() - packetSize; i++)
-        {
-            if (buffer[i] == syncByte1 && buffer[i + 1] == syncByte2)
-            {
-                foundSync = true;
-                syncPos = i;
-                break;
-            }
-        }
-        
-        if (!foundSync)
-        {
-            // No sync found, keep last few bytes
-            if (buffer.size() > 2)
-                buffer.erase(buffer.begin(), buffer.end() - 2);
-            break;
-        }
-        
-        // Remove bytes before sync
-        if (syncPos > 0)
-            buffer.erase(buffer.begin(), buffer.begin() + syncPos);
-        
-        if (buffer.size() < (size_t)packetSize)
-            break;
-        
-        // Validate checksum if enabled
-        if (useChecksum && !validateChecksum(buffer.data(), packetSize))
-        {
-            // Bad checksum, skip this sync and try next
-            buffer.erase(buffer.begin());
-            continue;
-        }
-        
-        // Parse samples
-        DataPacket packet;
-        packet.samples.resize(numChannels);
-        packet.valid = true;
-        packet.timestamp = 0;
-        
-        const uint8_t* samplePtr = buffer.data() + 2; // Skip sync bytes
-        
-        for (int ch = 0; ch < numChannels; ch++)
-        {
-            packet.samples[ch] = bytesToSample(samplePtr, bytesPerSample);
-            samplePtr += bytesPerSample;
-        }
-        
-        packets.push_back(packet);
-        
-        // Remove processed packet
-        buffer.erase(buffer.begin(), buffer.begin() + packetSize);
-    }
-    
-    return packets;
-}
-
-float ProtocolParser::bytesToSample(const uint8_t* bytes, int numBytes)
-{
-    int32_t rawValue = 0;
-    
-    switch (numBytes)
-    {
-        case 2: // int16 big-endian
-            rawValue = (int16_t)((bytes[0] << 8) | bytes[1]);
-            break;
-            
-        case 3: // int24 big-endian (sign-extend)
-            rawValue = (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
-            if (rawValue & 0x800000)
-                rawValue |= 0xFF000000; // Sign extend
-            break;
-            
-        case 4: // int32 or float32 big-endian
-            rawValue = (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
-            break;
-            
-        default:
-            return 0.0f;
-    }
-    
-    return rawValue * scaleFactor;
-}
-
-bool ProtocolParser::validateChecksum(const uint8_t* packet, int size)
-{
-    // Simple XOR checksum
-    uint8_t checksum = 0;
-    for (int i = 0; i < size - 1; i++)
-        checksum ^= packet[i];
-    
-    return checksum == packet[size - 1];
-}
-
 } // namespace CustomIC
 
 // ============================================================================
@@ -473,19 +462,11 @@ CustomICThread::CustomICThread(SourceNode* sn)
 {
     serial = std::make_unique<CustomIC::SerialPort>();
     parser = std::make_unique<CustomIC::ProtocolParser>();
-    readBuffer.resize(READ_BUFFER_SIZE);
     
     // Allocate buffers
     sourceBuffers.add(new DataBuffer(numChannels, 100000));
     
     dataBuffer = (float*) malloc(numChannels * bufferSize * sizeof(float));
-    timestampBuffer = (double*) malloc(bufferSize * sizeof(double));
-    sampleNumbers = (int64*) malloc(bufferSize * sizeof(int64));
-    ttlEventWords = (uint64*) malloc(bufferSize * sizeof(uint64));
-    
-    // Initialize TTL buffer
-    for (int i = 0; i < bufferSize; i++)
-        ttlEventWords[i] = 0;
     
     // Default configuration (8 channels @ 256 Hz, 16-bit samples)
     parser->configure(numChannels, bytesPerSample, scaleFactor);
@@ -496,9 +477,6 @@ CustomICThread::~CustomICThread()
     disconnect();
     
     free(dataBuffer);
-    free(timestampBuffer);
-    free(sampleNumbers);
-    free(ttlEventWords);
 }
 
 void CustomICThread::registerParameters()
@@ -518,9 +496,9 @@ void CustomICThread::registerParameters()
     addStringParameter(Parameter::PROCESSOR_SCOPE, "port", "Port",
         "Serial port name (e.g., COM3)", "");
     
-    Array<String> baudRates = {"9600", "19200", "38400", "57600", "115200", "230400", "460800", "921600"};
-    addCategoricalParameter(Parameter::PROCESSOR_SCOPE, "baud_rate", "Baud Rate",
-        "Serial communication baud rate", baudRates, 4); // Default: 115200
+    // Any rate the port accepts, not just the editor's list, so typed rates are saved too
+    addIntParameter(Parameter::PROCESSOR_SCOPE, "baud_rate", "Baud Rate",
+        "Serial communication baud rate", 115200, 0, 12000000);
     
     // Data format configuration
     Array<String> dataFormats = {"int16", "int24", "int32"};
@@ -563,8 +541,13 @@ void CustomICThread::parameterValueChanged(Parameter* param)
     }
     else if (param->getName() == "baud_rate")
     {
-        String baudStr = ((CategoricalParameter*)param)->getValueAsString();
-        baudRate = baudStr.getIntValue();
+        baudRate = (int)param->getValue();
+
+        // Older settings stored an index into this list of rates
+        const int listedRates[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600,
+                                   1000000, 1500000, 2000000, 3000000};
+        if (baudRate < numElementsInArray(listedRates))
+            baudRate = listedRates[baudRate];
     }
     else if (param->getName() == "data_format")
     {
@@ -609,6 +592,8 @@ void CustomICThread::setPort(const String& port)
 void CustomICThread::setBaudRate(int rate)
 {
     baudRate = rate;
+    if (hasParameter("baud_rate"))
+        getParameter("baud_rate")->setNextValue(rate);
 }
 
 void CustomICThread::setNumChannels(int num)
@@ -652,7 +637,18 @@ void CustomICThread::setSimulationMode(bool simulate)
 
 StringArray CustomICThread::getAvailablePorts() const
 {
-    return CustomIC::SerialPort::getAvailablePorts();
+    StringArray ports = CustomIC::SerialPort::getAvailablePorts();
+    
+#ifndef _WIN32
+    ports.add(CustomIC::PseudoTerminalDevice::PORT_NAME);
+#endif
+    
+    return ports;
+}
+
+double CustomICThread::getRequiredBytesPerSecond() const
+{
+    return parser->getPacketSize() * (double)sampleRate;
 }
 
 bool CustomICThread::isConnected() const
@@ -675,7 +671,24 @@ bool CustomICThread::connect()
         return false;
     }
     
-    if (!serial->open(portName, baudRate))
+    String devicePath = portName;
+    
+    if (portName == CustomIC::PseudoTerminalDevice::PORT_NAME)
+    {
+        loopbackDevice = std::make_unique<CustomIC::PseudoTerminalDevice>();
+        loopbackDevice->configure(numChannels, bytesPerSample, scaleFactor, sampleRate,
+                                  parser->getSyncByte1(), parser->getSyncByte2());
+        
+        if (!loopbackDevice->open())
+        {
+            loopbackDevice.reset();
+            return false;
+        }
+        
+        devicePath = loopbackDevice->getSlaveName();
+    }
+    
+    if (!serial->open(devicePath, baudRate))
     {
         LOGC("Failed to open port: ", portName.toStdString());
         return false;
@@ -696,6 +709,8 @@ void CustomICThread::disconnect()
     if (serial && serial->isOpen())
         serial->close();
     
+    loopbackDevice.reset();
+    
     if (parser)
         parser->reset();
 }
@@ -729,6 +744,11 @@ bool CustomICThread::startAcquisition()
     if (parser)
         parser->reset();
     
+    readLatency.reset();
+    bytesReceived = 0;
+    packetsReceived = 0;
+    checksumFailures = 0;
+    
     startThread();
     return true;
 }
@@ -745,6 +765,9 @@ bool CustomICThread::stopAcquisition()
         stopThread(500);
     }
     
+    if (readLatency.getCount() > 0)
+        LOGC("Custom IC read-to-buffer latency: ", readLatency.getSummary().toStdString());
+    
     sourceBuffers[0]->clear();
     return true;
 }
@@ -812,58 +835,68 @@ bool CustomICThread::updateBuffer()
     if (!serial || !serial->isOpen())
         return false;
     
-    int bytesRead = serial->read(readBuffer.data(), READ_BUFFER_SIZE);
+    // Block until the device has sent something, rather than polling
+    if (!serial->waitForData(READ_TIMEOUT_MS))
+        return true;
+    
+    const int64 readyTicks = Time::getHighResolutionTicks();
+    
+    // Drain everything the driver holds, up to the free parser space
+    int space = 0;
+    uint8_t* writePtr = parser->getWriteBuffer(space);
+    int bytesRead = serial->read(writePtr, space);
+    
+    if (bytesRead < 0)
+    {
+        LOGE("Custom IC: serial read failed on ", portName.toStdString());
+        return false;
+    }
     
     if (bytesRead > 0)
     {
-        // Parse data packets
-        auto packets = parser->parse(readBuffer.data(), bytesRead);
+        parser->commitWrite(bytesRead);
+        bytesReceived += bytesRead;
         
-        int numPackets = (int)packets.size();
-        if (numPackets > 0)
+        // Decode packets straight into the channel-major buffer
+        int numPackets;
+        bool addedSamples = false;
+        
+        while ((numPackets = parser->parse(dataBuffer, bufferSize)) > 0)
         {
-            // Prepare buffers
-            for (int i = 0; i < numPackets; i++)
-            {
-                const auto& packet = packets[i];
-                if (!packet.valid)
-                    continue;
-                
-                // Copy samples to channel-major buffer
-                for (int ch = 0; ch < numChannels; ch++)
-                {
-                    dataBuffer[ch * numPackets + i] = packet.samples[ch];
-                }
-                
-                sampleNumbers[i] = totalSamples + i;
-                
-                // Calculate timestamp
-                double timestamp = (double)(totalSamples + i) / sampleRate;
-                if (initialTimestamp < 0)
-                    initialTimestamp = timestamp;
-                timestampBuffer[i] = timestamp - initialTimestamp;
-                
-                ttlEventWords[i] = 0;
-            }
-            
-            // Add to buffer
-            sourceBuffers[0]->addToBuffer(
-                dataBuffer,
-                sampleNumbers,
-                timestampBuffer,
-                ttlEventWords,
-                numPackets);
+            addSamplesToBuffer(numPackets);
             
             totalSamples += numPackets;
+            packetsReceived += numPackets;
+            addedSamples = true;
         }
+        
+        checksumFailures = parser->getNumChecksumFailures();
+        
+        if (addedSamples)
+            readLatency.add(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - readyTicks));
     }
     
-    // Small sleep to avoid busy-waiting
-    sleep(1);
-    
     return true;
 }
 
+void CustomICThread::addSamplesToBuffer(int numSamples)
+{
+    // Samples are evenly spaced, so the block's first and last timestamps describe it
+    double firstTimestamp = (double)totalSamples / sampleRate;
+    if (initialTimestamp < 0)
+        initialTimestamp = firstTimestamp;
+    
+    double lastTimestamp = (double)(totalSamples + numSamples - 1) / sampleRate;
+    
+    sourceBuffers[0]->addToBuffer(
+        dataBuffer,
+        totalSamples,
+        firstTimestamp - initialTimestamp,
+        lastTimestamp - initialTimestamp,
+        0,
+        numSamples);
+}
+
 void CustomICThread::generateSimulatedData()
 {
     // Generate simulated neural-like data
@@ -886,27 +919,13 @@ void CustomICThread::generateSimulatedData()
                                   noise);
         }
         
-        sampleNumbers[s] = totalSamples + s;
-        
-        double timestamp = (double)(totalSamples + s) / sampleRate;
-        if (initialTimestamp < 0)
-            initialTimestamp = timestamp;
-        timestampBuffer[s] = timestamp - initialTimestamp;
-        
-        ttlEventWords[s] = 0;
-        
         simPhase += dt;
     }
     
-    // Add to buffer
-    sourceBuffers[0]->addToBuffer(
-        dataBuffer,
-        sampleNumbers,
-        timestampBuffer,
-        ttlEventWords,
-        samplesPerUpdate);
+    addSamplesToBuffer(samplesPerUpdate);
     
     totalSamples += samplesPerUpdate;
+    packetsReceived += samplesPerUpdate;
     
     // Sleep to match real-time
     sleep(10);
@@ -13,6 +13,9 @@
 #define CUSTOM_IC_THREAD_H
 
 #include <DataThreadHeaders.h>
+#include "ProtocolParser.h"
+#include "PseudoTerminalDevice.h"
+#include "LatencyHistogram.h"
 #include <atomic>
 #include <vector>
 #include <string>
@@ -25,6 +28,7 @@
     #include <fcntl.h>
     #include <unistd.h>
     #include <sys/ioctl.h>
+    #include <poll.h>
 #endif
 
 namespace CustomIC {
@@ -53,6 +57,12 @@ public:
     /** Write data to port */
     int write(const uint8_t* data, int numBytes);
     
+    /**
+     * Wait until data can be read, or the timeout expires. Returns false
+     * on timeout. On Windows the wait happens inside read() instead.
+     */
+    bool waitForData(int timeoutMs);
+    
     /** Get available bytes */
     int available();
     
@@ -65,63 +75,13 @@ public:
 private:
 #ifdef _WIN32
     HANDLE handle = INVALID_HANDLE_VALUE;
+    int readTimeoutMs = 0;
 #else
     int fd = -1;
+    bool dataReady = false;  // Last waitForData() saw the port readable
 #endif
 };
 
-/**
- * Data packet structure for parsed samples
- */
-struct DataPacket
-{
-    std::vector<float> samples;  // One sample per channel
-    int64 timestamp;             // Hardware timestamp if available
-    bool valid;
-};
-
-/**
- * Protocol parser for custom IC data format
- */
-class ProtocolParser
-{
-public:
-    ProtocolParser();
-    virtual ~ProtocolParser() = default;
-    
-    /** Configure parser parameters */
-    void configure(int numChannels, int bytesPerSample, float scaleFactor);
-    
-    /** Set sync bytes for packet detection */
-    void setSyncBytes(uint8_t sync1, uint8_t sync2);
-    
-    /** Process incoming bytes and extract packets */
-    virtual std::vector<DataPacket> parse(const uint8_t* data, int numBytes);
-    
-    /** Reset parser state */
-    virtual void reset();
-    
-    /** Get expected packet size */
-    int getPacketSize() const;
-
-protected:
-    /** Convert raw bytes to sample value */
-    virtual float bytesToSample(const uint8_t* bytes, int numBytes);
-    
-    /** Validate packet checksum */
-    virtual bool validateChecksum(const uint8_t* packet, int size);
-
-    int numChannels = 8;
-    int bytesPerSample = 2;
-    float scaleFactor = 0.195f;
-    uint8_t syncByte1 = 0xA0;
-    uint8_t syncByte2 = 0x5A;
-    bool useChecksum = true;
-    
-    std::vector<uint8_t> buffer;
-    static const int MAX_BUFFER_SIZE = 65536;
-};
-
 } // namespace CustomIC
 
 
@@ -176,6 +136,20 @@ public:
     bool isSimulating() const { return simulationMode; }
     bool isConnected() const;
     
+    /** Time from serial data becoming readable to its samples reaching the buffer */
+    const CustomIC::LatencyHistogram& getReadLatency() const { return readLatency; }
+    
+    /** Link totals since acquisition started, for the throughput display */
+    int64 getBytesReceived() const { return bytesReceived.load(); }
+    int64 getPacketsReceived() const { return packetsReceived.load(); }
+    int64 getChecksumFailures() const { return checksumFailures.load(); }
+    
+    /** Bytes per second the configured channels, format and rate need */
+    double getRequiredBytesPerSecond() const;
+    
+    /** Bytes per second the configured baud rate can carry (8N1) */
+    double getLinkBytesPerSecond() const { return baudRate / 10.0; }
+    
     StringArray getAvailablePorts() const;
     
     bool connect();
@@ -199,14 +173,13 @@ private:
     // Protocol parser
     std::unique_ptr<CustomIC::ProtocolParser> parser;
     
-    // Buffers
-    std::vector<uint8_t> readBuffer;
-    static const int READ_BUFFER_SIZE = 4096;
+    // Simulated device for the loopback port (POSIX only)
+    std::unique_ptr<CustomIC::PseudoTerminalDevice> loopbackDevice;
+    
+    // Buffers (serial data is read straight into the parser)
+    static const int READ_TIMEOUT_MS = 100;
     
     float* dataBuffer;
-    double* timestampBuffer;
-    int64* sampleNumbers;
-    uint64* ttlEventWords;
     int bufferSize = 1024;
     
     // Simulation mode
@@ -215,8 +188,15 @@ private:
     int64 totalSamples = 0;
     double initialTimestamp = -1.0;
     
+    /** Adds numSamples decoded samples to the DataBuffer as one block */
+    void addSamplesToBuffer(int numSamples);
+    
     // Status
     std::atomic<bool> connected{false};
+    CustomIC::LatencyHistogram readLatency;
+    std::atomic<int64> bytesReceived{0};
+    std::atomic<int64> packetsReceived{0};
+    std::atomic<int64> checksumFailures{0};
     
     void generateSimulatedData();
 };
@@ -0,0 +1,101 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Histogram of acquisition latencies.
+
+    ------------------------------------------------------------------
+*/
+
+#ifndef CUSTOM_IC_LATENCY_HISTOGRAM_H
+#define CUSTOM_IC_LATENCY_HISTOGRAM_H
+
+#include <JuceHeader.h>
+#include <atomic>
+
+namespace CustomIC {
+
+/**
+ * Latency histogram with power-of-two microsecond buckets.
+ * 
+ * Bucket 0 holds latencies under 1 us and bucket i those in
+ * [2^(i-1), 2^i) us. add() is lock-free, so it can be called on the
+ * acquisition thread while the editor reads the statistics.
+ */
+class LatencyHistogram
+{
+public:
+    static const int NUM_BUCKETS = 24;  // Last bucket collects everything from ~4 s
+    
+    LatencyHistogram() { reset(); }
+    
+    /** Record one latency */
+    void add(double seconds)
+    {
+        const int64 micros = (int64)(seconds * 1.0e6);
+        int bucket = 0;
+        
+        while (bucket < NUM_BUCKETS - 1 && ((int64)1 << bucket) <= micros)
+            bucket++;
+        
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        
+        int64 previousMax = maxMicros.load(std::memory_order_relaxed);
+        while (micros > previousMax && !maxMicros.compare_exchange_weak(previousMax, micros, std::memory_order_relaxed))
+        {
+        }
+    }
+    
+    /** Clear all counts */
+    void reset()
+    {
+        for (auto& bucket : buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        
+        count.store(0, std::memory_order_relaxed);
+        maxMicros.store(0, std::memory_order_relaxed);
+    }
+    
+    /** Number of latencies recorded */
+    int64 getCount() const { return count.load(std::memory_order_relaxed); }
+    
+    /** Largest latency recorded, in microseconds */
+    int64 getMaxMicros() const { return maxMicros.load(std::memory_order_relaxed); }
+    
+    /** Upper bound, in microseconds, of the bucket holding a percentile (0-1) */
+    int64 getPercentileMicros(double fraction) const
+    {
+        const int64 total = getCount();
+        const int64 target = (int64)std::ceil(fraction * (double)total);
+        int64 seen = 0;
+        
+        for (int i = 0; i < NUM_BUCKETS; i++)
+        {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            
+            if (total > 0 && seen >= target)
+                return (int64)1 << i;
+        }
+        
+        return getMaxMicros();
+    }
+    
+    /** One-line summary for logging */
+    String getSummary() const
+    {
+        return String(getCount()) + " reads, p50 < " + String(getPercentileMicros(0.5))
+            + " us, p99 < " + String(getPercentileMicros(0.99))
+            + " us, max " + String(getMaxMicros()) + " us";
+    }
+
+private:
+    std::atomic<int64> buckets[NUM_BUCKETS];
+    std::atomic<int64> count;
+    std::atomic<int64> maxMicros;
+};
+
+} // namespace CustomIC
+
+#endif // CUSTOM_IC_LATENCY_HISTOGRAM_H
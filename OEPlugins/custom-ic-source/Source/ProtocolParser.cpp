@@ -0,0 +1,225 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Packet parser for the custom IC serial protocol.
+
+    ------------------------------------------------------------------
+*/
+
+#include "ProtocolParser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace CustomIC {
+
+namespace {
+
+/** Decodes numChannels big-endian samples of Bytes bytes each */
+template <int Bytes>
+void decodeBigEndian(const uint8_t* src, float* dest, int destStride, int numChannels, float scale)
+{
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        int32_t rawValue;
+        
+        if (Bytes == 2)
+            rawValue = (int16_t)((src[0] << 8) | src[1]);
+        else if (Bytes == 3)
+            rawValue = (int32_t)(((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8)) >> 8;
+        else
+            rawValue = (int32_t)(((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | src[3]);
+        
+        dest[ch * destStride] = rawValue * scale;
+        src += Bytes;
+    }
+}
+
+} // namespace
+
+ProtocolParser::ProtocolParser()
+{
+    buffer.resize(MAX_BUFFER_SIZE);
+    configure(numChannels, bytesPerSample, scaleFactor);
+}
+
+void ProtocolParser::configure(int channels, int bytes, float scale)
+{
+    numChannels = channels;
+    bytesPerSample = bytes;
+    scaleFactor = scale;
+    
+    // Enough for a buffer full of packets
+    packetOffsets.resize(MAX_BUFFER_SIZE / getPacketSize() + 1);
+}
+
+void ProtocolParser::setSyncBytes(uint8_t sync1, uint8_t sync2)
+{
+    syncByte1 = sync1;
+    syncByte2 = sync2;
+}
+
+int ProtocolParser::getPacketSize() const
+{
+    // Sync(2) + Data(channels * bytesPerSample) + Checksum(1)
+    return 2 + (numChannels * bytesPerSample) + (useChecksum ? 1 : 0);
+}
+
+void ProtocolParser::reset()
+{
+    readPos = 0;
+    writePos = 0;
+    numChecksumFailures = 0;
+}
+
+uint8_t* ProtocolParser::getWriteBuffer(int& numBytes)
+{
+    const size_t packetSize = (size_t)getPacketSize();
+    
+    if (buffer.size() - writePos < packetSize)
+    {
+        // Move the unparsed tail to the front
+        std::memmove(buffer.data(), buffer.data() + readPos, writePos - readPos);
+        writePos -= readPos;
+        readPos = 0;
+        
+        // Still full (nothing has been parsed): drop the oldest half and resync
+        if (buffer.size() - writePos < packetSize)
+        {
+            size_t drop = writePos / 2;
+            std::memmove(buffer.data(), buffer.data() + drop, writePos - drop);
+            writePos -= drop;
+        }
+    }
+    
+    numBytes = (int)(buffer.size() - writePos);
+    return buffer.data() + writePos;
+}
+
+void ProtocolParser::commitWrite(int numBytes)
+{
+    writePos = std::min(buffer.size(), writePos + (size_t)std::max(0, numBytes));
+}
+
+void ProtocolParser::write(const uint8_t* data, int numBytes)
+{
+    while (numBytes > 0)
+    {
+        int space = 0;
+        uint8_t* dest = getWriteBuffer(space);
+        int n = std::min(space, numBytes);
+        
+        std::memcpy(dest, data, (size_t)n);
+        commitWrite(n);
+        
+        data += n;
+        numBytes -= n;
+    }
+}
+
+int ProtocolParser::findPackets(int maxPackets)
+{
+    const uint8_t* base = buffer.data();
+    const size_t packetSize = (size_t)getPacketSize();
+    size_t pos = readPos;
+    int numPackets = 0;
+    
+    while (numPackets < maxPackets && writePos - pos >= packetSize)
+    {
+        const uint8_t* p = base + pos;
+        
+        if (p[0] != syncByte1 || p[1] != syncByte2)
+        {
+            // Jump to the next candidate sync byte
+            auto* next = static_cast<const uint8_t*>(std::memchr(p + 1, syncByte1, writePos - pos - 1));
+            
+            if (next == nullptr)
+            {
+                pos = writePos;
+                break;
+            }
+            
+            pos = (size_t)(next - base);
+            continue;
+        }
+        
+        // Validate checksum if enabled
+        if (useChecksum && !validateChecksum(p, (int)packetSize))
+        {
+            // Bad checksum, skip this sync and try next
+            numChecksumFailures++;
+            pos++;
+            continue;
+        }
+        
+        packetOffsets[numPackets++] = pos;
+        pos += packetSize;
+    }
+    
+    readPos = pos;
+    return numPackets;
+}
+
+int ProtocolParser::parse(float* dest, int maxPackets)
+{
+    // Locate the packets first so the channel stride is known, then decode.
+    // The packets stay in place until the next getWriteBuffer().
+    const int numPackets = findPackets(std::min(maxPackets, (int)packetOffsets.size()));
+    
+    for (int i = 0; i < numPackets; i++)
+        decodePacket(buffer.data() + packetOffsets[i] + 2, dest + i, numPackets);
+    
+    return numPackets;
+}
+
+void ProtocolParser::decodePacket(const uint8_t* payload, float* dest, int destStride)
+{
+    switch (bytesPerSample)
+    {
+        case 2: // int16 big-endian
+            decodeBigEndian<2>(payload, dest, destStride, numChannels, scaleFactor);
+            break;
+            
+        case 3: // int24 big-endian (sign-extended)
+            decodeBigEndian<3>(payload, dest, destStride, numChannels, scaleFactor);
+            break;
+            
+        case 4: // int32 big-endian
+            decodeBigEndian<4>(payload, dest, destStride, numChannels, scaleFactor);
+            break;
+            
+        default:
+            for (int ch = 0; ch < numChannels; ch++)
+                dest[ch * destStride] = 0.0f;
+            break;
+    }
+}
+
+bool ProtocolParser::validateChecksum(const uint8_t* packet, int size)
+{
+    // Simple XOR checksum, folded from 8 bytes at a time
+    const int numBytes = size - 1;
+    uint64_t wordChecksum = 0;
+    int i = 0;
+    
+    for (; i + 8 <= numBytes; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, packet + i, sizeof(word));
+        wordChecksum ^= word;
+    }
+    
+    wordChecksum ^= wordChecksum >> 32;
+    wordChecksum ^= wordChecksum >> 16;
+    wordChecksum ^= wordChecksum >> 8;
+    
+    uint8_t checksum = (uint8_t)wordChecksum;
+    for (; i < numBytes; i++)
+        checksum ^= packet[i];
+    
+    return checksum == packet[size - 1];
+}
+
+} // namespace CustomIC
@@ -0,0 +1,111 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Packet parser for the custom IC serial protocol.
+
+    ------------------------------------------------------------------
+*/
+
+#ifndef CUSTOM_IC_PROTOCOL_PARSER_H
+#define CUSTOM_IC_PROTOCOL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CustomIC {
+
+/**
+ * Protocol parser for custom IC data format
+ * 
+ * Packets are [SYNC1][SYNC2][samples...][CHECKSUM]. Incoming bytes are
+ * read straight into a fixed-capacity receive buffer (getWriteBuffer /
+ * commitWrite), and parse() decodes every complete packet in it directly
+ * into a channel-major sample array. The buffer is compacted rather than
+ * wrapped, so packets are always contiguous; only the unparsed tail
+ * (less than one packet) is ever moved. No memory is allocated after
+ * configure().
+ */
+class ProtocolParser
+{
+public:
+    ProtocolParser();
+    virtual ~ProtocolParser() = default;
+    
+    /** Configure parser parameters */
+    void configure(int numChannels, int bytesPerSample, float scaleFactor);
+    
+    /** Set sync bytes for packet detection */
+    void setSyncBytes(uint8_t sync1, uint8_t sync2);
+    
+    /** Returns space for at least one packet of new bytes, and its size */
+    uint8_t* getWriteBuffer(int& numBytes);
+    
+    /** Marks bytes written to getWriteBuffer() as received */
+    void commitWrite(int numBytes);
+    
+    /** Copies received bytes into the buffer */
+    void write(const uint8_t* data, int numBytes);
+    
+    /**
+     * Decodes up to maxPackets complete packets into dest, channel-major
+     * with the packet count as stride: dest[channel * numPackets + packet].
+     * Returns numPackets.
+     */
+    int parse(float* dest, int maxPackets);
+    
+    /** Reset parser state */
+    virtual void reset();
+    
+    /** Get expected packet size */
+    int getPacketSize() const;
+    
+    /** Sync bytes that start each packet */
+    uint8_t getSyncByte1() const { return syncByte1; }
+    uint8_t getSyncByte2() const { return syncByte2; }
+    
+    /** Number of channels per packet */
+    int getNumChannels() const { return numChannels; }
+    
+    /** Bytes received but not yet parsed */
+    int getNumBuffered() const { return (int)(writePos - readPos); }
+    
+    /** Candidate packets rejected by the checksum since the last reset() */
+    int64_t getNumChecksumFailures() const { return numChecksumFailures; }
+
+protected:
+    /** Decode one packet's samples (after the sync bytes) into dest[channel * destStride] */
+    virtual void decodePacket(const uint8_t* payload, float* dest, int destStride);
+    
+    /** Validate packet checksum */
+    virtual bool validateChecksum(const uint8_t* packet, int size);
+
+    int numChannels = 8;
+    int bytesPerSample = 2;
+    float scaleFactor = 0.195f;
+    uint8_t syncByte1 = 0xA0;
+    uint8_t syncByte2 = 0x5A;
+    bool useChecksum = true;
+    
+    static const int MAX_BUFFER_SIZE = 65536;
+
+private:
+    /** Finds the offsets of up to maxPackets valid packets and consumes them */
+    int findPackets(int maxPackets);
+    
+    // Received bytes; [readPos, writePos) is unparsed
+    std::vector<uint8_t> buffer;
+    size_t readPos = 0;
+    size_t writePos = 0;
+    
+    // Offsets of the packets found by the current parse()
+    std::vector<size_t> packetOffsets;
+    
+    int64_t numChecksumFailures = 0;
+};
+
+} // namespace CustomIC
+
+#endif // CUSTOM_IC_PROTOCOL_PARSER_H
@@ -0,0 +1,205 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Simulated custom IC on a pseudo-terminal pair.
+
+    ------------------------------------------------------------------
+*/
+
+#include "PseudoTerminalDevice.h"
+#include <cmath>
+
+#ifndef _WIN32
+    #include <termios.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <stdlib.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace CustomIC {
+
+const char* const PseudoTerminalDevice::PORT_NAME = "Loopback (pty)";
+
+PseudoTerminalDevice::PseudoTerminalDevice()
+    : Thread("Custom IC pty device")
+{
+}
+
+PseudoTerminalDevice::~PseudoTerminalDevice()
+{
+    close();
+}
+
+void PseudoTerminalDevice::configure(int channels, int bytes, float scale, float rate,
+                                     uint8_t sync1, uint8_t sync2)
+{
+    jassert(!isThreadRunning());
+    
+    numChannels = channels;
+    bytesPerSample = bytes;
+    scaleFactor = scale;
+    sampleRate = rate;
+    syncByte1 = sync1;
+    syncByte2 = sync2;
+    
+    packets.resize((size_t)MAX_PACKETS_PER_WRITE * (size_t)(3 + numChannels * bytesPerSample));
+}
+
+#ifdef _WIN32
+
+bool PseudoTerminalDevice::open()
+{
+    LOGC("Pseudo-terminal loopback is not available on Windows");
+    return false;
+}
+
+void PseudoTerminalDevice::close()
+{
+}
+
+void PseudoTerminalDevice::run()
+{
+}
+
+#else
+
+bool PseudoTerminalDevice::open()
+{
+    close();
+    
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0)
+    {
+        LOGC("Failed to create pseudo-terminal pair");
+        close();
+        return false;
+    }
+    
+    slaveName = String(ptsname(masterFd));
+    
+    // Hold the slave open ourselves so writes to the master never see a
+    // hang-up, and make it raw before any packet goes through it
+    slaveFd = ::open(slaveName.toRawUTF8(), O_RDWR | O_NOCTTY);
+    
+    if (slaveFd < 0)
+    {
+        LOGC("Failed to open pseudo-terminal: ", slaveName.toStdString());
+        close();
+        return false;
+    }
+    
+    struct termios options;
+    tcgetattr(slaveFd, &options);
+    cfmakeraw(&options);
+    tcsetattr(slaveFd, TCSANOW, &options);
+    
+    // A reader that falls behind makes packets drop, as with a real UART
+    fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+    
+    startThread();
+    
+    LOGC("Pseudo-terminal device on ", slaveName.toStdString());
+    return true;
+}
+
+void PseudoTerminalDevice::close()
+{
+    stopThread(1000);
+    
+    if (slaveFd >= 0)
+    {
+        ::close(slaveFd);
+        slaveFd = -1;
+    }
+    
+    if (masterFd >= 0)
+    {
+        ::close(masterFd);
+        masterFd = -1;
+    }
+    
+    slaveName = String();
+}
+
+void PseudoTerminalDevice::run()
+{
+    const int packetSize = 3 + numChannels * bytesPerSample;
+    const double startTime = Time::getMillisecondCounterHiRes();
+    int64 packetsWritten = 0;
+    
+    while (!threadShouldExit())
+    {
+        const int64 due = (int64)((Time::getMillisecondCounterHiRes() - startTime) * 0.001 * sampleRate);
+        
+        // After a stall, skip ahead rather than bursting the whole backlog
+        if (due - packetsWritten > MAX_PACKETS_PER_WRITE)
+            packetsWritten = due - MAX_PACKETS_PER_WRITE;
+        
+        const int numPackets = (int)(due - packetsWritten);
+        
+        if (numPackets > 0)
+        {
+            for (int i = 0; i < numPackets; i++)
+                encodePacket(packetsWritten + i, packets.data() + (size_t)i * packetSize);
+            
+            const size_t numBytes = (size_t)numPackets * packetSize;
+            size_t written = 0;
+            
+            while (written < numBytes)
+            {
+                const ssize_t n = ::write(masterFd, packets.data() + written, numBytes - written);
+                
+                if (n <= 0)
+                    break; // Terminal buffer full: the rest is lost
+                
+                written += (size_t)n;
+            }
+            
+            packetsWritten += numPackets;
+        }
+        
+        wait(1);
+    }
+}
+
+#endif
+
+void PseudoTerminalDevice::encodePacket(int64 sampleIndex, uint8_t* dest) const
+{
+    const double t = (double)sampleIndex / sampleRate;
+    const double fullScale = (double)(((int64)1 << (bytesPerSample * 8 - 1)) - 1);
+    
+    uint8_t* p = dest;
+    *p++ = syncByte1;
+    *p++ = syncByte2;
+    
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        // Same mix of rhythms as the built-in simulation mode, in microvolts
+        const double alpha = 50.0 * std::sin(2.0 * M_PI * 10.0 * t);
+        const double beta = 20.0 * std::sin(2.0 * M_PI * 20.0 * t);
+        const double phaseOffset = ch * 0.1;
+        const double microvolts = alpha * std::cos(phaseOffset) + beta * std::sin(phaseOffset);
+        
+        const int32_t raw = (int32_t)jlimit(-fullScale, fullScale, std::round(microvolts / scaleFactor));
+        
+        // Big-endian, most significant byte first
+        for (int b = bytesPerSample - 1; b >= 0; b--)
+            *p++ = (uint8_t)((uint32_t)raw >> (b * 8));
+    }
+    
+    uint8_t checksum = 0;
+    for (const uint8_t* q = dest; q < p; q++)
+        checksum ^= *q;
+    
+    *p = checksum;
+}
+
+} // namespace CustomIC
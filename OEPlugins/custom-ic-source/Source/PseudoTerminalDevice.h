@@ -0,0 +1,75 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Simulated custom IC on a pseudo-terminal pair.
+
+    ------------------------------------------------------------------
+*/
+
+#ifndef CUSTOM_IC_PSEUDO_TERMINAL_DEVICE_H
+#define CUSTOM_IC_PSEUDO_TERMINAL_DEVICE_H
+
+#include <DataThreadHeaders.h>
+#include <cstdint>
+#include <vector>
+
+namespace CustomIC {
+
+/**
+ * Stand-in for a custom IC on a pseudo-terminal pair (POSIX only)
+ * 
+ * open() creates the pair and exposes its slave side as an ordinary
+ * serial port path, which SerialPort opens like real hardware. A
+ * background thread writes protocol packets of simulated EEG into the
+ * master side at the configured sample rate, so the complete serial path
+ * (wait, read, parse, addToBuffer) can be exercised without a device.
+ */
+class PseudoTerminalDevice : public Thread
+{
+public:
+    /** Name listed alongside the real serial ports */
+    static const char* const PORT_NAME;
+    
+    PseudoTerminalDevice();
+    ~PseudoTerminalDevice() override;
+    
+    /** Set the packet layout and rate to emit */
+    void configure(int numChannels, int bytesPerSample, float scaleFactor, float sampleRate,
+                   uint8_t sync1, uint8_t sync2);
+    
+    /** Create the pseudo-terminal pair; returns false if unsupported */
+    bool open();
+    
+    /** Stop writing and close the pair */
+    void close();
+    
+    /** Path of the slave side, to pass to SerialPort::open() */
+    String getSlaveName() const { return slaveName; }
+    
+    void run() override;
+
+private:
+    /** Writes one packet of simulated data for the given sample into dest */
+    void encodePacket(int64 sampleIndex, uint8_t* dest) const;
+    
+    static const int MAX_PACKETS_PER_WRITE = 1024;
+    
+    int masterFd = -1;
+    int slaveFd = -1;
+    String slaveName;
+    
+    int numChannels = 8;
+    int bytesPerSample = 2;
+    float scaleFactor = 0.195f;
+    float sampleRate = 256.0f;
+    uint8_t syncByte1 = 0xA0;
+    uint8_t syncByte2 = 0x5A;
+    
+    std::vector<uint8_t> packets;
+};
+
+} // namespace CustomIC
+
+#endif // CUSTOM_IC_PSEUDO_TERMINAL_DEVICE_H
@@ -0,0 +1,48 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Arbitrary serial baud rates on POSIX systems.
+
+    ------------------------------------------------------------------
+*/
+
+#include "SerialBaudRate.h"
+
+#if defined(__linux__)
+    #include <asm/termbits.h>
+    #include <sys/ioctl.h>
+#elif defined(__APPLE__)
+    #include <IOKit/serial/ioss.h>
+    #include <sys/ioctl.h>
+    #include <termios.h>
+#endif
+
+namespace CustomIC {
+
+bool setCustomBaudRate(int fd, int baudRate)
+{
+#if defined(__linux__)
+    struct termios2 options;
+    
+    if (ioctl(fd, TCGETS2, &options) != 0)
+        return false;
+    
+    options.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    options.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    options.c_ispeed = (speed_t)baudRate;
+    options.c_ospeed = (speed_t)baudRate;
+    
+    return ioctl(fd, TCSETS2, &options) == 0;
+#elif defined(__APPLE__)
+    speed_t speed = (speed_t)baudRate;
+    return ioctl(fd, IOSSIOSPEED, &speed) == 0;
+#else
+    (void)fd;
+    (void)baudRate;
+    return false;
+#endif
+}
+
+} // namespace CustomIC
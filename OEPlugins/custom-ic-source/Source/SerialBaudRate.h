@@ -0,0 +1,28 @@
+/*
+    ------------------------------------------------------------------
+
+    Custom IC Source Plugin for Open Ephys
+    
+    Arbitrary serial baud rates on POSIX systems.
+
+    ------------------------------------------------------------------
+*/
+
+#ifndef CUSTOM_IC_SERIAL_BAUD_RATE_H
+#define CUSTOM_IC_SERIAL_BAUD_RATE_H
+
+namespace CustomIC {
+
+/**
+ * Sets a baud rate that has no Bxxx constant on an open, configured port:
+ * termios2 with BOTHER on Linux, IOSSIOSPEED on macOS. Returns false if
+ * the platform or driver does not support it.
+ * 
+ * Lives in its own translation unit because the kernel's termios2
+ * definitions conflict with <termios.h>.
+ */
+bool setCustomBaudRate(int fd, int baudRate);
+
+} // namespace CustomIC
+
+#endif // CUSTOM_IC_SERIAL_BAUD_RATE_H
@@ -0,0 +1,194 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+/**
+ * Compares CSV parsing throughput of the original String-based parseLine()
+ * against the CSVParse tokenizer, single-threaded and split across threads.
+ *
+ * Usage: CSVParseBenchmark [numChannels] [numRows] [numThreads]
+ */
+
+#include "AppConfig.h"
+#include <juce_core/juce_core.h>
+
+#include "../Source/CSVTokenizer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace juce;
+
+namespace
+{
+/** The parser CSVFileSource used before the tokenizer, kept as the baseline */
+std::vector<float> parseLine(const String& line, char delim)
+{
+    std::vector<float> values;
+    String delimStr = String::charToString(delim);
+    StringArray tokens;
+    tokens.addTokens(line, delimStr, "\"");
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        String token = tokens[i].trim();
+        if (token.isNotEmpty())
+        {
+            float val = token.getFloatValue();
+            values.push_back(val);
+        }
+    }
+
+    return values;
+}
+
+/** Calls lineCallback (begin, end) for every non-empty line */
+template <typename Callback>
+void forEachLine(const char* begin, const char* end, Callback&& lineCallback)
+{
+    while (begin < end)
+    {
+        auto* newline = static_cast<const char*>(std::memchr(begin, '\n', (size_t)(end - begin)));
+        const char* lineEnd = newline != nullptr ? newline : end;
+
+        if (lineEnd > begin)
+            lineCallback(begin, lineEnd);
+
+        begin = lineEnd + 1;
+    }
+}
+
+std::string makeTestData(int numChannels, int numRows)
+{
+    Random random(42);
+    std::string text;
+    char field[32];
+
+    for (int row = 0; row < numRows; row++)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            int length = std::snprintf(field, sizeof(field), "%s%.6f", channel > 0 ? "," : "",
+                                       (random.nextFloat() - 0.5f) * 200.0f);
+            text.append(field, (size_t)length);
+        }
+
+        text += '\n';
+    }
+
+    return text;
+}
+
+/** Runs fn repeatedly for at least half a second and returns the best MB/s */
+template <typename Function>
+double measure(size_t numBytes, Function&& fn)
+{
+    using Clock = std::chrono::steady_clock;
+
+    double best = 0.0;
+    auto started = Clock::now();
+
+    do
+    {
+        auto t0 = Clock::now();
+        fn();
+        double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        best = jmax(best, (double)numBytes / (1024.0 * 1024.0) / seconds);
+    } while (Clock::now() - started < std::chrono::milliseconds(500));
+
+    return best;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int numChannels = argc > 1 ? std::atoi(argv[1]) : 64;
+    const int numRows = argc > 2 ? std::atoi(argv[2]) : 20000;
+    const int numThreads = argc > 3 ? std::atoi(argv[3]) : jmax(1, (int)std::thread::hardware_concurrency());
+
+    const std::string text = makeTestData(numChannels, numRows);
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    std::vector<float> legacyOutput((size_t)numRows * numChannels);
+    std::vector<float> output((size_t)numRows * numChannels);
+
+    std::printf("%d channels x %d rows, %.1f MB of text\n", numChannels, numRows, (double)text.size() / (1024.0 * 1024.0));
+
+    double legacy = measure(text.size(), [&]
+    {
+        size_t row = 0;
+        forEachLine(begin, end, [&](const char* lineBegin, const char* lineEnd)
+        {
+            std::vector<float> values = parseLine(String(CharPointer_UTF8(lineBegin), CharPointer_UTF8(lineEnd)), ',');
+            std::copy(values.begin(), values.end(), legacyOutput.begin() + (std::ptrdiff_t)(row++ * numChannels));
+        });
+    });
+
+    double tokenizer = measure(text.size(), [&]
+    {
+        size_t row = 0;
+        forEachLine(begin, end, [&](const char* lineBegin, const char* lineEnd)
+        {
+            CSVParse::parseRow(lineBegin, lineEnd, ',', -1, output.data() + row++ * numChannels, numChannels);
+        });
+    });
+
+    if (std::memcmp(output.data(), legacyOutput.data(), sizeof(float) * output.size()) != 0)
+        std::printf("warning: tokenizer output differs from parseLine\n");
+
+    // Same split as CSVFileSource: whole lines per thread, with row offsets
+    // known up front (here every line is a row)
+    std::vector<const char*> boundaries((size_t)numThreads + 1);
+    CSVParse::splitAtLines(begin, end, numThreads, boundaries.data());
+
+    std::vector<size_t> firstRow((size_t)numThreads + 1, 0);
+    for (int part = 0; part < numThreads; part++)
+        firstRow[(size_t)part + 1] = firstRow[(size_t)part] + (size_t)std::count(boundaries[(size_t)part], boundaries[(size_t)part + 1], '\n');
+
+    double parallel = measure(text.size(), [&]
+    {
+        std::vector<std::thread> threads;
+
+        for (int part = 0; part < numThreads; part++)
+        {
+            threads.emplace_back([&, part]
+            {
+                size_t row = firstRow[(size_t)part];
+                forEachLine(boundaries[(size_t)part], boundaries[(size_t)part + 1], [&](const char* lineBegin, const char* lineEnd)
+                {
+                    CSVParse::parseRow(lineBegin, lineEnd, ',', -1, output.data() + row++ * numChannels, numChannels);
+                });
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+    });
+
+    std::printf("parseLine           %8.1f MB/s\n", legacy);
+    std::printf("CSVParse            %8.1f MB/s  (%.1fx)\n", tokenizer, tokenizer / legacy);
+    std::printf("CSVParse %2d threads %8.1f MB/s  (%.1fx)\n", numThreads, parallel, parallel / legacy);
+
+    return 0;
+}
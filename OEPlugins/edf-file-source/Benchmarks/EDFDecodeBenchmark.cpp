@@ -0,0 +1,216 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+/**
+ * Checks EDFDecode::int16ToPhysical and int24ToPhysical against a scalar
+ * decode, then times them against it.
+ *
+ * The checks cover every length up to 70 samples, so each vector loop
+ * leaves every possible tail, and source runs that end exactly at the end
+ * of their buffer, so a kernel that reads past the signal is caught under
+ * a memory checker. Samples include the digital minimum and maximum, -1,
+ * 0 and random negative values.
+ *
+ * The vector path is chosen at compile time: SSE2 by default on x86, SSSE3
+ * for 24-bit samples when built with it (EDFDecodeBenchmarkSSSE3), and NEON
+ * on ARM. Exits with 1 if any check fails.
+ *
+ * Usage: EDFDecodeBenchmark [numSamples] [repeats]
+ */
+
+#include "../Source/EDFSampleDecoder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+int numFailures = 0;
+
+/** The per-sample decode EDFFileSource used before the bulk decoders */
+float scalarToPhysical(const uint8* src, int bytesPerSample, int index, float gain, float bias)
+{
+    const uint8* p = src + index * bytesPerSample;
+
+    int32 value;
+
+    if (bytesPerSample == 2)
+    {
+        value = (int16)(p[0] | (p[1] << 8));
+    }
+    else
+    {
+        value = p[0] | (p[1] << 8) | (p[2] << 16);
+
+        if (value & 0x800000)
+            value |= (int32)0xFF000000;
+    }
+
+    return (float)value * gain + bias;
+}
+
+/** Writes value as a little-endian sample */
+void putSample(uint8* dest, int bytesPerSample, int32 value)
+{
+    for (int b = 0; b < bytesPerSample; b++)
+        dest[b] = (uint8)((uint32)value >> (8 * b));
+}
+
+/** numSamples random samples, about a third of them the extremes */
+std::vector<uint8> makeSamples(int bytesPerSample, int numSamples, Random& random)
+{
+    const int32 maxValue = (1 << (8 * bytesPerSample - 1)) - 1;
+    const int32 extremes[] = { -maxValue - 1, maxValue, -1, 0, 1, -maxValue };
+
+    // Exactly numSamples samples, so reading past them leaves the allocation
+    std::vector<uint8> src((size_t)numSamples * bytesPerSample);
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        // Rotate the extremes through the lanes, so each is seen in vector and tail positions
+        const int32 value = random.nextInt(3) == 0 ? extremes[(i + numSamples) % 6]
+                                                   : random.nextInt({ -maxValue - 1, maxValue });
+
+        putSample(src.data() + (size_t)i * bytesPerSample, bytesPerSample, value);
+    }
+
+    return src;
+}
+
+void decode(int bytesPerSample, float* dest, const uint8* src, int numSamples, float gain, float bias)
+{
+    if (bytesPerSample == 2)
+        EDFDecode::int16ToPhysical(dest, src, numSamples, gain, bias);
+    else
+        EDFDecode::int24ToPhysical(dest, src, numSamples, gain, bias);
+}
+
+/** Decodes numSamples samples and checks them, and that nothing after them was written */
+void checkDecode(int bytesPerSample, int numSamples, float gain, float bias, Random& random)
+{
+    const std::vector<uint8> src = makeSamples(bytesPerSample, numSamples, random);
+    const float guard = -12345.0f;
+
+    std::vector<float> dest((size_t)numSamples + 8, guard);
+    decode(bytesPerSample, dest.data(), src.data(), numSamples, gain, bias);
+
+    const String what = String(bytesPerSample * 8) + "-bit, " + String(numSamples) + " samples, gain " + String(gain);
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        const float expected = scalarToPhysical(src.data(), bytesPerSample, i, gain, bias);
+
+        // Digital values are exact; with a gain and bias allow for a fused multiply-add
+        const bool ok = (gain == 1.0f && bias == 0.0f)
+                            ? dest[(size_t)i] == expected
+                            : std::abs(dest[(size_t)i] - expected) <= 1e-6f * jmax(1.0f, std::abs(expected));
+
+        if (!ok)
+        {
+            std::printf("FAILED: %s: sample %d is %.9g, expected %.9g\n", what.toRawUTF8(), i, dest[(size_t)i], expected);
+            numFailures++;
+            return;
+        }
+    }
+
+    for (size_t i = (size_t)numSamples; i < dest.size(); i++)
+    {
+        if (dest[i] != guard)
+        {
+            std::printf("FAILED: %s: wrote past the last sample\n", what.toRawUTF8());
+            numFailures++;
+            return;
+        }
+    }
+}
+
+/** Average time to decode numSamples samples, in microseconds */
+template <typename Decoder>
+double timeDecode(Decoder&& decoder, int repeats)
+{
+    const double start = Time::getMillisecondCounterHiRes();
+
+    for (int r = 0; r < repeats; r++)
+        decoder();
+
+    return (Time::getMillisecondCounterHiRes() - start) * 1000.0 / repeats;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int numSamples = argc > 1 ? std::atoi(argv[1]) : 1 << 16;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    Random random(1);
+
+    for (int bytesPerSample : { 2, 3 })
+    {
+        for (int n = 0; n <= 70; n++)
+        {
+            checkDecode(bytesPerSample, n, 1.0f, 0.0f, random);
+            checkDecode(bytesPerSample, n, 0.0312f, -3.5f, random);
+        }
+
+        checkDecode(bytesPerSample, 4099, 1.0f, 0.0f, random);
+        checkDecode(bytesPerSample, 4099, -0.25f, 100.0f, random);
+    }
+
+    // Timing
+    for (int bytesPerSample : { 2, 3 })
+    {
+        const std::vector<uint8> src = makeSamples(bytesPerSample, numSamples, random);
+        std::vector<float> dest((size_t)numSamples);
+
+        // Keeps the scalar loop from being dropped as unused
+        volatile float sink = 0.0f;
+
+        const double scalar = timeDecode([&]
+        {
+            for (int i = 0; i < numSamples; i++)
+                dest[(size_t)i] = scalarToPhysical(src.data(), bytesPerSample, i, 0.5f, 1.0f);
+
+            sink = dest[(size_t)numSamples / 2];
+        }, repeats);
+
+        const double bulk = timeDecode([&]
+        {
+            decode(bytesPerSample, dest.data(), src.data(), numSamples, 0.5f, 1.0f);
+            sink = dest[(size_t)numSamples / 2];
+        }, repeats);
+
+        std::printf("%d-bit, %d samples: scalar %.1f us, bulk %.1f us (%.1fx)\n",
+                    bytesPerSample * 8, numSamples, scalar, bulk, scalar / bulk);
+    }
+
+    if (numFailures > 0)
+    {
+        std::printf("%d checks failed\n", numFailures);
+        return 1;
+    }
+
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,310 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+/**
+ * Round trip for XZOutputStream, XZDecompress::readIndex and XZInputStream.
+ *
+ * Writes CSV-like text as two .xz streams with small blocks of different
+ * sizes, joined with stream padding (as `cat a.xz b.xz` plus padding would
+ * be), then checks that:
+ *  - readIndex finds both streams and every block, with the right sizes
+ *  - a sequential read returns the original text
+ *  - reads after random seeks, forwards and backwards, match the text,
+ *    including seeks to either side of block and stream boundaries and
+ *    reads that run across them
+ *
+ * Then times random seeks into that file against the same text written
+ * as a single block, which is how xz writes files by default. Seeks are
+ * timed with the default 1 MB read-ahead buffers, the 256 KB buffers
+ * CSVFileSource uses, and buffers the size of a block.
+ *
+ * Needs liblzma at run time. Exits with 1 if any check fails.
+ *
+ * Usage: XZSeekBenchmark [megabytes] [blockKB]
+ */
+
+#include "../Source/XZInputStream.h"
+#include "../Source/XZOutputStream.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// XZInputStream and XZOutputStream log through the GUI's logger
+extern "C" OELogger& getOELogger() { return OELogger::instance(); }
+std::string OELogger::getModuleName() { return "[XZSeekBenchmark]"; }
+std::string OELogger::getCurrentTimeIso() { return Time::getCurrentTime().toISO8601(true).toStdString(); }
+
+namespace
+{
+int numFailures = 0;
+
+void check(bool condition, const String& what)
+{
+    if (!condition)
+    {
+        std::printf("FAILED: %s\n", what.toRawUTF8());
+        numFailures++;
+    }
+}
+
+/** Rows of a timestamp and 16 channels, so the text compresses like real data */
+std::string makeTestText(int64 numBytes)
+{
+    std::string text;
+    text.reserve((size_t)numBytes + 256);
+
+    Random random(1);
+    int64 row = 0;
+
+    while ((int64)text.size() < numBytes)
+    {
+        text += String((double)row++ / 1000.0, 3).toStdString();
+
+        for (int ch = 0; ch < 16; ch++)
+            text += "," + String(random.nextInt(2000) - 1000).toStdString();
+
+        text += "\n";
+    }
+
+    text.resize((size_t)numBytes);
+    return text;
+}
+
+/** Writes text to an .xz file with the given block size; returns false on error */
+bool writeXZ(const File& file, const char* data, int64 numBytes, int64 blockSize)
+{
+    XZOutputStream output(file, blockSize);
+
+    if (!output.openedOk())
+        return false;
+
+    // Uneven writes, so blocks end in the middle of them
+    for (int64 written = 0; written < numBytes;)
+    {
+        const int64 chunk = jmin(numBytes - written, (int64)12345);
+
+        if (!output.write(data + written, (size_t)chunk))
+            return false;
+
+        written += chunk;
+    }
+
+    return output.finish();
+}
+
+/** Seeks and reads numBytes, checking them against the text */
+bool readMatches(XZInputStream& input, const std::string& text, int64 position, int numBytes, HeapBlock<char>& buffer)
+{
+    numBytes = (int)jmin((int64)numBytes, (int64)text.size() - position);
+
+    if (!input.setPosition(position))
+        return false;
+
+    for (int done = 0; done < numBytes;)
+    {
+        const int numRead = input.read(buffer + done, numBytes - done);
+
+        if (numRead <= 0)
+            return false;
+
+        done += numRead;
+    }
+
+    return input.getPosition() == position + numBytes
+           && std::memcmp(buffer, text.data() + position, (size_t)numBytes) == 0;
+}
+
+/** Average time of a seek and a 4 KB read at random positions, in milliseconds */
+double timeRandomSeeks(const File& file, const std::string& text, int numSeeks, int bufferSize)
+{
+    XZInputStream input(file, bufferSize);
+    HeapBlock<char> buffer(4096);
+    Random random(3);
+
+    const double start = Time::getMillisecondCounterHiRes();
+
+    for (int i = 0; i < numSeeks; i++)
+    {
+        input.setPosition((int64)(random.nextDouble() * (double)(text.size() - 4096)));
+        input.read(buffer, 4096);
+    }
+
+    return (Time::getMillisecondCounterHiRes() - start) / numSeeks;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int64 numBytes = (int64)((argc > 1 ? std::atof(argv[1]) : 8.0) * 1024 * 1024);
+    const int64 blockSize = (int64)(argc > 2 ? std::atoi(argv[2]) : 64) * 1024;
+
+    if (!XZDecompress::LZMALibrary::getInstance().canEncode())
+    {
+        std::printf("liblzma with encoder support is needed\n");
+        return 1;
+    }
+
+    const std::string text = makeTestText(numBytes);
+
+    // The first stream ends in the middle of a block's worth of text, and the
+    // second uses a block size that does not divide the first's
+    const int64 firstStreamBytes = numBytes / 3 + 777;
+    const int64 secondBlockSize = blockSize * 3 / 2 + 100;
+
+    TemporaryFile firstFile(".xz"), secondFile(".xz"), joinedFile(".xz"), singleBlockFile(".xz");
+
+    if (!writeXZ(firstFile.getFile(), text.data(), firstStreamBytes, blockSize)
+        || !writeXZ(secondFile.getFile(), text.data() + firstStreamBytes, numBytes - firstStreamBytes, secondBlockSize)
+        || !writeXZ(singleBlockFile.getFile(), text.data(), numBytes, numBytes))
+    {
+        std::printf("could not write the test files\n");
+        return 1;
+    }
+
+    // Concatenated streams with stream padding between them and at the end
+    {
+        const uint8_t padding[8] = {};
+        FileOutputStream joined(joinedFile.getFile());
+        joined.setPosition(0);
+        joined.truncate();
+
+        FileInputStream first(firstFile.getFile()), second(secondFile.getFile());
+        joined.writeFromInputStream(first, -1);
+        joined.write(padding, 4);
+        joined.writeFromInputStream(second, -1);
+        joined.write(padding, 8);
+    }
+
+    const File& file = joinedFile.getFile();
+
+    // Index
+    XZDecompress::XZIndex index;
+    check(XZDecompress::readIndex(file, index), "readIndex");
+
+    const int firstStreamBlocks = (int)((firstStreamBytes + blockSize - 1) / blockSize);
+    const int secondStreamBlocks = (int)((numBytes - firstStreamBytes + secondBlockSize - 1) / secondBlockSize);
+
+    check(index.streams.size() == 2, "two streams in the index");
+    check((int)index.blocks.size() == firstStreamBlocks + secondStreamBlocks, "block count");
+    check(index.uncompressedSize == numBytes, "uncompressed size");
+
+    std::vector<int64> boundaries;
+
+    if (index.streams.size() == 2 && (int)index.blocks.size() == firstStreamBlocks + secondStreamBlocks)
+    {
+        check(index.streams[0].numBlocks == firstStreamBlocks && index.streams[1].firstBlock == firstStreamBlocks,
+              "blocks per stream");
+        check(index.streams[0].uncompressedEnd == firstStreamBytes, "first stream length");
+
+        for (size_t b = 0; b < index.blocks.size(); b++)
+        {
+            const auto& block = index.blocks[b];
+            const bool inFirst = (int)b < firstStreamBlocks;
+            const int64 streamStart = inFirst ? 0 : firstStreamBytes;
+            const int64 streamEnd = inFirst ? firstStreamBytes : numBytes;
+            const int64 size = inFirst ? blockSize : secondBlockSize;
+            const int64 offset = streamStart + (int64)(inFirst ? b : b - (size_t)firstStreamBlocks) * size;
+
+            check(block.stream == (inFirst ? 0 : 1), "block " + String((int)b) + " stream");
+            check(block.uncompressedOffset == offset, "block " + String((int)b) + " offset");
+            check(block.uncompressedSize == jmin(size, streamEnd - offset), "block " + String((int)b) + " size");
+            check(index.findBlock(offset) == (int)b && (offset == 0 || index.findBlock(offset - 1) == (int)b - 1),
+                  "findBlock at block " + String((int)b));
+
+            boundaries.push_back(offset);
+        }
+    }
+
+    // Sequential read
+    {
+        XZInputStream input(file);
+        check(input.openedOk() && input.getTotalLength() == numBytes, "open and total length");
+
+        MemoryBlock decoded;
+        input.readIntoMemoryBlock(decoded);
+
+        check(!input.failed() && decoded.getSize() == (size_t)numBytes
+                  && std::memcmp(decoded.getData(), text.data(), (size_t)numBytes) == 0,
+              "sequential read");
+    }
+
+    // Random seeks, including both sides of every block and stream boundary
+    {
+        XZInputStream input(file);
+        HeapBlock<char> buffer((size_t)(3 * secondBlockSize));
+        Random random(2);
+        int numSeeks = 0;
+
+        for (int64 boundary : boundaries)
+        {
+            for (int64 position : { boundary - 1, boundary, boundary + 1, boundary - 100 })
+            {
+                if (position < 0 || position >= numBytes)
+                    continue;
+
+                // Short reads stay near the boundary, long ones run into later blocks and streams
+                const int length = random.nextBool() ? 200 : (int)(2 * secondBlockSize);
+                check(readMatches(input, text, position, length, buffer), "read at " + String(position));
+                numSeeks++;
+            }
+        }
+
+        // Backwards across the stream boundary, then random positions in any order
+        check(readMatches(input, text, firstStreamBytes - 10, 20, buffer), "read across the stream boundary");
+        check(readMatches(input, text, 5, 10, buffer), "read at the start after the stream boundary");
+
+        for (int i = 0; i < 300; i++)
+        {
+            const int64 position = (int64)(random.nextDouble() * (double)numBytes);
+            check(readMatches(input, text, position, 1 + random.nextInt(20000), buffer), "read at " + String(position));
+            numSeeks++;
+        }
+
+        check(!input.failed(), "no decoding errors");
+        std::printf("%d seeks checked across %d blocks in %d streams\n", numSeeks, (int)index.blocks.size(), (int)index.streams.size());
+    }
+
+    // Seek time against a single-block file
+    const double single = timeRandomSeeks(singleBlockFile.getFile(), text, 10, 1024 * 1024);
+
+    std::printf("%.1f MB of text, ms per random seek: single block %.2f\n", (double)numBytes / (1024.0 * 1024.0), single);
+
+    for (int bufferSize : { 1024 * 1024, 256 * 1024, (int)blockSize })
+    {
+        const double blocked = timeRandomSeeks(file, text, 50, bufferSize);
+
+        std::printf("  %lld KB blocks, %d KB buffers: %.2f (%.1fx)\n",
+                    (long long)(blockSize / 1024), bufferSize / 1024, blocked, single / blocked);
+    }
+
+    if (numFailures > 0)
+    {
+        std::printf("%d checks failed\n", numFailures);
+        return 1;
+    }
+
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -22,15 +22,95 @@
  */
 
 #include "CSVFileSource.h"
-#include "XZDecompress.h"
-#include <sstream>
+#include "CSVTokenizer.h"
+#include "XZInputStream.h"
+
+namespace
+{
+/**
+ * Reads the stream from its current position and calls
+ * lineCallback (begin, end, byteOffset) for each line, with the line ending
+ * removed. Stops early if the callback returns false.
+ */
+template <typename Callback>
+void forEachLine(InputStream& stream, Callback&& lineCallback)
+{
+    const int chunkSize = 256 * 1024;
+
+    std::vector<char> buffer;
+    int64 bufferOffset = stream.getPosition();  // Byte offset of buffer[0]
+    size_t lineStart = 0;
+
+    for (;;)
+    {
+        // Keep any partial line at the front and append the next chunk
+        buffer.erase(buffer.begin(), buffer.begin() + lineStart);
+        bufferOffset += (int64)lineStart;
+        lineStart = 0;
+
+        size_t carried = buffer.size();
+        buffer.resize(carried + chunkSize);
+        int bytesRead = stream.read(buffer.data() + carried, chunkSize);
+        buffer.resize(carried + (size_t)jmax(0, bytesRead));
+
+        const char* data = buffer.data();
+        const bool endOfStream = bytesRead <= 0;
+
+        for (;;)
+        {
+            auto* newline = static_cast<const char*>(std::memchr(data + lineStart, '\n', buffer.size() - lineStart));
+
+            if (newline == nullptr)
+                break;
+
+            const char* lineEnd = newline;
+            if (lineEnd > data + lineStart && lineEnd[-1] == '\r')
+                lineEnd--;
+
+            if (!lineCallback(data + lineStart, lineEnd, bufferOffset + (int64)lineStart))
+                return;
+
+            lineStart = (size_t)(newline - data) + 1;
+        }
+
+        if (endOfStream)
+        {
+            // Last line without a trailing newline
+            if (lineStart < buffer.size())
+            {
+                const char* lineEnd = data + buffer.size();
+                if (lineEnd[-1] == '\r')
+                    lineEnd--;
+
+                lineCallback(data + lineStart, lineEnd, bufferOffset + (int64)lineStart);
+            }
+
+            return;
+        }
+    }
+}
+
+bool isBlankLine(const char* begin, const char* end)
+{
+    for (const char* c = begin; c < end; c++)
+    {
+        if (!CharacterFunctions::isWhitespace(*c))
+            return false;
+    }
+
+    return true;
+}
+} // namespace
 
 CSVFileSource::CSVFileSource()
-    : numChannels(0),
+    : nextCacheSlot(0),
+      numChannels(0),
       numSamples(0),
       sampleRate(1000.0f),  // Default sample rate
       delimiter(','),
       hasHeader(false),
+      numDelimiters(-1),
+      timeColumnIndex(-1),
       currentSample(0)
 {
 }
@@ -39,242 +119,316 @@ CSVFileSource::~CSVFileSource()
 {
 }
 
-char CSVFileSource::detectDelimiter(const String& line)
+bool CSVFileSource::detectHeader(const char* begin, const char* end) const
 {
-    // Count occurrences of common delimiters
-    int commas = 0, tabs = 0, semicolons = 0;
-    
-    for (int i = 0; i < line.length(); i++)
+    // Try to parse as numbers - if less than half succeed, it's probably a header
+    int numTokens = 0;
+    int numericCount = 0;
+
+    CSVParse::forEachField(begin, end, delimiter, [&](const char* fieldBegin, const char* fieldEnd)
     {
-        char c = line[i];
-        if (c == ',') commas++;
-        else if (c == '\t') tabs++;
-        else if (c == ';') semicolons++;
-    }
-    
-    // Return the most common delimiter
-    if (tabs >= commas && tabs >= semicolons)
-        return '\t';
-    else if (semicolons >= commas)
-        return ';';
-    else
-        return ',';
+        numTokens++;
+
+        if (CSVParse::isNumber(fieldBegin, fieldEnd))
+            numericCount++;
+
+        return true;
+    });
+
+    return numericCount < numTokens / 2;
 }
 
-bool CSVFileSource::detectHeader(const String& line)
+bool CSVFileSource::isDataRow(const char* begin, const char* end) const
 {
-    // Try to parse as numbers - if all fail, it's probably a header
-    String delimStr = String::charToString(delimiter);
-    StringArray tokens;
-    tokens.addTokens(line, delimStr, "\"");
-    
-    if (tokens.size() == 0)
-        return false;
-    
-    int numericCount = 0;
-    for (int i = 0; i < tokens.size(); i++)
+    return CSVParse::countChar(begin, end, delimiter) == numDelimiters;
+}
+
+int CSVFileSource::parseDataRows(const char* begin, const char* end, float* dest, int maxRows) const
+{
+    int numRows = 0;
+
+    for (const char* lineStart = begin; lineStart < end && numRows < maxRows;)
     {
-        String token = tokens[i].trim();
-        if (token.isEmpty())
-            continue;
-            
-        // Try to convert to float
-        bool isNumeric = true;
-        bool hasDecimal = false;
-        bool hasSign = false;
-        
-        for (int j = 0; j < token.length(); j++)
+        auto* newline = static_cast<const char*>(std::memchr(lineStart, '\n', (size_t)(end - lineStart)));
+        const char* lineEnd = newline != nullptr ? newline : end;
+        const char* nextLine = newline != nullptr ? newline + 1 : end;
+
+        if (lineEnd > lineStart && lineEnd[-1] == '\r')
+            lineEnd--;
+
+        if (!isBlankLine(lineStart, lineEnd) && isDataRow(lineStart, lineEnd))
         {
-            char c = token[j];
-            if (c == '-' || c == '+')
-            {
-                if (hasSign || j > 0) { isNumeric = false; break; }
-                hasSign = true;
-            }
-            else if (c == '.')
-            {
-                if (hasDecimal) { isNumeric = false; break; }
-                hasDecimal = true;
-            }
-            else if (c == 'e' || c == 'E')
-            {
-                // Scientific notation - allow it
-            }
-            else if (!CharacterFunctions::isDigit(c))
-            {
-                isNumeric = false;
-                break;
-            }
+            if (dest != nullptr)
+                CSVParse::parseRow(lineStart, lineEnd, delimiter, timeColumnIndex, dest + (size_t)numRows * numChannels, numChannels);
+
+            numRows++;
         }
-        
-        if (isNumeric)
-            numericCount++;
+
+        lineStart = nextLine;
     }
-    
-    // If less than half are numeric, it's probably a header
-    return numericCount < tokens.size() / 2;
+
+    return numRows;
 }
 
-std::vector<float> CSVFileSource::parseLine(const String& line, char delim)
+namespace
 {
-    std::vector<float> values;
-    String delimStr = String::charToString(delim);
-    StringArray tokens;
-    tokens.addTokens(line, delimStr, "\"");
-    
-    for (int i = 0; i < tokens.size(); i++)
+/** Counts finished jobs; the destructor waits for all of them */
+struct JobCompletion
+{
+    explicit JobCompletion(int numJobs_) : numJobs(numJobs_), remaining(numJobs_) {}
+
+    ~JobCompletion()
+    {
+        // Always wait, even if remaining is already 0: the last job may not have
+        // called signal() yet, and finished must outlive that call
+        if (numJobs > 0)
+            finished.wait();
+    }
+
+    void jobDone()
     {
-        String token = tokens[i].trim();
-        if (token.isNotEmpty())
+        if (--remaining == 0)
+            finished.signal();
+    }
+
+    const int numJobs;
+    std::atomic<int> remaining;
+    WaitableEvent finished;
+};
+
+/** Marks a job done when it leaves scope, however the task exits */
+struct JobDoneGuard
+{
+    ~JobDoneGuard() { completion.jobDone(); }
+
+    JobCompletion& completion;
+};
+} // namespace
+
+void CSVFileSource::runInParallel(int numParts, const std::function<void(int)>& task)
+{
+    // The jobs refer to task and to completion on this stack frame, so this must not
+    // return before every job has finished. completion's destructor waits for them,
+    // also when task(0) throws, and each job counts itself done however its task exits
+    // (a job that never counted itself done would leave this waiting forever).
+    JobCompletion completion(numParts - 1);
+
+    for (int part = 1; part < numParts; part++)
+    {
+        parsePool->addJob([&completion, &task, part]
         {
-            float val = token.getFloatValue();
-            values.push_back(val);
-        }
+            JobDoneGuard done { completion };
+            task(part);
+        });
     }
-    
-    return values;
+
+    task(0);
 }
 
-bool CSVFileSource::open(File file)
+int CSVFileSource::parseBlockText(const char* begin, const char* end, float* dest, int maxRows)
 {
-    // Reset all state from previous file
-    data.clear();
-    channelNames.clear();
-    numChannels = 0;
-    numSamples = 0;
-    sampleRate = 1000.0f;
-    delimiter = ',';
-    hasHeader = false;
-    currentSample = 0;
-    
-    // Read file - automatically decompress if XZ compressed
-    StringArray lines;
-    
+    const int64 size = (int64)(end - begin);
+
+    if (size < PARALLEL_PARSE_MIN_BYTES || SystemStats::getNumCpus() < 2)
+        return parseDataRows(begin, end, dest, maxRows);
+
+    if (parsePool == nullptr)
+        parsePool = std::make_unique<ThreadPool>(jlimit(1, 7, SystemStats::getNumCpus() - 1));
+
+    const int numParts = (int)jmin((int64)parsePool->getNumThreads() + 1, size / MIN_PARSE_PART_BYTES);
+
+    std::vector<const char*> boundaries((size_t)numParts + 1);
+    CSVParse::splitAtLines(begin, end, numParts, boundaries.data());
+
+    // Count rows per part first so every part knows where its rows start
+    std::vector<int> firstRow((size_t)numParts + 1, 0);
+
+    runInParallel(numParts, [&](int part)
+    {
+        firstRow[(size_t)part + 1] = parseDataRows(boundaries[(size_t)part], boundaries[(size_t)part + 1], nullptr, maxRows);
+    });
+
+    for (int part = 0; part < numParts; part++)
+        firstRow[(size_t)part + 1] = jmin(maxRows, firstRow[(size_t)part] + firstRow[(size_t)part + 1]);
+
+    runInParallel(numParts, [&](int part)
+    {
+        const int rowsInPart = firstRow[(size_t)part + 1] - firstRow[(size_t)part];
+
+        if (rowsInPart > 0)
+            parseDataRows(boundaries[(size_t)part], boundaries[(size_t)part + 1],
+                          dest + (size_t)firstRow[(size_t)part] * numChannels, rowsInPart);
+    });
+
+    return firstRow[(size_t)numParts];
+}
+
+bool CSVFileSource::openInputStream(const File& file)
+{
+    // Automatically decompress if XZ compressed
     if (XZDecompress::hasXZExtension(file) || XZDecompress::isXZFile(file))
     {
         LOGC("CSV: Detected XZ compressed file");
-        if (!XZDecompress::readFileLines(file, lines))
+
+        // Decoded on a background thread while the rows are indexed and parsed.
+        // Playback reads a block of rows at a time, so buffers much larger
+        // than that only make each seek decode data that is thrown away
+        auto stream = std::make_unique<XZInputStream>(file, 256 * 1024);
+
+        if (!stream->openedOk())
         {
             LOGE("CSV: Failed to decompress XZ file: ", file.getFullPathName());
             return false;
         }
+
+        input = std::move(stream);
+        return true;
     }
-    else
-    {
-        file.readLines(lines);
-    }
-    
-    if (lines.size() < 2)
+
+    auto stream = std::make_unique<FileInputStream>(file);
+
+    if (!stream->openedOk())
     {
-        LOGE("CSV: File too short: ", file.getFullPathName());
+        LOGE("CSV: Failed to open file: ", file.getFullPathName());
         return false;
     }
-    
-    // Detect delimiter from first line
-    delimiter = detectDelimiter(lines[0]);
-    String delimDisplay = (delimiter == '\t') ? "TAB" : String::charToString(delimiter);
-    LOGC("CSV: Detected delimiter: '", delimDisplay, "'");
-    
-    // Detect if first line is header
-    hasHeader = detectHeader(lines[0]);
-    LOGC("CSV: Has header: ", hasHeader ? "yes" : "no");
-    
-    int startLine = 0;
-    int timeColumnIndex = -1;  // Index of time column to skip
-    
-    // Parse header if present
-    if (hasHeader)
+
+    input = std::move(stream);
+    return true;
+}
+
+bool CSVFileSource::open(File file)
+{
+    // Reset all state from previous file
+    input.reset();
+    blockOffsets.clear();
+    for (auto& block : blockCache)
     {
-        String delimStr = String::charToString(delimiter);
-        StringArray tokens;
-        tokens.addTokens(lines[0], delimStr, "\"");
-        for (int i = 0; i < tokens.size(); i++)
-        {
-            String name = tokens[i].trim().toLowerCase();
-            // Check if this is a time column
-            if (name == "time" || name == "timestamp" || name == "t" || name == "seconds" || name == "sec")
-            {
-                timeColumnIndex = i;
-                LOGC("CSV: Found time column at index ", i);
-            }
-            else if (tokens[i].trim().isNotEmpty())
-            {
-                channelNames.push_back(tokens[i].trim());  // Use original case
-            }
-        }
-        startLine = 1;
+        block.index = -1;
+        block.numRows = 0;
+        block.samples.clear();
     }
-    
-    // Parse data and detect sample rate from time column
+    nextCacheSlot = 0;
+    channelNames.clear();
     numChannels = 0;
+    numSamples = 0;
+    sampleRate = 1000.0f;
+    delimiter = ',';
+    hasHeader = false;
+    numDelimiters = -1;
+    timeColumnIndex = -1;
+    currentSample = 0;
+    
+    if (!openInputStream(file))
+        return false;
+    
+    bool firstLine = true;
     float firstTime = 0.0f;
-    float secondTime = 0.0f;
     bool sampleRateDetected = false;
-    
-    for (int i = startLine; i < lines.size(); i++)
+    int64 lineNumber = -1;
+
+    // Single pass: detect the format, count rows and index block offsets.
+    // Values are only parsed where needed to detect the format.
+    forEachLine(*input, [&](const char* begin, const char* end, int64 offset)
     {
-        String line = lines[i].trim();
-        if (line.isEmpty())
-            continue;
-            
-        std::vector<float> allValues = parseLine(line, delimiter);
-        
-        if (allValues.empty())
-            continue;
-        
-        // Extract time value if present (for sample rate detection)
-        if (timeColumnIndex >= 0 && timeColumnIndex < (int)allValues.size())
+        lineNumber++;
+
+        if (isBlankLine(begin, end))
+            return true;
+
+        if (firstLine)
         {
-            float timeVal = allValues[timeColumnIndex];
-            if (data.empty())
-                firstTime = timeVal;
-            else if (data.size() == 1 && !sampleRateDetected)
+            firstLine = false;
+            // Detect delimiter from first line
+            delimiter = CSVParse::detectDelimiter(begin, end);
+            String delimDisplay = (delimiter == '\t') ? "TAB" : String::charToString(delimiter);
+            LOGC("CSV: Detected delimiter: '", delimDisplay, "'");
+            
+            // Detect if first line is header
+            hasHeader = detectHeader(begin, end);
+            LOGC("CSV: Has header: ", hasHeader ? "yes" : "no");
+
+            if (hasHeader)
             {
-                secondTime = timeVal;
-                float dt = secondTime - firstTime;
-                if (dt > 0)
+                String line = String(CharPointer_UTF8(begin), CharPointer_UTF8(end));
+                String delimStr = String::charToString(delimiter);
+                StringArray tokens;
+                tokens.addTokens(line, delimStr, "\"");
+                for (int i = 0; i < tokens.size(); i++)
                 {
-                    sampleRate = 1.0f / dt;
-                    sampleRateDetected = true;
-                    LOGC("CSV: Detected sample rate from time column: ", sampleRate, " Hz");
+                    String name = tokens[i].trim().toLowerCase();
+                    // Check if this is a time column
+                    if (name == "time" || name == "timestamp" || name == "t" || name == "seconds" || name == "sec")
+                    {
+                        timeColumnIndex = i;
+                        LOGC("CSV: Found time column at index ", i);
+                    }
+                    else if (tokens[i].trim().isNotEmpty())
+                    {
+                        channelNames.push_back(tokens[i].trim());  // Use original case
+                    }
                 }
+                return true;
             }
         }
-        
-        // Build channel data (excluding time column)
-        std::vector<float> values;
-        for (int j = 0; j < (int)allValues.size(); j++)
-        {
-            if (j != timeColumnIndex)
-                values.push_back(allValues[j]);
-        }
-        
-        if (values.empty())
-            continue;
-        
+
         // Set number of channels from first data line
-        if (numChannels == 0)
+        if (numDelimiters < 0)
         {
-            numChannels = (int)values.size();
+            numDelimiters = CSVParse::countChar(begin, end, delimiter);
+
+            int numColumns = numDelimiters + 1;
+            numChannels = (timeColumnIndex >= 0 && timeColumnIndex < numColumns) ? numColumns - 1 : numColumns;
             LOGC("CSV: Detected ", numChannels, " channels (excluding time column)");
         }
-        
+
         // Ensure consistent channel count
-        if ((int)values.size() == numChannels)
+        if (!isDataRow(begin, end))
         {
-            data.push_back(values);
+            LOGC("CSV: Skipping line ", lineNumber, " - expected ", numDelimiters + 1, " values");
+            return true;
         }
-        else
+
+        // Detect sample rate from the first two values of the time column
+        if (timeColumnIndex >= 0 && numSamples < 2 && !sampleRateDetected)
         {
-            LOGC("CSV: Skipping line ", i, " - expected ", numChannels, " values, got ", values.size());
+            float timeVal = 0.0f;
+            int column = 0;
+
+            CSVParse::forEachField(begin, end, delimiter, [&](const char* fieldBegin, const char* fieldEnd)
+            {
+                if (column++ < timeColumnIndex)
+                    return true;
+
+                CSVParse::parseFloat(fieldBegin, fieldEnd, timeVal);
+                return false;
+            });
+
+            if (numSamples == 0)
+                firstTime = timeVal;
+            else
+            {
+                float dt = timeVal - firstTime;
+                if (dt > 0)
+                {
+                    sampleRate = 1.0f / dt;
+                    sampleRateDetected = true;
+                    LOGC("CSV: Detected sample rate from time column: ", sampleRate, " Hz");
+                }
+            }
         }
-    }
-    
-    numSamples = (int64)data.size();
+
+        if (numSamples % ROWS_PER_BLOCK == 0)
+            blockOffsets.push_back(offset);
+
+        numSamples++;
+        return true;
+    });
     
     if (numSamples == 0 || numChannels == 0)
     {
         LOGE("CSV: No valid data found");
+        input.reset();
         return false;
     }
     
@@ -309,11 +463,68 @@ bool CSVFileSource::open(File file)
         }
     }
     
-    LOGC("CSV: Loaded ", numSamples, " samples x ", numChannels, " channels at ", sampleRate, " Hz (assumed)");
+    LOGC("CSV: Indexed ", numSamples, " samples x ", numChannels, " channels at ", sampleRate, " Hz (assumed)");
     
     return true;
 }
 
+const CSVFileSource::CachedBlock* CSVFileSource::getBlock(int64 blockIndex)
+{
+    for (const auto& block : blockCache)
+    {
+        if (block.index == blockIndex)
+            return &block;
+    }
+
+    if (!input || blockIndex < 0 || blockIndex >= (int64)blockOffsets.size())
+        return nullptr;
+
+    // Decode into the oldest slot of the ring
+    CachedBlock& block = blockCache[nextCacheSlot];
+    nextCacheSlot = (nextCacheSlot + 1) % NUM_CACHED_BLOCKS;
+
+    block.index = -1;
+    block.numRows = 0;
+    block.samples.resize((size_t)ROWS_PER_BLOCK * numChannels);
+
+    const int rowsInBlock = (int)jmin((int64)ROWS_PER_BLOCK, numSamples - blockIndex * ROWS_PER_BLOCK);
+
+    const int64 start = blockOffsets[blockIndex];
+    const int64 stop = blockIndex + 1 < (int64)blockOffsets.size() ? blockOffsets[blockIndex + 1] : input->getTotalLength();
+
+    if (!input->setPosition(start))
+        return nullptr;
+
+    if (stop > start)
+    {
+        // Read the block's text in one go and tokenize it in place
+        blockText.resize((size_t)(stop - start));
+        int bytesRead = input->read(blockText.data(), (int)blockText.size());
+
+        block.numRows = parseBlockText(blockText.data(), blockText.data() + jmax(0, bytesRead),
+                                       block.samples.data(), rowsInBlock);
+    }
+    else
+    {
+        // Stream length unknown, so scan lines up to the end of the block
+        forEachLine(*input, [&](const char* begin, const char* end, int64)
+        {
+            if (isBlankLine(begin, end) || !isDataRow(begin, end))
+                return true;
+
+            CSVParse::parseRow(begin, end, delimiter, timeColumnIndex,
+                               block.samples.data() + (size_t)block.numRows * numChannels, numChannels);
+            return ++block.numRows < rowsInBlock;
+        });
+    }
+
+    if (block.numRows == 0)
+        return nullptr;
+
+    block.index = blockIndex;
+    return &block;
+}
+
 void CSVFileSource::fillRecordInfo()
 {
     infoArray.clear();
@@ -362,14 +573,24 @@ int CSVFileSource::readData(float* buffer, int nSamples)
     
     while (samplesRead < nSamples && currentSample < numSamples)
     {
-        // Copy sample data (interleaved)
-        for (int ch = 0; ch < numChannels; ch++)
-        {
-            buffer[samplesRead * numChannels + ch] = data[currentSample][ch];
-        }
+        const CachedBlock* block = getBlock(currentSample / ROWS_PER_BLOCK);
+
+        if (block == nullptr)
+            break;
+
+        int rowInBlock = (int)(currentSample % ROWS_PER_BLOCK);
+        int samplesToCopy = jmin(nSamples - samplesRead, block->numRows - rowInBlock);
+
+        if (samplesToCopy <= 0)
+            break;
+
+        // Rows are already interleaved, so copy them straight out
+        std::memcpy(buffer + (size_t)samplesRead * numChannels,
+                    block->samples.data() + (size_t)rowInBlock * numChannels,
+                    sizeof(float) * (size_t)samplesToCopy * numChannels);
         
-        samplesRead++;
-        currentSample++;
+        samplesRead += samplesToCopy;
+        currentSample += samplesToCopy;
     }
     
     return samplesRead;
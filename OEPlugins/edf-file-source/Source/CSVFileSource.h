@@ -43,6 +43,18 @@
  *   0.123,0.456,0.789
  *   0.234,0.567,0.890
  *   ...
+ *
+ * The file is not loaded into memory. open() makes one pass over it to count
+ * rows and record the byte offset of every ROWS_PER_BLOCK-th row; readData()
+ * then parses blocks of rows on demand into a small fixed-size cache, so
+ * memory use does not grow with file length and seekTo() jumps straight to
+ * the containing block. Compressed .xz files are decoded incrementally
+ * through XZInputStream, so they are never fully decompressed in memory.
+ *
+ * Each block's text is read with a single call and tokenized without
+ * allocation (see CSVTokenizer.h). Wide files, whose blocks are large, are
+ * split at line boundaries and parsed on a small thread pool straight into
+ * the cached block.
  */
 class CSVFileSource : public FileSource
 {
@@ -62,17 +74,67 @@ public:
     void processEventData(EventInfo& info, int64 fromSampleNumber, int64 toSampleNumber) override;
 
 private:
-    /** Detect the delimiter used in the file */
-    char detectDelimiter(const String& line);
+    /** Number of rows decoded together and indexed by one byte offset */
+    static constexpr int ROWS_PER_BLOCK = 1024;
+
+    /** Number of decoded blocks kept in the cache */
+    static constexpr int NUM_CACHED_BLOCKS = 8;
+
+    /** Blocks with at least this much text are parsed on several threads */
+    static constexpr int PARALLEL_PARSE_MIN_BYTES = 256 * 1024;
+
+    /** Smallest slice of a block handed to one parse thread */
+    static constexpr int MIN_PARSE_PART_BYTES = 64 * 1024;
+
+    /** A block of decoded rows */
+    struct CachedBlock
+    {
+        int64 index = -1;
+        int numRows = 0;
+        std::vector<float> samples;  // [row * numChannels + channel]
+    };
+
+    /** Create a stream over the (decompressed) file contents */
+    bool openInputStream(const File& file);
 
     /** Check if the first line is a header */
-    bool detectHeader(const String& line);
+    bool detectHeader(const char* begin, const char* end) const;
+
+    /** Returns true if a line has the expected number of fields */
+    bool isDataRow(const char* begin, const char* end) const;
+
+    /**
+     * Parse up to maxRows data rows from whole lines in [begin, end) into
+     * dest, skipping blank and malformed lines. Only counts the rows if dest
+     * is nullptr. Returns the number of rows.
+     */
+    int parseDataRows(const char* begin, const char* end, float* dest, int maxRows) const;
+
+    /** Parse the rows of a block's text, splitting large blocks across parsePool */
+    int parseBlockText(const char* begin, const char* end, float* dest, int maxRows);
+
+    /** Run task (part) for each part, using parsePool for all but the first */
+    void runInParallel(int numParts, const std::function<void(int)>& task);
+
+    /** Return the cached block, decoding it from the file if needed */
+    const CachedBlock* getBlock(int64 blockIndex);
+
+    // Source of the file contents; positions are byte offsets into the (decompressed) text
+    std::unique_ptr<InputStream> input;
+
+    // Byte offset of the first row of each block
+    std::vector<int64> blockOffsets;
+
+    // Ring of decoded blocks
+    CachedBlock blockCache[NUM_CACHED_BLOCKS];
+    int nextCacheSlot;
+
+    // Raw text of the block being decoded
+    std::vector<char> blockText;
 
-    /** Parse a line into values */
-    std::vector<float> parseLine(const String& line, char delimiter);
+    // Workers for parsing large blocks, created on first use
+    std::unique_ptr<ThreadPool> parsePool;
 
-    // Data storage
-    std::vector<std::vector<float>> data;  // [sample][channel]
     std::vector<String> channelNames;
     
     // File properties
@@ -81,6 +143,8 @@ private:
     float sampleRate;  // Default or from file
     char delimiter;
     bool hasHeader;
+    int numDelimiters;     // per data row
+    int timeColumnIndex;   // -1 if none
     
     // Reading state
     int64 currentSample;
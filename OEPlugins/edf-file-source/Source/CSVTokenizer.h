@@ -0,0 +1,346 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef CSV_TOKENIZER_H_DEFINED
+#define CSV_TOKENIZER_H_DEFINED
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CSV_PARSE_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CSV_PARSE_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * Allocation-free tokenizer for numeric CSV rows.
+ *
+ * Rows are scanned 16 bytes at a time for the delimiter, and fields are
+ * converted with a from_chars-style parser that accumulates the decimal
+ * mantissa as an integer and applies the exponent with a single exact
+ * multiply or divide. Values that cannot be converted exactly that way
+ * fall back to strtod.
+ *
+ * Kept free of JUCE so it can be benchmarked in isolation.
+ */
+namespace CSVParse
+{
+
+/** Bytes examined per delimiter scan step */
+constexpr int SCAN_WIDTH = 16;
+
+#if CSV_PARSE_USE_NEON
+/** Each matching byte sets this many bits in a scan mask */
+constexpr int BITS_PER_BYTE = 4;
+#else
+constexpr int BITS_PER_BYTE = 1;
+#endif
+
+/** Returns a mask with BITS_PER_BYTE bits set for each byte equal to c in p[0..SCAN_WIDTH) */
+inline uint64_t matchMask(const char* p, char c) noexcept
+{
+#if CSV_PARSE_USE_SSE2
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+#elif CSV_PARSE_USE_NEON
+    const uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(p)), vdupq_n_u8((uint8_t)c));
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < SCAN_WIDTH; i++)
+        mask |= (uint64_t)(p[i] == c) << i;
+    return mask;
+#endif
+}
+
+/** Index of the lowest set bit of a non-zero mask */
+inline int lowestSetBit(uint64_t mask) noexcept
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/** Returns the number of occurrences of c in [begin, end) */
+inline int countChar(const char* begin, const char* end, char c) noexcept
+{
+    int count = 0;
+    const char* p = begin;
+
+    for (; p + SCAN_WIDTH <= end; p += SCAN_WIDTH)
+        count += (int)std::bitset<64>(matchMask(p, c)).count();
+
+    count /= BITS_PER_BYTE;
+
+    for (; p < end; p++)
+        count += (*p == c) ? 1 : 0;
+
+    return count;
+}
+
+/** Returns the most frequent of tab, semicolon and comma in a line (ties in that order) */
+inline char detectDelimiter(const char* begin, const char* end) noexcept
+{
+    int commas = countChar(begin, end, ',');
+    int tabs = countChar(begin, end, '\t');
+    int semicolons = countChar(begin, end, ';');
+
+    if (tabs >= commas && tabs >= semicolons)
+        return '\t';
+    else if (semicolons >= commas)
+        return ';';
+    else
+        return ',';
+}
+
+inline bool isSpaceOrQuote(char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '"' || c == '\r';
+}
+
+/**
+ * Parses a decimal floating point number at the start of [p, end), skipping
+ * leading whitespace and quotes. Returns a pointer past the number, or
+ * nullptr if there is no number.
+ */
+inline const char* parseFloat(const char* p, const char* end, float& value) noexcept
+{
+    static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    while (p < end && isSpaceOrQuote(*p))
+        p++;
+
+    const char* start = p;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+
+    // Integer part; digits beyond the 19 that fit the mantissa only scale it
+    for (; p < end && (unsigned)(*p - '0') < 10; p++)
+    {
+        hasDigits = true;
+
+        if (significantDigits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            significantDigits += (mantissa != 0) ? 1 : 0;
+        }
+        else
+        {
+            exponent++;
+        }
+    }
+
+    // Fractional part
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++)
+        {
+            hasDigits = true;
+
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                significantDigits += (mantissa != 0) ? 1 : 0;
+                exponent--;
+            }
+        }
+    }
+
+    if (!hasDigits)
+        return nullptr;
+
+    // Exponent, only consumed if it has at least one digit
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = (*q++ == '-');
+
+        if (q < end && (unsigned)(*q - '0') < 10)
+        {
+            int e = 0;
+            for (; q < end && (unsigned)(*q - '0') < 10; q++)
+                e = (e < 10000) ? e * 10 + (*q - '0') : e;
+
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result;
+
+    if (mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        // Both operands are exact, so one IEEE operation gives a correctly rounded result
+        result = (double)mantissa;
+        result = exponent < 0 ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+
+        if (negative)
+            result = -result;
+    }
+    else
+    {
+        char text[64];
+        size_t length = std::min((size_t)(p - start), sizeof(text) - 1);
+        std::memcpy(text, start, length);
+        text[length] = 0;
+        result = std::strtod(text, nullptr);
+    }
+
+    value = (float)result;
+    return p;
+}
+
+/** Returns true if a field holds exactly one number, ignoring surrounding whitespace and quotes */
+inline bool isNumber(const char* begin, const char* end) noexcept
+{
+    float value;
+    const char* p = parseFloat(begin, end, value);
+
+    if (p == nullptr)
+        return false;
+
+    while (p < end && isSpaceOrQuote(*p))
+        p++;
+
+    return p == end;
+}
+
+/**
+ * Calls fieldCallback (begin, end) for each delimited field of [begin, end).
+ * Stops early if the callback returns false.
+ */
+template <typename Callback>
+inline void forEachField(const char* begin, const char* end, char delimiter, Callback&& fieldCallback)
+{
+    const char* fieldStart = begin;
+    const char* p = begin;
+
+    for (; p + SCAN_WIDTH <= end; p += SCAN_WIDTH)
+    {
+        for (uint64_t mask = matchMask(p, delimiter); mask != 0;)
+        {
+            const char* d = p + lowestSetBit(mask) / BITS_PER_BYTE;
+
+            if (!fieldCallback(fieldStart, d))
+                return;
+
+            fieldStart = d + 1;
+            mask &= ~(((uint64_t)1 << ((d - p + 1) * BITS_PER_BYTE)) - 1);
+        }
+    }
+
+    for (; p < end; p++)
+    {
+        if (*p == delimiter)
+        {
+            if (!fieldCallback(fieldStart, p))
+                return;
+
+            fieldStart = p + 1;
+        }
+    }
+
+    fieldCallback(fieldStart, end);
+}
+
+/**
+ * Parses up to numValues fields of a row into dest, skipping the field at
+ * skipColumn (-1 for none). Empty or non-numeric fields read as zero, and
+ * missing trailing fields are zero-filled.
+ */
+inline void parseRow(const char* begin, const char* end, char delimiter, int skipColumn, float* dest, int numValues) noexcept
+{
+    int column = 0;
+    int count = 0;
+
+    if (numValues > 0)
+    {
+        forEachField(begin, end, delimiter, [&](const char* fieldBegin, const char* fieldEnd)
+        {
+            if (column++ != skipColumn)
+            {
+                float value = 0.0f;
+                if (parseFloat(fieldBegin, fieldEnd, value) == nullptr)
+                    value = 0.0f;
+
+                dest[count++] = value;
+            }
+
+            return count < numValues;
+        });
+    }
+
+    while (count < numValues)
+        dest[count++] = 0.0f;
+}
+
+/**
+ * Splits [begin, end) into numParts ranges of roughly equal size whose
+ * boundaries fall just after a newline, so each range holds whole lines.
+ * Writes numParts + 1 boundaries; ranges may be empty.
+ */
+inline void splitAtLines(const char* begin, const char* end, int numParts, const char** boundaries) noexcept
+{
+    const size_t size = (size_t)(end - begin);
+
+    boundaries[0] = begin;
+    boundaries[numParts] = end;
+
+    for (int i = 1; i < numParts; i++)
+    {
+        const char* p = begin + size * (size_t)i / (size_t)numParts;
+        p = p > boundaries[i - 1] ? p : boundaries[i - 1];
+
+        auto* newline = static_cast<const char*>(std::memchr(p, '\n', (size_t)(end - p)));
+        boundaries[i] = newline != nullptr ? newline + 1 : end;
+    }
+}
+
+} // namespace CSVParse
+
+#endif // CSV_TOKENIZER_H_DEFINED
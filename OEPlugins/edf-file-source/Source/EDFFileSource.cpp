@@ -22,19 +22,31 @@
  */
 
 #include "EDFFileSource.h"
+#include "EDFSampleDecoder.h"
 
 EDFFileSource::EDFFileSource()
-    : currentRecord(-1),
+    : eventSampleRate(0),
+      unsentEventsFrom(-1),
+      bytesPerSample(2),
+      recordSize(0),
+      hasResampledStream(false),
+      resampleContextRecords(0),
+      rawRecordIndex(-1),
+      currentRecord(-1),
       currentSample(0),
       annotationSignalIndex(-1),
       sampleRate(0),
       numChannels(0),
+      samplesPerRecord(0),
       totalSamples(0)
 {
 }
 
 EDFFileSource::~EDFFileSource()
 {
+    stopAnnotationScanner();
+    mappedFile.reset();
+
     if (fileStream)
         fileStream.reset();
 }
@@ -198,76 +210,239 @@ bool EDFFileSource::parseSignalHeaders()
     return true;
 }
 
-float EDFFileSource::digitalToPhysical(int signalIndex, int digitalValue)
+void EDFFileSource::buildSignalGroups()
 {
-    const EDFSignal& sig = signals[signalIndex];
-    return (float)((digitalValue + sig.offset) * sig.scaleFactor);
-}
+    bytesPerSample = header.isBDF ? 3 : 2;
 
-bool EDFFileSource::readDataRecord(int recordIndex)
-{
-    if (!fileStream || recordIndex < 0 || recordIndex >= header.numDataRecords)
-        return false;
+    // Signals are stored one after another within each data record
+    signalOffsets.resize(header.numSignals);
+    recordSize = 0;
 
-    if (recordIndex == currentRecord)
-        return true;  // Already loaded
+    for (int i = 0; i < header.numSignals; i++)
+    {
+        signalOffsets[i] = recordSize;
+        recordSize += (int64)signals[i].numSamplesPerRecord * bytesPerSample;
+    }
+
+    // All signals share the record duration, so equal sample counts mean equal rates
+    signalGroups.clear();
 
-    // Calculate position of this data record
-    int64 recordSize = 0;
     for (int i = 0; i < header.numSignals; i++)
     {
-        int bytesPerSample = header.isBDF ? 3 : 2;
-        recordSize += signals[i].numSamplesPerRecord * bytesPerSample;
+        if (i == annotationSignalIndex || signals[i].numSamplesPerRecord <= 0)
+            continue;
+
+        auto group = std::find_if(signalGroups.begin(), signalGroups.end(), [&](const SignalGroup& g)
+                                  { return g.samplesPerRecord == signals[i].numSamplesPerRecord; });
+
+        if (group == signalGroups.end())
+        {
+            SignalGroup newGroup;
+            newGroup.samplesPerRecord = signals[i].numSamplesPerRecord;
+            newGroup.sampleRate = newGroup.samplesPerRecord / header.dataRecordDuration;
+            signalGroups.push_back(newGroup);
+            group = signalGroups.end() - 1;
+        }
+
+        group->signals.push_back(i);
     }
 
-    int64 recordPos = header.headerBytes + (int64)recordIndex * recordSize;
-    fileStream->setPosition(recordPos);
+    std::stable_sort(signalGroups.begin(), signalGroups.end(), [](const SignalGroup& a, const SignalGroup& b)
+                     { return a.samplesPerRecord > b.samplesPerRecord; });
 
-    // Resize buffers if needed
-    if (header.isBDF)
+    // Precompute the filter banks that bring slower groups up to the fastest rate
+    resamplers.clear();
+    hasResampledStream = signalGroups.size() > 1;
+
+    if (hasResampledStream)
     {
-        recordBuffer24.resize(header.numSignals);
-        for (int i = 0; i < header.numSignals; i++)
-            recordBuffer24[i].resize(signals[i].numSamplesPerRecord);
+        for (size_t g = 1; g < signalGroups.size(); g++)
+        {
+            int spr = signalGroups[g].samplesPerRecord;
+            resamplers[spr] = std::make_unique<PolyphaseResampler>(spr, signalGroups[0].samplesPerRecord);
+        }
+    }
+}
+
+void EDFFileSource::selectStream(int index)
+{
+    channelSignals.clear();
+    channelGains.clear();
+    channelBiases.clear();
+    channelResamplers.clear();
+    resampleInputOffsets.clear();
+    resampleContextRecords = 0;
+
+    numChannels = 0;
+    samplesPerRecord = 0;
+    sampleRate = 0;
+    totalSamples = 0;
+    currentRecord = -1;
+
+    if (signalGroups.empty())
+        return;
+
+    if (index >= 0 && index < (int)signalGroups.size())
+    {
+        channelSignals = signalGroups[index].signals;
+        samplesPerRecord = signalGroups[index].samplesPerRecord;
+        sampleRate = signalGroups[index].sampleRate;
     }
     else
     {
-        recordBuffer.resize(header.numSignals);
+        // Resampled stream: every data signal, in file order, at the fastest rate
         for (int i = 0; i < header.numSignals; i++)
-            recordBuffer[i].resize(signals[i].numSamplesPerRecord);
+        {
+            if (i != annotationSignalIndex && signals[i].numSamplesPerRecord > 0)
+                channelSignals.push_back(i);
+        }
+
+        samplesPerRecord = signalGroups[0].samplesPerRecord;
+        sampleRate = signalGroups[0].sampleRate;
     }
 
-    // Read each signal's data for this record
-    for (int sig = 0; sig < header.numSignals; sig++)
+    numChannels = (int)channelSignals.size();
+    totalSamples = (int64)samplesPerRecord * header.numDataRecords;
+
+    size_t resampleInputSize = 0;
+
+    for (int ch = 0; ch < numChannels; ch++)
     {
-        int numSamples = signals[sig].numSamplesPerRecord;
+        const EDFSignal& sig = signals[channelSignals[ch]];
 
-        if (header.isBDF)
+        // Physical = (Digital + offset) * scaleFactor, folded into one multiply-add
+        channelGains.push_back((float)sig.scaleFactor);
+        channelBiases.push_back((float)(sig.offset * sig.scaleFactor));
+
+        const PolyphaseResampler* resampler = nullptr;
+
+        if (sig.numSamplesPerRecord != samplesPerRecord)
         {
-            // 24-bit samples (3 bytes, little-endian, two's complement)
-            for (int s = 0; s < numSamples; s++)
-            {
-                uint8 bytes[3];
-                fileStream->read(bytes, 3);
-                int32 value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
-                // Sign extend
-                if (value & 0x800000)
-                    value |= 0xFF000000;
-                recordBuffer24[sig][s] = value;
-            }
+            resampler = resamplers[sig.numSamplesPerRecord].get();
+
+            int contextRecords = (resampler->getHalfLength() + sig.numSamplesPerRecord - 1) / sig.numSamplesPerRecord;
+            resampleContextRecords = jmax(resampleContextRecords, contextRecords);
         }
+
+        channelResamplers.push_back(resampler);
+    }
+
+    // Each resampled channel gets a window of (2 * context + 1) records
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        resampleInputOffsets.push_back(resampleInputSize);
+
+        if (channelResamplers[ch] != nullptr)
+            resampleInputSize += (size_t)(2 * resampleContextRecords + 1) * signals[channelSignals[ch]].numSamplesPerRecord;
+    }
+
+    resampleInput.resize(resampleInputSize);
+    decodedRecord.resize((size_t)numChannels * samplesPerRecord);
+
+    // Annotation onsets are stored in seconds; re-index them in this stream's samples
+    const ScopedLock sl(eventLock);
+    eventSampleRate = sampleRate;
+    buildEventIndex();
+}
+
+const uint8* EDFFileSource::getRecordData(int recordIndex)
+{
+    int64 recordPos = header.headerBytes + (int64)recordIndex * recordSize;
+
+    if (mappedFile != nullptr)
+    {
+        if (recordPos + recordSize > (int64)mappedFile->getSize())
+            return nullptr;
+
+        return static_cast<const uint8*>(mappedFile->getData()) + recordPos;
+    }
+
+    // Fall back to reading the whole record with a single call
+    if (recordIndex != rawRecordIndex)
+    {
+        rawRecordIndex = -1;
+
+        if (!fileStream->setPosition(recordPos)
+            || fileStream->read(rawRecord.get(), (int)recordSize) != (int)recordSize)
+            return nullptr;
+
+        rawRecordIndex = recordIndex;
+    }
+
+    return rawRecord.get();
+}
+
+bool EDFFileSource::readDataRecord(int recordIndex)
+{
+    if (!fileStream || recordIndex < 0 || recordIndex >= header.numDataRecords)
+        return false;
+
+    if (recordIndex == currentRecord)
+        return true;  // Already loaded
+
+    auto decode = [this](int ch, const uint8* record, float* dest)
+    {
+        const uint8* src = record + signalOffsets[channelSignals[ch]];
+        int numSamples = signals[channelSignals[ch]].numSamplesPerRecord;
+
+        if (header.isBDF)
+            EDFDecode::int24ToPhysical(dest, src, numSamples, channelGains[ch], channelBiases[ch]);
         else
+            EDFDecode::int16ToPhysical(dest, src, numSamples, channelGains[ch], channelBiases[ch]);
+    };
+
+    // Decode native-rate channels from this record, and the surrounding
+    // records of any resampled channels into their input windows
+    const int firstRecord = recordIndex - resampleContextRecords;
+    const int lastRecord = recordIndex + resampleContextRecords;
+    const int firstValid = jmax(firstRecord, 0);
+    const int lastValid = jmin(lastRecord, header.numDataRecords - 1);
+
+    for (int r = firstValid; r <= lastValid; r++)
+    {
+        const uint8* record = getRecordData(r);
+
+        if (record == nullptr)
+            return false;
+
+        for (int ch = 0; ch < numChannels; ch++)
         {
-            // 16-bit samples (2 bytes, little-endian)
-            for (int s = 0; s < numSamples; s++)
+            if (channelResamplers[ch] == nullptr)
             {
-                int16 value;
-                fileStream->read(&value, 2);
-                recordBuffer[sig][s] = value;
+                if (r == recordIndex)
+                    decode(ch, record, decodedRecord.data() + (size_t)ch * samplesPerRecord);
+            }
+            else
+            {
+                int spr = signals[channelSignals[ch]].numSamplesPerRecord;
+                decode(ch, record, resampleInput.data() + resampleInputOffsets[ch] + (size_t)(r - firstRecord) * spr);
             }
         }
     }
 
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        if (channelResamplers[ch] == nullptr)
+            continue;
+
+        int spr = signals[channelSignals[ch]].numSamplesPerRecord;
+        float* window = resampleInput.data() + resampleInputOffsets[ch];
+
+        // Hold the edge values past the start and end of the file
+        int validStart = (firstValid - firstRecord) * spr;
+        int validEnd = (lastValid - firstRecord + 1) * spr;
+        int windowSize = (lastRecord - firstRecord + 1) * spr;
+
+        std::fill(window, window + validStart, window[validStart]);
+        std::fill(window + validEnd, window + windowSize, window[validEnd - 1]);
+
+        channelResamplers[ch]->process(window,
+                                       (int64)firstRecord * spr,
+                                       (int64)recordIndex * samplesPerRecord,
+                                       decodedRecord.data() + (size_t)ch * samplesPerRecord,
+                                       samplesPerRecord);
+    }
+
     currentRecord = recordIndex;
     return true;
 }
@@ -275,20 +450,32 @@ bool EDFFileSource::readDataRecord(int recordIndex)
 bool EDFFileSource::open(File file)
 {
     // Reset all state from previous file
+    stopAnnotationScanner();
+    mappedFile.reset();
     if (fileStream)
         fileStream.reset();
     signals.clear();
-    recordBuffer.clear();
-    recordBuffer24.clear();
-    annotations.clear();
+    signalOffsets.clear();
+    signalGroups.clear();
+    resamplers.clear();
+    hasResampledStream = false;
+    decodedRecord.clear();
+    {
+        const ScopedLock sl(eventLock);
+        annotations.clear();
+        eventIndex.clear();
+    }
     header = EDFHeader();  // Reset header to defaults
+    rawRecordIndex = -1;
     currentRecord = -1;
     currentSample = 0;
     annotationSignalIndex = -1;
     sampleRate = 0;
     numChannels = 0;
+    samplesPerRecord = 0;
     totalSamples = 0;
     
+    edfFile = file;
     fileStream = std::make_unique<FileInputStream>(file);
 
     if (!fileStream->openedOk())
@@ -314,32 +501,38 @@ bool EDFFileSource::open(File file)
         return false;
     }
 
-    // Determine sample rate and channel count (excluding annotation channel)
-    numChannels = 0;
-    sampleRate = 0;
+    buildSignalGroups();
 
-    for (int i = 0; i < header.numSignals; i++)
+    if (signalGroups.empty())
     {
-        if (i == annotationSignalIndex)
-            continue;
+        LOGE("EDF: No data signals found");
+        fileStream.reset();
+        return false;
+    }
 
-        numChannels++;
-        
-        // Calculate sample rate from samples per record and record duration
-        double sigSampleRate = signals[i].numSamplesPerRecord / header.dataRecordDuration;
-        
-        if (sampleRate == 0)
-            sampleRate = sigSampleRate;
-        else if (std::abs(sampleRate - sigSampleRate) > 0.001)
-        {
-            LOGC("EDF: Warning - signals have different sample rates, using first: ", sampleRate);
-        }
+    for (const auto& group : signalGroups)
+        LOGC("  ", group.signals.size(), " signal(s) at ", group.sampleRate, " Hz");
+
+    // Map the file so data records can be decoded in place
+    mappedFile = std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+
+    if (mappedFile->getData() == nullptr)
+    {
+        LOGC("EDF: Could not memory-map file, reading records from disk");
+        mappedFile.reset();
+        rawRecord.allocate((size_t)recordSize, false);
     }
 
-    if (numChannels > 0)
-        totalSamples = signals[0].totalSamples;  // Assuming uniform sampling
+    selectStream(0);
+
+    // Decode EDF+ annotations without delaying playback
+    if (annotationSignalIndex >= 0 && header.isEDFPlus)
+    {
+        annotationScanner = std::make_unique<AnnotationScanner>(*this);
+        annotationScanner->startThread();
+    }
 
-    LOGC("EDF: Opened successfully - ", numChannels, " channels at ", sampleRate, " Hz");
+    LOGC("EDF: Opened successfully - ", signalGroups.size(), " stream(s), fastest ", sampleRate, " Hz");
 
     return true;
 }
@@ -348,37 +541,60 @@ void EDFFileSource::fillRecordInfo()
 {
     infoArray.clear();
 
-    // Create one record info for the entire file
-    RecordInfo info;
-    info.name = "EDF Recording";
-    info.sampleRate = (float)sampleRate;
-    info.numSamples = totalSamples;
-    info.startSampleNumber = 0;
-
-    // Add channel info
-    for (int i = 0; i < header.numSignals; i++)
+    auto addChannel = [this](RecordInfo& info, int sigIndex)
     {
-        if (i == annotationSignalIndex)
-            continue;
+        const EDFSignal& sig = signals[sigIndex];
 
         RecordedChannelInfo chInfo;
-        chInfo.name = signals[i].label;
+        chInfo.name = sig.label;
         
         // Convert units to microvolts if needed
-        String unit = signals[i].physicalDimension.toLowerCase();
+        String unit = sig.physicalDimension.toLowerCase();
         if (unit.contains("mv") || unit.contains("millivolt"))
-            chInfo.bitVolts = (float)(signals[i].scaleFactor * 1000.0);  // mV to µV
+            chInfo.bitVolts = (float)(sig.scaleFactor * 1000.0);  // mV to µV
         else if (unit.contains("v") && !unit.contains("uv") && !unit.contains("µv"))
-            chInfo.bitVolts = (float)(signals[i].scaleFactor * 1000000.0);  // V to µV
+            chInfo.bitVolts = (float)(sig.scaleFactor * 1000000.0);  // V to µV
         else
-            chInfo.bitVolts = (float)signals[i].scaleFactor;  // Already in µV or unknown
+            chInfo.bitVolts = (float)sig.scaleFactor;  // Already in µV or unknown
         
         chInfo.type = 0;  // Continuous data
         info.channels.add(chInfo);
+    };
+
+    // One record info per sample rate
+    for (const auto& group : signalGroups)
+    {
+        RecordInfo info;
+        info.name = hasResampledStream ? "EDF " + String(group.sampleRate, 2) + " Hz" : "EDF Recording";
+        info.sampleRate = (float)group.sampleRate;
+        info.numSamples = (int64)group.samplesPerRecord * header.numDataRecords;
+        info.startSampleNumber = 0;
+
+        for (int sig : group.signals)
+            addChannel(info, sig);
+
+        infoArray.add(info);
     }
 
-    infoArray.add(info);
-    numRecords = 1;
+    // Every signal brought up to the fastest rate
+    if (hasResampledStream)
+    {
+        RecordInfo info;
+        info.name = "EDF All Signals";
+        info.sampleRate = (float)signalGroups[0].sampleRate;
+        info.numSamples = (int64)signalGroups[0].samplesPerRecord * header.numDataRecords;
+        info.startSampleNumber = 0;
+
+        for (int i = 0; i < header.numSignals; i++)
+        {
+            if (i != annotationSignalIndex && signals[i].numSamplesPerRecord > 0)
+                addChannel(info, i);
+        }
+
+        infoArray.add(info);
+    }
+
+    numRecords = infoArray.size();
 }
 
 void EDFFileSource::updateActiveRecord(int index)
@@ -386,8 +602,8 @@ void EDFFileSource::updateActiveRecord(int index)
     if (index >= 0 && index < numRecords)
     {
         activeRecord = index;
+        selectStream(index);
         currentSample = 0;
-        currentRecord = -1;  // Force reload
     }
 }
 
@@ -403,11 +619,10 @@ void EDFFileSource::seekTo(int64 sampleNumber)
 
 int EDFFileSource::readData(float* buffer, int nSamples)
 {
-    if (!fileStream || numChannels == 0)
+    if (!fileStream || numChannels == 0 || samplesPerRecord <= 0)
         return 0;
 
     int samplesRead = 0;
-    int samplesPerRecord = signals[0].numSamplesPerRecord;
 
     while (samplesRead < nSamples && currentSample < totalSamples)
     {
@@ -419,36 +634,240 @@ int EDFFileSource::readData(float* buffer, int nSamples)
         if (!readDataRecord(recordIndex))
             break;
 
-        // Copy samples for all channels (interleaved: s1ch1, s1ch2, ..., s2ch1, s2ch2, ...)
-        int chIndex = 0;
-        for (int sig = 0; sig < header.numSignals; sig++)
-        {
-            if (sig == annotationSignalIndex)
-                continue;
+        // Copy as much of this record as fits
+        int samplesToCopy = jmin(nSamples - samplesRead, samplesPerRecord - sampleInRecord);
+        samplesToCopy = (int)jmin((int64)samplesToCopy, totalSamples - currentSample);
 
-            int digitalValue;
-            if (header.isBDF)
-                digitalValue = recordBuffer24[sig][sampleInRecord];
-            else
-                digitalValue = recordBuffer[sig][sampleInRecord];
+        // Interleave channels (s1ch1, s1ch2, ..., s2ch1, s2ch2, ...)
+        float* out = buffer + (size_t)samplesRead * numChannels;
 
-            buffer[samplesRead * numChannels + chIndex] = digitalToPhysical(sig, digitalValue);
-            chIndex++;
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const float* src = decodedRecord.data() + (size_t)ch * samplesPerRecord + sampleInRecord;
+
+            for (int s = 0; s < samplesToCopy; s++)
+                out[s * numChannels + ch] = src[s];
         }
 
-        samplesRead++;
-        currentSample++;
+        samplesRead += samplesToCopy;
+        currentSample += samplesToCopy;
     }
 
     return samplesRead;
 }
 
+void EDFFileSource::stopAnnotationScanner()
+{
+    if (annotationScanner != nullptr)
+    {
+        annotationScanner->stopThread(2000);
+        annotationScanner.reset();
+    }
+}
+
+void EDFFileSource::parseAnnotations()
+{
+    const EDFSignal& sig = signals[annotationSignalIndex];
+    const int numBytes = sig.numSamplesPerRecord * bytesPerSample;
+    const int64 signalOffset = signalOffsets[annotationSignalIndex];
+
+    // The main fileStream belongs to the reading thread, so use a separate
+    // stream when the file could not be mapped
+    std::unique_ptr<FileInputStream> stream;
+    HeapBlock<uint8> buffer;
+
+    if (mappedFile == nullptr)
+    {
+        stream = std::make_unique<FileInputStream>(edfFile);
+
+        if (!stream->openedOk())
+            return;
+
+        buffer.allocate((size_t)numBytes, false);
+    }
+
+    std::vector<EDFAnnotation> result;
+
+    for (int r = 0; r < header.numDataRecords; r++)
+    {
+        if (Thread::currentThreadShouldExit())
+            return;
+
+        int64 pos = header.headerBytes + (int64)r * recordSize + signalOffset;
+        const uint8* data = nullptr;
+
+        if (mappedFile != nullptr)
+        {
+            if (pos + numBytes > (int64)mappedFile->getSize())
+                break;
+
+            data = static_cast<const uint8*>(mappedFile->getData()) + pos;
+        }
+        else
+        {
+            if (!stream->setPosition(pos) || stream->read(buffer.get(), numBytes) != numBytes)
+                break;
+
+            data = buffer.get();
+        }
+
+        parseTALs(data, numBytes, r, result);
+    }
+
+    std::stable_sort(result.begin(), result.end(), [](const EDFAnnotation& a, const EDFAnnotation& b)
+                     { return a.onset < b.onset; });
+
+    LOGC("EDF: Found ", result.size(), " annotations");
+
+    const ScopedLock sl(eventLock);
+    annotations = std::move(result);
+    buildEventIndex();
+}
+
+void EDFFileSource::parseTALs(const uint8* data, int numBytes, int recordIndex, std::vector<EDFAnnotation>& result)
+{
+    // Each TAL is "+Onset[\x15Duration]\x14[Text\x14]...\x00". The first TAL of a
+    // record is a time-keeping entry whose onset is the start time of the record.
+    const double recordStart = recordIndex * header.dataRecordDuration;
+    double recordOnset = 0.0;
+    bool firstTAL = true;
+
+    int pos = 0;
+
+    while (pos < numBytes)
+    {
+        if (data[pos] == 0)
+        {
+            pos++;  // Padding between or after TALs
+            continue;
+        }
+
+        int end = pos;
+        while (end < numBytes && data[end] != 0)
+            end++;
+
+        // Split the TAL into its \x14-separated fields
+        StringArray fields;
+        int fieldStart = pos;
+
+        for (int i = pos; i <= end; i++)
+        {
+            if (i == end || data[i] == 0x14)
+            {
+                fields.add(String::fromUTF8((const char*)data + fieldStart, i - fieldStart));
+                fieldStart = i + 1;
+            }
+        }
+
+        pos = end + 1;
+
+        if (fields.isEmpty())
+            continue;
+
+        // The first field holds the onset and an optional \x15-separated duration
+        String timing = fields[0];
+        double onset = timing.upToFirstOccurrenceOf(String::charToString(0x15), false, false).getDoubleValue();
+        double duration = timing.fromFirstOccurrenceOf(String::charToString(0x15), false, false).getDoubleValue();
+
+        if (firstTAL)
+        {
+            recordOnset = onset;
+            firstTAL = false;
+        }
+
+        for (int f = 1; f < fields.size(); f++)
+        {
+            if (fields[f].isEmpty())
+                continue;
+
+            // Onsets are relative to the file start time, which may not be contiguous
+            // with the record index in EDF+D, so anchor them to the record they are in
+            EDFAnnotation annotation;
+            annotation.onset = recordStart + (onset - recordOnset);
+            annotation.duration = duration;
+            annotation.annotation = fields[f];
+            result.push_back(annotation);
+        }
+    }
+}
+
+void EDFFileSource::buildEventIndex()
+{
+    eventIndex.clear();
+
+    if (eventSampleRate <= 0)
+        return;
+
+    for (const auto& annotation : annotations)
+    {
+        int64 onset = (int64)std::llround(annotation.onset * eventSampleRate);
+
+        eventIndex.push_back({ onset, 0, 0, annotation.annotation });
+
+        if (annotation.duration > 0)
+        {
+            int64 offset = (int64)std::llround((annotation.onset + annotation.duration) * eventSampleRate);
+
+            eventIndex.push_back({ onset, 0, 1, String() });
+            eventIndex.push_back({ offset, 0, 0, String() });
+        }
+    }
+
+    std::stable_sort(eventIndex.begin(), eventIndex.end());
+}
+
 void EDFFileSource::processEventData(EventInfo& info, int64 fromSampleNumber, int64 toSampleNumber)
 {
-    // EDF+ annotations would be processed here
-    // For now, we return empty event info
-    info.channels.clear();
-    info.channelStates.clear();
-    info.sampleNumbers.clear();
-    info.text.clear();
+    // Never block playback on the annotation scan or a stream change; the events
+    // of blocks that find the lock busy are sent with the next block that gets it
+    const ScopedTryLock sl(eventLock);
+
+    if (!sl.isLocked())
+    {
+        if (unsentEventsFrom < 0)
+            unsentEventsFrom = fromSampleNumber;
+
+        return;
+    }
+
+    // Only if playback has moved straight on since; after a loop or a seek back,
+    // the unsent range is no longer the one that was played
+    if (unsentEventsFrom >= 0 && unsentEventsFrom < fromSampleNumber
+        && toSampleNumber - unsentEventsFrom < totalSamples)
+    {
+        fromSampleNumber = unsentEventsFrom;
+    }
+
+    unsentEventsFrom = -1;
+
+    if (eventIndex.empty() || totalSamples <= 0)
+        return;
+
+    int64 localFrom = fromSampleNumber % totalSamples;
+    int64 localTo = toSampleNumber % totalSamples;
+
+    auto addRange = [&](int64 from, int64 to)
+    {
+        AnnotationEvent key{ from, 0, 0, String() };
+        auto it = std::lower_bound(eventIndex.begin(), eventIndex.end(), key);
+
+        for (; it != eventIndex.end() && it->sampleNumber < to; ++it)
+        {
+            info.channels.push_back(it->channel);
+            info.channelStates.push_back(it->state);
+            info.sampleNumbers.push_back(it->sampleNumber);
+            info.text.push_back(it->text);
+        }
+    };
+
+    // Playback may have wrapped around the end of the file
+    if (localTo >= localFrom)
+    {
+        addRange(localFrom, localTo);
+    }
+    else
+    {
+        addRange(localFrom, totalSamples);
+        addRange(0, localTo);
+    }
 }
@@ -28,6 +28,8 @@
 #include <vector>
 #include <map>
 
+#include "PolyphaseResampler.h"
+
 /**
  * EDF File Source Plugin
  * 
@@ -38,6 +40,14 @@
  * - EDF (European Data Format)
  * - EDF+ (with annotations)
  * - BDF (BioSemi Data Format, 24-bit)
+ *
+ * Signals are grouped by sample rate and each group is exposed as its own
+ * stream. Files with more than one rate also get an "All Signals" stream in
+ * which the slower signals are upsampled to the fastest rate.
+ *
+ * EDF+ annotations are decoded on a background thread when the file is
+ * opened. Each one is sent as a text event at its onset, and annotations
+ * with a duration also hold TTL line 0 high until they end.
  */
 class EDFFileSource : public FileSource
 {
@@ -107,6 +117,14 @@ private:
         int64 totalSamples;
     };
 
+    // Data signals that share a sample rate
+    struct SignalGroup
+    {
+        int samplesPerRecord;
+        double sampleRate;
+        std::vector<int> signals;  // Indices into signals
+    };
+
     struct EDFAnnotation
     {
         double onset;       // Time in seconds
@@ -114,35 +132,115 @@ private:
         String annotation;  // Annotation text
     };
 
+    // An annotation onset or offset in the sample numbers of the active stream
+    struct AnnotationEvent
+    {
+        int64 sampleNumber;
+        int16 channel;
+        int16 state;
+        String text;
+
+        bool operator<(const AnnotationEvent& other) const
+        {
+            // Offsets sort before onsets on the same sample so back-to-back
+            // annotations leave the TTL line high
+            return sampleNumber < other.sampleNumber
+                || (sampleNumber == other.sampleNumber && state < other.state);
+        }
+    };
+
+    // Runs parseAnnotations() once per opened file
+    class AnnotationScanner : public Thread
+    {
+    public:
+        AnnotationScanner(EDFFileSource& owner_) : Thread("EDF Annotation Scanner"), owner(owner_) {}
+        void run() override { owner.parseAnnotations(); }
+
+    private:
+        EDFFileSource& owner;
+    };
+
     /** Parse the EDF header */
     bool parseHeader();
 
     /** Parse signal headers */
     bool parseSignalHeaders();
 
-    /** Parse annotations from EDF+ */
+    /** Parse annotations from every data record of an EDF+ file (called on annotationScanner) */
     void parseAnnotations();
 
+    /** Parse the time-stamped annotation lists (TALs) of one data record */
+    void parseTALs(const uint8* data, int numBytes, int recordIndex, std::vector<EDFAnnotation>& result);
+
+    /** Convert annotations to the sorted event index for the active stream (eventLock must be held) */
+    void buildEventIndex();
+
+    /** Stop any running annotation scan */
+    void stopAnnotationScanner();
+
     /** Read a fixed-length ASCII string from file */
     String readAscii(int length);
 
-    /** Read a data record from file */
+    /** Load and decode a data record of the active stream into decodedRecord */
     bool readDataRecord(int recordIndex);
 
-    /** Convert digital value to physical value */
-    float digitalToPhysical(int signalIndex, int digitalValue);
+    /** Returns the raw bytes of a data record, or nullptr if it cannot be read */
+    const uint8* getRecordData(int recordIndex);
+
+    /** Compute the record layout and group data signals by sample rate */
+    void buildSignalGroups();
+
+    /** Set up the per-channel decoding tables for a stream */
+    void selectStream(int index);
 
     // File handle
     std::unique_ptr<FileInputStream> fileStream;
+    File edfFile;
+
+    // Read-only mapping of the whole file; null if mapping failed, in which
+    // case whole data records are read through fileStream instead
+    std::unique_ptr<MemoryMappedFile> mappedFile;
 
     // Header information
     EDFHeader header;
     std::vector<EDFSignal> signals;
-    std::vector<EDFAnnotation> annotations;
-
-    // Data record buffer
-    std::vector<std::vector<int16>> recordBuffer;  // [signal][sample]
-    std::vector<std::vector<int32>> recordBuffer24; // For BDF (24-bit)
+    std::vector<EDFAnnotation> annotations;  // Guarded by eventLock
+
+    // Annotation events sorted by sample number, for binary search in processEventData
+    std::unique_ptr<AnnotationScanner> annotationScanner;
+    CriticalSection eventLock;
+    std::vector<AnnotationEvent> eventIndex;
+    double eventSampleRate;
+    int64 unsentEventsFrom;  // First sample of blocks whose events were not sent, -1 if none (playback thread only)
+
+    // Data record layout
+    int bytesPerSample;
+    int64 recordSize;                   // bytes per data record
+    std::vector<int64> signalOffsets;   // byte offset of each signal within a record
+
+    // Streams: one per sample rate (fastest first), plus an optional
+    // stream with every signal resampled to the fastest rate
+    std::vector<SignalGroup> signalGroups;
+    bool hasResampledStream;
+
+    // Filter banks for upsampling each slower group, keyed by samplesPerRecord
+    std::map<int, std::unique_ptr<PolyphaseResampler>> resamplers;
+
+    // Per-channel decoding tables for the active stream
+    std::vector<int> channelSignals;    // signal index for each channel
+    std::vector<float> channelGains;    // physical = digital * gain + bias
+    std::vector<float> channelBiases;
+    std::vector<const PolyphaseResampler*> channelResamplers;  // nullptr at native rate
+
+    // Records either side of the current one needed to resample it
+    int resampleContextRecords;
+    std::vector<size_t> resampleInputOffsets;  // start of each channel in resampleInput
+    std::vector<float> resampleInput;
+
+    // Data record buffers
+    HeapBlock<uint8> rawRecord;         // used when the file is not mapped
+    int rawRecordIndex;
+    std::vector<float> decodedRecord;   // [channel * samplesPerRecord + sample]
     int currentRecord;
 
     // Reading state
@@ -152,6 +250,7 @@ private:
     // Computed values
     double sampleRate;
     int numChannels;
+    int samplesPerRecord;
     int64 totalSamples;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EDFFileSource);
@@ -0,0 +1,159 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef EDF_SAMPLE_DECODER_H_DEFINED
+#define EDF_SAMPLE_DECODER_H_DEFINED
+
+#include <JuceHeader.h>
+
+#if JUCE_USE_SSE_INTRINSICS
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#elif JUCE_USE_ARM_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ * Bulk decoders for EDF/BDF data records.
+ *
+ * Each signal occupies a contiguous run of little-endian two's complement
+ * samples inside a data record, so a whole signal can be unpacked and
+ * converted to physical units in one pass:
+ *
+ *   physical = digital * gain + bias
+ *
+ * where gain and bias are precomputed per channel from the signal header.
+ */
+namespace EDFDecode
+{
+
+/** Decodes numSamples 16-bit EDF samples from src into dest */
+inline void int16ToPhysical (float* dest, const uint8* src, int numSamples, float gain, float bias) noexcept
+{
+    int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+    const __m128 g = _mm_set1_ps (gain);
+    const __m128 b = _mm_set1_ps (bias);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (src + i * 2));
+
+        // Duplicate each int16 into both halves of an int32, then shift down to sign extend
+        const __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+        const __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+        _mm_storeu_ps (dest + i, _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (lo), g), b));
+        _mm_storeu_ps (dest + i + 4, _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (hi), g), b));
+    }
+#elif JUCE_USE_ARM_NEON
+    const float32x4_t g = vdupq_n_f32 (gain);
+    const float32x4_t b = vdupq_n_f32 (bias);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const int16x8_t v = vreinterpretq_s16_u8 (vld1q_u8 (src + i * 2));
+
+        vst1q_f32 (dest + i, vmlaq_f32 (b, vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v))), g));
+        vst1q_f32 (dest + i + 4, vmlaq_f32 (b, vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v))), g));
+    }
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        const int16 value = (int16) (src[i * 2] | (src[i * 2 + 1] << 8));
+        dest[i] = (float) value * gain + bias;
+    }
+}
+
+/** Decodes numSamples 24-bit BDF samples from src into dest */
+inline void int24ToPhysical (float* dest, const uint8* src, int numSamples, float gain, float bias) noexcept
+{
+    int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+    const __m128 g = _mm_set1_ps (gain);
+    const __m128 b = _mm_set1_ps (bias);
+
+#if defined(__SSSE3__)
+    // Move each 3-byte sample into the top of a 32-bit lane; the arithmetic
+    // shift below then sign extends it. Each load reads 16 bytes but only
+    // consumes 12, so stop while a full load is still inside the signal.
+    const __m128i shuffle = _mm_setr_epi8 (-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+
+    for (; i + 6 <= numSamples; i += 4)
+    {
+        const __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (src + i * 3));
+        const __m128i s = _mm_srai_epi32 (_mm_shuffle_epi8 (v, shuffle), 8);
+
+        _mm_storeu_ps (dest + i, _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (s), g), b));
+    }
+#else
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const uint8* p = src + i * 3;
+
+        const __m128i s = _mm_srai_epi32 (_mm_setr_epi32 ((int32) ((uint32) p[0] << 8 | (uint32) p[1] << 16 | (uint32) p[2] << 24),
+                                                          (int32) ((uint32) p[3] << 8 | (uint32) p[4] << 16 | (uint32) p[5] << 24),
+                                                          (int32) ((uint32) p[6] << 8 | (uint32) p[7] << 16 | (uint32) p[8] << 24),
+                                                          (int32) ((uint32) p[9] << 8 | (uint32) p[10] << 16 | (uint32) p[11] << 24)),
+                                          8);
+
+        _mm_storeu_ps (dest + i, _mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (s), g), b));
+    }
+#endif
+#elif JUCE_USE_ARM_NEON
+    const float32x4_t g = vdupq_n_f32 (gain);
+    const float32x4_t b = vdupq_n_f32 (bias);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        // De-interleave 8 samples into their low, middle and high bytes
+        const uint8x8x3_t v = vld3_u8 (src + i * 3);
+
+        const uint16x8_t lo16 = vshll_n_u8 (v.val[0], 8);
+        const uint16x8_t hi16 = vorrq_u16 (vshll_n_u8 (v.val[2], 8), vmovl_u8 (v.val[1]));
+
+        // Assemble (high << 24 | mid << 16 | low << 8) and sign extend with an arithmetic shift
+        const int32x4_t a = vshrq_n_s32 (vreinterpretq_s32_u32 (vorrq_u32 (vshll_n_u16 (vget_low_u16 (hi16), 16), vmovl_u16 (vget_low_u16 (lo16)))), 8);
+        const int32x4_t c = vshrq_n_s32 (vreinterpretq_s32_u32 (vorrq_u32 (vshll_n_u16 (vget_high_u16 (hi16), 16), vmovl_u16 (vget_high_u16 (lo16)))), 8);
+
+        vst1q_f32 (dest + i, vmlaq_f32 (b, vcvtq_f32_s32 (a), g));
+        vst1q_f32 (dest + i + 4, vmlaq_f32 (b, vcvtq_f32_s32 (c), g));
+    }
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        const uint8* p = src + i * 3;
+        const int32 value = (int32) ((uint32) p[0] << 8 | (uint32) p[1] << 16 | (uint32) p[2] << 24) >> 8;
+        dest[i] = (float) value * gain + bias;
+    }
+}
+
+} // namespace EDFDecode
+
+#endif // EDF_SAMPLE_DECODER_H_DEFINED
@@ -0,0 +1,89 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "PolyphaseResampler.h"
+#include <numeric>
+
+PolyphaseResampler::PolyphaseResampler(int inputRate, int outputRate, int tapsPerPhase_)
+    : tapsPerPhase(jmax(2, tapsPerPhase_ & ~1))
+{
+    jassert(inputRate > 0 && outputRate >= inputRate);
+
+    int divisor = std::gcd(inputRate, outputRate);
+    upFactor = outputRate / divisor;
+    downFactor = inputRate / divisor;
+
+    const int halfLength = getHalfLength();
+    bank.resize((size_t)upFactor * tapsPerPhase);
+
+    for (int phase = 0; phase < upFactor; phase++)
+    {
+        float* taps = bank.data() + (size_t)phase * tapsPerPhase;
+        const double fraction = (double)phase / upFactor;
+        double sum = 0.0;
+
+        for (int tap = 0; tap < tapsPerPhase; tap++)
+        {
+            // Distance from the output position to this tap's input sample
+            const double t = fraction + (halfLength - 1 - tap);
+
+            double sinc = 1.0;
+            if (t != 0.0)
+                sinc = std::sin(MathConstants<double>::pi * t) / (MathConstants<double>::pi * t);
+
+            // Blackman window spanning (-halfLength, halfLength)
+            const double x = 0.5 + t / (2.0 * halfLength);
+            const double window = 0.42 - 0.5 * std::cos(2.0 * MathConstants<double>::pi * x)
+                                       + 0.08 * std::cos(4.0 * MathConstants<double>::pi * x);
+
+            taps[tap] = (float)(sinc * window);
+            sum += taps[tap];
+        }
+
+        // Normalise each phase to unity DC gain
+        for (int tap = 0; tap < tapsPerPhase; tap++)
+            taps[tap] = (float)(taps[tap] / sum);
+    }
+}
+
+void PolyphaseResampler::process(const float* input, int64 inputStart, int64 firstOutput, float* output, int numOutput) const
+{
+    const int halfLength = getHalfLength();
+
+    int64 position = firstOutput * downFactor;
+
+    for (int n = 0; n < numOutput; n++, position += downFactor)
+    {
+        const int64 inputIndex = position / upFactor;
+        const int phase = (int)(position % upFactor);
+
+        const float* x = input + (inputIndex - inputStart - halfLength + 1);
+        const float* taps = bank.data() + (size_t)phase * tapsPerPhase;
+
+        float acc = 0.0f;
+        for (int tap = 0; tap < tapsPerPhase; tap++)
+            acc += x[tap] * taps[tap];
+
+        output[n] = acc;
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef POLYPHASE_RESAMPLER_H_DEFINED
+#define POLYPHASE_RESAMPLER_H_DEFINED
+
+#include <JuceHeader.h>
+#include <vector>
+
+/**
+ * Rational-ratio upsampler using a precomputed polyphase filter bank.
+ *
+ * Converts a signal sampled at inputRate to outputRate (outputRate >= inputRate)
+ * with a Blackman-windowed sinc interpolation kernel. The ratio is reduced to
+ * upFactor / downFactor, and one branch of tapsPerPhase coefficients is stored
+ * for each of the upFactor output phases, so every output sample costs a single
+ * short dot product with no per-sample coefficient evaluation.
+ *
+ * Output sample n sits at input position n * downFactor / upFactor. The
+ * resampler itself is stateless: callers pass a window of input samples that
+ * covers getHalfLength() samples either side of the requested output range,
+ * which makes seeking free.
+ */
+class PolyphaseResampler
+{
+public:
+    /** Builds the filter bank for converting inputRate to outputRate */
+    PolyphaseResampler(int inputRate, int outputRate, int tapsPerPhase = 16);
+
+    /** Number of input samples needed on each side of an output position */
+    int getHalfLength() const { return tapsPerPhase / 2; }
+
+    /** Reduced interpolation factor */
+    int getUpFactor() const { return upFactor; }
+
+    /** Reduced decimation factor */
+    int getDownFactor() const { return downFactor; }
+
+    /**
+     * Computes numOutput samples starting at output index firstOutput.
+     *
+     * input holds consecutive input samples, the first of which has input
+     * index inputStart. It must cover every input index from
+     * (firstOutput * downFactor / upFactor) - getHalfLength() + 1 to
+     * ((firstOutput + numOutput - 1) * downFactor / upFactor) + getHalfLength().
+     */
+    void process(const float* input, int64 inputStart, int64 firstOutput, float* output, int numOutput) const;
+
+private:
+    int upFactor;
+    int downFactor;
+    int tapsPerPhase;
+
+    // [phase * tapsPerPhase + tap], taps ordered by increasing input index
+    std::vector<float> bank;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResampler);
+};
+
+#endif // POLYPHASE_RESAMPLER_H_DEFINED
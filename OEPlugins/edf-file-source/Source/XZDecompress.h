@@ -9,6 +9,7 @@
 #define XZ_DECOMPRESS_H
 
 #include <JuceHeader.h>
+#include <algorithm>
 #include <vector>
 #include <cstdint>
 
@@ -39,8 +40,11 @@ typedef uint64_t lzma_vli;
 
 #define LZMA_CONCATENATED       0x08
 #define LZMA_RUN                0
+#define LZMA_FULL_FLUSH         2
 #define LZMA_FINISH             3
 
+#define LZMA_CHECK_CRC64        4
+
 typedef struct {
     const uint8_t* next_in;
     size_t avail_in;
@@ -72,6 +76,7 @@ typedef struct {
 typedef lzma_ret (*lzma_stream_decoder_fn)(lzma_stream*, uint64_t, uint32_t);
 typedef lzma_ret (*lzma_code_fn)(lzma_stream*, uint32_t);
 typedef void (*lzma_end_fn)(lzma_stream*);
+typedef lzma_ret (*lzma_easy_encoder_fn)(lzma_stream*, uint32_t, uint32_t);
 
 /**
  * LZMA Library wrapper with dynamic loading
@@ -102,6 +107,14 @@ public:
             fn_end(strm);
     }
     
+    bool canEncode() const { return available && fn_easy_encoder != nullptr; }
+    
+    lzma_ret easy_encoder(lzma_stream* strm, uint32_t preset, uint32_t check) {
+        if (fn_easy_encoder)
+            return fn_easy_encoder(strm, preset, check);
+        return LZMA_PROG_ERROR;
+    }
+    
 private:
     LZMALibrary() : available(false), handle(nullptr) {
         loadLibrary();
@@ -128,7 +141,14 @@ private:
             "liblzma.dll",
             // Common installation locations
             "C:/Program Files/xz/bin/liblzma.dll",
-            "C:/xz/bin/liblzma.dll"
+            "C:/xz/bin/liblzma.dll",
+#if JUCE_MAC
+            "liblzma.5.dylib",
+            "/opt/homebrew/lib/liblzma.5.dylib",
+            "/usr/local/lib/liblzma.5.dylib",
+#elif JUCE_LINUX
+            "liblzma.so.5",
+#endif
         };
         
         for (const auto& path : searchPaths) {
@@ -154,10 +174,12 @@ private:
         fn_stream_decoder = (lzma_stream_decoder_fn)GetProcAddress((HMODULE)handle, "lzma_stream_decoder");
         fn_code = (lzma_code_fn)GetProcAddress((HMODULE)handle, "lzma_code");
         fn_end = (lzma_end_fn)GetProcAddress((HMODULE)handle, "lzma_end");
+        fn_easy_encoder = (lzma_easy_encoder_fn)GetProcAddress((HMODULE)handle, "lzma_easy_encoder");
 #else
         fn_stream_decoder = (lzma_stream_decoder_fn)dlsym(handle, "lzma_stream_decoder");
         fn_code = (lzma_code_fn)dlsym(handle, "lzma_code");
         fn_end = (lzma_end_fn)dlsym(handle, "lzma_end");
+        fn_easy_encoder = (lzma_easy_encoder_fn)dlsym(handle, "lzma_easy_encoder");
 #endif
         
         available = (fn_stream_decoder && fn_code && fn_end);
@@ -174,6 +196,7 @@ private:
     lzma_stream_decoder_fn fn_stream_decoder = nullptr;
     lzma_code_fn fn_code = nullptr;
     lzma_end_fn fn_end = nullptr;
+    lzma_easy_encoder_fn fn_easy_encoder = nullptr;  // Optional, only needed for writing
 };
 
 /**
@@ -304,16 +327,180 @@ inline bool readFileLines(const File& file, StringArray& lines)
 }
 
 /**
- * Get decompressed file size (useful for progress indication)
+ * Block layout of an .xz file, read from the index at the end of each stream
+ */
+struct XZIndex {
+    struct Stream {
+        int64 headerOffset = 0;        // File offset of the 12-byte stream header
+        uint8_t header[12] = {};
+        int64 blocksEnd = 0;           // File offset just past the last block
+        int64 uncompressedEnd = 0;     // Uncompressed offset just past the last block
+        int firstBlock = 0;
+        int numBlocks = 0;
+    };
+    
+    struct Block {
+        int64 compressedOffset = 0;    // File offset of the block header
+        int64 uncompressedOffset = 0;
+        int64 uncompressedSize = 0;
+        int stream = 0;
+    };
+    
+    std::vector<Stream> streams;
+    std::vector<Block> blocks;
+    int64 uncompressedSize = 0;
+    
+    /** Returns the block containing an uncompressed position (the last block if past the end) */
+    int findBlock(int64 position) const {
+        auto it = std::upper_bound(blocks.begin(), blocks.end(), position,
+                                   [](int64 p, const Block& b) { return p < b.uncompressedOffset; });
+        return jmax(0, (int)(it - blocks.begin()) - 1);
+    }
+};
+
+/**
+ * Reads a variable-length integer from an xz index; returns false if malformed
+ */
+inline bool readVLI(const uint8_t*& p, const uint8_t* end, int64& value) {
+    uint64_t result = 0;
+    
+    for (int i = 0; i < 9 && p < end; i++) {
+        uint8_t byte = *p++;
+        result |= (uint64_t)(byte & 0x7F) << (7 * i);
+        
+        if ((byte & 0x80) == 0) {
+            value = (int64)result;
+            return (byte != 0 || i == 0) && result <= (uint64_t)INT64_MAX;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Parse the stream footers and indexes of an .xz file, walking backwards
+ * from the end so concatenated streams and stream padding are handled.
+ * Only the index structure is validated; block data is checked by the
+ * decoder as it is read.
+ */
+inline bool readIndex(const File& file, XZIndex& index) {
+    static const uint8_t headerMagic[6] = { 0xFD, '7', 'z', 'X', 'Z', 0x00 };
+    
+    index = XZIndex();
+    
+    FileInputStream stream(file);
+    if (!stream.openedOk())
+        return false;
+    
+    int64 pos = stream.getTotalLength();
+    std::vector<XZIndex::Stream> streams;
+    std::vector<std::vector<XZIndex::Block>> streamBlocks;
+    
+    while (pos > 0) {
+        uint8_t word[4];
+        
+        // Skip stream padding
+        if (pos % 4 != 0 || pos < 12 || !stream.setPosition(pos - 4) || stream.read(word, 4) != 4)
+            return false;
+        
+        if (word[0] == 0 && word[1] == 0 && word[2] == 0 && word[3] == 0) {
+            pos -= 4;
+            continue;
+        }
+        
+        // Stream footer: CRC32, backward size, flags, "YZ"
+        uint8_t footer[12];
+        if (!stream.setPosition(pos - 12) || stream.read(footer, 12) != 12 || footer[10] != 'Y' || footer[11] != 'Z')
+            return false;
+        
+        const int64 indexSize = ((int64)ByteOrder::littleEndianInt(footer + 4) + 1) * 4;
+        const int64 indexOffset = pos - 12 - indexSize;
+        
+        if (indexOffset < 12)
+            return false;
+        
+        MemoryBlock indexData((size_t)indexSize);
+        if (!stream.setPosition(indexOffset) || stream.read(indexData.getData(), (int)indexSize) != (int)indexSize)
+            return false;
+        
+        // Index: indicator, record count, (unpadded, uncompressed) sizes, padding, CRC32
+        const uint8_t* p = (const uint8_t*)indexData.getData();
+        const uint8_t* end = p + indexSize - 4;
+        int64 numRecords = 0;
+        
+        if (*p++ != 0 || !readVLI(p, end, numRecords) || numRecords > indexSize)
+            return false;
+        
+        std::vector<XZIndex::Block> blocks;
+        int64 blocksSize = 0;
+        
+        for (int64 i = 0; i < numRecords; i++) {
+            int64 unpaddedSize, uncompressedSize;
+            if (!readVLI(p, end, unpaddedSize) || !readVLI(p, end, uncompressedSize) || unpaddedSize < 5)
+                return false;
+            
+            XZIndex::Block block;
+            block.compressedOffset = blocksSize;  // Relative to the first block for now
+            block.uncompressedOffset = 0;
+            block.uncompressedSize = uncompressedSize;
+            blocks.push_back(block);
+            
+            blocksSize += (unpaddedSize + 3) & ~(int64)3;
+        }
+        
+        while (p < end) {
+            if (*p++ != 0)
+                return false;
+        }
+        
+        XZIndex::Stream info;
+        info.headerOffset = indexOffset - blocksSize - 12;
+        info.blocksEnd = indexOffset;
+        
+        if (info.headerOffset < 0 || !stream.setPosition(info.headerOffset) || stream.read(info.header, 12) != 12
+            || memcmp(info.header, headerMagic, 6) != 0 || memcmp(info.header + 6, footer + 8, 2) != 0)
+            return false;
+        
+        for (auto& block : blocks)
+            block.compressedOffset += info.headerOffset + 12;
+        
+        streams.insert(streams.begin(), info);
+        streamBlocks.insert(streamBlocks.begin(), std::move(blocks));
+        pos = info.headerOffset;
+    }
+    
+    // Number the blocks in file order
+    for (size_t s = 0; s < streams.size(); s++) {
+        streams[s].firstBlock = (int)index.blocks.size();
+        streams[s].numBlocks = (int)streamBlocks[s].size();
+        
+        for (auto& block : streamBlocks[s]) {
+            block.stream = (int)s;
+            block.uncompressedOffset = index.uncompressedSize;
+            index.uncompressedSize += block.uncompressedSize;
+            index.blocks.push_back(block);
+        }
+        
+        streams[s].uncompressedEnd = index.uncompressedSize;
+    }
+    
+    index.streams = std::move(streams);
+    return !index.streams.empty();
+}
+
+/**
+ * Get decompressed file size from the xz index, or -1 if it cannot be read
  */
 inline int64 getDecompressedSize(const File& file)
 {
     if (!hasXZExtension(file) && !isXZFile(file))
         return file.getSize();
     
-    // XZ files store uncompressed size in footer (last 12 bytes)
-    // This is a simplified estimate - actual size may vary
-    return file.getSize() * 5; // Typical compression ratio estimate
+    XZIndex index;
+    if (!readIndex(file, index))
+        return -1;
+    
+    return index.uncompressedSize;
 }
 
 } // namespace XZDecompress
@@ -0,0 +1,428 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "XZInputStream.h"
+
+namespace
+{
+/** Bytes of compressed input read per call */
+constexpr int COMPRESSED_CHUNK_SIZE = 64 * 1024;
+
+/** Bytes decoded into the first buffer after a start or seek */
+constexpr int FIRST_FILL_SIZE = 16 * 1024;
+
+/** Most bytes decoded per call to the decoder, so a stop request is seen quickly */
+constexpr int DECODE_STEP_SIZE = 64 * 1024;
+} // namespace
+
+XZInputStream::XZInputStream(const File& f, int size)
+    : Thread("XZ Decoder"),
+      file(f),
+      bufferSize(jmax(4096, size)),
+      opened(false),
+      hasIndex(false),
+      startBlock(0),
+      strmInitialised(false),
+      inputFinished(false),
+      currentStream(0),
+      compressedBytesLeft(0),
+      outputBytesLeft(0),
+      fillSize(0),
+      decoderFinished(false),
+      decodeError(false),
+      totalLength(-1),
+      readBufferIndex(0),
+      readOffset(0),
+      position(0)
+{
+    strm = LZMA_STREAM_INIT;
+
+    if (!XZDecompress::LZMALibrary::getInstance().isAvailable())
+    {
+        LOGE("XZ: Cannot decompress - liblzma not available");
+        return;
+    }
+
+    if (!FileInputStream(file).openedOk())
+    {
+        LOGE("XZ: Failed to open file: ", file.getFullPathName());
+        return;
+    }
+
+    hasIndex = XZDecompress::readIndex(file, index);
+
+    if (hasIndex)
+        totalLength = index.uncompressedSize;
+    else
+        LOGC("XZ: No usable block index in ", file.getFileName(), ", seeking will decode from the start");
+
+    compressedChunk.malloc(COMPRESSED_CHUNK_SIZE);
+
+    for (auto& buffer : buffers)
+        buffer.data.malloc(bufferSize);
+
+    opened = true;
+    startThread();
+}
+
+XZInputStream::~XZInputStream()
+{
+    signalThreadShouldExit();
+    bufferEmptied.signal();
+    stopThread(5000);
+}
+
+void XZInputStream::run()
+{
+    compressed = std::make_unique<FileInputStream>(file);
+
+    bool moreData = false;
+
+    if (!compressed->openedOk())
+    {
+        LOGE("XZ: Failed to open file: ", file.getFullPathName());
+        decodeError = true;
+    }
+    else
+    {
+        moreData = beginSegment(startBlock);
+    }
+
+    int fillIndex = 0;
+    fillSize = jmin(bufferSize, FIRST_FILL_SIZE);
+
+    while (moreData && !threadShouldExit())
+    {
+        Buffer& buffer = buffers[fillIndex];
+
+        // Wait for the reader to hand this buffer back
+        bool isFull;
+        {
+            const ScopedLock lock(bufferLock);
+            isFull = buffer.full;
+        }
+
+        if (isFull)
+        {
+            bufferEmptied.wait(-1);
+            continue;
+        }
+
+        int numBytes = 0;
+        moreData = decodeInto(buffer.data, numBytes);
+
+        {
+            const ScopedLock lock(bufferLock);
+            buffer.numBytes = numBytes;
+            buffer.full = numBytes > 0;
+        }
+
+        bufferFilled.signal();
+        fillIndex ^= 1;
+    }
+
+    endSegment();
+    compressed.reset();
+
+    // Let a waiting reader see the end of the data; on exit requests the
+    // reader is the one stopping us, so it is not waiting
+    {
+        const ScopedLock lock(bufferLock);
+        decoderFinished = true;
+    }
+
+    bufferFilled.signal();
+}
+
+bool XZInputStream::beginSegment(int blockIndex)
+{
+    auto& lzma = XZDecompress::LZMALibrary::getInstance();
+
+    endSegment();
+
+    uint32_t flags = 0;
+
+    if (hasIndex)
+    {
+        if (blockIndex >= (int)index.blocks.size())
+            return false;
+
+        const auto& block = index.blocks[(size_t)blockIndex];
+        const auto& stream = index.streams[(size_t)block.stream];
+
+        currentStream = block.stream;
+        compressedBytesLeft = stream.blocksEnd - block.compressedOffset;
+        outputBytesLeft = stream.uncompressedEnd - block.uncompressedOffset;
+
+        if (!compressed->setPosition(block.compressedOffset))
+        {
+            decodeError = true;
+            return false;
+        }
+    }
+    else
+    {
+        flags = LZMA_CONCATENATED;
+        compressedBytesLeft = compressed->getTotalLength();
+        compressed->setPosition(0);
+    }
+
+    if (lzma.stream_decoder(&strm, UINT64_MAX, flags) != LZMA_OK)
+    {
+        LOGE("XZ: Failed to initialize decoder");
+        decodeError = true;
+        return false;
+    }
+
+    strmInitialised = true;
+    inputFinished = false;
+
+    if (hasIndex)
+    {
+        // The decoder expects a stream header, so give it this stream's
+        // before the block data
+        strm.next_in = index.streams[(size_t)currentStream].header;
+        strm.avail_in = sizeof(index.streams[(size_t)currentStream].header);
+    }
+
+    return true;
+}
+
+void XZInputStream::endSegment()
+{
+    if (strmInitialised)
+    {
+        XZDecompress::LZMALibrary::getInstance().end(&strm);
+        strm = LZMA_STREAM_INIT;
+        strmInitialised = false;
+    }
+}
+
+bool XZInputStream::decodeInto(HeapBlock<char>& dest, int& numBytes)
+{
+    auto& lzma = XZDecompress::LZMALibrary::getInstance();
+
+    const int fillTo = fillSize;
+    fillSize = jmin(bufferSize, fillSize * 2);
+
+    uint8_t* nextOut = reinterpret_cast<uint8_t*>(dest.get());
+    numBytes = 0;
+
+    while (numBytes < fillTo)
+    {
+        // Checked between steps, so restart() does not wait for a whole buffer
+        if (threadShouldExit())
+            return false;
+
+        if (hasIndex && outputBytesLeft == 0)
+        {
+            // All blocks of this stream are decoded. Its index is not fed
+            // to the decoder (it would not match when starting mid-stream),
+            // so move straight on to the next stream's blocks.
+            const auto& stream = index.streams[(size_t)currentStream];
+            const int nextBlock = stream.firstBlock + stream.numBlocks;
+
+            if (nextBlock >= (int)index.blocks.size() || !beginSegment(nextBlock))
+                return false;
+
+            continue;
+        }
+
+        if (strm.avail_in == 0 && !inputFinished)
+        {
+            int bytesRead = compressed->read(compressedChunk, (int)jmin((int64)COMPRESSED_CHUNK_SIZE, compressedBytesLeft));
+
+            if (bytesRead > 0)
+            {
+                strm.next_in = compressedChunk;
+                strm.avail_in = (size_t)bytesRead;
+                compressedBytesLeft -= bytesRead;
+            }
+            else
+            {
+                inputFinished = true;
+            }
+        }
+
+        const size_t step = (size_t)jmin(fillTo - numBytes, DECODE_STEP_SIZE);
+        strm.next_out = nextOut;
+        strm.avail_out = step;
+
+        XZDecompress::lzma_ret ret = lzma.code(&strm, (inputFinished && !hasIndex) ? LZMA_FINISH : LZMA_RUN);
+        const size_t produced = step - strm.avail_out;
+
+        nextOut += produced;
+        numBytes += (int)produced;
+
+        if (hasIndex)
+            outputBytesLeft -= (int64)produced;
+
+        if (ret == LZMA_STREAM_END)
+        {
+            totalLength = (int64)strm.total_out;
+            return false;
+        }
+
+        const bool truncated = hasIndex && inputFinished && strm.avail_in == 0 && produced == 0;
+
+        if (ret != LZMA_OK || truncated)
+        {
+            LOGE("XZ: Decompression error: ", truncated ? (int)LZMA_BUF_ERROR : (int)ret);
+            decodeError = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool XZInputStream::waitForReadBuffer()
+{
+    for (;;)
+    {
+        {
+            const ScopedLock lock(bufferLock);
+
+            if (buffers[readBufferIndex].full)
+                return true;
+
+            if (decoderFinished)
+                return false;
+        }
+
+        bufferFilled.wait(-1);
+    }
+}
+
+void XZInputStream::releaseReadBuffer()
+{
+    {
+        const ScopedLock lock(bufferLock);
+        buffers[readBufferIndex].full = false;
+    }
+
+    readBufferIndex ^= 1;
+    readOffset = 0;
+    bufferEmptied.signal();
+}
+
+void XZInputStream::restart(int blockIndex)
+{
+    signalThreadShouldExit();
+    bufferEmptied.signal();
+    stopThread(5000);
+
+    for (auto& buffer : buffers)
+    {
+        buffer.numBytes = 0;
+        buffer.full = false;
+    }
+
+    decoderFinished = false;
+    bufferFilled.reset();
+    bufferEmptied.reset();
+
+    startBlock = blockIndex;
+    readBufferIndex = 0;
+    readOffset = 0;
+    position = (hasIndex && blockIndex < (int)index.blocks.size()) ? index.blocks[(size_t)blockIndex].uncompressedOffset : 0;
+
+    startThread();
+}
+
+int64 XZInputStream::getTotalLength()
+{
+    return totalLength.load();
+}
+
+bool XZInputStream::isExhausted()
+{
+    const ScopedLock lock(bufferLock);
+    return decoderFinished && !buffers[readBufferIndex].full;
+}
+
+int XZInputStream::read(void* destBuffer, int maxBytesToRead)
+{
+    if (!opened)
+        return 0;
+
+    auto* dest = static_cast<char*>(destBuffer);
+    int bytesRead = 0;
+
+    // A full buffer is not touched by the decoder, so it can be read unlocked
+    while (bytesRead < maxBytesToRead && waitForReadBuffer())
+    {
+        const Buffer& buffer = buffers[readBufferIndex];
+        int numBytes = jmin(maxBytesToRead - bytesRead, buffer.numBytes - readOffset);
+
+        std::memcpy(dest + bytesRead, buffer.data + readOffset, (size_t)numBytes);
+        readOffset += numBytes;
+        bytesRead += numBytes;
+
+        if (readOffset == buffer.numBytes)
+            releaseReadBuffer();
+    }
+
+    position += bytesRead;
+    return bytesRead;
+}
+
+int64 XZInputStream::getPosition()
+{
+    return position;
+}
+
+bool XZInputStream::setPosition(int64 newPosition)
+{
+    if (!opened || newPosition < 0)
+        return false;
+
+    if (hasIndex)
+    {
+        // Jump to the target's block unless it is at most one block ahead,
+        // where decoding on is no slower than starting over
+        const int targetBlock = index.findBlock(newPosition);
+
+        if (newPosition < position || targetBlock > index.findBlock(position) + 1)
+            restart(targetBlock);
+    }
+    else if (newPosition < position)
+    {
+        restart(0);
+    }
+
+    // Skip forward, dropping whole buffers without copying them
+    while (position < newPosition && waitForReadBuffer())
+    {
+        const Buffer& buffer = buffers[readBufferIndex];
+        int numBytes = (int)jmin((int64)(buffer.numBytes - readOffset), newPosition - position);
+
+        readOffset += numBytes;
+        position += numBytes;
+
+        if (readOffset == buffer.numBytes)
+            releaseReadBuffer();
+    }
+
+    return position == newPosition;
+}
@@ -0,0 +1,146 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef XZ_INPUT_STREAM_H_DEFINED
+#define XZ_INPUT_STREAM_H_DEFINED
+
+#include <FileSourceHeaders.h>
+
+#include "XZDecompress.h"
+
+/**
+ * Reads the decompressed contents of an .xz file as a stream.
+ *
+ * A background thread decodes the file into two fixed-size buffers: it
+ * fills one while the reader consumes the other. Only those two buffers
+ * and one chunk of compressed input are ever in memory, and the first
+ * bytes can be read as soon as the first buffer has been decoded. After
+ * opening or seeking, the first buffers are filled only partly, starting
+ * small and doubling up to the buffer size, so the reader does not wait
+ * for a whole buffer to be decoded before it gets the data it asked for.
+ *
+ * The block index at the end of the file is read when it is opened, so
+ * the total length is known up front and seeking only has to decode from
+ * the start of the block containing the target (short forward seeks just
+ * discard decoded data). Files written as a single block, as xz does by
+ * default, therefore seek no faster than from the start of the file; see
+ * XZOutputStream for writing files with smaller blocks. If the index
+ * cannot be read the file is decoded as one sequential stream.
+ */
+class XZInputStream : public InputStream,
+                      private Thread
+{
+public:
+    /** Opens the file and starts decoding; check openedOk() afterwards */
+    explicit XZInputStream(const File& file, int bufferSize = 1024 * 1024);
+
+    /** Stops the decoder thread */
+    ~XZInputStream() override;
+
+    /** Returns false if liblzma or the file could not be opened */
+    bool openedOk() const { return opened; }
+
+    /** Returns true if the stream was cut short by a decoding or read error */
+    bool failed() const { return decodeError.load(); }
+
+    /** The decompressed size, or -1 if the file has no usable index and has not been decoded to the end yet */
+    int64 getTotalLength() override;
+
+    bool isExhausted() override;
+    int read(void* destBuffer, int maxBytesToRead) override;
+    int64 getPosition() override;
+    bool setPosition(int64 newPosition) override;
+
+private:
+    /** Decoder thread: fills buffers until the end of the file or stop */
+    void run() override;
+
+    /** Decodes the next buffer's worth of data; returns false at the end, on error or when asked to stop */
+    bool decodeInto(HeapBlock<char>& dest, int& numBytes);
+
+    /**
+     * Starts a decoder at a block, covering the rest of that block's stream
+     * (or the whole file if there is no index). Returns false on error.
+     */
+    bool beginSegment(int blockIndex);
+
+    /** Releases the current decoder */
+    void endSegment();
+
+    /** Waits for the buffer the reader is on; returns false at the end of the data */
+    bool waitForReadBuffer();
+
+    /** Hands the reader's buffer back to the decoder */
+    void releaseReadBuffer();
+
+    /** Stops the decoder and starts again from the beginning of a block */
+    void restart(int blockIndex);
+
+    struct Buffer
+    {
+        HeapBlock<char> data;
+        int numBytes = 0;
+        bool full = false;  // Written by the decoder, waiting to be read
+    };
+
+    const File file;
+    const int bufferSize;
+    bool opened;
+
+    // Block layout, fixed once opened
+    XZDecompress::XZIndex index;
+    bool hasIndex;
+
+    // Block the decoder thread starts from; only changed while it is stopped
+    int startBlock;
+
+    // Decoder state, only touched on the decoder thread
+    std::unique_ptr<FileInputStream> compressed;
+    HeapBlock<uint8_t> compressedChunk;
+    XZDecompress::lzma_stream strm;
+    bool strmInitialised;
+    bool inputFinished;
+    int currentStream;
+    int64 compressedBytesLeft;  // In the current segment
+    int64 outputBytesLeft;      // In the current segment, if indexed
+    int fillSize;               // Bytes to decode into the next buffer
+
+    // Buffers handed between decoder and reader
+    Buffer buffers[2];
+    CriticalSection bufferLock;
+    WaitableEvent bufferFilled;
+    WaitableEvent bufferEmptied;
+    bool decoderFinished;  // No more buffers will be filled
+
+    std::atomic<bool> decodeError;
+    std::atomic<int64> totalLength;
+
+    // Reader state
+    int readBufferIndex;
+    int readOffset;  // Bytes already consumed from the reader's buffer
+    int64 position;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(XZInputStream);
+};
+
+#endif // XZ_INPUT_STREAM_H_DEFINED
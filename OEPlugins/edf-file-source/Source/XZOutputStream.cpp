@@ -0,0 +1,173 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "XZOutputStream.h"
+
+namespace
+{
+/** Bytes of compressed output written per call */
+constexpr int COMPRESSED_CHUNK_SIZE = 64 * 1024;
+} // namespace
+
+XZOutputStream::XZOutputStream(const File& file, int64 size, int preset)
+    : blockSize(jmax((int64)4096, size)),
+      bytesInBlock(0),
+      position(0),
+      opened(false),
+      finished(false),
+      failed(false)
+{
+    strm = LZMA_STREAM_INIT;
+
+    auto& lzma = XZDecompress::LZMALibrary::getInstance();
+
+    if (!lzma.canEncode())
+    {
+        LOGE("XZ: Cannot compress - liblzma encoder not available");
+        return;
+    }
+
+    output = std::make_unique<FileOutputStream>(file);
+
+    if (output->failedToOpen() || !output->setPosition(0) || output->truncate().failed())
+    {
+        LOGE("XZ: Failed to create file: ", file.getFullPathName());
+        output.reset();
+        return;
+    }
+
+    if (lzma.easy_encoder(&strm, (uint32_t)jlimit(0, 9, preset), LZMA_CHECK_CRC64) != LZMA_OK)
+    {
+        LOGE("XZ: Failed to initialize encoder");
+        output.reset();
+        return;
+    }
+
+    compressedChunk.malloc(COMPRESSED_CHUNK_SIZE);
+    opened = true;
+}
+
+XZOutputStream::~XZOutputStream()
+{
+    if (opened && !finished)
+        finish();
+
+    if (opened)
+        XZDecompress::LZMALibrary::getInstance().end(&strm);
+}
+
+bool XZOutputStream::encode(const uint8_t* data, size_t numBytes, uint32_t action)
+{
+    auto& lzma = XZDecompress::LZMALibrary::getInstance();
+
+    strm.next_in = data;
+    strm.avail_in = numBytes;
+
+    for (;;)
+    {
+        strm.next_out = compressedChunk;
+        strm.avail_out = COMPRESSED_CHUNK_SIZE;
+
+        XZDecompress::lzma_ret ret = lzma.code(&strm, action);
+        const size_t numCompressed = COMPRESSED_CHUNK_SIZE - strm.avail_out;
+
+        if (numCompressed > 0 && !output->write(compressedChunk, numCompressed))
+        {
+            LOGE("XZ: Failed to write compressed data");
+            return false;
+        }
+
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+        {
+            LOGE("XZ: Compression error: ", (int)ret);
+            return false;
+        }
+
+        // Flushes and finishing are complete at LZMA_STREAM_END, plain runs
+        // once the input has been taken
+        if (action == LZMA_RUN ? strm.avail_in == 0 : ret == LZMA_STREAM_END)
+            return true;
+    }
+}
+
+bool XZOutputStream::write(const void* dataToWrite, size_t numberOfBytes)
+{
+    if (!opened || finished || failed)
+        return false;
+
+    auto* data = static_cast<const uint8_t*>(dataToWrite);
+
+    while (numberOfBytes > 0)
+    {
+        const size_t numBytes = (size_t)jmin((int64)numberOfBytes, blockSize - bytesInBlock);
+
+        if (!encode(data, numBytes, LZMA_RUN))
+        {
+            failed = true;
+            return false;
+        }
+
+        data += numBytes;
+        numberOfBytes -= numBytes;
+        bytesInBlock += (int64)numBytes;
+        position += (int64)numBytes;
+
+        // Close the block so the next one starts a new entry in the index
+        if (bytesInBlock == blockSize)
+        {
+            if (!encode(nullptr, 0, LZMA_FULL_FLUSH))
+            {
+                failed = true;
+                return false;
+            }
+
+            bytesInBlock = 0;
+        }
+    }
+
+    return true;
+}
+
+bool XZOutputStream::finish()
+{
+    if (!opened || finished)
+        return !failed;
+
+    finished = true;
+
+    if (!failed && !encode(nullptr, 0, LZMA_FINISH))
+        failed = true;
+
+    output->flush();
+
+    if (output->getStatus().failed())
+        failed = true;
+
+    return !failed;
+}
+
+void XZOutputStream::flush()
+{
+    if (output != nullptr)
+        output->flush();
+}
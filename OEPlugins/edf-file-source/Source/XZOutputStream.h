@@ -0,0 +1,87 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef XZ_OUTPUT_STREAM_H_DEFINED
+#define XZ_OUTPUT_STREAM_H_DEFINED
+
+#include <FileSourceHeaders.h>
+
+#include "XZDecompress.h"
+
+/**
+ * Writes an .xz file made of independently decodable blocks of a fixed
+ * uncompressed size (like xz --block-size), so XZInputStream can seek
+ * into it by decoding a single block instead of the whole file.
+ *
+ * Smaller blocks seek faster but compress slightly worse; a few MB per
+ * block keeps the size within about a percent of a single-block file.
+ */
+class XZOutputStream : public OutputStream
+{
+public:
+    /** Default uncompressed bytes per block */
+    static constexpr int64 DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    /** Creates (or replaces) the file; check openedOk() afterwards */
+    explicit XZOutputStream(const File& file, int64 blockSize = DEFAULT_BLOCK_SIZE, int preset = 6);
+
+    /** Finishes the stream if finish() has not been called */
+    ~XZOutputStream() override;
+
+    /** Returns false if liblzma's encoder or the file could not be opened */
+    bool openedOk() const { return opened; }
+
+    /** Writes the last block, index and footer; returns false if anything failed */
+    bool finish();
+
+    /** Flushes compressed data already produced to the file (does not end a block) */
+    void flush() override;
+
+    /** Number of uncompressed bytes written */
+    int64 getPosition() override { return position; }
+
+    /** Not supported */
+    bool setPosition(int64) override { return false; }
+
+    bool write(const void* dataToWrite, size_t numberOfBytes) override;
+
+private:
+    /** Runs the encoder over some input with an lzma action */
+    bool encode(const uint8_t* data, size_t numBytes, uint32_t action);
+
+    std::unique_ptr<FileOutputStream> output;
+    XZDecompress::lzma_stream strm;
+    HeapBlock<uint8_t> compressedChunk;
+
+    const int64 blockSize;
+    int64 bytesInBlock;
+    int64 position;
+
+    bool opened;
+    bool finished;
+    bool failed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(XZOutputStream);
+};
+
+#endif // XZ_OUTPUT_STREAM_H_DEFINED
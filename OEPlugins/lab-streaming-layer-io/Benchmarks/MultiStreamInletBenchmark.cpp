@@ -0,0 +1,285 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+/*
+ Drives LSLStreamReader and LSLMarkerReader the way the inlet thread does,
+ against EEG, EMG, accelerometer and marker outlets created in this process.
+ Every data outlet sends a sample counter on all channels and stamps each
+ sample from a shared start time, so the run checks that no samples are
+ lost or reordered and that the streams stay on one timeline. A marker is
+ sent with every third EEG sample, checking that none are lost and counting
+ those placed exactly on their sample. Wake-ups and pull latency are
+ reported.
+
+ Usage: MultiStreamInletBenchmark [seconds] [blocking|adaptive]
+ */
+
+#include "../Source/Inlet/LSLMarkerReader.h"
+#include "../Source/Inlet/LSLStreamReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/** Largest timestamp error allowed once clock correction is applied; in process it only removes estimation noise (seconds) */
+const double MAX_SKEW = 0.001;
+
+struct TestStream
+{
+    const char* name;
+    const char* type;
+    int numChannels;
+    double sampleRate;
+};
+
+const TestStream TEST_STREAMS[] = {
+    { "Benchmark EEG", "EEG", 32, 500.0 },
+    { "Benchmark EMG", "EMG", 8, 2000.0 },
+    { "Benchmark ACC", "ACC", 3, 50.0 }
+};
+
+const int NUM_TEST_STREAMS = 3;
+
+/** EEG samples per marker */
+const int MARKER_INTERVAL = 3;
+
+/** TTL word the markers should leave on an EEG sample: markers "1" to "8" in turn, on lines 1 to 8 */
+unsigned long long getExpectedWord (long long sampleNumber)
+{
+    return sampleNumber % MARKER_INTERVAL == 0 ? 1ULL << ((sampleNumber / MARKER_INTERVAL) % 8) : 0;
+}
+
+/**
+ * Pushes a counter at the stream's rate, in 1 ms bursts, with timestamps
+ * from startTime. With a marker outlet, also pushes a marker a quarter of a
+ * sample ahead of every MARKER_INTERVAL-th sample.
+ */
+void runOutlet (lsl::stream_outlet& outlet, const TestStream& stream, double startTime, const std::atomic<bool>& running, lsl::stream_outlet* markerOutlet, std::atomic<long long>* markersSent)
+{
+    std::vector<float> sample (stream.numChannels);
+    long long sent = 0;
+
+    while (running)
+    {
+        const long long due = (long long) ((lsl::local_clock() - startTime) * stream.sampleRate);
+
+        for (; sent < due; sent++)
+        {
+            const double timestamp = startTime + sent / stream.sampleRate;
+
+            if (markerOutlet != nullptr && sent % MARKER_INTERVAL == 0)
+            {
+                const std::string marker = std::to_string ((sent / MARKER_INTERVAL) % 8 + 1);
+                markerOutlet->push_sample (&marker, timestamp - 0.25 / stream.sampleRate);
+                (*markersSent)++;
+            }
+
+            std::fill (sample.begin(), sample.end(), (float) sent);
+            outlet.push_sample (sample, timestamp);
+        }
+
+        std::this_thread::sleep_for (std::chrono::milliseconds (1));
+    }
+}
+
+} // namespace
+
+int main (int argc, char** argv)
+{
+    const double seconds = argc > 1 ? std::atof (argv[1]) : 3.0;
+    const bool adaptive = argc > 2 && std::strcmp (argv[2], "adaptive") == 0;
+
+    std::vector<std::unique_ptr<lsl::stream_outlet>> outlets;
+    std::vector<std::unique_ptr<LSLStreamReader>> readers;
+
+    for (const auto& stream : TEST_STREAMS)
+    {
+        lsl::stream_info info (stream.name, stream.type, stream.numChannels, stream.sampleRate, lsl::cf_float32, std::string (stream.name) + " source");
+        outlets.push_back (std::make_unique<lsl::stream_outlet> (info));
+
+        const auto found = lsl::resolve_stream ("source_id", info.source_id(), 1, 5.0);
+
+        if (found.empty())
+        {
+            std::printf ("Could not resolve the in-process outlet %s\n", stream.name);
+            return 1;
+        }
+
+        readers.push_back (std::make_unique<LSLStreamReader> (found[0], 0.25, 0.01, 1024));
+
+        if (! readers.back()->open (5.0))
+        {
+            std::printf ("Could not open the in-process outlet %s\n", stream.name);
+            return 1;
+        }
+    }
+
+    lsl::stream_info markerInfo ("Benchmark Markers", "Markers", 1, lsl::IRREGULAR_RATE, lsl::cf_string, "Benchmark Markers source");
+    lsl::stream_outlet markerOutlet (markerInfo);
+    const auto foundMarkers = lsl::resolve_stream ("source_id", markerInfo.source_id(), 1, 5.0);
+
+    if (foundMarkers.empty())
+    {
+        std::printf ("Could not resolve the in-process marker outlet\n");
+        return 1;
+    }
+
+    LSLMarkerReader markerReader (foundMarkers[0], 4096);
+    markerReader.setMapping ({ { "1", 1 }, { "2", 2 }, { "3", 3 }, { "4", 4 }, { "5", 5 }, { "6", 6 }, { "7", 7 }, { "8", 8 } });
+
+    if (! markerReader.open (5.0))
+    {
+        std::printf ("Could not open the in-process marker outlet\n");
+        return 1;
+    }
+
+    for (auto& reader : readers)
+        reader->waitForTimeCorrection (2.0);
+
+    markerReader.waitForTimeCorrection (2.0);
+
+    const double startTime = lsl::local_clock();
+    std::atomic<bool> running { true };
+    std::atomic<long long> markersSent { 0 };
+    std::vector<std::thread> senders;
+
+    for (int i = 0; i < NUM_TEST_STREAMS; i++)
+        senders.emplace_back (runOutlet, std::ref (*outlets[i]), std::cref (TEST_STREAMS[i]), startTime, std::cref (running), i == 0 ? &markerOutlet : nullptr, &markersSent);
+
+    std::vector<long long> received (NUM_TEST_STREAMS, 0);
+    long long wakeUps = 0;
+    long long markersPlaced = 0;
+    long long markersExact = 0;
+    int errors = 0;
+
+    while (lsl::local_clock() - startTime < seconds)
+    {
+        std::vector<int> samplesRead (NUM_TEST_STREAMS, 0);
+
+        if (adaptive)
+        {
+            int waitMilliseconds = 100;
+
+            for (auto& reader : readers)
+                waitMilliseconds = std::min (waitMilliseconds, reader->getMillisecondsToChunk());
+
+            if (waitMilliseconds > 0)
+                std::this_thread::sleep_for (std::chrono::milliseconds (waitMilliseconds));
+
+            for (int i = 0; i < NUM_TEST_STREAMS; i++)
+            {
+                samplesRead[i] = readers[i]->pull (readers[i]->getChunkSize(), 0.0);
+                readers[i]->adaptChunkSize();
+            }
+        }
+        else
+        {
+            for (int i = 0; i < NUM_TEST_STREAMS; i++)
+                samplesRead[i] = readers[i]->pull (readers[i]->getCapacity(), i == 0 ? 0.1 : 0.0);
+        }
+
+        wakeUps++;
+
+        markerReader.pull();
+        markerReader.place (readers[0]->getTimestamps(), samplesRead[0], readers[0]->getEventWords());
+
+        for (int i = 0; i < NUM_TEST_STREAMS; i++)
+        {
+            LSLStreamReader& reader = *readers[i];
+            reader.prepareBlock (samplesRead[i], startTime, 1.0f);
+
+            if (i == 0)
+            {
+                for (int s = 0; s < samplesRead[i]; s++)
+                {
+                    const unsigned long long word = reader.getEventWords()[s];
+                    markersPlaced += (long long) std::bitset<64> (word).count();
+
+                    if (word != 0 && word == getExpectedWord (received[i] + s))
+                        markersExact++;
+                }
+            }
+
+            for (int s = 0; s < samplesRead[i]; s++)
+            {
+                const long long expected = received[i] + s;
+                const float value = reader.getChannelData()[(size_t) (reader.getNumChannels() - 1) * samplesRead[i] + s];
+                const double skew = reader.getTimestamps()[s] - expected / reader.getSampleRate();
+
+                if (value != (float) expected || reader.getSampleNumbers()[s] != expected || std::abs (skew) > MAX_SKEW)
+                {
+                    if (errors++ < 5)
+                        std::printf ("%s: sample %lld read as %g at %+.3f ms\n", reader.getInfo().name().c_str(), expected, value, skew * 1000.0);
+                }
+            }
+
+            received[i] += samplesRead[i];
+        }
+    }
+
+    running = false;
+
+    for (auto& sender : senders)
+        sender.join();
+
+    // Markers still pending, or still in the inlet, were sent after the last EEG sample read
+    std::this_thread::sleep_for (std::chrono::milliseconds (100));
+    markerReader.pull();
+
+    const long long markersLost = markersSent - markersPlaced - markerReader.getNumPending();
+
+    std::printf ("%s pulls over %.1f s: %lld wake-ups (%.0f/s)\n", adaptive ? "Adaptive" : "Blocking", seconds, wakeUps, wakeUps / seconds);
+
+    for (int i = 0; i < NUM_TEST_STREAMS; i++)
+    {
+        std::printf ("  %-14s %3d ch %6.0f Hz: %7lld samples, chunk %4d, max latency %6.2f ms\n",
+                     TEST_STREAMS[i].name,
+                     TEST_STREAMS[i].numChannels,
+                     TEST_STREAMS[i].sampleRate,
+                     received[i],
+                     readers[i]->getChunkSize(),
+                     readers[i]->getMaxPullLatency() * 1000.0);
+    }
+
+    std::printf ("  Markers: %lld sent, %lld placed (%lld on their own sample), %d pending, %lld lost\n",
+                 markersSent.load(),
+                 markersPlaced,
+                 markersExact,
+                 markerReader.getNumPending(),
+                 markersLost);
+
+    std::printf (errors == 0 ? "All samples in order and aligned\n" : "%d samples out of order or misaligned\n", errors);
+
+    return errors == 0 && markersLost == 0 ? 0 : 1;
+}
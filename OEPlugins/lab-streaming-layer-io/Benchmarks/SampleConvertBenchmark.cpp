@@ -0,0 +1,125 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+/*
+ Micro-benchmark and check for the outlet's SampleConvert kernels against
+ a scalar clamp-and-round loop, including values past the integer rails.
+
+ Usage: SampleConvertBenchmark [numValues]
+ */
+
+#include "../Source/SampleConvert.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/** Runs fn repeatedly for about 0.2 s and returns the rate in million values per second */
+template <typename Fn>
+double measure (Fn&& fn, size_t count)
+{
+    using Clock = std::chrono::steady_clock;
+
+    fn(); // warm up
+
+    long iterations = 0;
+    const auto start = Clock::now();
+    double elapsed = 0.0;
+
+    do
+    {
+        for (int i = 0; i < 16; i++)
+            fn();
+
+        iterations += 16;
+        elapsed = std::chrono::duration<double> (Clock::now() - start).count();
+    } while (elapsed < 0.2);
+
+    return (double) iterations * count / elapsed / 1.0e6;
+}
+
+template <typename IntType, typename Kernel>
+bool run (const char* name, Kernel&& kernel, const std::vector<float>& src, float gain, float lo, float hi)
+{
+    const size_t count = src.size();
+    std::vector<IntType> reference (count), converted (count);
+
+    auto scalar = [&]
+    {
+        for (size_t i = 0; i < count; i++)
+            reference[i] = SampleConvert::saturate<IntType> (src[i] * gain, lo, hi);
+    };
+
+    scalar();
+    kernel (src.data(), converted.data(), count, gain);
+
+    if (reference != converted)
+    {
+        std::printf ("MISMATCH: %s\n", name);
+        return false;
+    }
+
+    const double scalarRate = measure (scalar, count);
+    const double kernelRate = measure ([&]
+                                       { kernel (src.data(), converted.data(), count, gain); },
+                                       count);
+
+    std::printf ("%-6s | %9.0f %9.0f %6.2fx\n", name, scalarRate, kernelRate, kernelRate / scalarRate);
+
+    return true;
+}
+
+} // namespace
+
+int main (int argc, char** argv)
+{
+    // 256 channels x 1024 samples by default
+    const size_t count = argc > 1 ? (size_t) std::atol (argv[1]) : 256 * 1024;
+
+    std::mt19937 rng (12345);
+    std::uniform_real_distribution<float> dist (-8000.0f, 8000.0f);
+
+    std::vector<float> src (count);
+
+    for (auto& v : src)
+        v = dist (rng);
+
+    // Values the int16 path has to clip at a gain of 1 / 0.195
+    const float edges[] = { 1.0e9f, -1.0e9f, 6389.0f, -6390.0f, 0.0975f, -0.0975f };
+
+    for (size_t i = 0; i < count && i < sizeof (edges) / sizeof (edges[0]); i++)
+        src[i * 7 % count] = edges[i];
+
+    std::printf ("Rates in million values per second\n\n");
+    std::printf ("%-6s | %9s %9s %7s\n", "format", "scalar", "kernel", "");
+
+    bool ok = run<int16_t> ("int16", SampleConvert::floatToInt16, src, 1.0f / 0.195f, -32768.0f, 32767.0f);
+    ok = run<int32_t> ("int32", SampleConvert::floatToInt32, src, 1.0e6f, SampleConvert::INT32_MIN_FLOAT, SampleConvert::INT32_MAX_FLOAT) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+/*
+ Micro-benchmark for SampleTranspose against the loops the inlet and
+ outlet used before, over a range of channel counts and chunk sizes.
+
+ Usage: SampleTransposeBenchmark [numChannels] [chunkSize]
+ */
+
+#include "../Source/SampleTranspose.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/** The inlet's former path: scale in place, then a strided transpose */
+void legacyDeinterleave (float* src, int numChannels, int numSamples, float* dest, float scale)
+{
+    for (int i = 0; i < numChannels * numSamples; i++)
+        src[i] = scale * src[i];
+
+    for (int ch = 0; ch < numChannels; ch++)
+        for (int i = 0; i < numSamples; i++)
+            dest[ch * numSamples + i] = src[i * numChannels + ch];
+}
+
+/** The outlet's former path: one strided read per channel per sample */
+void legacyInterleave (const float* const* src, int numChannels, int numSamples, float* dest, float scale)
+{
+    for (int sample = 0; sample < numSamples; sample++)
+        for (int ch = 0; ch < numChannels; ch++)
+            dest[sample * numChannels + ch] = src[ch][sample] * scale;
+}
+
+/** Runs fn repeatedly for about 0.2 s and returns the rate in million samples (all channels) per second */
+template <typename Fn>
+double measure (Fn&& fn, int numChannels, int numSamples)
+{
+    using Clock = std::chrono::steady_clock;
+
+    fn(); // warm up
+
+    long iterations = 0;
+    const auto start = Clock::now();
+    double elapsed = 0.0;
+
+    do
+    {
+        for (int i = 0; i < 16; i++)
+            fn();
+
+        iterations += 16;
+        elapsed = std::chrono::duration<double> (Clock::now() - start).count();
+    } while (elapsed < 0.2);
+
+    return (double) iterations * numChannels * numSamples / elapsed / 1.0e6;
+}
+
+/** Random interleaved samples and per-channel buffers for one chunk shape */
+struct Chunk
+{
+    Chunk (int numChannels, int numSamples)
+        : total ((size_t) numChannels * numSamples),
+          interleaved (total),
+          scratch (total),
+          legacyOut (total),
+          kernelOut (total),
+          channels (numChannels),
+          constChannels (numChannels)
+    {
+        std::mt19937 rng (numChannels * 7919 + numSamples);
+        std::uniform_real_distribution<float> dist (-1000.0f, 1000.0f);
+
+        for (auto& v : interleaved)
+            v = dist (rng);
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            channels[ch] = kernelOut.data() + (size_t) ch * numSamples;
+            constChannels[ch] = channels[ch];
+        }
+    }
+
+    size_t total;
+    std::vector<float> interleaved, scratch, legacyOut, kernelOut;
+    std::vector<float*> channels;
+    std::vector<const float*> constChannels;
+};
+
+/** Checks both directions against the old loops, leaving the deinterleaved data in kernelOut */
+bool matchesLegacy (Chunk& c, int numChannels, int numSamples, float scale)
+{
+    c.scratch = c.interleaved;
+    legacyDeinterleave (c.scratch.data(), numChannels, numSamples, c.legacyOut.data(), scale);
+    SampleTranspose::deinterleave (c.interleaved.data(), numChannels, numSamples, c.channels.data(), scale);
+
+    if (c.legacyOut != c.kernelOut)
+    {
+        std::printf ("MISMATCH: deinterleave %d x %d\n", numChannels, numSamples);
+        return false;
+    }
+
+    legacyInterleave (c.constChannels.data(), numChannels, numSamples, c.legacyOut.data(), scale);
+    SampleTranspose::interleave (c.constChannels.data(), numChannels, numSamples, c.scratch.data(), scale);
+
+    if (c.legacyOut != c.scratch)
+    {
+        std::printf ("MISMATCH: interleave %d x %d\n", numChannels, numSamples);
+        return false;
+    }
+
+    return true;
+}
+
+/** Checks the shapes whose channels or samples are not a multiple of the 4 x 4 tiles,
+    so the scalar edges run too, including chunks longer than one cache band */
+bool checkTileEdges()
+{
+    bool ok = true;
+
+    for (int numChannels = 1; numChannels <= 9; numChannels++)
+    {
+        for (int numSamples : { 1, 2, 3, 4, 5, 7, 33, 300 })
+        {
+            Chunk chunk (numChannels, numSamples);
+            ok = matchesLegacy (chunk, numChannels, numSamples, 0.195f) && ok;
+        }
+    }
+
+    for (int numChannels : { 13, 33, 67 })
+    {
+        for (int numSamples : { 1, 7, 33, 257 })
+        {
+            Chunk chunk (numChannels, numSamples);
+            ok = matchesLegacy (chunk, numChannels, numSamples, 0.195f) && ok;
+        }
+    }
+
+    return ok;
+}
+
+bool run (int numChannels, int numSamples)
+{
+    const float scale = 0.195f;
+    Chunk c (numChannels, numSamples);
+
+    // Check both directions, then time the inlet
+    if (!matchesLegacy (c, numChannels, numSamples, scale))
+        return false;
+
+    const double legacyIn = measure ([&]
+                                     {
+                                         c.scratch = c.interleaved;
+                                         legacyDeinterleave (c.scratch.data(), numChannels, numSamples, c.legacyOut.data(), scale);
+                                     },
+                                     numChannels,
+                                     numSamples);
+
+    const double kernelIn = measure ([&]
+                                     {
+                                         c.scratch = c.interleaved; // same copy cost as the legacy run
+                                         SampleTranspose::deinterleave (c.scratch.data(), numChannels, numSamples, c.channels.data(), scale);
+                                     },
+                                     numChannels,
+                                     numSamples);
+
+    // Outlet direction, from the per-channel data just produced
+    const double legacyOutRate = measure ([&]
+                                          { legacyInterleave (c.constChannels.data(), numChannels, numSamples, c.legacyOut.data(), scale); },
+                                          numChannels,
+                                          numSamples);
+
+    const double kernelOutRate = measure ([&]
+                                          { SampleTranspose::interleave (c.constChannels.data(), numChannels, numSamples, c.scratch.data(), scale); },
+                                          numChannels,
+                                          numSamples);
+
+    std::printf ("%8d %8d | %9.0f %9.0f %6.2fx | %9.0f %9.0f %6.2fx\n",
+                 numChannels,
+                 numSamples,
+                 legacyIn,
+                 kernelIn,
+                 kernelIn / legacyIn,
+                 legacyOutRate,
+                 kernelOutRate,
+                 kernelOutRate / legacyOutRate);
+
+    return true;
+}
+
+} // namespace
+
+int main (int argc, char** argv)
+{
+    std::vector<int> channelCounts = { 8, 32, 64, 128, 256 };
+    std::vector<int> chunkSizes = { 32, 256, 1024 };
+
+    if (argc > 1)
+        channelCounts = { std::atoi (argv[1]) };
+
+    if (argc > 2)
+        chunkSizes = { std::atoi (argv[2]) };
+
+    bool ok = checkTileEdges();
+
+    std::printf ("Rates in million channel-samples per second\n\n");
+    std::printf ("%8s %8s | %9s %9s %7s | %9s %9s %7s\n", "channels", "chunk", "inlet old", "new", "", "outlet old", "new", "");
+
+    for (int numChannels : channelCounts)
+        for (int numSamples : chunkSizes)
+            ok = run (numChannels, numSamples) && ok;
+
+    return ok ? 0 : 1;
+}
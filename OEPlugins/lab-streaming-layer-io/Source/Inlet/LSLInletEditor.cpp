@@ -60,13 +60,22 @@ LSLInletEditor::LSLInletEditor(GenericProcessor *parentNode, LSLInletThread *thr
 {
     inletThread = thread;
 
-    desiredWidth = 200;
+    desiredWidth = 370;
 
     // Stream selector
     addSelectedStreamParameterEditor(Parameter::PROCESSOR_SCOPE, "data_stream", 10, 29);
     addTextBoxParameterEditor(Parameter::PROCESSOR_SCOPE, "scale", 10, 54);
     addSelectedStreamParameterEditor(Parameter::PROCESSOR_SCOPE, "marker_stream", 10, 79);
     addPathParameterEditor(Parameter::PROCESSOR_SCOPE, "mapping", 10, 104);
+    addComboBoxParameterEditor(Parameter::PROCESSOR_SCOPE, "stream_set", 190, 29);
+    addComboBoxParameterEditor(Parameter::PROCESSOR_SCOPE, "pull_mode", 190, 54);
+
+    statsLabel = std::make_unique<Label> ("Pull Statistics", "");
+    statsLabel->setBounds (190, 79, 170, 50);
+    statsLabel->setFont (FontOptions ("Inter", "Regular", 11.0f));
+    statsLabel->setJustificationType (Justification::topLeft);
+    statsLabel->setColour (Label::textColourId, Colours::grey);
+    addAndMakeVisible (statsLabel.get());
 
     refreshButton = std::make_unique<RefreshButton>();
     refreshButton->setBounds (desiredWidth - 65, 4, 16, 16);
@@ -87,9 +96,24 @@ void LSLInletEditor::buttonClicked(Button *button)
 void LSLInletEditor::startAcquisition()
 {
     refreshButton->setEnabled (false);
+    statsLabel->setText ("", dontSendNotification);
+    startTimer (500);
 }
 
 void LSLInletEditor::stopAcquisition()
 {
+    stopTimer();
+    timerCallback();
     refreshButton->setEnabled (true);
+}
+
+void LSLInletEditor::timerCallback()
+{
+    statsLabel->setText (String (inletThread->getNumStreams()) + (inletThread->getNumStreams() == 1 ? " stream" : " streams")
+                         + ", chunk: " + String (inletThread->getChunkSize()) + " samples\n"
+                         + "Backlog: " + String (inletThread->getBacklog()) + " samples\n"
+                         + "Latency: " + String (inletThread->getPullLatency() * 1000.0, 1) + " ms (max "
+                         + String (inletThread->getMaxPullLatency() * 1000.0, 1) + ")\n"
+                         + "Dropped: " + String (inletThread->getDroppedSamples()) + " samples",
+                         dontSendNotification);
 }
\ No newline at end of file
@@ -46,7 +46,8 @@ private:
 };
 
 class LSLInletEditor : public GenericEditor,
-                       public Button::Listener
+                       public Button::Listener,
+                       public Timer
 {
 public:
     /** The class constructor, used to initialize any members. */
@@ -64,8 +65,12 @@ public:
     /** Updates editor state on stop of acquisition */
     void stopAcquisition() override;
 
+    /** Shows the inlet's pull statistics during acquisition */
+    void timerCallback() override;
+
 private:
     std::unique_ptr<RefreshButton> refreshButton;
+    std::unique_ptr<Label> statsLabel;
 
     LSLInletThread* inletThread;
 };
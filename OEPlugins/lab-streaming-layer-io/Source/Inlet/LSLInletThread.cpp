@@ -28,22 +28,13 @@
 #include <sstream>
 
 LSLInletThread::LSLInletThread (SourceNode* sn) : DataThread (sn),
-                                                  numSamples (DEFAULT_NUM_SAMPLES),
+                                                  pullMode (PullMode::BLOCKING),
+                                                  streamSet (StreamSet::SELECTED),
                                                   dataScale (DEFAULT_DATA_SCALE),
                                                   selectedDataStream (STREAM_SELECTION_UNDEFINED)
 {
-    numChannels = 1; // start with 1 channel, will resize the buffers as needed
-    // calculate data buffer size instead of using a fixed value if the function of (numChannels, numSamples) can be determined
-    sourceBuffers.add (new DataBuffer (numChannels, 100000));
-    this->dataStream = NULL;
-    this->markersStream = NULL;
-
-    dataBuffer = (float*) malloc (numChannels * numSamples * sizeof (float));
-    samples = (float*) malloc (numChannels * numSamples * sizeof (float));
-    timestampBuffer = (double*) malloc (numSamples * sizeof (double));
-
-    sampleNumbers = (int64*) malloc (numSamples * sizeof (int64));
-    ttlEventWords = (uint64*) malloc (numSamples * sizeof (uint64));
+    // one buffer per acquired stream, resized from the stream's sample rate when acquisition starts
+    sourceBuffers.add (new DataBuffer (1, 100000));
 
     eventMap["0"] = 0;
     eventMap["1"] = 1;
@@ -60,11 +51,6 @@ LSLInletThread::LSLInletThread (SourceNode* sn) : DataThread (sn),
 
 LSLInletThread::~LSLInletThread()
 {
-    free (dataBuffer);
-    free (samples);
-    free (timestampBuffer);
-    free (sampleNumbers);
-    free (ttlEventWords);
 }
 
 void LSLInletThread::registerParameters()
@@ -87,6 +73,8 @@ void LSLInletThread::registerParameters()
     getParameter ("marker_stream")->currentValue = selectedMarkersStream;
 
     addIntParameter (Parameter::PROCESSOR_SCOPE, "scale", "Scale", "Scale factor for the data samples", 1, 0.0f, 10000.0f);
+    addCategoricalParameter (Parameter::PROCESSOR_SCOPE, "stream_set", "Acquire", "Which data streams to acquire, each as its own stream: the selected one, all from its host, or all discovered", { "Selected", "Same Host", "All" }, 0);
+    addCategoricalParameter (Parameter::PROCESSOR_SCOPE, "pull_mode", "Pull Mode", "Blocking wakes on every new sample; Adaptive pulls chunks sized from the stream rate and backlog", { "Blocking", "Adaptive" }, 0);
     addPathParameter (Parameter::PROCESSOR_SCOPE, "mapping", "Marker Map File", "Select a file with the TTL mapping for the markers stream", "", { "json" }, false, false, true);
 }
 
@@ -133,6 +121,15 @@ void LSLInletThread::parameterValueChanged (Parameter* param)
     {
         dataScale = ((IntParameter*) param)->getValue();
     }
+    else if (param->getName() == "stream_set")
+    {
+        streamSet = (StreamSet) (int) param->getValue();
+        CoreServices::updateSignalChain (sn->getEditor());
+    }
+    else if (param->getName() == "pull_mode")
+    {
+        pullMode = (PullMode) (int) param->getValue();
+    }
     else if (param->getName() == "mapping")
     {
         std::string filePath = ((PathParameter*) param)->getValue().toString().toStdString();
@@ -206,125 +203,136 @@ void LSLInletThread::discover()
 
 bool LSLInletThread::updateBuffer()
 {
-    int max_samples_total = numChannels * numSamples;
-    std::size_t multiplexed_samples_read = 0;
+    std::fill (samplesRead.begin(), samplesRead.end(), 0);
 
     try
     {
-        multiplexed_samples_read = dataStream->pull_chunk_multiplexed (dataBuffer, timestampBuffer, max_samples_total, numSamples);
+        if (pullMode == PullMode::ADAPTIVE)
+        {
+            // One sleep serves all streams, until the first of them has a chunk due
+            int waitMilliseconds = (int) (PULL_TIMEOUT * 1000);
+
+            for (auto* reader : readers)
+            {
+                waitMilliseconds = jmin (waitMilliseconds, reader->getMillisecondsToChunk());
+            }
+
+            if (waitMilliseconds > 0)
+            {
+                wait (waitMilliseconds);
+            }
+
+            for (int i = 0; i < readers.size(); i++)
+            {
+                samplesRead[i] = readers[i]->pull (readers[i]->getChunkSize(), 0.0);
+                readers[i]->adaptChunkSize();
+            }
+        }
+        else
+        {
+            // Block on the selected stream, then drain the others without waiting
+            for (int i = 0; i < readers.size(); i++)
+            {
+                samplesRead[i] = readers[i]->pull (readers[i]->getCapacity(), i == 0 ? PULL_TIMEOUT : 0.0);
+            }
+        }
     }
     catch (const std::runtime_error& re)
     {
         LOGE ("Failed to read data samples with runtime error: ", re.what());
     }
 
-    if (multiplexed_samples_read <= 0)
-    {
-        return true;
-    }
-
-    std::size_t data_samples_read = multiplexed_samples_read / numChannels;
-    jassert (multiplexed_samples_read % numChannels == 0);
-
-    readMarkers (data_samples_read);
-
     if (initialTimestamp == TIMESTAMP_UNDEFINED)
     {
-        initialTimestamp = timestampBuffer[0];
+        // All streams count time from the first sample received on any of them
+        for (int i = 0; i < readers.size(); i++)
+        {
+            if (samplesRead[i] > 0 && (initialTimestamp == TIMESTAMP_UNDEFINED || readers[i]->getTimestamps()[0] < initialTimestamp))
+            {
+                initialTimestamp = readers[i]->getTimestamps()[0];
+            }
+        }
     }
 
-    // Compute sample numbers and
-    // convert time from absolute to relative
-    for (int i = 0; i < data_samples_read; i++)
+    if (markerReader != nullptr)
     {
-        sampleNumbers[i] = totalSamples + i;
-        timestampBuffer[i] -= initialTimestamp;
-    }
+        readMarkers();
 
-    // Apply user defined scaling
-    for (int i = 0; i < multiplexed_samples_read; i++)
-    {
-        dataBuffer[i] = (float) (dataScale * dataBuffer[i]);
+        if (samplesRead[0] > 0)
+        {
+            markerReader->place (readers[0]->getTimestamps(), samplesRead[0], readers[0]->getEventWords());
+        }
     }
 
-    //Update dataBuffer from sample major to channel major
-    for (int ch = 0; ch < numChannels; ch++)
+    for (int i = 0; i < readers.size(); i++)
     {
-        for (int i = 0; i < data_samples_read; i++)
+        const int numRead = samplesRead[i];
+
+        if (numRead <= 0)
         {
-            samples[ch * data_samples_read + i] = dataBuffer[i * numChannels + ch];
+            continue;
         }
-    }
 
-    sourceBuffers[0]->addToBuffer (
-        samples,
-        sampleNumbers,
-        timestampBuffer,
-        ttlEventWords,
-        (int) data_samples_read);
+        LSLStreamReader* reader = readers[i];
+        reader->prepareBlock (numRead, initialTimestamp, dataScale);
 
-    totalSamples += data_samples_read;
+        const int samples_written = sourceBuffers[i]->addToBuffer (
+            reader->getChannelData(),
+            reader->getSampleNumbers(),
+            reader->getTimestamps(),
+            reader->getEventWords(),
+            numRead);
+
+        if (samples_written < numRead)
+        {
+            reader->addDroppedSamples (numRead - samples_written);
+        }
+    }
+
+    publishStatistics();
 
     return true;
 }
 
-// expects timestampBuffer to be populated with sample timestamps
-// in order to match markers with data samples
-void LSLInletThread::readMarkers (std::size_t samples_to_read)
+void LSLInletThread::publishStatistics()
 {
-    if (markersStream == NULL)
-    {
-        return;
-    }
-
-    //LOGC("*** readMarkers called with samples_to_read = ", samples_to_read);
-
-    // clear TTL buffer
-    for (int i = 0; i < samples_to_read; i++)
-    {
-        ttlEventWords[i] = 0;
-    }
+    int chunk = 0;
+    int64 queued = 0;
+    double latency = 0.0;
+    double maxLatency = 0.0;
+    int64 dropped = 0;
+
+    for (auto* reader : readers)
+    {
+        chunk = jmax (chunk, reader->getChunkSize());
+        queued += reader->getBacklog();
+        latency = jmax (latency, reader->getPullLatency());
+        maxLatency = jmax (maxLatency, reader->getMaxPullLatency());
+        dropped += reader->getDroppedSamples();
+    }
+
+    currentChunkSize = chunk;
+    backlog = queued;
+    pullLatency = latency;
+    maxPullLatency = maxLatency;
+    droppedSamples = dropped;
+}
 
+void LSLInletThread::readMarkers()
+{
     try
     {
-        std::string sample;
-        int i = 0;
-        while (double ts = markersStream->pull_sample (&sample, 1, 0.0))
-        {
-            // broadcast the marker text to the signal chain
-            broadcastMessage (sample);
+        const int numMarkers = markerReader->pull();
 
-            // try to find closest event timestamp among sample timestamps
-            bool found_match = false;
-            for (int j = i; samples_to_read; j++)
-            {
-                if (timestampBuffer[j] >= ts)
-                {
-                    i = j;
-                    found_match = true;
-                    break;
-                }
-            }
-            if (! found_match)
-            {
-                LOGE ("Discarding marker because it couldn't be matched with data sample timestamp");
-                break;
-            }
-
-            auto it = eventMap.find (sample);
-            if (it != eventMap.end())
-            {
-                ttlEventWords[i] = 1ULL << (it->second - 1);
-            }
-            else
-            {
-                LOGC ("No event channel mapping found for marker: '", sample, "'");
-            }
+        // broadcast the marker text to the signal chain
+        for (int i = 0; i < numMarkers; i++)
+        {
+            broadcastMessage (markerReader->getPulledMarker (i));
+        }
 
-            if (++i >= samples_to_read)
-            {
-                break;
-            }
+        for (const auto& marker : markerReader->getNewUnmappedMarkers())
+        {
+            LOGC ("No event channel mapping found for marker: '", marker, "'");
         }
     }
     catch (const std::runtime_error& re)
@@ -344,71 +352,71 @@ bool LSLInletThread::foundInputSource()
 
 bool LSLInletThread::startAcquisition()
 {
-    if (selectedDataStream == STREAM_SELECTION_UNDEFINED)
+    if (selectedDataStream == STREAM_SELECTION_UNDEFINED || acquiredStreams.empty())
     {
         LOGC ("Not starting acquisition because no data stream was selected");
         return false;
     }
 
-    totalSamples = 0;
     initialTimestamp = TIMESTAMP_UNDEFINED;
 
-    this->dataStream = new lsl::stream_inlet (dataStreams[selectedDataStream]);
+    readers.clear();
 
-    numChannels = dataStreams[selectedDataStream].channel_count();
-    sourceBuffers[0]->resize (numChannels, 100000);
-
-    if (auto newBuffer = (float*) realloc (dataBuffer, numChannels * numSamples * sizeof (float)))
-    {
-        dataBuffer = newBuffer;
-    }
-    else
-    {
-        LOGE ("Failed to allocate data buffer");
-        return false;
-    }
-    if (auto newBuffer = (double*) realloc (timestampBuffer, numSamples * sizeof (double)))
+    for (int i = 0; i < acquiredStreams.size(); i++)
     {
-        timestampBuffer = newBuffer;
-    }
-    else
-    {
-        LOGE ("Failed to allocate timestamp buffer");
-        return false;
-    }
+        auto* reader = readers.add (new LSLStreamReader (acquiredStreams[i], MAX_CHUNK_SECONDS, TARGET_CHUNK_SECONDS, (int) DEFAULT_NUM_SAMPLES));
 
-    if (auto newBuffer = (int64*) realloc (sampleNumbers, numSamples * sizeof (int64)))
-    {
-        sampleNumbers = newBuffer;
-    }
-    else
-    {
-        LOGE ("Failed to allocate sample numbers buffer");
-        return false;
+        if (! reader->open (OPEN_STREAM_TIMEOUT))
+        {
+            LOGE ("Not starting acquisition because LSL stream ", acquiredStreams[i].name(), " could not be opened");
+            readers.clear();
+            return false;
+        }
+
+        // Size the buffer from the stream's rate
+        sourceBuffers[i]->resize (reader->getNumChannels(),
+                                  jmax (reader->getCapacity() * 4, (int) std::ceil (reader->getSampleRate() * DATA_BUFFER_SECONDS)));
     }
-    if (auto newBuffer = (uint64*) realloc (ttlEventWords, numSamples * sizeof (uint64)))
+
+    samplesRead.assign (readers.size(), 0);
+
+    if (markerStreams.size())
     {
-        ttlEventWords = newBuffer;
+        int selectedMarkerStream = ((SelectedStreamParameter*) (getParameter ("marker_stream")))->getSelectedIndex();
+        jassert (markerStreams[selectedMarkerStream].channel_count() == 1);
+
+        markerReader = std::make_unique<LSLMarkerReader> (markerStreams[selectedMarkerStream], MAX_PENDING_MARKERS);
+        markerReader->setMapping (eventMap);
 
-        // initialize the TTL buffer to 0
-        for (int i = 0; i < numSamples; i++)
+        if (! markerReader->open (OPEN_STREAM_TIMEOUT))
         {
-            ttlEventWords[i] = 0;
+            LOGE ("LSL marker stream ", markerStreams[selectedMarkerStream].name(), " could not be opened; acquiring without markers");
+            markerReader.reset();
         }
     }
-    else
+
+    // The clock offset estimates started above run in parallel, so this waits
+    // about one round of estimation rather than one per stream
+    for (auto* reader : readers)
     {
-        LOGE ("Failed to allocate TTL word buffer");
-        return false;
+        if (reader->waitForTimeCorrection (TIME_CORRECTION_TIMEOUT))
+        {
+            LOGC ("LSL stream ", reader->getInfo().name(), " clock offset ", String (reader->getTimeCorrection() * 1000.0, 3), " ms");
+        }
+        else
+        {
+            LOGE ("No clock offset estimate for LSL stream ", reader->getInfo().name(), "; its timestamps may not align with the other streams");
+        }
     }
 
-    if (markerStreams.size())
+    if (markerReader != nullptr && ! markerReader->waitForTimeCorrection (TIME_CORRECTION_TIMEOUT))
     {
-        int selectedMarkerStream = ((SelectedStreamParameter*) (getParameter ("marker_stream")))->getSelectedIndex();
-        this->markersStream = new lsl::stream_inlet (markerStreams[selectedMarkerStream]);
-        jassert (this->markersStream->get_channel_count() == 1);
+        LOGE ("No clock offset estimate for the LSL marker stream; markers may not align with samples");
     }
 
+    publishStatistics();
+    numStreams = readers.size();
+
     startThread();
     return true;
 }
@@ -426,20 +434,30 @@ bool LSLInletThread::stopAcquisition()
         stopThread (500);
     }
 
-    if (this->dataStream != NULL)
+    for (auto* reader : readers)
     {
-        this->dataStream->close_stream();
-        delete this->dataStream;
-        this->dataStream = NULL;
+        LOGC ("LSL stream ", reader->getInfo().name(), " pulled with chunk size ", reader->getChunkSize(), ", backlog ", reader->getBacklog(),
+              " samples, max latency ", String (reader->getMaxPullLatency() * 1000.0, 1), " ms, dropped ", reader->getDroppedSamples(), " samples");
     }
-    if (this->markersStream != NULL)
+
+    readers.clear();
+
+    if (markerReader != nullptr)
     {
-        this->markersStream->close_stream();
-        delete this->markersStream;
-        this->markersStream = NULL;
+        if (markerReader->getNumPending() > 0 || markerReader->getDroppedMarkers() > 0)
+        {
+            LOGC ("LSL marker stream stopped with ", markerReader->getNumPending(), " markers not yet placed, ",
+                  markerReader->getDroppedMarkers(), " dropped from a full queue");
+        }
+
+        markerReader.reset();
+    }
+
+    for (auto* buffer : sourceBuffers)
+    {
+        buffer->clear();
     }
 
-    sourceBuffers[0]->clear();
     return true;
 }
 
@@ -457,50 +475,87 @@ void LSLInletThread::updateSettings (OwnedArray<ContinuousChannel>* continuousCh
     configurationObjects->clear();
     sourceStreams->clear();
 
-    if (dataStreams.empty())
+    acquiredStreams.clear();
+
+    if (dataStreams.empty() || selectedDataStream < 0 || selectedDataStream >= dataStreams.size())
     {
         return;
     }
 
-    numChannels = dataStreams[selectedDataStream].channel_count();
+    const lsl::stream_info& selected = dataStreams[selectedDataStream];
+    acquiredStreams.push_back (selected);
 
-    DataStream::Settings settings {
-        dataStreams[selectedDataStream].name(),
-        dataStreams[selectedDataStream].type(),
-        dataStreams[selectedDataStream].source_id(),
+    if (streamSet != StreamSet::SELECTED)
+    {
+        for (const auto& stream : dataStreams)
+        {
+            if (stream.uid() == selected.uid())
+            {
+                continue;
+            }
 
-        (float) dataStreams[selectedDataStream].nominal_srate()
+            if (streamSet == StreamSet::ALL || stream.hostname() == selected.hostname())
+            {
+                acquiredStreams.push_back (stream);
+            }
+        }
+    }
 
-    };
-    sourceStreams->add (new DataStream (settings));
-    for (int ch = 0; ch < dataStreams[selectedDataStream].channel_count(); ch++)
+    for (const auto& stream : acquiredStreams)
     {
-        ContinuousChannel::Settings settings {
-            ContinuousChannel::Type::ELECTRODE,
-            "CH" + String (ch + 1),
-            "description",
-            "identifier",
+        DataStream::Settings settings {
+            stream.name(),
+            stream.type(),
+            stream.source_id(),
 
-            0.195f,
+            (float) stream.nominal_srate()
 
-            sourceStreams->getFirst()
         };
 
-        continuousChannels->add (new ContinuousChannel (settings));
+        DataStream* dataStream = new DataStream (settings);
+        sourceStreams->add (dataStream);
+
+        for (int ch = 0; ch < stream.channel_count(); ch++)
+        {
+            ContinuousChannel::Settings settings {
+                ContinuousChannel::Type::ELECTRODE,
+                "CH" + String (ch + 1),
+                "description",
+                "identifier",
+
+                0.195f,
+
+                dataStream
+            };
+
+            continuousChannels->add (new ContinuousChannel (settings));
+        }
+
+        // SourceNode expects one event channel per stream; markers are only
+        // written to the selected stream's
+        EventChannel::Settings eventSettings {
+            EventChannel::Type::TTL,
+            "Events" + stream.source_id(),
+            "description",
+            "identifier",
+            dataStream,
+            64
+        };
+
+        eventChannels->add (new EventChannel (eventSettings));
     }
+}
 
-    EventChannel::Settings eventSettings {
-        EventChannel::Type::TTL,
-        "Events" + dataStreams[selectedDataStream].source_id(),
-        "description",
-        "identifier",
-        sourceStreams->getFirst(),
-        64
-    };
+void LSLInletThread::resizeBuffers()
+{
+    const int numBuffers = jmax (1, (int) acquiredStreams.size());
 
-    const auto ec = new EventChannel (eventSettings);
+    while (sourceBuffers.size() < numBuffers)
+    {
+        sourceBuffers.add (new DataBuffer (1, 100000));
+    }
 
-    eventChannels->add (ec);
+    sourceBuffers.removeLast (sourceBuffers.size() - numBuffers);
 }
 
 std::unique_ptr<GenericEditor> LSLInletThread::createEditor (SourceNode* sn)
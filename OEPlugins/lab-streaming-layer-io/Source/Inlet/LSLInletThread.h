@@ -26,13 +26,62 @@
 
 #include <DataThreadHeaders.h>
 
+#include "LSLMarkerReader.h"
+#include "LSLStreamReader.h"
+
 #include <lsl_cpp.h>
 
+#include <atomic>
+
 const float DEFAULT_DATA_SCALE = 1.0f;
 const int STREAM_SELECTION_UNDEFINED = -1;
 const double TIMESTAMP_UNDEFINED = -1;
 const size_t DEFAULT_NUM_SAMPLES = 1024;
 
+/** Longest a pull waits for data, so the thread can notice it should exit (seconds) */
+const double PULL_TIMEOUT = 0.1;
+
+/** Largest chunk pulled in one update, as a duration of the stream (seconds) */
+const double MAX_CHUNK_SECONDS = 0.25;
+
+/** Chunk duration the adaptive mode aims for when it is keeping up (seconds) */
+const double TARGET_CHUNK_SECONDS = 0.01;
+
+/** Duration of data each source DataBuffer can hold (seconds) */
+const double DATA_BUFFER_SECONDS = 5.0;
+
+/** Markers held while waiting for data to cover their timestamps */
+const int MAX_PENDING_MARKERS = 4096;
+
+/** Longest acquisition start waits to connect to each stream (seconds) */
+const double OPEN_STREAM_TIMEOUT = 2.0;
+
+/** Longest acquisition start waits for each stream's first clock offset estimate (seconds) */
+const double TIME_CORRECTION_TIMEOUT = 2.0;
+
+/** How updateBuffer() waits for and pulls samples */
+enum class PullMode
+{
+    /** Block until a sample arrives, then take everything already received */
+    BLOCKING = 0,
+
+    /** Sleep until a chunk is due, with the chunk size following the backlog */
+    ADAPTIVE = 1
+};
+
+/** Which discovered data streams are acquired along with the selected one */
+enum class StreamSet
+{
+    /** Only the selected stream */
+    SELECTED = 0,
+
+    /** The selected stream and every other data stream from the same host */
+    SAME_HOST = 1,
+
+    /** Every discovered data stream */
+    ALL = 2
+};
+
 class LSLInletThread : public DataThread
 {
 public:
@@ -45,8 +94,11 @@ public:
     /** User defined scaling factor for samples */
     float dataScale;
 
-    /** Number of samples to read during each update cycle */
-    int numSamples;
+    /** How samples are pulled from the inlets */
+    PullMode pullMode;
+
+    /** Which data streams are acquired */
+    StreamSet streamSet;
 
     /** Index (in the discovered streams list) of the user selected LSL stream */
     int selectedDataStream;
@@ -61,6 +113,9 @@ public:
     std::vector<lsl::stream_info> dataStreams;
     std::vector<lsl::stream_info> markerStreams;
 
+    /** Data streams to acquire, each published as its own DataStream, the selected stream first */
+    std::vector<lsl::stream_info> acquiredStreams;
+
     /** Perform LSL stream discovery */
     void discover();
 
@@ -103,6 +158,9 @@ public:
     //       (can optionally be overriden by sub-classes)
     // ------------------------------------------------------------
 
+    /** Keeps one DataBuffer per acquired stream */
+    void resizeBuffers() override;
+
     /** Create the DataThread custom editor */
     std::unique_ptr<GenericEditor> createEditor (SourceNode* sn) override;
 
@@ -118,27 +176,55 @@ public:
     // ** Allows the DataThread plugin to handle a config message while acquisition is not active. */
     String handleConfigMessage (const String& msg) override;
 
+    // ------------------------------------------------------------
+    //                   PULL STATISTICS
+    //      (updated by the acquisition thread, read by the editor)
+    // ------------------------------------------------------------
+
+    /** Number of streams being acquired */
+    int getNumStreams() const { return numStreams.load(); }
+
+    /** Largest number of samples per pull the adaptive mode is aiming for, across streams */
+    int getChunkSize() const { return currentChunkSize.load(); }
+
+    /** Samples still queued in all inlets after the last pull */
+    int64 getBacklog() const { return backlog.load(); }
+
+    /** Local clock minus the newest sample's timestamp at the last pull, worst stream (seconds) */
+    double getPullLatency() const { return pullLatency.load(); }
+
+    /** Largest pull latency since acquisition started (seconds) */
+    double getMaxPullLatency() const { return maxPullLatency.load(); }
+
+    /** Samples lost because a source DataBuffer was full, across streams */
+    int64 getDroppedSamples() const { return droppedSamples.load(); }
+
 private:
     template <typename T>
     void printBuffer (const char* desc, T* buf, size_t size);
-    void readMarkers (std::size_t samples_to_read);
-    std::string trim (const std::string str);
 
-    int64 totalSamples;
-    lsl::stream_inlet* dataStream;
-    lsl::stream_inlet* markersStream;
+    /** Pulls and broadcasts new markers, queueing them to be placed on the selected stream's samples */
+    void readMarkers();
+
+    /** Copies the readers' pull statistics to the values read by the editor */
+    void publishStatistics();
+    std::string trim (const std::string str);
 
-    float* dataBuffer;
-    float* samples;
-    double* timestampBuffer;
+    OwnedArray<LSLStreamReader> readers;
+    std::vector<int> samplesRead;
+    std::unique_ptr<LSLMarkerReader> markerReader;
 
-    int64* sampleNumbers;
-    uint64* ttlEventWords;
     std::map<std::string, uint64> eventMap;
 
-    int numChannels;
     double initialTimestamp;
 
+    std::atomic<int> numStreams { 0 };
+    std::atomic<int> currentChunkSize { 0 };
+    std::atomic<int64> backlog { 0 };
+    std::atomic<double> pullLatency { 0.0 };
+    std::atomic<double> maxPullLatency { 0.0 };
+    std::atomic<int64> droppedSamples { 0 };
+
     bool firstConnect = true;
 };
 
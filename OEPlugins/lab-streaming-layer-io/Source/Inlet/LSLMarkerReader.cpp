@@ -0,0 +1,180 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "LSLMarkerReader.h"
+
+#include <algorithm>
+
+/** Markers taken from the inlet per pull_chunk call */
+static const int MARKER_CHUNK_SIZE = 64;
+
+LSLMarkerReader::LSLMarkerReader (const lsl::stream_info& info_, int maxPendingMarkers)
+    : info (info_),
+      maxPending (maxPendingMarkers),
+      chunk (MARKER_CHUNK_SIZE),
+      chunkTimestamps (MARKER_CHUNK_SIZE)
+{
+}
+
+LSLMarkerReader::~LSLMarkerReader()
+{
+    close();
+}
+
+bool LSLMarkerReader::open (double timeout)
+{
+    inlet = std::make_unique<lsl::stream_inlet> (info);
+    inlet->set_postprocessing (lsl::post_clocksync);
+
+    pending.clear();
+    droppedMarkers = 0;
+
+    try
+    {
+        inlet->open_stream (timeout);
+    }
+    catch (const lsl::timeout_error&)
+    {
+        inlet.reset();
+        return false;
+    }
+
+    try
+    {
+        // Starts the background estimate; there is none to return yet
+        inlet->time_correction (0.0);
+    }
+    catch (const lsl::timeout_error&)
+    {
+    }
+
+    return true;
+}
+
+bool LSLMarkerReader::waitForTimeCorrection (double timeout)
+{
+    try
+    {
+        inlet->time_correction (timeout);
+        return true;
+    }
+    catch (const lsl::timeout_error&)
+    {
+        return false;
+    }
+}
+
+void LSLMarkerReader::close()
+{
+    if (inlet != nullptr)
+    {
+        inlet->close_stream();
+        inlet.reset();
+    }
+
+    pending.clear();
+}
+
+void LSLMarkerReader::setMapping (const std::map<std::string, unsigned long long>& lineForMarker)
+{
+    wordForMarker.clear();
+
+    for (const auto& [marker, line] : lineForMarker)
+    {
+        wordForMarker[marker] = (line >= 1 && line <= 64) ? 1ULL << (line - 1) : 0;
+    }
+}
+
+unsigned long long LSLMarkerReader::getWord (const std::string& marker)
+{
+    auto it = wordForMarker.find (marker);
+
+    if (it != wordForMarker.end())
+    {
+        return it->second;
+    }
+
+    // Remember unmapped markers so they are reported once, not on every repeat
+    wordForMarker.emplace (marker, 0);
+    newUnmappedMarkers.push_back (marker);
+
+    return 0;
+}
+
+int LSLMarkerReader::pull()
+{
+    pulledMarkers.clear();
+    newUnmappedMarkers.clear();
+
+    std::size_t numPulled;
+
+    do
+    {
+        numPulled = inlet->pull_chunk_multiplexed (chunk.data(), chunkTimestamps.data(), MARKER_CHUNK_SIZE, MARKER_CHUNK_SIZE, 0.0);
+
+        for (std::size_t i = 0; i < numPulled; i++)
+        {
+            const PendingMarker marker { chunkTimestamps[i], getWord (chunk[i]) };
+
+            // Markers normally arrive in timestamp order, so this is an append
+            auto position = std::upper_bound (pending.begin(), pending.end(), marker.timestamp, [] (double timestamp, const PendingMarker& m)
+                                              { return timestamp < m.timestamp; });
+            pending.insert (position, marker);
+
+            pulledMarkers.push_back (std::move (chunk[i]));
+        }
+    } while (numPulled == MARKER_CHUNK_SIZE);
+
+    while ((int) pending.size() > maxPending)
+    {
+        pending.pop_front();
+        droppedMarkers++;
+    }
+
+    return (int) pulledMarkers.size();
+}
+
+int LSLMarkerReader::place (const double* timestamps, int numSamples, unsigned long long* words)
+{
+    if (numSamples <= 0)
+    {
+        return 0;
+    }
+
+    const double* first = timestamps;
+    const double* end = timestamps + numSamples;
+    const double lastTimestamp = timestamps[numSamples - 1];
+    int placed = 0;
+
+    // Pending markers are sorted, so each search starts where the last one landed
+    while (! pending.empty() && pending.front().timestamp <= lastTimestamp)
+    {
+        first = std::lower_bound (first, end, pending.front().timestamp);
+        words[first - timestamps] |= pending.front().word;
+
+        pending.pop_front();
+        placed++;
+    }
+
+    return placed;
+}
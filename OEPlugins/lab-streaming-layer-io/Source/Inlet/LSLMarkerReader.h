@@ -0,0 +1,127 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef LSLMARKERREADER_H_DEFINED
+#define LSLMARKERREADER_H_DEFINED
+
+#include <lsl_cpp.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Pulls an LSL marker stream on behalf of the LSL Inlet and places its
+ * markers on data samples as TTL words.
+ *
+ * Markers are pulled in bulk and translated to TTL words once, through a
+ * table compiled from the marker mapping, then held in a queue until a
+ * data block covering their timestamp arrives. Placement is a binary search
+ * over the block's timestamps, so markers that are ahead of the data are
+ * kept for a later block instead of being discarded.
+ *
+ * Timestamps are moved onto the local clock with LSL's clock
+ * synchronization, matching LSLStreamReader.
+ *
+ * Kept free of JUCE so it can be driven by in-process outlets outside the GUI.
+ */
+class LSLMarkerReader
+{
+public:
+    /** Creates a reader for a single-channel string stream; the inlet is not created until open() */
+    LSLMarkerReader (const lsl::stream_info& info, int maxPendingMarkers);
+
+    /** Closes the inlet if it is still open */
+    ~LSLMarkerReader();
+
+    /** Creates and subscribes the inlet and starts its clock offset estimate; false if it could not be reached within timeout */
+    bool open (double timeout);
+
+    /** Waits up to timeout seconds for the first clock offset estimate; returns false if none arrived */
+    bool waitForTimeCorrection (double timeout);
+
+    /** Closes and destroys the inlet, and drops any pending markers */
+    void close();
+
+    /**
+     * Compiles the marker text to TTL line table. Line n (1-64) sets bit
+     * n - 1; line 0 keeps the marker as a broadcast message only.
+     */
+    void setMapping (const std::map<std::string, unsigned long long>& lineForMarker);
+
+    /**
+     * Pulls every marker already received into the pending queue, and
+     * returns how many were pulled. Their text is available from
+     * getPulledMarker() until the next pull.
+     */
+    int pull();
+
+    /** Text of the i-th marker of the last pull */
+    const std::string& getPulledMarker (int i) const { return pulledMarkers[i]; }
+
+    /** Marker texts of the last pull with no entry in the mapping, each reported once */
+    const std::vector<std::string>& getNewUnmappedMarkers() const { return newUnmappedMarkers; }
+
+    /**
+     * ORs the word of every pending marker up to the last of numSamples
+     * timestamps into words, at the first sample at or after the marker.
+     * Markers older than the first sample land on it. Returns the number
+     * of markers placed.
+     */
+    int place (const double* timestamps, int numSamples, unsigned long long* words);
+
+    /** Markers waiting for data to cover their timestamp */
+    int getNumPending() const { return (int) pending.size(); }
+
+    /** Markers dropped because the pending queue was full */
+    long long getDroppedMarkers() const { return droppedMarkers; }
+
+private:
+    struct PendingMarker
+    {
+        double timestamp;
+        unsigned long long word;
+    };
+
+    /** Looks up the TTL word for a marker, adding unmapped markers to the table */
+    unsigned long long getWord (const std::string& marker);
+
+    lsl::stream_info info;
+    std::unique_ptr<lsl::stream_inlet> inlet;
+
+    int maxPending;
+    std::deque<PendingMarker> pending;
+    long long droppedMarkers = 0;
+
+    std::unordered_map<std::string, unsigned long long> wordForMarker;
+
+    std::vector<std::string> chunk;
+    std::vector<double> chunkTimestamps;
+    std::vector<std::string> pulledMarkers;
+    std::vector<std::string> newUnmappedMarkers;
+};
+
+#endif
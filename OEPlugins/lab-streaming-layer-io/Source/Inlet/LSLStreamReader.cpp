@@ -0,0 +1,196 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "LSLStreamReader.h"
+#include "../SampleTranspose.h"
+
+#include <algorithm>
+#include <cmath>
+
+LSLStreamReader::LSLStreamReader (const lsl::stream_info& info_, double maxChunkSeconds, double targetChunkSeconds, int minCapacity)
+    : info (info_)
+{
+    numChannels = info.channel_count();
+    sampleRate = info.nominal_srate();
+
+    capacity = std::max (minCapacity, (int) std::ceil (sampleRate * maxChunkSeconds));
+    targetChunkSize = std::clamp ((int) std::ceil (sampleRate * targetChunkSeconds), 1, capacity);
+    chunkSize = targetChunkSize;
+
+    interleaved.resize ((size_t) numChannels * capacity);
+    timestamps.resize (capacity);
+    channelData.resize ((size_t) numChannels * capacity);
+    channelPointers.resize (numChannels);
+    sampleNumbers.resize (capacity);
+    eventWords.resize (capacity, 0);
+}
+
+LSLStreamReader::~LSLStreamReader()
+{
+    close();
+}
+
+bool LSLStreamReader::open (double timeout)
+{
+    inlet = std::make_unique<lsl::stream_inlet> (info);
+
+    // Let LSL add its clock offset estimate to every timestamp, so samples
+    // from streams on other hosts land on this machine's clock
+    inlet->set_postprocessing (lsl::post_clocksync);
+
+    totalSamples = 0;
+    timeCorrection = 0.0;
+    backlog = 0;
+    pullLatency = 0.0;
+    maxPullLatency = 0.0;
+    droppedSamples = 0;
+    chunkSize = targetChunkSize;
+
+    try
+    {
+        inlet->open_stream (timeout);
+    }
+    catch (const lsl::timeout_error&)
+    {
+        inlet.reset();
+        return false;
+    }
+
+    try
+    {
+        // Starts the background estimate; there is none to return yet
+        timeCorrection = inlet->time_correction (0.0);
+    }
+    catch (const lsl::timeout_error&)
+    {
+    }
+
+    return true;
+}
+
+bool LSLStreamReader::waitForTimeCorrection (double timeout)
+{
+    try
+    {
+        timeCorrection = inlet->time_correction (timeout);
+        return true;
+    }
+    catch (const lsl::timeout_error&)
+    {
+        return false;
+    }
+}
+
+void LSLStreamReader::close()
+{
+    if (inlet != nullptr)
+    {
+        inlet->close_stream();
+        inlet.reset();
+    }
+}
+
+int LSLStreamReader::pull (int maxSamples, double timeout)
+{
+    maxSamples = std::min (maxSamples, capacity);
+
+    int numRead = 0;
+
+    if (timeout > 0.0)
+    {
+        const double firstTimestamp = inlet->pull_sample (interleaved.data(), numChannels, timeout);
+
+        if (firstTimestamp == 0.0)
+        {
+            return 0;
+        }
+
+        timestamps[0] = firstTimestamp;
+        numRead = 1;
+    }
+
+    if (maxSamples > numRead)
+    {
+        const std::size_t valuesRead = inlet->pull_chunk_multiplexed (interleaved.data() + (size_t) numRead * numChannels,
+                                                                      timestamps.data() + numRead,
+                                                                      (size_t) (maxSamples - numRead) * numChannels,
+                                                                      maxSamples - numRead,
+                                                                      0.0);
+        numRead += (int) (valuesRead / numChannels);
+    }
+
+    if (numRead == 0)
+    {
+        return 0;
+    }
+
+    pullLatency = lsl::local_clock() - timestamps[numRead - 1];
+    maxPullLatency = std::max (maxPullLatency, pullLatency);
+    backlog = (long long) inlet->samples_available();
+
+    std::fill (eventWords.begin(), eventWords.begin() + numRead, 0);
+
+    return numRead;
+}
+
+int LSLStreamReader::getMillisecondsToChunk()
+{
+    const int available = (int) inlet->samples_available();
+
+    if (available >= chunkSize || sampleRate <= 0.0)
+    {
+        return 0;
+    }
+
+    return (int) std::ceil ((chunkSize - available) * 1000.0 / sampleRate);
+}
+
+void LSLStreamReader::adaptChunkSize()
+{
+    if (backlog > chunkSize)
+    {
+        chunkSize = std::min (capacity, chunkSize * 2);
+    }
+    else if (backlog == 0 && chunkSize > targetChunkSize)
+    {
+        chunkSize = std::max (targetChunkSize, chunkSize - chunkSize / 8);
+    }
+}
+
+void LSLStreamReader::prepareBlock (int numRead, double startTime, float scale)
+{
+    for (int i = 0; i < numRead; i++)
+    {
+        sampleNumbers[i] = totalSamples + i;
+        timestamps[i] -= startTime;
+    }
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        channelPointers[ch] = channelData.data() + (size_t) ch * numRead;
+    }
+
+    SampleTranspose::deinterleave (interleaved.data(), numChannels, numRead, channelPointers.data(), scale);
+
+    totalSamples += numRead;
+}
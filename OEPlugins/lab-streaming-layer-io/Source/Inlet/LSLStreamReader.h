@@ -0,0 +1,156 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef LSLSTREAMREADER_H_DEFINED
+#define LSLSTREAMREADER_H_DEFINED
+
+#include <lsl_cpp.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Pulls one LSL data stream on behalf of the LSL Inlet.
+ *
+ * Owns the stream's inlet and every buffer a pull fills: the interleaved
+ * samples and timestamps coming from LSL, and the channel-major samples,
+ * sample numbers and TTL words handed on to a DataBuffer.
+ *
+ * Timestamps are moved onto the local clock with LSL's clock
+ * synchronization, so readers for streams from different hosts share a
+ * single timeline.
+ *
+ * Kept free of JUCE so it can be driven by in-process outlets outside the GUI.
+ */
+class LSLStreamReader
+{
+public:
+    /** Sizes the buffers for the stream's rate; the inlet is not created until open() */
+    LSLStreamReader (const lsl::stream_info& info, double maxChunkSeconds, double targetChunkSeconds, int minCapacity);
+
+    /** Closes the inlet if it is still open */
+    ~LSLStreamReader();
+
+    /**
+     * Creates the inlet and subscribes to the stream, so samples are queued
+     * from now on rather than from the first pull, then starts estimating the
+     * clock offset in the background. Returns false if the outlet could not
+     * be reached within timeout seconds.
+     */
+    bool open (double timeout);
+
+    /** Waits up to timeout seconds for the first clock offset estimate; returns false if none arrived */
+    bool waitForTimeCorrection (double timeout);
+
+    /** Closes and destroys the inlet */
+    void close();
+
+    /**
+     * Pulls up to maxSamples into the interleaved buffers.
+     *
+     * With a non-zero timeout, waits up to that long for the first sample and
+     * then takes whatever else is already queued, since LSL's timed chunk pull
+     * waits for a full chunk. Returns the number of samples read.
+     */
+    int pull (int maxSamples, double timeout);
+
+    /** Milliseconds until chunkSize samples should be queued, from the nominal rate */
+    int getMillisecondsToChunk();
+
+    /** Grows the chunk size while a backlog builds, and eases it back once drained */
+    void adaptChunkSize();
+
+    /**
+     * Readies the last numRead samples for a DataBuffer: scales and transposes
+     * them to channel-major order, numbers them, and makes their timestamps
+     * relative to startTime.
+     */
+    void prepareBlock (int numRead, double startTime, float scale);
+
+    /** Counts samples the DataBuffer had no room for */
+    void addDroppedSamples (int count) { droppedSamples += count; }
+
+    const lsl::stream_info& getInfo() const { return info; }
+    int getNumChannels() const { return numChannels; }
+    double getSampleRate() const { return sampleRate; }
+
+    /** Largest number of samples a single pull can return */
+    int getCapacity() const { return capacity; }
+
+    /** Samples per pull in adaptive mode */
+    int getChunkSize() const { return chunkSize; }
+
+    /** Timestamps of the last pull, on the local clock until prepareBlock() */
+    double* getTimestamps() { return timestamps.data(); }
+
+    /** TTL words for the last pull, cleared by each pull */
+    unsigned long long* getEventWords() { return eventWords.data(); }
+
+    /** Channel-major samples after prepareBlock(), channelCount x numRead */
+    float* getChannelData() { return channelData.data(); }
+
+    /** Sample numbers after prepareBlock() */
+    long long* getSampleNumbers() { return sampleNumbers.data(); }
+
+    /** Clock offset to the sender estimated when the stream was opened (seconds) */
+    double getTimeCorrection() const { return timeCorrection; }
+
+    /** Samples still queued in the inlet after the last pull */
+    long long getBacklog() const { return backlog; }
+
+    /** Local clock minus the newest sample's timestamp at the last pull (seconds) */
+    double getPullLatency() const { return pullLatency; }
+
+    /** Largest pull latency since the reader was opened (seconds) */
+    double getMaxPullLatency() const { return maxPullLatency; }
+
+    /** Samples lost because the DataBuffer was full */
+    long long getDroppedSamples() const { return droppedSamples; }
+
+private:
+    lsl::stream_info info;
+    std::unique_ptr<lsl::stream_inlet> inlet;
+
+    int numChannels;
+    double sampleRate;
+    int capacity;
+    int chunkSize;
+    int targetChunkSize;
+
+    std::vector<float> interleaved;
+    std::vector<double> timestamps;
+    std::vector<float> channelData;
+    std::vector<float*> channelPointers;
+    std::vector<long long> sampleNumbers;
+    std::vector<unsigned long long> eventWords;
+
+    long long totalSamples = 0;
+
+    double timeCorrection = 0.0;
+    long long backlog = 0;
+    double pullLatency = 0.0;
+    double maxPullLatency = 0.0;
+    long long droppedSamples = 0;
+};
+
+#endif
@@ -30,9 +30,10 @@ LSLOutlet::LSLOutlet()
       streamType("EEG"),
       dataScale(1.0f),
       includeMarkers(true),
+      sampleFormat(OutletFormat::FLOAT32),
+      chunkMilliseconds(DEFAULT_CHUNK_MILLISECONDS),
       forwardBroadcasts(true),
       streaming(false),
-      totalSamplesPushed(0),
       broadcastMessagesForwarded(0)
 {
     // Generate a unique source ID based on time
@@ -76,6 +77,17 @@ void LSLOutlet::registerParameters()
                         "forward_broadcasts", "Forward Broadcasts",
                         "Forward broadcast messages as LSL markers",
                         forwardBroadcasts);
+
+    addCategoricalParameter(Parameter::GLOBAL_SCOPE,
+                            "sample_format", "Format",
+                            "Sample type sent to LSL; integer formats are in units of bit_volts",
+                            { "float32", "int32", "int16" },
+                            0, true);
+
+    addIntParameter(Parameter::GLOBAL_SCOPE,
+                    "chunk_ms", "Chunk (ms)",
+                    "Duration of the chunks LSL transmits",
+                    chunkMilliseconds, 1, 1000, true);
 }
 
 void LSLOutlet::parameterValueChanged(Parameter* param)
@@ -100,6 +112,14 @@ void LSLOutlet::parameterValueChanged(Parameter* param)
     {
         forwardBroadcasts = (bool)param->getValue();
     }
+    else if (param->getName() == "sample_format")
+    {
+        sampleFormat = (OutletFormat)(int)param->getValue();
+    }
+    else if (param->getName() == "chunk_ms")
+    {
+        chunkMilliseconds = (int)param->getValue();
+    }
 }
 
 void LSLOutlet::updateSettings()
@@ -144,24 +164,38 @@ void LSLOutlet::setIncludeMarkers(bool include)
     }
 }
 
+void LSLOutlet::setSampleFormat(OutletFormat format)
+{
+    if (!streaming)
+    {
+        sampleFormat = format;
+        Parameter* param = getParameter("sample_format");
+        if (param) param->setNextValue((int)format);
+    }
+}
+
+void LSLOutlet::setChunkMilliseconds(int milliseconds)
+{
+    if (!streaming)
+    {
+        chunkMilliseconds = milliseconds;
+        Parameter* param = getParameter("chunk_ms");
+        if (param) param->setNextValue(milliseconds);
+    }
+}
+
 int LSLOutlet::getNumConsumers() const
 {
-    if (dataOutlets.empty())
+    if (sender.getDataQueues().isEmpty())
         return 0;
-    
+
     // Return consumer count for first outlet
-    auto it = dataOutlets.begin();
-    if (it != dataOutlets.end() && it->second)
-    {
-        return it->second->have_consumers() ? 1 : 0;
-    }
-    return 0;
+    return sender.getDataQueues().getFirst()->outlet->have_consumers() ? 1 : 0;
 }
 
 void LSLOutlet::createOutlets()
 {
     destroyOutlets();
-    totalSamplesPushed = 0;
     broadcastMessagesForwarded = 0;
 
     // Create an LSL outlet for each data stream
@@ -173,6 +207,21 @@ void LSLOutlet::createOutlets()
 
         if (numChannels > 0)
         {
+            // Integer formats count steps of the coarsest channel's bit volts,
+            // so no channel's range is clipped
+            float bitVolts = 0.0f;
+            for (auto channel : stream->getContinuousChannels())
+                bitVolts = jmax(bitVolts, channel->getBitVolts());
+            if (bitVolts <= 0.0f) bitVolts = 1.0f;
+
+            lsl::channel_format_t channelFormat = lsl::cf_float32;
+            if (sampleFormat == OutletFormat::INT32)
+                channelFormat = lsl::cf_int32;
+            else if (sampleFormat == OutletFormat::INT16)
+                channelFormat = lsl::cf_int16;
+
+            bool integerFormat = sampleFormat != OutletFormat::FLOAT32;
+
             // Create stream info
             String outletName = streamName + "_" + stream->getName();
             lsl::stream_info info(
@@ -180,7 +229,7 @@ void LSLOutlet::createOutlets()
                 streamType.toStdString(),
                 numChannels,
                 sampleRate,
-                lsl::cf_float32,
+                channelFormat,
                 (sourceId + "_" + String(streamId)).toStdString()
             );
 
@@ -193,6 +242,8 @@ void LSLOutlet::createOutlets()
                 chan.append_child_value("label", channel->getName().toStdString());
                 chan.append_child_value("unit", "uV");
                 chan.append_child_value("type", streamType.toStdString());
+                if (integerFormat)
+                    chan.append_child_value("bit_volts", std::to_string(bitVolts));
             }
 
             // Add acquisition info
@@ -201,14 +252,28 @@ void LSLOutlet::createOutlets()
             acq.append_child_value("model", "Open Ephys GUI");
             acq.append_child_value("plugin", "LSL Outlet");
             acq.append_child_value("scale_factor", std::to_string(dataScale));
+            acq.append_child_value("sample_format", getParameter("sample_format")->getValueAsString().toStdString());
+
+            // Consumers recover microvolts as value * bit_volts / scale_factor
+            if (integerFormat)
+                acq.append_child_value("bit_volts", std::to_string(bitVolts));
 
             // Create the outlet with a chunk size for efficiency
-            int chunkSize = (int)(sampleRate / 20); // ~50ms chunks
-            if (chunkSize < 1) chunkSize = 1;
-            dataOutlets[streamId] = std::make_unique<lsl::stream_outlet>(info, chunkSize);
+            int chunkSize = jmax(1, roundToInt(sampleRate * chunkMilliseconds / 1000.0));
+
+            // Resolve the channels' buffer indices once, rather than on every block
+            std::vector<int> channelIndices;
+            for (auto channel : stream->getContinuousChannels())
+                channelIndices.push_back(channel->getGlobalIndex());
+
+            sender.addDataOutlet(std::make_unique<lsl::stream_outlet>(info, chunkSize),
+                                 streamId, channelIndices, sampleRate, SEND_QUEUE_SECONDS,
+                                 sampleFormat, 1.0f / bitVolts, chunkSize);
 
             LOGC("LSL Outlet: Created outlet '", outletName, "' with ", numChannels, 
-                 " channels at ", sampleRate, " Hz (scale=", dataScale, ")");
+                 " channels at ", sampleRate, " Hz (scale=", dataScale,
+                 ", format=", getParameter("sample_format")->getValueAsString(),
+                 ", chunk=", chunkSize, " samples)");
         }
     }
 
@@ -230,25 +295,34 @@ void LSLOutlet::createOutlets()
         desc.append_child_value("ttl_format", "TTL_Line<N>_State<0|1>");
         desc.append_child_value("broadcast_prefix", "BROADCAST:");
 
-        markerOutlet = std::make_unique<lsl::stream_outlet>(markerInfo);
+        sender.setMarkerOutlet(std::make_unique<lsl::stream_outlet>(markerInfo));
         LOGC("LSL Outlet: Created marker outlet '", streamName, "_Markers'");
     }
 }
 
 void LSLOutlet::destroyOutlets()
 {
-    if (totalSamplesPushed > 0)
+    sender.stopThread(1000);
+
+    if (sender.getSamplesSent() > 0)
     {
-        LOGC("LSL Outlet: Session ended. Total samples: ", totalSamplesPushed,
+        LOGC("LSL Outlet: Session ended. Total samples: ", sender.getSamplesSent(),
              ", Broadcasts forwarded: ", broadcastMessagesForwarded);
     }
-    dataOutlets.clear();
-    markerOutlet.reset();
+
+    if (sender.getDroppedSamples() > 0 || sender.getDroppedMarkers() > 0)
+    {
+        LOGC("LSL Outlet: Send queues overflowed. Dropped samples: ", sender.getDroppedSamples(),
+             ", Dropped markers: ", sender.getDroppedMarkers());
+    }
+
+    sender.clear();
 }
 
 bool LSLOutlet::startAcquisition()
 {
     createOutlets();
+    sender.startThread();
     streaming = true;
     LOGC("LSL Outlet: Started streaming");
     return true;
@@ -267,69 +341,36 @@ void LSLOutlet::process(AudioBuffer<float>& buffer)
     if (!streaming)
         return;
 
-    // Process each data stream
-    for (auto stream : getDataStreams())
-    {
-        uint16 streamId = stream->getStreamId();
-        
-        // Check if we have an outlet for this stream
-        auto it = dataOutlets.find(streamId);
-        if (it == dataOutlets.end() || !it->second)
-            continue;
+    double timestamp = lsl::local_clock();
 
-        int numChannels = stream->getChannelCount();
-        int numSamples = getNumSamplesInBlock(streamId);
+    // Queue each data stream for the sender thread
+    for (auto queue : sender.getDataQueues())
+    {
+        int numSamples = getNumSamplesInBlock(queue->streamId);
 
-        if (numSamples == 0 || numChannels == 0)
+        if (numSamples == 0 || queue->numChannels == 0)
             continue;
 
-        // Resize buffer if needed
-        size_t requiredSize = (size_t)(numChannels * numSamples);
-        if (sampleBuffer.size() < requiredSize)
-        {
-            sampleBuffer.resize(requiredSize);
-        }
-
-        // Copy samples in channel-major order (LSL expects interleaved data)
-        // Apply scale factor like the Inlet does
-        for (int sample = 0; sample < numSamples; sample++)
-        {
-            for (int ch = 0; ch < numChannels; ch++)
-            {
-                int globalIndex = stream->getContinuousChannels()[ch]->getGlobalIndex();
-                sampleBuffer[sample * numChannels + ch] = 
-                    buffer.getSample(globalIndex, sample) * dataScale;
-            }
-        }
-
-        // Push the chunk to LSL
-        it->second->push_chunk_multiplexed(sampleBuffer.data(), 
-                                           (unsigned long)(numSamples * numChannels));
-        totalSamplesPushed += numSamples;
+        sender.queueBlock(*queue, buffer, numSamples, dataScale, timestamp);
     }
 }
 
 void LSLOutlet::handleTTLEvent(TTLEventPtr event)
 {
-    if (!streaming || !markerOutlet || !includeMarkers)
+    if (!streaming || !sender.hasMarkerOutlet() || !includeMarkers)
         return;
 
-    // Create marker string with TTL info
-    String marker = "TTL_Line" + String(event->getLine()) + 
-                    "_State" + String(event->getState() ? "1" : "0");
-    
-    std::string markerStr = marker.toStdString();
-    markerOutlet->push_sample(&markerStr);
+    // The sender formats the marker string off the processing thread
+    sender.queueTTL(event->getLine(), event->getState(), lsl::local_clock());
 }
 
 void LSLOutlet::handleBroadcastMessage(const String& message, int64 messageTime)
 {
-    if (!streaming || !markerOutlet || !forwardBroadcasts)
+    if (!streaming || !sender.hasMarkerOutlet() || !forwardBroadcasts)
         return;
 
     // Forward broadcast message as marker with prefix
     String marker = "BROADCAST:" + message;
-    std::string markerStr = marker.toStdString();
-    markerOutlet->push_sample(&markerStr);
+    sender.sendMarker(marker.toStdString());
     broadcastMessagesForwarded++;
 }
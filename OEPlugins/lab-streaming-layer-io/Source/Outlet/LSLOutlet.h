@@ -27,9 +27,13 @@
 #include <ProcessorHeaders.h>
 #include <lsl_cpp.h>
 
-#include <memory>
-#include <vector>
-#include <map>
+#include "LSLOutletSender.h"
+
+/** Seconds of samples each stream's send queue can hold before blocks are dropped */
+const double SEND_QUEUE_SECONDS = 2.0;
+
+/** Default duration of the chunks LSL transmits (ms) */
+const int DEFAULT_CHUNK_MILLISECONDS = 50;
 
 /**
  * LSL Outlet Plugin
@@ -42,10 +46,15 @@
  * - Streams TTL events as string markers
  * - Configurable stream name and type
  * - Adjustable data scale factor (like LSL Inlet)
+ * - float32, int32 or int16 samples, with the conversion in the stream info
+ * - Configurable chunk duration
  * - Channel metadata (labels, units) included in LSL stream info
  * - Responds to broadcast messages (forwards as markers)
  * - Statistics tracking (samples pushed, consumers connected)
  * - Parameter persistence for all settings
+ *
+ * process() only copies each block into a lock-free queue; LSLOutletSender
+ * pushes the queued samples to LSL on its own thread.
  */
 class LSLOutlet : public GenericProcessor
 {
@@ -107,6 +116,18 @@ public:
     /** Set whether to include markers */
     void setIncludeMarkers(bool include);
 
+    /** Get the sample format declared to LSL */
+    OutletFormat getSampleFormat() const { return sampleFormat; }
+
+    /** Set the sample format declared to LSL */
+    void setSampleFormat(OutletFormat format);
+
+    /** Get the duration of the chunks LSL transmits (ms) */
+    int getChunkMilliseconds() const { return chunkMilliseconds; }
+
+    /** Set the duration of the chunks LSL transmits (ms) */
+    void setChunkMilliseconds(int milliseconds);
+
     /** Check if outlet is currently streaming */
     bool isStreaming() const { return streaming; }
 
@@ -114,7 +135,16 @@ public:
     int getNumConsumers() const;
 
     /** Get total samples pushed since acquisition start */
-    int64 getTotalSamplesPushed() const { return totalSamplesPushed; }
+    int64 getTotalSamplesPushed() const { return sender.getSamplesSent(); }
+
+    /** Largest fraction of any stream's send queue currently filled */
+    float getQueueFill() const { return sender.getQueueFill(); }
+
+    /** Samples dropped because a send queue was full */
+    int64 getDroppedSamples() const { return sender.getDroppedSamples(); }
+
+    /** TTL markers dropped because the marker queue was full */
+    int64 getDroppedMarkers() const { return sender.getDroppedMarkers(); }
 
 private:
     /** Create LSL outlet streams for all data streams */
@@ -135,17 +165,17 @@ private:
     /** Whether to include TTL markers */
     bool includeMarkers;
 
-    /** Whether to forward broadcast messages as markers */
-    bool forwardBroadcasts;
+    /** Sample format declared to LSL */
+    OutletFormat sampleFormat;
 
-    /** Map of data stream ID to LSL outlet */
-    std::map<uint16, std::unique_ptr<lsl::stream_outlet>> dataOutlets;
+    /** Duration of the chunks LSL transmits (ms) */
+    int chunkMilliseconds;
 
-    /** LSL outlet for TTL events/markers */
-    std::unique_ptr<lsl::stream_outlet> markerOutlet;
+    /** Whether to forward broadcast messages as markers */
+    bool forwardBroadcasts;
 
-    /** Buffer for interleaved samples */
-    std::vector<float> sampleBuffer;
+    /** Owns the LSL outlets and pushes queued samples and markers to them */
+    LSLOutletSender sender;
 
     /** Whether we are currently streaming */
     bool streaming;
@@ -153,9 +183,6 @@ private:
     /** Source ID for LSL streams */
     String sourceId;
 
-    /** Total samples pushed (for stats) */
-    int64 totalSamplesPushed;
-
     /** Track broadcast messages received */
     int broadcastMessagesForwarded;
 
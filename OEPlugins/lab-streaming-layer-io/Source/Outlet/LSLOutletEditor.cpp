@@ -98,6 +98,40 @@ LSLOutletEditor::LSLOutletEditor(LSLOutlet* parentNode)
 
     yPos += 25;
 
+    // Sample Format
+    formatLabel = std::make_unique<Label>("FormatLabel", "Format:");
+    formatLabel->setBounds(10, yPos, 50, 20);
+    formatLabel->setFont(Font("Default", 12, Font::plain));
+    formatLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(formatLabel.get());
+
+    formatSelector = std::make_unique<ComboBox>("FormatSelector");
+    formatSelector->setBounds(60, yPos, 70, 20);
+    formatSelector->addItem("float32", (int)OutletFormat::FLOAT32 + 1);
+    formatSelector->addItem("int32", (int)OutletFormat::INT32 + 1);
+    formatSelector->addItem("int16", (int)OutletFormat::INT16 + 1);
+    formatSelector->setSelectedId((int)processor->getSampleFormat() + 1, dontSendNotification);
+    formatSelector->addListener(this);
+    addAndMakeVisible(formatSelector.get());
+
+    // Chunk Duration
+    chunkLabel = std::make_unique<Label>("ChunkLabel", "Chunk ms:");
+    chunkLabel->setBounds(135, yPos, 65, 20);
+    chunkLabel->setFont(Font("Default", 12, Font::plain));
+    chunkLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(chunkLabel.get());
+
+    chunkEditor = std::make_unique<Label>("ChunkEditor", String(processor->getChunkMilliseconds()));
+    chunkEditor->setBounds(200, yPos, 40, 20);
+    chunkEditor->setFont(Font("Default", 12, Font::plain));
+    chunkEditor->setColour(Label::textColourId, Colours::white);
+    chunkEditor->setColour(Label::backgroundColourId, Colours::darkgrey);
+    chunkEditor->setEditable(true);
+    chunkEditor->addListener(this);
+    addAndMakeVisible(chunkEditor.get());
+
+    yPos += 25;
+
     // Status Label
     statusLabel = std::make_unique<Label>("StatusLabel", "Ready");
     statusLabel->setBounds(10, yPos, 230, 20);
@@ -110,6 +144,7 @@ LSLOutletEditor::LSLOutletEditor(LSLOutlet* parentNode)
 
 LSLOutletEditor::~LSLOutletEditor()
 {
+    stopTimer();
 }
 
 void LSLOutletEditor::labelTextChanged(Label* label)
@@ -134,6 +169,18 @@ void LSLOutletEditor::labelTextChanged(Label* label)
             label->setText(String(processor->getDataScale(), 1), dontSendNotification);
         }
     }
+    else if (label == chunkEditor.get())
+    {
+        int milliseconds = label->getText().getIntValue();
+        if (milliseconds >= 1 && milliseconds <= 1000)
+        {
+            processor->setChunkMilliseconds(milliseconds);
+        }
+        else
+        {
+            label->setText(String(processor->getChunkMilliseconds()), dontSendNotification);
+        }
+    }
 }
 
 void LSLOutletEditor::buttonClicked(Button* button)
@@ -150,30 +197,48 @@ void LSLOutletEditor::buttonClicked(Button* button)
     }
 }
 
+void LSLOutletEditor::comboBoxChanged(ComboBox* comboBox)
+{
+    if (comboBox == formatSelector.get())
+    {
+        processor->setSampleFormat((OutletFormat)(formatSelector->getSelectedId() - 1));
+    }
+}
+
 void LSLOutletEditor::setControlsEnabled(bool enabled)
 {
     streamNameEditor->setEditable(enabled);
     streamTypeEditor->setEditable(enabled);
+    chunkEditor->setEditable(enabled);
+    formatSelector->setEnabled(enabled);
     markersButton->setEnabled(enabled);
     broadcastButton->setEnabled(enabled);
     
     Colour bgColour = enabled ? Colours::darkgrey : Colours::grey;
     streamNameEditor->setColour(Label::backgroundColourId, bgColour);
     streamTypeEditor->setColour(Label::backgroundColourId, bgColour);
+    chunkEditor->setColour(Label::backgroundColourId, bgColour);
 }
 
 void LSLOutletEditor::startAcquisition()
 {
     setControlsEnabled(false);
     updateStatus();
+    startTimer(500);
 }
 
 void LSLOutletEditor::stopAcquisition()
 {
+    stopTimer();
     setControlsEnabled(true);
     updateStatus();
 }
 
+void LSLOutletEditor::timerCallback()
+{
+    updateStatus();
+}
+
 void LSLOutletEditor::updateStatus()
 {
     if (processor->isStreaming())
@@ -182,8 +247,14 @@ void LSLOutletEditor::updateStatus()
         String status = "Streaming";
         if (consumers > 0)
             status += " (" + String(consumers) + " consumer" + (consumers > 1 ? "s" : "") + ")";
+        status += ", queue " + String(roundToInt(processor->getQueueFill() * 100.0f)) + "%";
+
+        int64 dropped = processor->getDroppedSamples();
+        if (dropped > 0)
+            status += ", " + String(dropped) + " dropped";
+
         statusLabel->setText(status, dontSendNotification);
-        statusLabel->setColour(Label::textColourId, Colours::green);
+        statusLabel->setColour(Label::textColourId, dropped > 0 ? Colours::orange : Colours::green);
     }
     else
     {
@@ -36,10 +36,15 @@ class LSLOutlet;
  * - Data scale factor
  * - TTL marker streaming
  * - Broadcast message forwarding
+ * - Sample format and chunk duration
+ *
+ * While streaming, the status line shows send queue usage and drops.
  */
 class LSLOutletEditor : public GenericEditor,
                         public Label::Listener,
-                        public Button::Listener
+                        public Button::Listener,
+                        public ComboBox::Listener,
+                        public Timer
 {
 public:
     /** Constructor */
@@ -54,10 +59,16 @@ public:
     /** Called when a button is clicked */
     void buttonClicked(Button* button) override;
 
+    /** Called when the sample format changes */
+    void comboBoxChanged(ComboBox* comboBox) override;
+
     /** Update the display when acquisition state changes */
     void startAcquisition() override;
     void stopAcquisition() override;
 
+    /** Refreshes the status line while streaming */
+    void timerCallback() override;
+
 private:
     /** Pointer to the processor */
     LSLOutlet* processor;
@@ -80,6 +91,14 @@ private:
     /** Forward broadcasts checkbox */
     std::unique_ptr<ToggleButton> broadcastButton;
 
+    /** Sample format selector */
+    std::unique_ptr<Label> formatLabel;
+    std::unique_ptr<ComboBox> formatSelector;
+
+    /** Chunk duration label and editor */
+    std::unique_ptr<Label> chunkLabel;
+    std::unique_ptr<Label> chunkEditor;
+
     /** Status indicator */
     std::unique_ptr<Label> statusLabel;
 
@@ -0,0 +1,281 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include "LSLOutletSender.h"
+#include "../SampleConvert.h"
+#include "../SampleTranspose.h"
+
+namespace
+{
+/** TTL events the marker ring can hold */
+constexpr int TTL_QUEUE_SIZE = 1024;
+
+/** Longest the sender sleeps when nothing notifies it (ms) */
+constexpr int DRAIN_INTERVAL_MS = 100;
+}
+
+LSLOutletSender::DataQueue::DataQueue(std::unique_ptr<lsl::stream_outlet> outlet_,
+                                      uint16 streamId_,
+                                      const std::vector<int>& channelIndices_,
+                                      double sampleRate_,
+                                      int capacity,
+                                      OutletFormat format_,
+                                      float integerGain_,
+                                      int chunkSize_)
+    : outlet(std::move(outlet_)),
+      streamId(streamId_),
+      channelIndices(channelIndices_),
+      channelPointers(channelIndices_.size()),
+      numChannels((int)channelIndices_.size()),
+      sampleRate(sampleRate_),
+      format(format_),
+      integerGain(integerGain_),
+      chunkSize(jmax(1, chunkSize_)),
+      fifo(capacity),
+      samples((size_t)capacity * channelIndices_.size()),
+      timestamps((size_t)capacity)
+{
+    if (format == OutletFormat::INT16)
+        int16Samples.resize((size_t)chunkSize * numChannels);
+    else if (format == OutletFormat::INT32)
+        int32Samples.resize((size_t)chunkSize * numChannels);
+}
+
+LSLOutletSender::LSLOutletSender()
+    : Thread("LSL Outlet Sender"),
+      ttlFifo(TTL_QUEUE_SIZE),
+      ttlMarkers(TTL_QUEUE_SIZE)
+{
+}
+
+LSLOutletSender::~LSLOutletSender()
+{
+    stopThread(1000);
+}
+
+LSLOutletSender::DataQueue* LSLOutletSender::addDataOutlet(std::unique_ptr<lsl::stream_outlet> outlet,
+                                                           uint16 streamId,
+                                                           const std::vector<int>& channelIndices,
+                                                           double sampleRate,
+                                                           double queueSeconds,
+                                                           OutletFormat format,
+                                                           float integerGain,
+                                                           int chunkSize)
+{
+    // AbstractFifo keeps one slot free, so ask for one more than the ring should hold
+    int capacity = jmax(4096, (int)(sampleRate * queueSeconds)) + 1;
+
+    return dataQueues.add(new DataQueue(std::move(outlet), streamId, channelIndices, sampleRate, capacity,
+                                        format, integerGain, chunkSize));
+}
+
+void LSLOutletSender::setMarkerOutlet(std::unique_ptr<lsl::stream_outlet> outlet)
+{
+    markerOutlet = std::move(outlet);
+}
+
+void LSLOutletSender::clear()
+{
+    jassert(!isThreadRunning());
+
+    dataQueues.clear();
+    markerOutlet.reset();
+    ttlFifo.reset();
+    droppedMarkers = 0;
+}
+
+bool LSLOutletSender::queueBlock(DataQueue& queue, const AudioBuffer<float>& buffer, int numSamples, float scale, double timestamp)
+{
+    int start1, size1, start2, size2;
+    queue.fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    if (size1 + size2 < numSamples)
+    {
+        // Dropping the whole block keeps every chunk LSL receives contiguous
+        queue.droppedSamples += numSamples;
+        notify();
+        return false;
+    }
+
+    const int numChannels = queue.numChannels;
+
+    for (int ch = 0; ch < numChannels; ch++)
+        queue.channelPointers[ch] = buffer.getReadPointer(queue.channelIndices[ch]);
+
+    SampleTranspose::interleave(queue.channelPointers.data(), numChannels, size1,
+                                queue.samples.data() + (size_t)start1 * numChannels, scale);
+
+    if (size2 > 0)
+    {
+        for (int ch = 0; ch < numChannels; ch++)
+            queue.channelPointers[ch] += size1;
+
+        SampleTranspose::interleave(queue.channelPointers.data(), numChannels, size2,
+                                    queue.samples.data() + (size_t)start2 * numChannels, scale);
+    }
+
+    // The newest sample is stamped with the time the block was queued
+    const double samplePeriod = 1.0 / queue.sampleRate;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        int slot = i < size1 ? start1 + i : start2 + i - size1;
+        queue.timestamps[slot] = timestamp - (numSamples - 1 - i) * samplePeriod;
+    }
+
+    queue.fifo.finishedWrite(numSamples);
+    notify();
+
+    return true;
+}
+
+bool LSLOutletSender::queueTTL(int line, bool state, double timestamp)
+{
+    int start1, size1, start2, size2;
+    ttlFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        droppedMarkers++;
+        return false;
+    }
+
+    ttlMarkers[start1] = { line, state, timestamp };
+    ttlFifo.finishedWrite(1);
+    notify();
+
+    return true;
+}
+
+void LSLOutletSender::sendMarker(const std::string& marker)
+{
+    // liblsl outlets may be pushed to from several threads
+    if (markerOutlet)
+        markerOutlet->push_sample(&marker);
+}
+
+float LSLOutletSender::getQueueFill() const
+{
+    float fill = 0.0f;
+
+    for (auto queue : dataQueues)
+        fill = jmax(fill, (float)queue->fifo.getNumReady() / (float)(queue->fifo.getTotalSize() - 1));
+
+    return fill;
+}
+
+int64 LSLOutletSender::getSamplesSent() const
+{
+    int64 total = 0;
+
+    for (auto queue : dataQueues)
+        total += queue->samplesSent.load();
+
+    return total;
+}
+
+int64 LSLOutletSender::getDroppedSamples() const
+{
+    int64 total = 0;
+
+    for (auto queue : dataQueues)
+        total += queue->droppedSamples.load();
+
+    return total;
+}
+
+void LSLOutletSender::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(DRAIN_INTERVAL_MS);
+        drain();
+    }
+
+    // Send what was queued before acquisition stopped
+    drain();
+}
+
+void LSLOutletSender::drain()
+{
+    for (auto queue : dataQueues)
+    {
+        int start1, size1, start2, size2;
+        queue->fifo.prepareToRead(queue->fifo.getNumReady(), start1, size1, start2, size2);
+
+        send(*queue, start1, size1);
+        send(*queue, start2, size2);
+
+        queue->fifo.finishedRead(size1 + size2);
+        queue->samplesSent += size1 + size2;
+    }
+
+    int start1, size1, start2, size2;
+    ttlFifo.prepareToRead(ttlFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2; i++)
+    {
+        const TTLMarker& ttl = ttlMarkers[i < size1 ? start1 + i : start2 + i - size1];
+
+        std::string marker = "TTL_Line" + std::to_string(ttl.line)
+                             + "_State" + (ttl.state ? "1" : "0");
+
+        if (markerOutlet)
+            markerOutlet->push_sample(&marker, ttl.timestamp);
+    }
+
+    ttlFifo.finishedRead(size1 + size2);
+}
+
+void LSLOutletSender::send(DataQueue& queue, int start, int size)
+{
+    const int numChannels = queue.numChannels;
+
+    if (queue.format == OutletFormat::FLOAT32)
+    {
+        if (size > 0)
+            queue.outlet->push_chunk_multiplexed(queue.samples.data() + (size_t)start * numChannels,
+                                                 queue.timestamps.data() + start,
+                                                 (size_t)size * numChannels);
+        return;
+    }
+
+    for (int offset = 0; offset < size; offset += queue.chunkSize)
+    {
+        const int count = jmin(queue.chunkSize, size - offset);
+        const float* src = queue.samples.data() + (size_t)(start + offset) * numChannels;
+        const double* timestamps = queue.timestamps.data() + start + offset;
+        const size_t elements = (size_t)count * numChannels;
+
+        if (queue.format == OutletFormat::INT16)
+        {
+            SampleConvert::floatToInt16(src, queue.int16Samples.data(), elements, queue.integerGain);
+            queue.outlet->push_chunk_multiplexed(queue.int16Samples.data(), timestamps, elements);
+        }
+        else
+        {
+            SampleConvert::floatToInt32(src, queue.int32Samples.data(), elements, queue.integerGain);
+            queue.outlet->push_chunk_multiplexed(queue.int32Samples.data(), timestamps, elements);
+        }
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef LSLOUTLETSENDER_H_DEFINED
+#define LSLOUTLETSENDER_H_DEFINED
+
+#include <ProcessorHeaders.h>
+#include <lsl_cpp.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Sample type an outlet declares to LSL */
+enum class OutletFormat
+{
+    FLOAT32,
+    INT32,
+    INT16
+};
+
+/**
+ * Background sender for the LSL Outlet
+ *
+ * The processing thread copies each block into a pre-sized single-producer,
+ * single-consumer ring per data stream, and TTL events into a ring of their
+ * own. This thread drains the rings into LSL, so a stall inside liblsl
+ * (slow consumers, full socket buffers) fills the ring instead of holding
+ * up the signal chain. When a ring is full, the whole block is dropped and
+ * counted.
+ *
+ * Samples carry the local LSL clock time at which their block was queued,
+ * so the delay through the ring does not shift their timestamps.
+ *
+ * Rings hold scaled floats. Integer outlets are converted here, one chunk
+ * at a time, so the processing thread only pays for the interleave.
+ */
+class LSLOutletSender : public Thread
+{
+public:
+    /** One data stream's outlet and the ring feeding it */
+    struct DataQueue
+    {
+        DataQueue(std::unique_ptr<lsl::stream_outlet> outlet,
+                  uint16 streamId,
+                  const std::vector<int>& channelIndices,
+                  double sampleRate,
+                  int capacity,
+                  OutletFormat format,
+                  float integerGain,
+                  int chunkSize);
+
+        std::unique_ptr<lsl::stream_outlet> outlet;
+
+        /** Open Ephys stream this queue carries */
+        uint16 streamId;
+
+        /** Global buffer index of each channel, cached when acquisition starts */
+        std::vector<int> channelIndices;
+
+        /** Read pointers to the channels of the block being queued */
+        std::vector<const float*> channelPointers;
+
+        int numChannels;
+        double sampleRate;
+
+        OutletFormat format;
+
+        /** Integer counts per scaled unit, applied when converting to an integer format */
+        float integerGain;
+
+        /** Largest number of samples converted and pushed at once */
+        int chunkSize;
+
+        /** Indices into the rings, in samples */
+        AbstractFifo fifo;
+
+        /** Interleaved samples, numChannels per sample */
+        std::vector<float> samples;
+
+        /** Local LSL clock time of each sample */
+        std::vector<double> timestamps;
+
+        /** Converted samples of one chunk, for the integer formats */
+        std::vector<int16_t> int16Samples;
+        std::vector<int32_t> int32Samples;
+
+        std::atomic<int64> samplesSent { 0 };
+        std::atomic<int64> droppedSamples { 0 };
+    };
+
+    /** Constructor */
+    LSLOutletSender();
+
+    /** Destructor */
+    ~LSLOutletSender();
+
+    /**
+     * Adds a data outlet with a ring holding queueSeconds of samples; call
+     * while the thread is stopped. The outlet must have been declared with
+     * the channel format matching format.
+     */
+    DataQueue* addDataOutlet(std::unique_ptr<lsl::stream_outlet> outlet,
+                             uint16 streamId,
+                             const std::vector<int>& channelIndices,
+                             double sampleRate,
+                             double queueSeconds,
+                             OutletFormat format,
+                             float integerGain,
+                             int chunkSize);
+
+    /** Sets the outlet TTL events and broadcast messages are sent to; call while the thread is stopped */
+    void setMarkerOutlet(std::unique_ptr<lsl::stream_outlet> outlet);
+
+    /** Destroys all outlets and rings; call while the thread is stopped */
+    void clear();
+
+    /** Data queues, in the order they were added */
+    const OwnedArray<DataQueue>& getDataQueues() const { return dataQueues; }
+
+    /**
+     * Scales, interleaves and queues the first numSamples of each of the
+     * queue's channels. Called on the processing thread; never blocks.
+     * Returns false if the ring was full and the block was dropped.
+     */
+    bool queueBlock(DataQueue& queue, const AudioBuffer<float>& buffer, int numSamples, float scale, double timestamp);
+
+    /** Queues a TTL event marker. Called on the processing thread; never blocks. */
+    bool queueTTL(int line, bool state, double timestamp);
+
+    /** Sends a marker straight to the marker outlet, for callers off the processing thread */
+    void sendMarker(const std::string& marker);
+
+    /** Whether a marker outlet was set */
+    bool hasMarkerOutlet() const { return markerOutlet != nullptr; }
+
+    /** Largest fraction of any data ring currently filled */
+    float getQueueFill() const;
+
+    /** Samples sent to LSL across data queues */
+    int64 getSamplesSent() const;
+
+    /** Samples dropped from full rings across data queues */
+    int64 getDroppedSamples() const;
+
+    /** TTL markers dropped from a full ring */
+    int64 getDroppedMarkers() const { return droppedMarkers.load(); }
+
+    /** Drains the rings until the thread is stopped, then sends whatever is left */
+    void run() override;
+
+private:
+    /** A TTL event waiting to be sent as a marker */
+    struct TTLMarker
+    {
+        int line;
+        bool state;
+        double timestamp;
+    };
+
+    /** Sends everything currently queued */
+    void drain();
+
+    /** Sends size samples of a queue's ring from start, converting them to the outlet's format */
+    void send(DataQueue& queue, int start, int size);
+
+    OwnedArray<DataQueue> dataQueues;
+
+    std::unique_ptr<lsl::stream_outlet> markerOutlet;
+
+    AbstractFifo ttlFifo;
+    std::vector<TTLMarker> ttlMarkers;
+    std::atomic<int64> droppedMarkers { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LSLOutletSender);
+};
+
+#endif // LSLOUTLETSENDER_H_DEFINED
@@ -0,0 +1,122 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef SAMPLECONVERT_H_DEFINED
+#define SAMPLECONVERT_H_DEFINED
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAMPLE_CONVERT_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SAMPLE_CONVERT_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * Float to integer sample kernels for the LSL Outlet's integer formats.
+ *
+ * Each value is multiplied by gain, rounded to nearest and saturated to
+ * the destination range, so a clipped sample pins at the rail instead of
+ * wrapping around. The float is clamped before conversion because the
+ * hardware conversion returns INT32_MIN for every out-of-range input.
+ *
+ * Kept free of JUCE so it can be benchmarked in isolation.
+ */
+namespace SampleConvert
+{
+
+/** Float range that converts to a valid int32; 2^31 itself is out of range */
+constexpr float INT32_MIN_FLOAT = -2147483648.0f;
+constexpr float INT32_MAX_FLOAT = 2147483520.0f;
+
+/** Scalar reference for one value */
+template <typename IntType>
+inline IntType saturate (float value, float lo, float hi) noexcept
+{
+    return (IntType) std::lrint (std::min (std::max (value, lo), hi));
+}
+
+/** dest[i] = saturate_int16 (round (src[i] * gain)) */
+inline void floatToInt16 (const float* src, int16_t* dest, size_t count, float gain) noexcept
+{
+    size_t i = 0;
+
+#if SAMPLE_CONVERT_USE_SSE2
+    const __m128 g = _mm_set1_ps (gain);
+    const __m128 lo = _mm_set1_ps (-32768.0f);
+    const __m128 hi = _mm_set1_ps (32767.0f);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128 a = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (src + i), g), lo), hi);
+        const __m128 b = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (src + i + 4), g), lo), hi);
+
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + i), _mm_packs_epi32 (_mm_cvtps_epi32 (a), _mm_cvtps_epi32 (b)));
+    }
+#elif SAMPLE_CONVERT_USE_NEON
+    // vcvtnq rounds to nearest and saturates, vqmovn narrows with saturation
+    for (; i + 8 <= count; i += 8)
+    {
+        const int32x4_t a = vcvtnq_s32_f32 (vmulq_n_f32 (vld1q_f32 (src + i), gain));
+        const int32x4_t b = vcvtnq_s32_f32 (vmulq_n_f32 (vld1q_f32 (src + i + 4), gain));
+
+        vst1q_s16 (dest + i, vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b)));
+    }
+#endif
+
+    for (; i < count; i++)
+        dest[i] = saturate<int16_t> (src[i] * gain, -32768.0f, 32767.0f);
+}
+
+/** dest[i] = saturate_int32 (round (src[i] * gain)) */
+inline void floatToInt32 (const float* src, int32_t* dest, size_t count, float gain) noexcept
+{
+    size_t i = 0;
+
+#if SAMPLE_CONVERT_USE_SSE2
+    const __m128 g = _mm_set1_ps (gain);
+    const __m128 lo = _mm_set1_ps (INT32_MIN_FLOAT);
+    const __m128 hi = _mm_set1_ps (INT32_MAX_FLOAT);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 a = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (src + i), g), lo), hi);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + i), _mm_cvtps_epi32 (a));
+    }
+#elif SAMPLE_CONVERT_USE_NEON
+    for (; i + 4 <= count; i += 4)
+        vst1q_s32 (dest + i, vcvtnq_s32_f32 (vmulq_n_f32 (vld1q_f32 (src + i), gain)));
+#endif
+
+    for (; i < count; i++)
+        dest[i] = saturate<int32_t> (src[i] * gain, INT32_MIN_FLOAT, INT32_MAX_FLOAT);
+}
+
+} // namespace SampleConvert
+
+#endif // SAMPLECONVERT_H_DEFINED
@@ -0,0 +1,184 @@
+/*
+ ------------------------------------------------------------------
+
+ This file is part of the Open Ephys GUI
+ Copyright (C) 2022 Open Ephys
+
+ ------------------------------------------------------------------
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef SAMPLETRANSPOSE_H_DEFINED
+#define SAMPLETRANSPOSE_H_DEFINED
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SAMPLE_TRANSPOSE_USE_SSE 1
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SAMPLE_TRANSPOSE_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * Scale-and-transpose kernels between LSL's interleaved (sample-major)
+ * chunks and Open Ephys' per-channel buffers.
+ *
+ * Both directions work on 4 x 4 tiles held in SIMD registers, and walk the
+ * interleaved side in bands of getBandSamples() samples so that each band
+ * stays in L1 while every channel group is read from or written to it. The
+ * per-channel side is then accessed in runs of contiguous floats per
+ * channel instead of one float per cache line.
+ *
+ * Kept free of JUCE so it can be benchmarked in isolation.
+ */
+namespace SampleTranspose
+{
+
+/** Bytes of interleaved data per cache band, sized to stay in L1 */
+constexpr int BAND_BYTES = 16384;
+
+/** Samples per cache band for a channel count: a multiple of 4 between 8 and 256 */
+inline int getBandSamples (int numChannels) noexcept
+{
+    return std::clamp (BAND_BYTES / (int) sizeof (float) / std::max (1, numChannels), 8, 256) & ~3;
+}
+
+/** Loads rows r0..r3 (4 floats each), transposes, scales and stores the columns to c0..c3 */
+inline void transpose4x4 (const float* r0, const float* r1, const float* r2, const float* r3, float* c0, float* c1, float* c2, float* c3, float scale) noexcept
+{
+#if SAMPLE_TRANSPOSE_USE_SSE
+    const __m128 s = _mm_set1_ps (scale);
+
+    __m128 a = _mm_loadu_ps (r0);
+    __m128 b = _mm_loadu_ps (r1);
+    __m128 c = _mm_loadu_ps (r2);
+    __m128 d = _mm_loadu_ps (r3);
+
+    _MM_TRANSPOSE4_PS (a, b, c, d);
+
+    _mm_storeu_ps (c0, _mm_mul_ps (a, s));
+    _mm_storeu_ps (c1, _mm_mul_ps (b, s));
+    _mm_storeu_ps (c2, _mm_mul_ps (c, s));
+    _mm_storeu_ps (c3, _mm_mul_ps (d, s));
+#elif SAMPLE_TRANSPOSE_USE_NEON
+    const float32x4x2_t ab = vtrnq_f32 (vld1q_f32 (r0), vld1q_f32 (r1));
+    const float32x4x2_t cd = vtrnq_f32 (vld1q_f32 (r2), vld1q_f32 (r3));
+
+    vst1q_f32 (c0, vmulq_n_f32 (vcombine_f32 (vget_low_f32 (ab.val[0]), vget_low_f32 (cd.val[0])), scale));
+    vst1q_f32 (c1, vmulq_n_f32 (vcombine_f32 (vget_low_f32 (ab.val[1]), vget_low_f32 (cd.val[1])), scale));
+    vst1q_f32 (c2, vmulq_n_f32 (vcombine_f32 (vget_high_f32 (ab.val[0]), vget_high_f32 (cd.val[0])), scale));
+    vst1q_f32 (c3, vmulq_n_f32 (vcombine_f32 (vget_high_f32 (ab.val[1]), vget_high_f32 (cd.val[1])), scale));
+#else
+    const float* rows[4] = { r0, r1, r2, r3 };
+    float* cols[4] = { c0, c1, c2, c3 };
+    float tile[4][4];
+
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 4; j++)
+            tile[j][i] = rows[i][j] * scale;
+
+    for (int j = 0; j < 4; j++)
+        std::copy (tile[j], tile[j] + 4, cols[j]);
+#endif
+}
+
+/**
+ * Interleaved src[sample * numChannels + channel] to per-channel
+ * dest[channel][sample], multiplying by scale.
+ */
+inline void deinterleave (const float* src, int numChannels, int numSamples, float* const* dest, float scale) noexcept
+{
+    const int bandSamples = getBandSamples (numChannels);
+
+    for (int s0 = 0; s0 < numSamples; s0 += bandSamples)
+    {
+        const int s1 = std::min (numSamples, s0 + bandSamples);
+        const float* band = src + (size_t) s0 * numChannels;
+        int ch = 0;
+
+        for (; ch + 4 <= numChannels; ch += 4)
+        {
+            float* d0 = dest[ch];
+            float* d1 = dest[ch + 1];
+            float* d2 = dest[ch + 2];
+            float* d3 = dest[ch + 3];
+            const float* p = band + ch;
+            int s = s0;
+
+            for (; s + 4 <= s1; s += 4, p += 4 * numChannels)
+                transpose4x4 (p, p + numChannels, p + 2 * numChannels, p + 3 * numChannels, d0 + s, d1 + s, d2 + s, d3 + s, scale);
+
+            for (; s < s1; s++, p += numChannels)
+            {
+                d0[s] = p[0] * scale;
+                d1[s] = p[1] * scale;
+                d2[s] = p[2] * scale;
+                d3[s] = p[3] * scale;
+            }
+        }
+
+        for (; ch < numChannels; ch++)
+            for (int s = s0; s < s1; s++)
+                dest[ch][s] = src[(size_t) s * numChannels + ch] * scale;
+    }
+}
+
+/**
+ * Per-channel src[channel][sample] to interleaved
+ * dest[sample * numChannels + channel], multiplying by scale.
+ */
+inline void interleave (const float* const* src, int numChannels, int numSamples, float* dest, float scale) noexcept
+{
+    const int bandSamples = getBandSamples (numChannels);
+
+    for (int s0 = 0; s0 < numSamples; s0 += bandSamples)
+    {
+        const int s1 = std::min (numSamples, s0 + bandSamples);
+        float* band = dest + (size_t) s0 * numChannels;
+        int ch = 0;
+
+        for (; ch + 4 <= numChannels; ch += 4)
+        {
+            const float* c0 = src[ch];
+            const float* c1 = src[ch + 1];
+            const float* c2 = src[ch + 2];
+            const float* c3 = src[ch + 3];
+            float* p = band + ch;
+            int s = s0;
+
+            for (; s + 4 <= s1; s += 4, p += 4 * numChannels)
+                transpose4x4 (c0 + s, c1 + s, c2 + s, c3 + s, p, p + numChannels, p + 2 * numChannels, p + 3 * numChannels, scale);
+
+            for (; s < s1; s++, p += numChannels)
+            {
+                p[0] = c0[s] * scale;
+                p[1] = c1[s] * scale;
+                p[2] = c2[s] * scale;
+                p[3] = c3[s] * scale;
+            }
+        }
+
+        for (; ch < numChannels; ch++)
+            for (int s = s0; s < s1; s++)
+                dest[(size_t) s * numChannels + ch] = src[ch][s] * scale;
+    }
+}
+
+} // namespace SampleTranspose
+
+#endif // SAMPLETRANSPOSE_H_DEFINED
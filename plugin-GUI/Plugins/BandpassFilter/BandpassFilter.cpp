@@ -22,7 +22,6 @@
 */
 
 #include <stdio.h>
-#include <thread>
 
 #include "BandpassFilter.h"
 #include "BandpassFilterEditor.h"
@@ -31,28 +30,51 @@ void BandpassFilterSettings::createFilters (int numChannels, float sampleRate_,
 {
     sampleRate = sampleRate_;
 
-    filters.clear();
+    // Every channel runs the same order 2 bandpass (two biquad stages) in Direct Form II
+    filters.setup (numChannels, 2);
 
-    for (int n = 0; n < numChannels; ++n)
-    {
-        filters.add (new Dsp::SmoothedFilterDesign<Dsp::Butterworth::Design::BandPass // design type
-                                                   <2>, // order
-                                                   1, // number of channels (must be const)
-                                                   Dsp::DirectFormII> (1)); // realization
-    }
+    // Not acquiring, so the new filters can go straight into the bank
+    const SpinLock::ScopedLockType lock (pendingLock);
 
-    updateFilters (lowCut, highCut);
+    setFilterParameters (lowCut, highCut);
+    filters.setCoefficients (design);
+    hasPendingFilters = false;
 }
 
 void BandpassFilterSettings::updateFilters (double lowCut, double highCut)
 {
-    for (int n = 0; n < filters.size(); n++)
+    // process() may be filtering with the bank, so only the pending set is written here
+    const SpinLock::ScopedLockType lock (pendingLock);
+
+    setFilterParameters (lowCut, highCut);
+
+    for (int stage = 0; stage < 2; stage++)
+        pendingStages[stage] = design[stage];
+
+    hasPendingFilters = true;
+}
+
+void BandpassFilterSettings::applyPendingFilters (int numSamples)
+{
+    const SpinLock::ScopedTryLockType lock (pendingLock);
+
+    if (! lock.isLocked() || ! hasPendingFilters || numSamples <= 0)
+        return;
+
+    for (int n = 0; n < filters.getNumChannels(); n++)
     {
-        setFilterParameters (lowCut, highCut, n);
+        for (int stage = 0; stage < 2; stage++)
+            filters.setTargetCoefficients (n, stage, pendingStages[stage]);
     }
+
+    // Moving the coefficients over the block avoids a click at the change. Very long
+    // blocks (e.g. from file playback) ramp over 20 ms only, so most of the block
+    // is not filtered by the designs in between.
+    filters.rampToTargets (jmin (numSamples, jmax (1, (int) (sampleRate / 50))));
+    hasPendingFilters = false;
 }
 
-void BandpassFilterSettings::setFilterParameters (double lowCut, double highCut, int channel)
+void BandpassFilterSettings::setFilterParameters (double lowCut, double highCut)
 {
     Dsp::Params params;
     params[0] = sampleRate; // sample rate
@@ -60,33 +82,13 @@ void BandpassFilterSettings::setFilterParameters (double lowCut, double highCut,
     params[2] = (highCut + lowCut) / 2; // center frequency
     params[3] = highCut - lowCut; // bandwidth
 
-    filters[channel]->setParams (params);
-}
-
-FilterJob::FilterJob (String name, Array<Dsp::Filter*> filters_, Array<float*> channelPointers_, int numSamples_)
-    : ThreadPoolJob (name),
-      filters (filters_),
-      channelPointers (channelPointers_),
-      numSamples (numSamples_),
-      numChannels (channelPointers_.size())
-{
-}
-
-ThreadPoolJob::JobStatus FilterJob::runJob()
-{
-    for (int i = 0; i < numChannels; i++)
-    {
-        float* ptr = channelPointers[i];
-        filters[i]->process (numSamples, &ptr);
-    }
-
-    return ThreadPoolJob::jobHasFinished;
+    design.setParams (params);
 }
 
 BandpassFilter::BandpassFilter (bool headless)
     : GenericProcessor ("Bandpass Filter", headless)
 {
-    threadPool = std::make_unique<ThreadPool> (4);
+    setNumWorkerThreads (4);
 }
 
 AudioProcessorEditor* BandpassFilter::createEditor()
@@ -168,13 +170,32 @@ void BandpassFilter::updateSettings()
 {
     settings.update (getDataStreams());
 
+    partitions.clear();
+    channelPointers.clear();
+
     for (auto stream : getDataStreams())
     {
-        settings[stream->getStreamId()]->createFilters (
+        BandpassFilterSettings* streamSettings = settings[stream->getStreamId()];
+
+        streamSettings->createFilters (
             stream->getChannelCount(),
             stream->getSampleRate(),
             (*stream)["low_cut"],
             (*stream)["high_cut"]);
+
+        for (int first = 0; first < stream->getChannelCount(); first += CHANNELS_PER_THREAD)
+        {
+            FilterPartition partition;
+            partition.filters = &streamSettings->filters;
+            partition.firstChannel = first;
+            partition.numChannels = jmin (CHANNELS_PER_THREAD, stream->getChannelCount() - first);
+            partition.pointerOffset = channelPointers.size() + first;
+            partition.numSamples = 0;
+
+            partitions.add (partition);
+        }
+
+        channelPointers.insertMultiple (-1, nullptr, stream->getChannelCount());
     }
 }
 
@@ -208,69 +229,47 @@ void BandpassFilter::parameterValueChanged (Parameter* param)
     }
     else if (param->getName().equalsIgnoreCase ("threads"))
     {
-        if (threadPool->getNumJobs() > 0)
-        {
-            param->restorePreviousValue();
-            return;
-        }
-
-        int numThreads = param->getValueAsString().getIntValue();
-        threadPool.reset (new ThreadPool (numThreads));
+        setNumWorkerThreads (param->getValueAsString().getIntValue());
     }
 }
 
-bool BandpassFilter::stopAcquisition()
-{
-    return threadPool->removeAllJobs (true, 1000);
-}
-
 void BandpassFilter::process (AudioBuffer<float>& buffer)
 {
+    channelPointers.fill (nullptr);
+
+    int pointerOffset = 0;
+    int partition = 0;
+
     for (auto stream : getDataStreams())
     {
-        if ((*stream)["enable_stream"])
-        {
-            BandpassFilterSettings* streamSettings = settings[stream->getStreamId()];
-
-            const uint16 streamId = stream->getStreamId();
-            const uint32 numSamples = getNumSamplesInBlock (streamId);
+        const uint16 streamId = stream->getStreamId();
+        const int numSamples = (int) getNumSamplesInBlock (streamId);
 
-            int i = 0;
-            Array<float*> channelPointers;
-            Array<Dsp::Filter*> filters;
+        settings[streamId]->applyPendingFilters (numSamples);
 
+        // Unselected channels and disabled streams stay null, so the bank leaves them unfiltered
+        if ((*stream)["enable_stream"])
+        {
             for (auto localChannelIndex : *((*stream)["channels"].getArray()))
             {
-                int globalChannelIndex = getGlobalChannelIndex (stream->getStreamId(), (int) localChannelIndex);
-
-                channelPointers.add (buffer.getWritePointer (globalChannelIndex));
-                filters.add (streamSettings->filters[localChannelIndex]);
-                i++;
-
-                if (i % CHANNELS_PER_THREAD == 0)
-                {
-                    String jobName = String (streamId) + "_" + String (i++);
-
-                    FilterJob* job = new FilterJob (jobName, filters, channelPointers, numSamples);
-
-                    threadPool->addJob (job, true);
+                int globalChannelIndex = getGlobalChannelIndex (streamId, (int) localChannelIndex);
 
-                    channelPointers.clear();
-                    filters.clear();
-                }
+                channelPointers.set (pointerOffset + (int) localChannelIndex, buffer.getWritePointer (globalChannelIndex));
             }
+        }
 
-            if (channelPointers.size() > 0)
-            {
-                String jobName = String (streamId) + "_" + String (i++);
-
-                FilterJob* job = new FilterJob (jobName, filters, channelPointers, numSamples);
+        for (int first = 0; first < stream->getChannelCount(); first += CHANNELS_PER_THREAD)
+            partitions.getReference (partition++).numSamples = numSamples;
 
-                threadPool->addJob (job, true);
-            }
-        }
+        pointerOffset += stream->getChannelCount();
     }
 
-    while (threadPool->getNumJobs() > 0)
-        std::this_thread::sleep_for (std::chrono::microseconds (50));
+    parallelFor (partitions.size(), [this] (int p)
+                 {
+                     const FilterPartition& partition = partitions.getReference (p);
+
+                     partition.filters->process (partition.numSamples,
+                                                 channelPointers.getRawDataPointer() + partition.pointerOffset,
+                                                 partition.firstChannel,
+                                                 partition.numChannels); });
 }
@@ -27,6 +27,7 @@
 #include <ProcessorHeaders.h>
 #include <DspLib.h>
 
+// A multiple of Dsp::BiquadBank::GroupSize, so each partition owns whole channel groups
 #define CHANNELS_PER_THREAD 32
 
 /** Holds settings for one stream's filters */
@@ -40,34 +41,50 @@ public:
     /** Holds the sample rate for this stream*/
     float sampleRate;
 
-    /** Holds the filters for one stream*/
-    OwnedArray<Dsp::Filter> filters;
+    /** Holds the filter coefficients and state for every channel in the stream (processing thread only)*/
+    Dsp::BiquadBank filters;
+
+    /** Designs the Butterworth bandpass whose coefficients are copied into the bank*/
+    Dsp::Butterworth::Design::BandPass<2> design;
 
     /** Creates new filters when input settings change*/
     void createFilters (int numChannels, float sampleRate, double lowCut, double highCut);
 
-    /** Updates filters when parameters change*/
+    /** Designs new filters when parameters change; process() ramps to them over its next block*/
     void updateFilters (double lowCut, double highCut);
 
-    /** Sets filter parameters for one channel*/
-    void setFilterParameters (double lowCut, double highCut, int channel);
+    /** Called by process() at the start of a block: starts the ramp to any filters designed since the last block (over the block, at most 20 ms)*/
+    void applyPendingFilters (int numSamples);
+
+private:
+    /** Sets the design's parameters for a new pair of cutoffs*/
+    void setFilterParameters (double lowCut, double highCut);
+
+    /** Coefficients designed by updateFilters(), not yet handed to the bank*/
+    Dsp::Biquad pendingStages[2];
+    bool hasPendingFilters = false;
+
+    /** Guards the pending coefficients; process() only tries it, and picks them up next block if it is busy*/
+    SpinLock pendingLock;
 };
 
-/** Allows multi-threaded filtering */
-class FilterJob : public ThreadPoolJob
+/** A range of one stream's channels, filtered by a single worker thread */
+struct FilterPartition
 {
-public:
-    /** Constructor */
-    FilterJob (String name, Array<Dsp::Filter*> filters, Array<float*> channelPointer, int numSamples);
+    /** The stream's filters */
+    Dsp::BiquadBank* filters;
 
-    /** Runs the job inside a thread */
-    JobStatus runJob();
+    /** First local channel in the range */
+    int firstChannel;
 
-private:
-    Array<Dsp::Filter*> filters;
-    Array<float*> channelPointers;
-    int numSamples;
+    /** Number of channels in the range */
     int numChannels;
+
+    /** Index of the range's first pointer in BandpassFilter::channelPointers */
+    int pointerOffset;
+
+    /** Samples in the stream's current block */
+    int numSamples;
 };
 
 /**
@@ -102,13 +119,14 @@ public:
     /** Called when upstream settings are changed.*/
     void updateSettings() override;
 
-    /** Stops any ongoing worker threads */
-    bool stopAcquisition() override;
-
 private:
     StreamSettings<BandpassFilterSettings> settings;
 
-    std::unique_ptr<ThreadPool> threadPool;
+    /** Fixed ranges of channels handed to the worker threads */
+    Array<FilterPartition> partitions;
+
+    /** Write pointers for every channel of every stream, or null if the channel is not filtered */
+    Array<float*> channelPointers;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BandpassFilter);
 };
@@ -21,14 +21,160 @@
 
 */
 
+#include <algorithm>
 #include <stdio.h>
 
 #include "CommonAvgRef.h"
 #include "CommonAvgRefEditor.h"
 
+#if JUCE_USE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+/** Sorts two rows of rankTileSamples values column by column, smaller values into a */
+inline void compareExchange (float* a, float* b)
+{
+    static_assert (CARSettings::rankTileSamples % 4 == 0, "Tiles are processed 4 samples at a time");
+
+    for (int i = 0; i < CARSettings::rankTileSamples; i += 4)
+    {
+#if JUCE_USE_SSE_INTRINSICS
+        const __m128 x = _mm_loadu_ps (a + i);
+        const __m128 y = _mm_loadu_ps (b + i);
+        _mm_storeu_ps (a + i, _mm_min_ps (x, y));
+        _mm_storeu_ps (b + i, _mm_max_ps (x, y));
+#elif JUCE_USE_ARM_NEON
+        const float32x4_t x = vld1q_f32 (a + i);
+        const float32x4_t y = vld1q_f32 (b + i);
+        vst1q_f32 (a + i, vminq_f32 (x, y));
+        vst1q_f32 (b + i, vmaxq_f32 (x, y));
+#else
+        for (int j = i; j < i + 4; j++)
+        {
+            const float x = a[j];
+            const float y = b[j];
+            a[j] = jmin (x, y);
+            b[j] = jmax (x, y);
+        }
+#endif
+    }
+}
+} // namespace
+
+CARSettings::RankSelection::RankSelection (Mode mode_, int numChannels_, int firstRank_, int lastRank_)
+    : mode (mode_),
+      numChannels (numChannels_),
+      firstRank (firstRank_),
+      lastRank (lastRank_)
+{
+    columns.allocate ((size_t) numChannels * rankTileSamples, true);
+
+    // Batcher's odd-even merge sort for the next power of two. Comparators that touch
+    // channels past the end are dropped, as if those channels held +infinity.
+    int size = 1;
+
+    while (size < numChannels)
+        size <<= 1;
+
+    std::vector<std::pair<int, int>> sortingNetwork;
+
+    for (int p = 1; p < size; p <<= 1)
+    {
+        for (int k = p; k >= 1; k >>= 1)
+        {
+            for (int j = k % p; j + k < size; j += 2 * k)
+            {
+                for (int i = 0; i < jmin (k, size - j - k); i++)
+                {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p) && i + j + k < numChannels)
+                        sortingNetwork.emplace_back (i + j, i + j + k);
+                }
+            }
+        }
+    }
+
+    // Keep only the comparators that can move a value into one of the ranks we average
+    std::vector<bool> needed ((size_t) numChannels, false);
+
+    for (int r = firstRank; r < lastRank; r++)
+        needed[r] = true;
+
+    for (auto it = sortingNetwork.rbegin(); it != sortingNetwork.rend(); ++it)
+    {
+        if (needed[it->first] || needed[it->second])
+        {
+            needed[it->first] = needed[it->second] = true;
+            network.push_back (*it);
+        }
+    }
+
+    std::reverse (network.begin(), network.end());
+}
+
 CARSettings::CARSettings()
+    : hasPending (false)
 {
-    m_avgBuffer = AudioBuffer<float> (1, 10000); // 1-dimensional buffer to hold the average
+}
+
+void CARSettings::prepare (Mode mode, int numChannels, float trimPercent)
+{
+    int firstRank;
+    int lastRank;
+
+    if (mode == MEDIAN)
+    {
+        // One middle rank for an odd count, the two middle ranks for an even count
+        firstRank = (numChannels - 1) / 2;
+        lastRank = numChannels / 2 + 1;
+    }
+    else if (mode == TRIMMED_MEAN)
+    {
+        firstRank = jmin ((int) (numChannels * trimPercent / 100.0f), (numChannels - 1) / 2);
+        lastRank = numChannels - firstRank;
+    }
+    else
+    {
+        return;
+    }
+
+    {
+        // process() never changes the selections themselves, so they can be read under the lock
+        const SpinLock::ScopedLockType lock (selectionLock);
+        const RankSelection* latest = hasPending ? pending.get() : active.get();
+
+        if (latest != nullptr && latest->matches (mode, numChannels) && latest->firstRank == firstRank)
+            return;
+    }
+
+    // Built here, without the lock, so process() is never held up by it
+    auto selection = std::make_unique<RankSelection> (mode, numChannels, firstRank, lastRank);
+
+    {
+        const SpinLock::ScopedLockType lock (selectionLock);
+
+        std::swap (pending, selection);
+        hasPending = true;
+    }
+
+    // selection now holds a selection process() has finished with (or never took), freed here
+}
+
+CARSettings::RankSelection* CARSettings::getRankSelection()
+{
+    const SpinLock::ScopedTryLockType lock (selectionLock);
+
+    if (lock.isLocked() && hasPending)
+    {
+        // The replaced selection stays in pending until prepare() frees it
+        std::swap (active, pending);
+        hasPending = false;
+    }
+
+    return active.get();
 }
 
 CommonAverageRef::CommonAverageRef()
@@ -61,6 +207,23 @@ void CommonAverageRef::registerParameters()
                        0.0f,
                        100.0f,
                        1.0f);
+
+    addCategoricalParameter (Parameter::STREAM_SCOPE,
+                             "mode",
+                             "Mode",
+                             "How the reference channels are combined at each sample",
+                             { "Mean", "Median", "Trimmed mean" },
+                             0);
+
+    addFloatParameter (Parameter::STREAM_SCOPE,
+                       "trim",
+                       "Trim",
+                       "Percentage of reference channels dropped from each end in trimmed mean mode",
+                       "%",
+                       10.0f,
+                       0.0f,
+                       45.0f,
+                       1.0f);
 }
 
 AudioProcessorEditor* CommonAverageRef::createEditor()
@@ -72,6 +235,33 @@ AudioProcessorEditor* CommonAverageRef::createEditor()
 void CommonAverageRef::updateSettings()
 {
     settings.update (getDataStreams());
+
+    for (auto stream : getDataStreams())
+    {
+        // Enough for any selection, so process() never allocates
+        settings[stream->getStreamId()]->referenceChannels.ensureStorageAllocated (stream->getChannelCount());
+        settings[stream->getStreamId()]->affectedChannels.ensureStorageAllocated (stream->getChannelCount());
+
+        prepareStream (stream);
+    }
+}
+
+void CommonAverageRef::parameterValueChanged (Parameter* param)
+{
+    if (param->getName().equalsIgnoreCase ("reference")
+        || param->getName().equalsIgnoreCase ("affected")
+        || param->getName().equalsIgnoreCase ("mode")
+        || param->getName().equalsIgnoreCase ("trim"))
+    {
+        prepareStream (getDataStream (param->getStreamId()));
+    }
+}
+
+void CommonAverageRef::prepareStream (const DataStream* stream)
+{
+    const int numReferenceChannels = (*stream)["reference"].getArray()->size();
+
+    settings[stream->getStreamId()]->prepare ((CARSettings::Mode) int ((*stream)["mode"]), numReferenceChannels, (*stream)["trim"]);
 }
 
 void CommonAverageRef::process (AudioBuffer<float>& buffer)
@@ -86,46 +276,102 @@ void CommonAverageRef::process (AudioBuffer<float>& buffer)
             const int numReferenceChannels = (*stream)["reference"].getArray()->size();
             const int numAffectedChannels = (*stream)["affected"].getArray()->size();
 
-            // There is no need to do any processing if either number of reference or affected channels is zero.
+            // There is no need to process this stream if either number of reference or affected channels is zero.
             if (! numReferenceChannels
                 || ! numAffectedChannels)
             {
-                return;
+                continue;
             }
 
-            settings_->m_avgBuffer.clear();
+            settings_->referenceChannels.clearQuick();
+            settings_->affectedChannels.clearQuick();
 
             for (int i = 0; i < numReferenceChannels; ++i)
             {
                 int localIndex = (*stream)["reference"][i];
                 int globalIndex = stream->getContinuousChannels()[localIndex]->getGlobalIndex();
 
-                settings_->m_avgBuffer.addFrom (0, // destChannel
-                                                0, // destStartSample
-                                                buffer, // source
-                                                globalIndex, // sourceChannel
-                                                0, // sourceStartSample
-                                                numSamples, // numSamples
-                                                1.0f); // gain to apply
+                settings_->referenceChannels.add (buffer.getReadPointer (globalIndex));
             }
 
-            settings_->m_avgBuffer.applyGain (1.0f / float (numReferenceChannels));
-
-            const float gain = -1.0f * float ((*stream)["gain"]) / 100.f;
-
             for (int i = 0; i < numAffectedChannels; ++i)
             {
                 int localIndex = (*stream)["affected"][i];
                 int globalIndex = stream->getContinuousChannels()[localIndex]->getGlobalIndex();
 
-                buffer.addFrom (globalIndex, // destChannel
-                                0, // destStartSample
-                                settings_->m_avgBuffer, // source
-                                0, // sourceChannel
-                                0, // sourceStartSample
-                                numSamples, // numSamples
-                                gain); // gain to apply
+                settings_->affectedChannels.add (buffer.getWritePointer (globalIndex));
             }
+
+            const float gain = -1.0f * float ((*stream)["gain"]) / 100.f;
+            const auto mode = (CARSettings::Mode) int ((*stream)["mode"]);
+
+            // The network is built on the message thread when the parameters change; until
+            // one that matches them arrives, fall back to the plain mean rather than building it here
+            CARSettings::RankSelection* selection = settings_->getRankSelection();
+
+            if (mode != CARSettings::MEAN && selection != nullptr && selection->matches (mode, numReferenceChannels))
+                subtractRankedMean (settings_, *selection, numSamples, gain);
+            else
+                subtractMean (settings_, numSamples, gain);
         }
     }
 }
+
+void CommonAverageRef::subtractMean (CARSettings* settings_, int numSamples, float gain)
+{
+    const Array<const float*>& reference = settings_->referenceChannels;
+    const float scale = gain / float (reference.size());
+
+    float average[CARSettings::meanTileSamples];
+
+    for (int start = 0; start < numSamples; start += CARSettings::meanTileSamples)
+    {
+        const int count = jmin (CARSettings::meanTileSamples, numSamples - start);
+
+        FloatVectorOperations::copy (average, reference[0] + start, count);
+
+        for (int i = 1; i < reference.size(); ++i)
+            FloatVectorOperations::add (average, reference[i] + start, count);
+
+        for (auto* channel : settings_->affectedChannels)
+            FloatVectorOperations::addWithMultiply (channel + start, average, scale, count);
+    }
+}
+
+void CommonAverageRef::subtractRankedMean (CARSettings* settings_, CARSettings::RankSelection& selection, int numSamples, float gain)
+{
+    constexpr int tileSamples = CARSettings::rankTileSamples;
+
+    const Array<const float*>& reference = settings_->referenceChannels;
+    const float scale = gain / float (selection.lastRank - selection.firstRank);
+    float* columns = selection.columns.getData();
+
+    float average[tileSamples];
+
+    for (int start = 0; start < numSamples; start += tileSamples)
+    {
+        const int count = jmin (tileSamples, numSamples - start);
+
+        // Each row holds one reference channel; the network sorts every column at once
+        for (int i = 0; i < reference.size(); ++i)
+        {
+            float* row = columns + i * tileSamples;
+
+            FloatVectorOperations::copy (row, reference[i] + start, count);
+
+            if (count < tileSamples)
+                FloatVectorOperations::clear (row + count, tileSamples - count);
+        }
+
+        for (const auto& step : selection.network)
+            compareExchange (columns + step.first * tileSamples, columns + step.second * tileSamples);
+
+        FloatVectorOperations::copy (average, columns + selection.firstRank * tileSamples, tileSamples);
+
+        for (int r = selection.firstRank + 1; r < selection.lastRank; ++r)
+            FloatVectorOperations::add (average, columns + r * tileSamples, tileSamples);
+
+        for (auto* channel : settings_->affectedChannels)
+            FloatVectorOperations::addWithMultiply (channel + start, average, scale, count);
+    }
+}
@@ -26,25 +26,95 @@
 
 #include <ProcessorHeaders.h>
 
+#include <vector>
+
 /** Holds settings for one stream's CAR*/
 
 class CARSettings
 {
 public:
+    /** How the reference is computed from the reference channels at each sample */
+    enum Mode
+    {
+        MEAN = 0,
+        MEDIAN,
+        TRIMMED_MEAN
+    };
+
+    /** Samples per tile when averaging all reference channels */
+    static constexpr int meanTileSamples = 256;
+
+    /** Samples per tile when ranking reference channels */
+    static constexpr int rankTileSamples = 16;
+
+    /** The ranks averaged into a median or trimmed mean reference, and the network that sorts them into place */
+    struct RankSelection
+    {
+        /** Builds the selection network for numChannels reference channels */
+        RankSelection (Mode mode, int numChannels, int firstRank, int lastRank);
+
+        /** Returns true if this selection was built for the given mode and channel count */
+        bool matches (Mode mode_, int numChannels_) const { return mode == mode_ && numChannels == numChannels_; }
+
+        const Mode mode;
+        const int numChannels;
+
+        /** First rank averaged into the reference */
+        const int firstRank;
+
+        /** One past the last rank averaged into the reference */
+        const int lastRank;
+
+        /** Compare-exchange steps that bring ranks [firstRank, lastRank) into place */
+        std::vector<std::pair<int, int>> network;
+
+        /** One tile of every reference channel, rankTileSamples per channel */
+        HeapBlock<float> columns;
+    };
+
     /** Constructor -- sets default values*/
     CARSettings();
 
     /** Destructor */
     ~CARSettings() {}
 
-    /** Buffer to hold average */
-    AudioSampleBuffer m_avgBuffer;
+    /** Builds a selection for a median or trimmed mean over numChannels reference channels,
+        for process() to pick up at its next block; does nothing if the latest one already matches */
+    void prepare (Mode mode, int numChannels, float trimPercent);
+
+    /** Called by process() at the start of a block: takes any selection built since the last
+        block and returns the one to use, or nullptr if none has been built yet */
+    RankSelection* getRankSelection();
+
+    /** Reference channels for the current block */
+    Array<const float*> referenceChannels;
+
+    /** Affected channels for the current block */
+    Array<float*> affectedChannels;
+
+private:
+    /** The selection process() uses; only replaced by process() itself */
+    std::unique_ptr<RankSelection> active;
+
+    /** A selection waiting for process(), or the one it replaced, which prepare() frees */
+    std::unique_ptr<RankSelection> pending;
+
+    /** True if pending holds a selection process() has not taken yet */
+    bool hasPending;
+
+    /** Guards pending; process() only tries it, and takes a new selection next block if it is busy */
+    SpinLock selectionLock;
 };
 
 /**
     This is a simple filter that subtracts the average of a subset of channels from 
     another subset of channels. The gain parameter allows you to subtract a percentage of the total avg.
 
+    The reference can also be the median or a trimmed mean of the reference channels
+    at each sample, so a few bad channels do not leak into every affected channel.
+    All modes work on short tiles of samples: the reference for a tile is computed
+    and subtracted from the affected channels while the tile is still in cache.
+
     See Ludwig et al. 2009 Using a common average reference to improve cortical
     neuron recordings from microelectrode arrays. J. Neurophys, 2009 for a detailed
     discussion
@@ -67,6 +137,9 @@ public:
     /** Called when upstream settings are changed.*/
     void updateSettings() override;
 
+    /** Called when a parameter value is updated, to rebuild the stream's reference settings */
+    void parameterValueChanged (Parameter* param) override;
+
     /** Returns the current gain level that is set in the processor */
     float getGainLevel (uint16 streamId);
 
@@ -77,6 +150,15 @@ public:
     AudioProcessorEditor* createEditor() override;
 
 private:
+    /** Builds the selection network for a stream's current parameters */
+    void prepareStream (const DataStream* stream);
+
+    /** Subtracts gain times the mean of the reference channels from the affected channels */
+    static void subtractMean (CARSettings* settings, int numSamples, float gain);
+
+    /** Subtracts gain times the mean of the selected ranks of the reference channels from the affected channels */
+    static void subtractRankedMean (CARSettings* settings, CARSettings::RankSelection& selection, int numSamples, float gain);
+
     StreamSettings<CARSettings> settings;
 
     // ==================================================================
@@ -26,9 +26,11 @@
 CommonAverageRefEditor::CommonAverageRefEditor (GenericProcessor* parentProcessor)
     : GenericEditor (parentProcessor)
 {
-    desiredWidth = 170;
+    desiredWidth = 300;
 
     addMaskChannelsParameterEditor (Parameter::STREAM_SCOPE, "affected", 10, 35);
     addMaskChannelsParameterEditor (Parameter::STREAM_SCOPE, "reference", 10, 65);
     addBoundedValueParameterEditor (Parameter::STREAM_SCOPE, "gain", 10, 95);
+    addComboBoxParameterEditor (Parameter::STREAM_SCOPE, "mode", 160, 35);
+    addBoundedValueParameterEditor (Parameter::STREAM_SCOPE, "trim", 160, 65);
 }
@@ -238,3 +238,146 @@ TEST_F (CommonAverageRefTests, GainFullSubtractsFullReference)
     // 2.0 - 1.0*1.0 = 1.0
     ASSERT_TRUE (checkSamplesEqual (1, 1.0f));
 }
+
+class CommonAverageRefModeTests : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        createProcessor (6);
+    }
+
+    /** Creates the processor with two streams of channelsPerStream channels each */
+    void createProcessor (int channelsPerStream)
+    {
+        numChannels = channelsPerStream;
+        tester = std::make_unique<ProcessorTester> (TestSourceNodeBuilder (FakeSourceNodeParams {
+            numChannels,
+            30000.0f,
+            1.0,
+            2 }));
+        processor = tester->createProcessor<CommonAverageRef> (Plugin::Processor::FILTER);
+        ASSERT_EQ (processor->getNumDataStreams(), 2);
+        processor->update();
+    }
+
+    /** Uses channels 0 to numChannels - 2 of a stream as reference and the last channel as affected */
+    void setChannels (const DataStream* stream, int mode, float trim)
+    {
+        Array<var> reference;
+
+        for (int i = 0; i < numChannels - 1; i++)
+            reference.add (i);
+
+        // Set the way the editor does, so the processor prepares the stream for the new values
+        stream->getParameter ("reference")->setNextValue (reference, false);
+        stream->getParameter ("affected")->setNextValue (Array<var> ({ numChannels - 1 }), false);
+        stream->getParameter ("mode")->setNextValue (mode, false);
+        stream->getParameter ("trim")->setNextValue (trim, false);
+    }
+
+    /** Fills channel i of every stream with referenceValues[i] and the affected channel with 10, then processes one block */
+    void processBlock (const Array<float>& referenceValues, int bufferSize)
+    {
+        signal = std::make_unique<AudioBuffer<float>> (2 * numChannels, bufferSize);
+
+        for (int s = 0; s < 2; s++)
+        {
+            for (int i = 0; i < numChannels - 1; i++)
+                FloatVectorOperations::fill (signal->getWritePointer (s * numChannels + i), referenceValues[i], bufferSize);
+
+            FloatVectorOperations::fill (signal->getWritePointer (s * numChannels + numChannels - 1), 10.0f, bufferSize);
+        }
+
+        for (auto stream : processor->getDataStreams())
+            AccessClass::ExternalProcessorAccessor::injectNumSamples (processor, stream->getStreamId(), bufferSize);
+
+        processor->process (*(signal.get()));
+    }
+
+    /** Checks that every sample of a channel is close to the expected value */
+    bool checkSamplesEqual (int chan, float expected)
+    {
+        for (int j = 0; j < signal->getNumSamples(); j++)
+        {
+            if (std::isgreater (fabs (signal->getSample (chan, j) - expected), 0.001f))
+                return false;
+        }
+        return true;
+    }
+
+    int numChannels;
+
+    CommonAverageRef* processor;
+    std::unique_ptr<ProcessorTester> tester;
+    std::unique_ptr<AudioBuffer<float>> signal;
+};
+
+TEST_F (CommonAverageRefModeTests, MedianIgnoresBadChannel)
+{
+    for (auto stream : processor->getDataStreams())
+        setChannels (stream, 1, 10.0f);
+
+    // Reference channels 1, 2, 3, 4 and a bad channel at 1000: the median is 3
+    processBlock ({ 1.0f, 1000.0f, 2.0f, 4.0f, 3.0f }, 37);
+
+    ASSERT_TRUE (checkSamplesEqual (numChannels - 1, 10.0f - 3.0f));
+    ASSERT_TRUE (checkSamplesEqual (2 * numChannels - 1, 10.0f - 3.0f));
+}
+
+TEST_F (CommonAverageRefModeTests, MedianOfEvenAndLargeChannelCounts)
+{
+    // Even counts average the two middle ranks; 64 and 127 need networks for
+    // 64 and 128 channels, the second with comparators dropped past the end
+    for (int numReference : { 2, 4, 8, 64, 127 })
+    {
+        createProcessor (numReference + 1);
+
+        for (auto stream : processor->getDataStreams())
+            setChannels (stream, 1, 10.0f);
+
+        // Distinct values in scrambled order, with a bad channel at each end
+        Array<float> referenceValues;
+
+        for (int i = 0; i < numReference; i++)
+            referenceValues.add ((float) ((i * 37) % numReference));
+
+        referenceValues.set (0, 1000.0f);
+        referenceValues.set (numReference - 1, -1000.0f);
+
+        Array<float> sorted (referenceValues);
+        sorted.sort();
+
+        const float median = numReference % 2 == 1 ? sorted[numReference / 2]
+                                                    : (sorted[numReference / 2 - 1] + sorted[numReference / 2]) / 2.0f;
+
+        processBlock (referenceValues, 37);
+
+        ASSERT_TRUE (checkSamplesEqual (numChannels - 1, 10.0f - median)) << numReference << " reference channels";
+        ASSERT_TRUE (checkSamplesEqual (2 * numChannels - 1, 10.0f - median)) << numReference << " reference channels";
+    }
+}
+
+TEST_F (CommonAverageRefModeTests, TrimmedMeanDropsExtremes)
+{
+    for (auto stream : processor->getDataStreams())
+        setChannels (stream, 2, 20.0f);
+
+    // 20% of 5 channels drops one from each end, leaving 2, 3 and 4
+    processBlock ({ -500.0f, 4.0f, 2.0f, 3.0f, 900.0f }, 100);
+
+    ASSERT_TRUE (checkSamplesEqual (numChannels - 1, 10.0f - 3.0f));
+}
+
+TEST_F (CommonAverageRefModeTests, StreamWithoutReferenceDoesNotStopLaterStreams)
+{
+    setChannels (processor->getDataStreams()[0], 0, 0.0f);
+    setChannels (processor->getDataStreams()[1], 0, 0.0f);
+
+    processor->getDataStreams()[0]->getParameter ("reference")->setNextValue (Array<var>(), false);
+
+    processBlock ({ 1.0f, 2.0f, 3.0f, 4.0f, 5.0f }, 20);
+
+    ASSERT_TRUE (checkSamplesEqual (numChannels - 1, 10.0f));
+    ASSERT_TRUE (checkSamplesEqual (2 * numChannels - 1, 10.0f - 3.0f));
+}
@@ -26,8 +26,82 @@
 
 #include "SpikeDetectorEditor.h"
 
+#if JUCE_USE_SSE_INTRINSICS
+#include <xmmintrin.h>
+#elif JUCE_USE_ARM_NEON
+#include <arm_neon.h>
+#endif
+
 #define OVERFLOW_BUFFER_SAMPLES 200
 
+namespace
+{
+/** Samples checked on every channel before looking for the earliest crossing among them */
+const int crossingTileSamples = 64;
+
+/** Returns a bit for each of the first numSamples (at most 64) samples that is below threshold */
+inline uint64 crossingMask (const float* samples, int numSamples, float threshold)
+{
+    uint64 mask = 0;
+    int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+    const __m128 t = _mm_set1_ps (threshold);
+
+    for (; i + 4 <= numSamples; i += 4)
+        mask |= (uint64) _mm_movemask_ps (_mm_cmplt_ps (_mm_loadu_ps (samples + i), t)) << i;
+#elif JUCE_USE_ARM_NEON
+    const float32x4_t t = vdupq_n_f32 (threshold);
+    const uint32 bitValues[4] = { 1, 2, 4, 8 };
+    const uint32x4_t bits = vld1q_u32 (bitValues);
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const uint32x4_t below = vandq_u32 (vcltq_f32 (vld1q_f32 (samples + i), t), bits);
+        const uint32x2_t sum = vpadd_u32 (vget_low_u32 (below), vget_high_u32 (below));
+        mask |= (uint64) vget_lane_u32 (vpadd_u32 (sum, sum), 0) << i;
+    }
+#endif
+
+    for (; i < numSamples; ++i)
+    {
+        if (samples[i] < threshold)
+            mask |= (uint64) 1 << i;
+    }
+
+    return mask;
+}
+
+/** Scans a tile of samples channel by channel and returns the offset of the earliest one
+    below its channel's threshold (or -1), setting checkedIndex to the first of the
+    checked channels that crossed there -- the one a sample-by-sample scan would find */
+int findCrossingInTile (const float* const* channels,
+                        const Array<int>& checkedChannels,
+                        const Array<float>& thresholds,
+                        int firstSample,
+                        int numSamples,
+                        int& checkedIndex)
+{
+    int earliest = numSamples;
+
+    for (int k = 0; k < checkedChannels.size(); ++k)
+    {
+        const int ch = checkedChannels.getUnchecked (k);
+
+        // Later channels only win with an earlier crossing
+        const uint64 mask = crossingMask (channels[ch] + firstSample, earliest, thresholds.getUnchecked (ch));
+
+        if (mask != 0)
+        {
+            earliest = countNumberOfBits ((mask & (~mask + 1)) - 1);
+            checkedIndex = k;
+        }
+    }
+
+    return earliest < numSamples ? earliest : -1;
+}
+} // namespace
+
 SpikeDetectorSettings::SpikeDetectorSettings() : nextAvailableChannel (0),
                                                  singleElectrodeCount (0),
                                                  stereotrodeCount (0),
@@ -65,15 +139,164 @@ bool AbsValueThresholder::checkSample (int channel, float sample)
     return false;
 }
 
-StdDevThresholder::StdDevThresholder (int numChannels) : Thresholder()
+int AbsValueThresholder::findCrossing (const float* const* channels,
+                                       const bool* active,
+                                       int numChannels,
+                                       int startSample,
+                                       int endSample,
+                                       int& channel)
+{
+    checkedChannels.clearQuick();
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        if (active[ch])
+            checkedChannels.add (ch);
+    }
+
+    if (checkedChannels.isEmpty())
+        return endSample;
+
+    for (int first = startSample; first < endSample; first += crossingTileSamples)
+    {
+        int k = 0;
+        const int offset = findCrossingInTile (channels, checkedChannels, thresholds, first, jmin (crossingTileSamples, endSample - first), k);
+
+        if (offset >= 0)
+        {
+            channel = checkedChannels[k];
+            return first + offset;
+        }
+    }
+
+    return endSample;
+}
+
+SampledThresholder::SampledThresholder (int numChannels) : Thresholder()
+{
+    for (int i = 0; i < numChannels; i++)
+    {
+        thresholds.set (i, -50.0f);
+        bufferIndex.add (-1);
+    }
+}
+
+bool SampledThresholder::checkSample (int channel, float sample)
+{
+    index += 1;
+    index %= skipSamples;
+
+    if (index == 0)
+        addSample (channel, sample);
+
+    if (sample < thresholds[channel])
+        return true;
+
+    return false;
+}
+
+void SampledThresholder::addSample (int channel, float sample)
+{
+    // update buffer
+    int nextIndex = (bufferIndex[channel] + 1) % bufferSize;
+
+    const bool update = getStoresBeforeUpdate (channel) == 0;
+
+    storeSample (channel, nextIndex, sample);
+
+    bufferIndex.set (channel, nextIndex);
+
+    // compute threshold
+    if (update)
+        updateThreshold (channel);
+}
+
+int SampledThresholder::getStoresBeforeUpdate (int channel) const
+{
+    // Updates when the sample at the end of the buffer is stored
+    return (2 * bufferSize - 2 - bufferIndex[channel]) % bufferSize;
+}
+
+int SampledThresholder::findCrossing (const float* const* channels,
+                                      const bool* active,
+                                      int numChannels,
+                                      int startSample,
+                                      int endSample,
+                                      int& channel)
+{
+    checkedChannels.clearQuick();
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        if (active[ch])
+            checkedChannels.add (ch);
+    }
+
+    const int numChecked = checkedChannels.size();
+
+    if (numChecked == 0)
+        return endSample;
+
+    for (int first = startSample; first < endSample; first += crossingTileSamples)
+    {
+        const int numSamples = jmin (crossingTileSamples, endSample - first);
+        const int numCalls = numSamples * numChecked;
+
+        // Call (within this tile) on which checkSample would store its first sample
+        const int firstStore = skipSamples - 1 - index;
+
+        // If a buffer could fill up here, its threshold changes partway through the tile,
+        // so check the tile a sample at a time instead (this is rare)
+        const int maxStores = (numCalls + skipSamples - 1) / skipSamples;
+        bool thresholdChanges = false;
+
+        for (auto ch : checkedChannels)
+        {
+            if (getStoresBeforeUpdate (ch) < maxStores)
+                thresholdChanges = true;
+        }
+
+        if (thresholdChanges)
+        {
+            const int crossing = Thresholder::findCrossing (channels, active, numChannels, first, first + numSamples, channel);
+
+            if (crossing < first + numSamples)
+                return crossing;
+
+            continue;
+        }
+
+        int k = 0;
+        const int offset = findCrossingInTile (channels, checkedChannels, thresholds, first, numSamples, k);
+        const int numCallsMade = offset >= 0 ? offset * numChecked + k + 1 : numCalls;
+
+        // Store the samples the checkSample calls up to the crossing would have
+        for (int call = firstStore; call < numCallsMade; call += skipSamples)
+        {
+            const int ch = checkedChannels.getUnchecked (call % numChecked);
+
+            addSample (ch, channels[ch][first + call / numChecked]);
+        }
+
+        index = (index + numCallsMade) % skipSamples;
+
+        if (offset >= 0)
+        {
+            channel = checkedChannels[k];
+            return first + offset;
+        }
+    }
+
+    return endSample;
+}
+
+StdDevThresholder::StdDevThresholder (int numChannels) : SampledThresholder (numChannels)
 {
     for (int i = 0; i < numChannels; i++)
     {
         stdLevels.set (i, 4.0f);
         stds.set (i, 50.0 / 4.0f);
-        thresholds.set (i, -50.0f);
         sampleBuffer.add (new Array<float>());
-        bufferIndex.add (-1);
     }
 }
 
@@ -96,29 +319,9 @@ float StdDevThresholder::getThreshold (int channel)
     return 0.0f;
 }
 
-bool StdDevThresholder::checkSample (int channel, float sample)
+void StdDevThresholder::storeSample (int channel, int position, float sample)
 {
-    index += 1;
-    index %= skipSamples;
-
-    if (index == 0)
-    {
-        // update buffer
-        int nextIndex = (bufferIndex[channel] + 1) % bufferSize;
-
-        sampleBuffer[channel]->set (nextIndex, sample);
-
-        bufferIndex.set (channel, nextIndex);
-
-        // compute threshold
-        if (nextIndex == bufferSize - 1)
-            computeStd (channel);
-    }
-
-    if (sample < thresholds[channel])
-        return true;
-
-    return false;
+    sampleBuffer[channel]->set (position, sample);
 }
 
 void StdDevThresholder::computeStd (int channel)
@@ -144,15 +347,21 @@ void StdDevThresholder::computeStd (int channel)
     thresholds.set (channel, threshold);
 }
 
-DynamicThresholder::DynamicThresholder (int numChannels) : Thresholder()
+DynamicThresholder::DynamicThresholder (int numChannels, int firstChannel) : SampledThresholder (numChannels)
 {
+    // Channels update at a fixed point in their buffer, so this must divide it evenly
+    jassert (bufferSize % updateInterval == 0);
+
     for (int i = 0; i < numChannels; i++)
     {
         sigmaLevels.set (i, 4.0f);
         medians.set (i, 50.0 / 4.0f);
-        thresholds.set (i, -50.0f);
-        sampleBuffer.add (new std::vector<float> (bufferSize));
-        bufferIndex.add (-1);
+
+        auto* histogram = histograms.add (new Histogram());
+        histogram->binIndexes.resize (bufferSize);
+
+        // Consecutive channels update 97 stored samples apart (mod updateInterval)
+        histogram->phase = ((firstChannel + i) * 97) % updateInterval;
     }
 }
 
@@ -173,37 +382,86 @@ float DynamicThresholder::getThreshold (int channel)
     return 0.0f;
 }
 
-bool DynamicThresholder::checkSample (int channel, float sample)
+void DynamicThresholder::storeSample (int channel, int position, float sample)
 {
-    index += 1;
-    index %= skipSamples;
+    Histogram& histogram = *histograms.getUnchecked (channel);
 
-    if (index == 0)
+    if (histogram.full)
     {
-        // update buffer
-        int nextIndex = (bufferIndex[channel] + 1) % bufferSize;
+        // the sample being replaced leaves the histogram
+        const int oldBin = histogram.binIndexes[position];
 
-        sampleBuffer.getUnchecked (channel)->at (nextIndex) = abs (sample) / scalar;
+        histogram.counts[oldBin]--;
+        histogram.octaveCounts[oldBin / binsPerOctave]--;
+    }
 
-        bufferIndex.set (channel, nextIndex);
+    const int bin = getBin (std::abs (sample) / scalar);
 
-        // compute threshold
-        if (nextIndex == bufferSize - 1)
-            computeSigma (channel);
-    }
+    histogram.binIndexes[position] = (uint16) bin;
+    histogram.counts[bin]++;
+    histogram.octaveCounts[bin / binsPerOctave]++;
 
-    if (sample < thresholds[channel])
-        return true;
+    if (position == bufferSize - 1)
+        histogram.full = true;
+}
 
-    return false;
+int DynamicThresholder::getStoresBeforeUpdate (int channel) const
+{
+    const Histogram& histogram = *histograms.getUnchecked (channel);
+
+    // Samples stored so far (modulo bufferSize once the buffer is full)
+    const int stored = bufferIndex[channel] + 1;
+
+    // The first update waits for a full buffer; after that, every updateInterval samples
+    const int firstCandidate = histogram.full ? stored + 1 : bufferSize;
+    const int offset = (updateInterval - (firstCandidate + histogram.phase) % updateInterval) % updateInterval;
+
+    return firstCandidate + offset - (stored + 1);
+}
+
+int DynamicThresholder::getBin (float value)
+{
+    uint32 bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+
+    // exponent and top 5 mantissa bits: 32 bins per octave
+    const int bin = (int) (bits >> 18) - lowestExponent * binsPerOctave;
+
+    return jlimit (0, numBins - 1, bin);
+}
+
+float DynamicThresholder::getBinStart (int bin)
+{
+    const uint32 bits = (uint32) (bin + lowestExponent * binsPerOctave) << 18;
+
+    float value;
+    std::memcpy (&value, &bits, sizeof (value));
+
+    return value;
 }
 
 void DynamicThresholder::computeSigma (int channel)
 {
-    std::sort (sampleBuffer.getUnchecked (channel)->begin(),
-               sampleBuffer.getUnchecked (channel)->end());
+    const Histogram& histogram = *histograms.getUnchecked (channel);
+
+    // rank of the median, as the element at bufferSize / 2 after sorting
+    const int rank = bufferSize / 2;
+
+    int below = 0;
+    int octave = 0;
+
+    while (octave < numOctaves - 1 && below + histogram.octaveCounts[octave] <= rank)
+        below += histogram.octaveCounts[octave++];
+
+    int bin = octave * binsPerOctave;
+
+    while (bin < numBins - 1 && below + histogram.counts[bin] <= rank)
+        below += histogram.counts[bin++];
 
-    float median = sampleBuffer.getUnchecked (channel)->at (bufferSize / 2);
+    // place the median within its bin assuming the values there are evenly spread
+    const float start = getBinStart (bin);
+    const float fraction = ((float) (rank - below) + 0.5f) / (float) jmax (1, (int) histogram.counts[bin]);
+    const float median = start + (getBinStart (bin + 1) - start) * fraction;
 
     medians.set (channel, median);
 
@@ -304,12 +562,24 @@ void SpikeDetector::parameterValueChanged (Parameter* p)
                     (float) spikeChannel->getParameter ("std_threshold" + String (ch + 1))->getValue());
             }
         }
-        else if (param->getSelectedString().equalsIgnoreCase ("STD"))
+        else if (param->getSelectedString().equalsIgnoreCase ("DYN"))
         {
+            // spread threshold updates over all channels of all spike channels
+            int firstChannel = 0;
+
+            for (auto otherChannel : spikeChannels)
+            {
+                if (otherChannel == spikeChannel)
+                    break;
+
+                firstChannel += otherChannel->getNumChannels();
+            }
+
             spikeChannel->thresholder.reset();
             spikeChannel->thresholder =
                 std::make_unique<DynamicThresholder> (
-                    spikeChannel->getNumChannels());
+                    spikeChannel->getNumChannels(),
+                    firstChannel);
 
             for (int ch = 0; ch < spikeChannel->getNumChannels(); ch++)
             {
@@ -733,71 +1003,78 @@ void SpikeDetector::process (AudioBuffer<float>& buffer)
 
             const int nSamples = getNumSamplesInBlock (streamId);
 
-            int sampleIndex = spikeChannel->currentSampleIndex - 1;
+            const int lastSample = nSamples - OVERFLOW_BUFFER_SAMPLES / 2;
+
+            overflowPointers.clearQuick();
+            blockPointers.clearQuick();
+            activeChannels.clearQuick();
 
-            // cycle through samples
-            while (sampleIndex < nSamples - OVERFLOW_BUFFER_SAMPLES / 2)
+            for (int ch = 0; ch < spikeChannel->getNumChannels(); ch++)
             {
-                ++sampleIndex;
+                const int globalChannel = spikeChannel->globalChannelIndexes[ch];
 
-                // cycle through channels
-                for (int ch = 0; ch < spikeChannel->getNumChannels(); ch++)
-                {
-                    // check whether spike detection is active
-                    if (spikeChannel->detectSpikesOnChannel (ch))
-                    {
-                        int currentChannel = spikeChannel->globalChannelIndexes[ch];
+                overflowPointers.add (overflowBuffer.getReadPointer (globalChannel) + OVERFLOW_BUFFER_SAMPLES);
+                blockPointers.add (buffer.getReadPointer (globalChannel));
+                activeChannels.add (spikeChannel->detectSpikesOnChannel (ch));
+            }
 
-                        float currentSample = getSample (currentChannel, sampleIndex, buffer);
+            int sampleIndex = spikeChannel->currentSampleIndex - 1;
 
-                        if (spikeChannel->thresholder->checkSample (ch, currentSample))
-                        {
-                            // find the peak
-                            int peakIndex = sampleIndex;
+            // jump from one threshold crossing to the next
+            while (sampleIndex < lastSample)
+            {
+                int ch = 0;
+                const int crossing = findCrossing (spikeChannel, sampleIndex + 1, lastSample + 1, ch);
 
-                            while (getSample (currentChannel, sampleIndex, buffer) > getSample (currentChannel, sampleIndex + 1, buffer)
-                                   && sampleIndex < peakIndex + spikeChannel->getPostPeakSamples())
-                            {
-                                ++sampleIndex;
-                            }
+                if (crossing > lastSample)
+                {
+                    sampleIndex = lastSample;
+                    break;
+                }
 
-                            peakIndex = sampleIndex;
+                sampleIndex = crossing;
 
-                            sampleIndex -= (spikeChannel->getPrePeakSamples() + 1);
+                int currentChannel = spikeChannel->globalChannelIndexes[ch];
 
-                            // create a buffer to hold the spike data
-                            Spike::Buffer spikeBuffer (spikeChannel);
+                // find the peak
+                int peakIndex = sampleIndex;
 
-                            // add the waveform
-                            addWaveformToSpikeBuffer (spikeBuffer,
-                                                      sampleIndex,
-                                                      buffer);
+                while (getSample (currentChannel, sampleIndex, buffer) > getSample (currentChannel, sampleIndex + 1, buffer)
+                       && sampleIndex < peakIndex + spikeChannel->getPostPeakSamples())
+                {
+                    ++sampleIndex;
+                }
+
+                peakIndex = sampleIndex;
 
-                            // get the spike timestamp (aligned to the peak index)
-                            int64 sampleNumber = getFirstSampleNumberForBlock (streamId) + peakIndex;
+                sampleIndex -= (spikeChannel->getPrePeakSamples() + 1);
 
-                            // create a spike object
-                            SpikePtr newSpike = Spike::createSpike (spikeChannel,
-                                                                    sampleNumber,
-                                                                    spikeChannel->thresholder->getThresholds(),
-                                                                    spikeBuffer);
+                // create a buffer to hold the spike data
+                Spike::Buffer spikeBuffer (spikeChannel);
 
-                            spikeCount++;
+                // add the waveform
+                addWaveformToSpikeBuffer (spikeBuffer,
+                                          sampleIndex,
+                                          buffer);
 
-                            // add spike to the outgoing EventBuffer
-                            addSpike (newSpike);
+                // get the spike timestamp (aligned to the peak index)
+                int64 sampleNumber = getFirstSampleNumberForBlock (streamId) + peakIndex;
 
-                            // advance the sample index
-                            sampleIndex = peakIndex + spikeChannel->getPostPeakSamples();
+                // create a spike object
+                SpikePtr newSpike = Spike::createSpike (spikeChannel,
+                                                        sampleNumber,
+                                                        spikeChannel->thresholder->getThresholds(),
+                                                        spikeBuffer);
 
-                            break; // quit channels "for" loop
-                        }
+                spikeCount++;
 
-                    } // if detectSpikesOnChannel
+                // add spike to the outgoing EventBuffer
+                addSpike (newSpike);
 
-                } // cycle through channels
+                // advance the sample index
+                sampleIndex = peakIndex + spikeChannel->getPostPeakSamples();
 
-            } // while (sampleIndex < nSamples - OVERFLOW_BUFFER_SAMPLES)
+            } // while (sampleIndex < lastSample)
 
             spikeChannel->currentSampleIndex = sampleIndex - nSamples; // should be negative
 
@@ -845,6 +1122,41 @@ float SpikeDetector::getSample (int globalChannelIndex, int sampleIndex, AudioBu
     }
 }
 
+int SpikeDetector::findCrossing (SpikeChannel* spikeChannel, int startSample, int endSample, int& channel)
+{
+    Thresholder* thresholder = spikeChannel->thresholder.get();
+    const int numChannels = spikeChannel->getNumChannels();
+
+    int sample = startSample;
+
+    if (sample < 0)
+    {
+        const int overflowEnd = jmin (0, endSample);
+
+        sample = thresholder->findCrossing (overflowPointers.getRawDataPointer(),
+                                            activeChannels.getRawDataPointer(),
+                                            numChannels,
+                                            sample,
+                                            overflowEnd,
+                                            channel);
+
+        if (sample < overflowEnd)
+            return sample;
+    }
+
+    if (sample < endSample)
+    {
+        sample = thresholder->findCrossing (blockPointers.getRawDataPointer(),
+                                            activeChannels.getRawDataPointer(),
+                                            numChannels,
+                                            sample,
+                                            endSample,
+                                            channel);
+    }
+
+    return sample;
+}
+
 void SpikeDetector::saveCustomParametersToXml (XmlElement* xml)
 {
     for (auto spikeChannel : spikeChannels)
@@ -74,8 +74,63 @@ public:
     /** Gets an array of thresholds for all channels*/
     Array<float>& getThresholds() { return thresholds; }
 
+    /** Finds the first sample below threshold, scanning each channel a tile at a time */
+    int findCrossing (const float* const* channels, const bool* active, int numChannels, int startSample, int endSample, int& channel) override;
+
 private:
     Array<float> thresholds;
+    Array<int> checkedChannels;
+};
+
+/**
+    Base class for thresholders that adapt to the signal.
+
+    Every skipSamples-th call to checkSample (counted across all channels)
+    stores that sample in its channel's buffer; by default, a channel's
+    threshold is recomputed whenever its buffer fills up.
+
+*/
+class SampledThresholder : public Thresholder
+{
+public:
+    /** Constructor */
+    SampledThresholder (int numChannels);
+
+    /** Destructor */
+    virtual ~SampledThresholder() {}
+
+    /** Checks whether a sample should trigger a spike*/
+    bool checkSample (int channel, float sample) override;
+
+    /** Finds the first sample below threshold a tile at a time, storing the same samples checkSample would */
+    int findCrossing (const float* const* channels, const bool* active, int numChannels, int startSample, int endSample, int& channel) override;
+
+    /** Gets an array of thresholds for all channels*/
+    Array<float>& getThresholds() { return thresholds; }
+
+protected:
+    /** Stores a sample at a position in a channel's buffer */
+    virtual void storeSample (int channel, int position, float sample) = 0;
+
+    /** Recomputes a channel's threshold */
+    virtual void updateThreshold (int channel) = 0;
+
+    /** Returns how many samples a channel stores before the one that updates its threshold */
+    virtual int getStoresBeforeUpdate (int channel) const;
+
+    Array<float> thresholds;
+    Array<int> bufferIndex;
+
+    const int bufferSize = 4000;
+    const int skipSamples = 50;
+
+private:
+    /** Stores every skipSamples-th sample, as checkSample does */
+    void addSample (int channel, float sample);
+
+    Array<int> checkedChannels;
+
+    int index = 0;
 };
 
 /**
@@ -86,7 +141,7 @@ private:
     deviation, a spike will be triggered.
 
 */
-class StdDevThresholder : public Thresholder
+class StdDevThresholder : public SampledThresholder
 {
 public:
     /** Constructor*/
@@ -95,32 +150,24 @@ public:
     /** Destructor */
     virtual ~StdDevThresholder() {}
 
-    /** Checks whether a sample should trigger a spike*/
-    bool checkSample (int channel, float sample);
-
     /** Sets the threshold for a given channel*/
     void setThreshold (int channel, float threshold);
 
     /** Gets the threshold for a given channel*/
     float getThreshold (int channel);
 
-    /** Gets an array of thresholds for all channels*/
-    Array<float>& getThresholds() { return thresholds; }
+protected:
+    void storeSample (int channel, int position, float sample) override;
+
+    void updateThreshold (int channel) override { computeStd (channel); }
 
 private:
     /** Computes the standard deviation of a given channel*/
     void computeStd (int channel);
 
-    Array<float> thresholds;
     Array<float> stdLevels;
     Array<float> stds;
     OwnedArray<Array<float>> sampleBuffer;
-    Array<int> bufferIndex;
-
-    const int bufferSize = 4000;
-    const int skipSamples = 50;
-
-    int index;
 };
 
 /**
@@ -129,44 +176,71 @@ private:
 
     Thr = 4 * s
     s = median{ |x| / 0.6745 }
+
+    The median is taken over each channel's last bufferSize stored samples,
+    which are kept in a histogram with log-spaced bins (3% wide) instead of
+    being sorted. Thresholds are updated every updateInterval stored samples,
+    at a different point for each channel, so that channels do not all
+    update in the same block.
 */
-class DynamicThresholder : public Thresholder
+class DynamicThresholder : public SampledThresholder
 {
 public:
-    /** Constructor */
-    DynamicThresholder (int numChannels);
+    /** Constructor. firstChannel is the position of this thresholder's first channel
+        among all channels being thresholded, and sets when each channel updates. */
+    DynamicThresholder (int numChannels, int firstChannel = 0);
 
     /** Destructor */
     virtual ~DynamicThresholder() {}
 
-    /** Checks whether a sample should trigger a spike*/
-    bool checkSample (int channel, float sample);
-
     /** Sets the threshold for a given channel*/
     void setThreshold (int channel, float threshold);
 
     /** Gets the threshold for a given channel*/
     float getThreshold (int channel);
 
-    /** Gets an array of thresholds for all channels*/
-    Array<float>& getThresholds() { return thresholds; }
+    /** Number of stored samples between threshold updates of one channel */
+    static constexpr int updateInterval = 250;
+
+protected:
+    void storeSample (int channel, int position, float sample) override;
+
+    void updateThreshold (int channel) override { computeSigma (channel); }
+
+    int getStoresBeforeUpdate (int channel) const override;
 
 private:
+    static constexpr int binsPerOctave = 32;
+    static constexpr int numOctaves = 32;
+    static constexpr int numBins = binsPerOctave * numOctaves;
+
+    /** Biased float exponent of the lowest bin (2^-4) */
+    static constexpr int lowestExponent = 123;
+
+    /** Counts of the values in one channel's buffer, per bin and per octave */
+    struct Histogram
+    {
+        std::vector<uint16> binIndexes;
+        uint16 counts[numBins] = {};
+        uint16 octaveCounts[numOctaves] = {};
+        bool full = false;
+        int phase = 0;
+    };
+
+    /** Returns the bin holding a (non-negative) value, read from its exponent and top mantissa bits */
+    static int getBin (float value);
+
+    /** Returns the smallest value that falls in a bin */
+    static float getBinStart (int bin);
+
     /** Computes sigma value used for dynamic thresholding*/
     void computeSigma (int channel);
 
-    Array<float> thresholds;
     Array<float> sigmaLevels;
     Array<float> medians;
-    OwnedArray<std::vector<float>> sampleBuffer;
-    Array<int> bufferIndex;
-
-    const int bufferSize = 4000;
-    const int skipSamples = 50;
+    OwnedArray<Histogram> histograms;
 
     const float scalar = 0.6745f;
-
-    int index;
 };
 
 /**
@@ -239,12 +313,24 @@ private:
     /** Extra samples are placed in this buffer to allow seamless
     transitions between callbacks. */
     AudioBuffer<float> overflowBuffer;
+
+    /** Sample 0 of each channel of the spike channel being processed,
+        in the overflow buffer and in the current block */
+    Array<const float*> overflowPointers;
+    Array<const float*> blockPointers;
+
+    /** Whether detection is on for each channel of the spike channel being processed */
+    Array<bool> activeChannels;
     // =====================================================================
 
     /** Returns the sample value at a given index, taking into account 
         the overflow buffer */
     float getSample (int globalChannelIndex, int sampleIndex, AudioBuffer<float>& buffer);
 
+    /** Finds the first threshold crossing from startSample up to (not including) endSample,
+        reading negative indexes from the overflow buffer. Returns endSample if there is none. */
+    int findCrossing (SpikeChannel* spikeChannel, int startSample, int endSample, int& channel);
+
     /** Adds a waveform (starting a given sample) to spike data buffer*/
     void addWaveformToSpikeBuffer (Spike::Buffer& s,
                                    int sampleIndex,
@@ -31,6 +31,9 @@
 #include <ProcessorHeaders.h>
 #include <TestFixtures.h>
 
+#include <algorithm>
+#include <vector>
+
 class SpikeDetectorTests : public ::testing::Test
 {
 protected:
@@ -50,3 +53,213 @@ protected:
     {
     }
 };
+
+namespace
+{
+const int numTestChannels = 4;
+const int numTestSamples = 500000;
+
+/** Noise with occasional negative spikes, and a louder stretch partway through
+    so adaptive thresholds move */
+std::vector<std::vector<float>> createTestSignal()
+{
+    Random random (42);
+    std::vector<std::vector<float>> data (numTestChannels, std::vector<float> (numTestSamples));
+
+    for (int ch = 0; ch < numTestChannels; ch++)
+    {
+        for (int i = 0; i < numTestSamples; i++)
+        {
+            const float gain = (i > numTestSamples / 3) ? 2.0f : 1.0f;
+            data[ch][i] = gain * 15.0f * (random.nextFloat() + random.nextFloat() + random.nextFloat() - 1.5f);
+
+            if (random.nextInt (3000) == 0)
+                data[ch][i] -= 120.0f + 10.0f * ch;
+        }
+    }
+
+    return data;
+}
+
+/** Detects crossings with one checkSample call per sample and channel, as SpikeDetector
+    used to, then with findCrossing over uneven blocks, and checks both give the same
+    crossings and end up with the same thresholds */
+void expectSameCrossings (Thresholder& perSample, Thresholder& scanned)
+{
+    const std::vector<std::vector<float>> data = createTestSignal();
+    const bool active[numTestChannels] = { true, false, true, true };
+    const int samplesAfterCrossing = 40;
+
+    std::vector<std::pair<int, int>> expected;
+
+    for (int sample = 0; sample < numTestSamples; ++sample)
+    {
+        for (int ch = 0; ch < numTestChannels; ch++)
+        {
+            if (active[ch] && perSample.checkSample (ch, data[ch][sample]))
+            {
+                expected.push_back ({ sample, ch });
+                sample += samplesAfterCrossing;
+                break;
+            }
+        }
+    }
+
+    const float* channels[numTestChannels];
+
+    for (int ch = 0; ch < numTestChannels; ch++)
+        channels[ch] = data[ch].data();
+
+    std::vector<std::pair<int, int>> actual;
+    Random random (7);
+    int sample = 0;
+    int blockEnd = 0;
+
+    while (blockEnd < numTestSamples)
+    {
+        blockEnd = jmin (numTestSamples, blockEnd + 1 + random.nextInt (1000));
+
+        while (sample < blockEnd)
+        {
+            int ch = -1;
+            const int crossing = scanned.findCrossing (channels, active, numTestChannels, sample, blockEnd, ch);
+
+            if (crossing == blockEnd)
+            {
+                sample = blockEnd;
+                break;
+            }
+
+            actual.push_back ({ crossing, ch });
+            sample = crossing + samplesAfterCrossing + 1;
+        }
+    }
+
+    EXPECT_GT (expected.size(), 50);
+    EXPECT_EQ (actual, expected);
+
+    for (int ch = 0; ch < numTestChannels; ch++)
+        EXPECT_EQ (scanned.getThresholds()[ch], perSample.getThresholds()[ch]);
+}
+} // namespace
+
+TEST (SpikeDetectorThresholderTests, AbsValueScanMatchesPerSampleChecks)
+{
+    AbsValueThresholder perSample (numTestChannels);
+    AbsValueThresholder scanned (numTestChannels);
+
+    for (int ch = 0; ch < numTestChannels; ch++)
+    {
+        perSample.setThreshold (ch, -60.0f - ch);
+        scanned.setThreshold (ch, -60.0f - ch);
+    }
+
+    expectSameCrossings (perSample, scanned);
+}
+
+TEST (SpikeDetectorThresholderTests, StdDevScanMatchesPerSampleChecks)
+{
+    StdDevThresholder perSample (numTestChannels);
+    StdDevThresholder scanned (numTestChannels);
+
+    expectSameCrossings (perSample, scanned);
+}
+
+TEST (SpikeDetectorThresholderTests, DynamicScanMatchesPerSampleChecks)
+{
+    DynamicThresholder perSample (numTestChannels);
+    DynamicThresholder scanned (numTestChannels);
+
+    expectSameCrossings (perSample, scanned);
+}
+
+/*
+The histogram median is within a bin width (3%) of sorting the last 4000 stored
+samples, after the noise level changes partway through the buffer.
+*/
+TEST (SpikeDetectorThresholderTests, DynamicMedianMatchesSortedBuffer)
+{
+    DynamicThresholder thresholder (1);
+
+    // every 50th checked sample is stored; the 5000th store updates the threshold
+    const int numStores = 5000;
+    std::vector<float> samples (50 * numStores);
+    Random random (3);
+
+    for (int i = 0; i < (int) samples.size(); i++)
+    {
+        const float scale = (i < (int) samples.size() / 2) ? 10.0f : 30.0f;
+        samples[i] = scale * (random.nextFloat() + random.nextFloat() + random.nextFloat() - 1.5f);
+    }
+
+    for (float sample : samples)
+        thresholder.checkSample (0, sample);
+
+    std::vector<float> stored;
+
+    for (int k = numStores - 4000 + 1; k <= numStores; k++)
+        stored.push_back (std::abs (samples[50 * k - 1]) / 0.6745f);
+
+    std::sort (stored.begin(), stored.end());
+
+    const float expected = -4.0f * stored[stored.size() / 2];
+
+    EXPECT_NEAR (thresholder.getThresholds()[0], expected, -0.03f * expected);
+}
+
+/*
+Single-electrode thresholders created for consecutive channels update their
+thresholds in different blocks rather than all at once.
+*/
+TEST (SpikeDetectorThresholderTests, DynamicUpdatesAreSpreadOverBlocks)
+{
+    const int numElectrodes = 64;
+    const int blockSize = 1000;
+
+    OwnedArray<DynamicThresholder> thresholders;
+    Array<float> previous;
+
+    for (int i = 0; i < numElectrodes; i++)
+    {
+        thresholders.add (new DynamicThresholder (1, i));
+
+        // far enough below the noise that nothing crosses
+        thresholders[i]->setThreshold (0, 100.0f);
+        previous.add (thresholders[i]->getThresholds()[0]);
+    }
+
+    std::vector<float> block (blockSize);
+    const float* channels[1] = { block.data() };
+    const bool active[1] = { true };
+    Random random (5);
+
+    int totalUpdates = 0;
+    int mostUpdatesInOneBlock = 0;
+
+    for (int b = 0; b < 1000; b++)
+    {
+        for (auto& sample : block)
+            sample = 20.0f * (random.nextFloat() - 0.5f);
+
+        int updates = 0;
+
+        for (int i = 0; i < numElectrodes; i++)
+        {
+            int channel = -1;
+            ASSERT_EQ (thresholders[i]->findCrossing (channels, active, 1, 0, blockSize, channel), blockSize);
+
+            if (thresholders[i]->getThresholds()[0] != previous[i])
+            {
+                previous.set (i, thresholders[i]->getThresholds()[0]);
+                updates++;
+            }
+        }
+
+        totalUpdates += updates;
+        mostUpdatesInOneBlock = jmax (mostUpdatesInOneBlock, updates);
+    }
+
+    // each block stores 20 samples per electrode, so about 5 of 64 update per block
+    EXPECT_GT (totalUpdates, numElectrodes * 10);
+    EXPECT_LE (mostUpdatesInOneBlock, numElectrodes / 4);
+}
@@ -23,15 +23,32 @@
 
 #include "DataBuffer.h"
 
+#if JUCE_USE_SSE_INTRINSICS
+#include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+#define DATA_BUFFER_USE_NEON_64 1
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+/** Timestamp of the sample at offset within a block, spacing the block's samples evenly */
+double interpolateTimestamp (double firstTimestamp, double lastTimestamp, int offset, int numSamples)
+{
+    if (numSamples <= 1 || offset == 0)
+        return firstTimestamp;
+
+    return firstTimestamp + (lastTimestamp - firstTimestamp) * offset / (numSamples - 1);
+}
+} // namespace
+
 DataBuffer::DataBuffer (int chans, int size)
-    : abstractFifo (size), buffer (chans, size), numChans (chans)
+    : abstractFifo (size), buffer (chans, size), blockFifo (size), eventFifo (size), numChans (chans)
 {
-    sampleNumberBuffer.malloc (size);
-    timestampBuffer.malloc (size);
-    eventCodeBuffer.malloc (size);
+    blockBuffer.malloc (size);
+    eventBuffer.malloc (size);
 
-    lastSampleNumber = 0;
-    lastTimestamp = -1.0;
+    clear();
 }
 
 DataBuffer::~DataBuffer()
@@ -42,6 +59,15 @@ void DataBuffer::clear()
 {
     buffer.clear();
     abstractFifo.reset();
+    blockFifo.reset();
+    eventFifo.reset();
+
+    samplesWritten = 0;
+    lastWrittenEventCode = 0;
+
+    samplesRead = 0;
+    headBlockOffset = 0;
+    lastReadEventCode = 0;
 
     lastSampleNumber = 0;
     lastTimestamp = -1.0;
@@ -52,15 +78,15 @@ void DataBuffer::resize (int chans, int size)
     buffer.setSize (chans, size);
 
     abstractFifo.setTotalSize (size);
+    blockFifo.setTotalSize (size);
+    eventFifo.setTotalSize (size);
 
-    sampleNumberBuffer.malloc (size);
-    timestampBuffer.malloc (size);
-    eventCodeBuffer.malloc (size);
-
-    lastSampleNumber = 0;
-    lastTimestamp = -1.0;
+    blockBuffer.malloc (size);
+    eventBuffer.malloc (size);
 
     numChans = chans;
+
+    clear();
 }
 
 int DataBuffer::addToBuffer (float* data,
@@ -69,60 +95,277 @@ int DataBuffer::addToBuffer (float* data,
                              uint64* eventCodes,
                              int numItems)
 {
+    const WriteRegion region = prepareWrite (numItems);
+    const int numWritten = region.blockSize1 + region.blockSize2;
+
+    if (numWritten == 0)
+        return 0;
+
+    writeEventCodes (eventCodes, numWritten);
+
+    return writeBlock (data, numItems, region, { sampleNumbers[0], timestamps[0], timestamps[numWritten - 1], numWritten });
+}
+
+int DataBuffer::addToBuffer (const float* data,
+                             int64 firstSampleNumber,
+                             double firstTimestamp,
+                             double lastTimestamp_,
+                             uint64 eventCode,
+                             int numItems)
+{
+    const EventCodeChange change { 0, eventCode };
+
+    return addToBuffer (data, firstSampleNumber, firstTimestamp, lastTimestamp_, &change, 1, numItems);
+}
+
+int DataBuffer::addToBuffer (const float* data,
+                             int64 firstSampleNumber,
+                             double firstTimestamp,
+                             double lastTimestamp_,
+                             const EventCodeChange* eventCodeChanges,
+                             int numEventCodeChanges,
+                             int numItems)
+{
+    const WriteRegion region = prepareWrite (numItems);
+    const int numWritten = region.blockSize1 + region.blockSize2;
+
+    if (numWritten == 0)
+        return 0;
+
+    writeEventCodeChanges (eventCodeChanges, numEventCodeChanges, numWritten);
+
+    const double lastWrittenTimestamp = interpolateTimestamp (firstTimestamp, lastTimestamp_, numWritten - 1, numItems);
+
+    return writeBlock (data, numItems, region, { firstSampleNumber, firstTimestamp, lastWrittenTimestamp, numWritten });
+}
+
+DataBuffer::WriteRegion DataBuffer::prepareWrite (int numItems)
+{
+    WriteRegion region;
+    abstractFifo.prepareToWrite (numItems, region.startIndex1, region.blockSize1, region.startIndex2, region.blockSize2);
+    return region;
+}
+
+int DataBuffer::writeBlock (const float* data, int numItems, const WriteRegion& region, const BlockInfo& info)
+{
+    for (int chan = 0; chan < numChans; ++chan)
+    {
+        const float* source = data + (size_t) chan * numItems;
+
+        buffer.copyFrom (chan, region.startIndex1, source, region.blockSize1);
+
+        if (region.blockSize2 > 0)
+            buffer.copyFrom (chan, region.startIndex2, source + region.blockSize1, region.blockSize2);
+    }
+
+    // The block fifo holds at most one entry per unread sample, so it has room
+    int blockIndex1, blockCount1, blockIndex2, blockCount2;
+    blockFifo.prepareToWrite (1, blockIndex1, blockCount1, blockIndex2, blockCount2);
+    jassert (blockCount1 == 1);
+
+    blockBuffer[blockIndex1] = info;
+    blockFifo.finishedWrite (1);
+
+    samplesWritten += info.numSamples;
+
+    // Publishing the samples last makes their metadata visible to the reader first
+    abstractFifo.finishedWrite (info.numSamples);
+
+    return info.numSamples;
+}
+
+void DataBuffer::writeEventCodes (const uint64* eventCodes, int numItems)
+{
+    int sample = findEventCodeChange (eventCodes, numItems, lastWrittenEventCode);
+
+    while (sample < numItems)
+    {
+        writeEventCodeChange (sample, eventCodes[sample]);
+        ++sample;
+        sample += findEventCodeChange (eventCodes + sample, numItems - sample, lastWrittenEventCode);
+    }
+}
+
+void DataBuffer::writeEventCodeChanges (const EventCodeChange* changes, int numChanges, int numItems)
+{
+    for (int i = 0; i < numChanges && changes[i].sampleIndex < numItems; ++i)
+    {
+        jassert (i == 0 || changes[i].sampleIndex >= changes[i - 1].sampleIndex);
+
+        // Changes before the block take effect at its first sample, and of several
+        // changes at one sample, only the last takes effect
+        const int sampleIndex = jmax (0, changes[i].sampleIndex);
+
+        if (i + 1 < numChanges && jmax (0, changes[i + 1].sampleIndex) == sampleIndex)
+            continue;
+
+        writeEventCodeChange (sampleIndex, changes[i].eventCode);
+    }
+}
+
+void DataBuffer::writeEventCodeChange (int sampleIndex, uint64 eventCode)
+{
+    if (eventCode == lastWrittenEventCode)
+        return;
+
+    // The event fifo holds at most one entry per unread sample, so it has room
     int startIndex1, blockSize1, startIndex2, blockSize2;
+    eventFifo.prepareToWrite (1, startIndex1, blockSize1, startIndex2, blockSize2);
+    jassert (blockSize1 == 1);
 
-    abstractFifo.prepareToWrite (numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+    eventBuffer[startIndex1] = { samplesWritten + sampleIndex, eventCode };
+    eventFifo.finishedWrite (1);
 
-    int bs[3] = { blockSize1, blockSize2, 0 };
-    int si[2] = { startIndex1, startIndex2 };
-    int cSize = 0;
-    int idx = 0;
+    lastWrittenEventCode = eventCode;
+}
+
+int DataBuffer::findEventCodeChange (const uint64* eventCodes, int numItems, uint64 eventCode)
+{
+    int i = 0;
+
+#if JUCE_USE_SSE_INTRINSICS
+    // SSE2 has no 64-bit compare, but two codes are equal when all four 32-bit halves are
+    const __m128i reference = _mm_set1_epi64x ((long long) eventCode);
 
-    // for each of the dest blocks we can write to...
-    for (int i = 0; bs[i] != 0; ++i)
+    for (; i + 4 <= numItems; i += 4)
     {
-        cSize = bs[i];
-        for (int chan = 0; chan < numChans; ++chan) // write that much, per channel
-        {
-            buffer.copyFrom (chan, // (int destChannel)
-                             si[i], // (int destStartSample)
-                             data + (chan * numItems) + idx, // (const float* source)
-                             cSize); // (int num samples)
-        }
+        const __m128i a = _mm_cmpeq_epi32 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (eventCodes + i)), reference);
+        const __m128i b = _mm_cmpeq_epi32 (_mm_loadu_si128 (reinterpret_cast<const __m128i*> (eventCodes + i + 2)), reference);
+
+        if (_mm_movemask_epi8 (_mm_and_si128 (a, b)) != 0xFFFF)
+            break;
+    }
+#elif DATA_BUFFER_USE_NEON_64
+    const uint64x2_t reference = vdupq_n_u64 (eventCode);
 
-        memcpy (sampleNumberBuffer + si[i], sampleNumbers + idx, (size_t) cSize * sizeof (int64));
-        memcpy (timestampBuffer + si[i], timestamps + idx, (size_t) cSize * sizeof (double));
-        memcpy (eventCodeBuffer + si[i], eventCodes + idx, (size_t) cSize * sizeof (uint64));
+    for (; i + 4 <= numItems; i += 4)
+    {
+        const uint64x2_t a = vceqq_u64 (vld1q_u64 (reinterpret_cast<const uint64_t*> (eventCodes + i)), reference);
+        const uint64x2_t b = vceqq_u64 (vld1q_u64 (reinterpret_cast<const uint64_t*> (eventCodes + i + 2)), reference);
+        const uint64x2_t both = vandq_u64 (a, b);
 
-        idx += cSize;
+        if ((vgetq_lane_u64 (both, 0) & vgetq_lane_u64 (both, 1)) != ~(uint64_t) 0)
+            break;
     }
+#endif
 
-    // finish write
-    abstractFifo.finishedWrite (idx);
+    for (; i < numItems; ++i)
+    {
+        if (eventCodes[i] != eventCode)
+            return i;
+    }
 
-    return idx;
+    return numItems;
 }
 
 int DataBuffer::getNumSamples() const { return abstractFifo.getNumReady(); }
 
-int DataBuffer::readAllFromBuffer (AudioBuffer<float>& data,
-                                   int64* blockSampleNumber,
-                                   double* blockTimestamp,
-                                   uint64* eventCodes,
-                                   int maxSize,
-                                   int dstStartChannel,
-                                   int numChannels)
+DataBuffer::ReadSpan DataBuffer::prepareToRead (int maxSize)
 {
-    // check to see if the maximum size is smaller than the total number of available ints
-    int numReady = abstractFifo.getNumReady();
-    int numItems = (maxSize < numReady) ? maxSize : numReady;
+    ReadSpan span;
 
-    int startIndex1, blockSize1, startIndex2, blockSize2;
-    abstractFifo.prepareToRead (numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+    const int numReady = abstractFifo.getNumReady();
+    const int numItems = (maxSize < numReady) ? maxSize : numReady;
+
+    abstractFifo.prepareToRead (numItems, span.startIndex1, span.blockSize1, span.startIndex2, span.blockSize2);
+
+    if (numItems > 0)
+    {
+        int blockIndex1, blockCount1, blockIndex2, blockCount2;
+        blockFifo.prepareToRead (1, blockIndex1, blockCount1, blockIndex2, blockCount2);
+        jassert (blockCount1 == 1);
+
+        const BlockInfo& head = blockBuffer[blockIndex1];
+
+        span.sampleNumber = head.sampleNumber + headBlockOffset;
+        span.timestamp = interpolateTimestamp (head.firstTimestamp, head.lastTimestamp, headBlockOffset, head.numSamples);
+    }
+    else
+    {
+        span.sampleNumber = lastSampleNumber;
+        span.timestamp = lastTimestamp;
+    }
+
+    return span;
+}
+
+void DataBuffer::getEventCodes (const ReadSpan& span, uint64* eventCodes) const
+{
+    int sample = 0;
+    uint64 code = lastReadEventCode;
+
+    forEachEventCodeChange (span,
+                            [&] (int offset, uint64 nextCode)
+                            {
+                                std::fill (eventCodes + sample, eventCodes + offset, code);
+                                code = nextCode;
+                                sample = offset;
+                            });
+
+    std::fill (eventCodes + sample, eventCodes + span.getNumSamples(), code);
+}
+
+void DataBuffer::finishedRead (const ReadSpan& span)
+{
+    const int numItems = span.getNumSamples();
+
+    if (numItems == 0)
+        return;
+
+    lastSampleNumber = span.sampleNumber;
+    lastTimestamp = span.timestamp;
+
+    // Release metadata before samples, so the writer never finds its fifos fuller than the ring
+    int remaining = numItems;
+
+    while (remaining > 0)
+    {
+        int blockIndex1, blockCount1, blockIndex2, blockCount2;
+        blockFifo.prepareToRead (1, blockIndex1, blockCount1, blockIndex2, blockCount2);
+        jassert (blockCount1 == 1);
+
+        const int available = blockBuffer[blockIndex1].numSamples - headBlockOffset;
 
+        if (remaining < available)
+        {
+            headBlockOffset += remaining;
+            break;
+        }
+
+        remaining -= available;
+        headBlockOffset = 0;
+        blockFifo.finishedRead (1);
+    }
+
+    const int64 endPosition = samplesRead + numItems;
+
+    while (eventFifo.getNumReady() > 0)
+    {
+        int startIndex1, blockSize1, startIndex2, blockSize2;
+        eventFifo.prepareToRead (1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+        const EventChange& change = eventBuffer[startIndex1];
+
+        if (change.position >= endPosition)
+            break;
+
+        lastReadEventCode = change.eventCode;
+        eventFifo.finishedRead (1);
+    }
+
+    samplesRead = endPosition;
+
+    abstractFifo.finishedRead (numItems);
+}
+
+void DataBuffer::copySpan (const ReadSpan& span,
+                           AudioBuffer<float>& data,
+                           int dstStartChannel,
+                           int numChannels) const
+{
     int channelsToCopy = numChannels < 0 ? data.getNumChannels() : numChannels;
 
-    if (blockSize1 > 0)
+    if (span.blockSize1 > 0)
     {
         for (int chan = 0; chan < channelsToCopy; ++chan)
         {
@@ -130,46 +373,42 @@ int DataBuffer::readAllFromBuffer (AudioBuffer<float>& data,
                            0, // destStartSample
                            buffer, // source
                            chan, // sourceChannel
-                           startIndex1, // sourceStartSample
-                           blockSize1); // numSamples
+                           span.startIndex1, // sourceStartSample
+                           span.blockSize1); // numSamples
         }
-
-        memcpy (blockSampleNumber, sampleNumberBuffer + startIndex1, 8);
-        memcpy (blockTimestamp, timestampBuffer + startIndex1, 8);
-        memcpy (eventCodes, eventCodeBuffer + startIndex1, blockSize1 * 8);
-    }
-    else
-    {
-        // std::cout << "NO SAMPLES" << std::endl;
-        memcpy (blockSampleNumber, &lastSampleNumber, 8);
-        memcpy (blockTimestamp, &lastTimestamp, 8);
     }
 
-    if (blockSize2 > 0)
+    if (span.blockSize2 > 0)
     {
         for (int chan = 0; chan < channelsToCopy; ++chan)
         {
             data.copyFrom (dstStartChannel + chan, // destChan
-                           blockSize1, // destStartSample
+                           span.blockSize1, // destStartSample
                            buffer, // source
                            chan, // sourceChannel
-                           startIndex2, // sourceStartSample
-                           blockSize2); // numSamples
+                           span.startIndex2, // sourceStartSample
+                           span.blockSize2); // numSamples
         }
-        memcpy (eventCodes + blockSize1, eventCodeBuffer + startIndex2, blockSize2 * 8);
     }
+}
 
-    // std::cout << "START SAMPLE FOR READ: " << *blockSampleNumber << std::endl;
+int DataBuffer::readAllFromBuffer (AudioBuffer<float>& data,
+                                   int64* blockSampleNumber,
+                                   double* blockTimestamp,
+                                   uint64* eventCodes,
+                                   int maxSize,
+                                   int dstStartChannel,
+                                   int numChannels)
+{
+    const ReadSpan span = prepareToRead (maxSize);
 
-    if (numItems > 0)
-    {
-        lastSampleNumber = *blockSampleNumber;
-        lastTimestamp = *blockTimestamp;
+    copySpan (span, data, dstStartChannel, numChannels);
 
-        // std::cout << "Updating last sample number: " << lastSampleNumber << std::endl;
-    }
+    *blockSampleNumber = span.sampleNumber;
+    *blockTimestamp = span.timestamp;
 
-    abstractFifo.finishedRead (numItems);
+    getEventCodes (span, eventCodes);
+    finishedRead (span);
 
-    return numItems;
+    return span.getNumSamples();
 }
@@ -30,6 +30,15 @@
 /**
     Manages reading and writing data to a circular buffer.
 
+    Samples are stored per channel in a ring that readers can access in
+    place. Sample numbers and timestamps are kept once per written block,
+    and event codes only where they change, so metadata costs scale with
+    the number of writes and TTL transitions rather than with the number
+    of samples.
+
+    One thread may write while another reads, without locks or
+    allocation; resize() and clear() must not overlap either.
+
     See @DataThread
 */
 class PLUGIN_API DataBuffer
@@ -44,8 +53,21 @@ public:
     /** Clears the buffer.*/
     void clear();
 
+    /** An event code taking effect at a sample within a block */
+    struct EventCodeChange
+    {
+        /** Index of the sample within the block */
+        int sampleIndex;
+
+        /** Event code from that sample on */
+        uint64 eventCode;
+    };
+
     /** Add an array of floats to the buffer.
 
+        Only the first sample number, the first and last timestamps, and the
+        positions where the event code changes are kept.
+
         @param data The data in channel-major order. Length is `numItems` * numChans.
         @param sampleNumbers  Array of sample numbers (integers). Same length as numItems.
         @param timestamps  Array of timestamps (in seconds) (double). Same length as numItems.
@@ -61,10 +83,64 @@ public:
                      uint64* eventCodes,
                      int numItems);
 
+    /** Add a block of consecutively numbered samples to the buffer.
+
+        @param data The data in channel-major order. Length is `numItems` * numChans.
+        @param firstSampleNumber Sample number of the first sample.
+        @param firstTimestamp Timestamp of the first sample (in seconds).
+        @param lastTimestamp Timestamp of the last sample (in seconds); samples in
+        between are spaced evenly.
+        @param eventCode Event code held for the whole block.
+        @param numItems Total number of samples per channel.
+
+        @return The number of items actually written. May be less than numItems if
+        the buffer doesn't have space.
+    */
+    int addToBuffer (const float* data,
+                     int64 firstSampleNumber,
+                     double firstTimestamp,
+                     double lastTimestamp,
+                     uint64 eventCode,
+                     int numItems);
+
+    /** Add a block of consecutively numbered samples, with its TTL transitions.
+
+        @param data The data in channel-major order. Length is `numItems` * numChans.
+        @param firstSampleNumber Sample number of the first sample.
+        @param firstTimestamp Timestamp of the first sample (in seconds).
+        @param lastTimestamp Timestamp of the last sample (in seconds); samples in
+        between are spaced evenly.
+        @param eventCodeChanges Event codes in order of sampleIndex. The code written
+        last stays in effect until the first change. Changes with a negative
+        sampleIndex take effect at the first sample.
+        @param numEventCodeChanges Number of entries in eventCodeChanges.
+        @param numItems Total number of samples per channel.
+
+        @return The number of items actually written. May be less than numItems if
+        the buffer doesn't have space; changes past the written samples are dropped
+        with them.
+    */
+    int addToBuffer (const float* data,
+                     int64 firstSampleNumber,
+                     double firstTimestamp,
+                     double lastTimestamp,
+                     const EventCodeChange* eventCodeChanges,
+                     int numEventCodeChanges,
+                     int numItems);
+
+    /** Returns the index of the first of numItems event codes that differs from
+        eventCode, or numItems if they all match. Compares several codes at a time.
+    */
+    static int findEventCodeChange (const uint64* eventCodes, int numItems, uint64 eventCode);
+
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples() const;
 
-    /** Copies as many samples as possible from the DataBuffer to an AudioBuffer.*/
+    /** Copies as many samples as possible from the DataBuffer to an AudioBuffer.
+
+        Writes the first sample's number and timestamp, and one event code
+        per sample copied.
+    */
     int readAllFromBuffer (AudioBuffer<float>& data,
                            int64* sampleNumbers,
                            double* timestamps,
@@ -73,16 +149,145 @@ public:
                            int dstStartChannel = 0,
                            int numChannels = -1);
 
+    /** Samples ready to be read in place, in up to two contiguous regions of the ring */
+    struct ReadSpan
+    {
+        int startIndex1 = 0;
+        int blockSize1 = 0;
+        int startIndex2 = 0;
+        int blockSize2 = 0;
+
+        /** Sample number of the first sample */
+        int64 sampleNumber = 0;
+
+        /** Timestamp of the first sample (in seconds) */
+        double timestamp = -1.0;
+
+        int getNumSamples() const { return blockSize1 + blockSize2; }
+    };
+
+    /** Returns up to maxSize samples to read in place with getReadPointer().
+        Nothing is consumed until finishedRead() is called with the same span.
+        With no samples ready, the span carries the last sample number and
+        timestamp read.
+    */
+    ReadSpan prepareToRead (int maxSize);
+
+    /** Returns a channel's samples starting at a ring index taken from a ReadSpan */
+    const float* getReadPointer (int channel, int ringIndex) const { return buffer.getReadPointer (channel, ringIndex); }
+
+    /** Copies a span's samples to the start of an AudioBuffer */
+    void copySpan (const ReadSpan& span,
+                   AudioBuffer<float>& data,
+                   int dstStartChannel = 0,
+                   int numChannels = -1) const;
+
+    /** Calls fn (sampleOffset, eventCode) with the event code in effect at the
+        start of a span, then at each sample in the span where it changes.
+        Costs one call per change, however long the span is.
+    */
+    template <typename Fn>
+    void forEachEventCodeChange (const ReadSpan& span, Fn&& fn) const
+    {
+        const int numItems = span.getNumSamples();
+
+        if (numItems == 0)
+            return;
+
+        int startIndex1, blockSize1, startIndex2, blockSize2;
+        eventFifo.prepareToRead (eventFifo.getNumReady(), startIndex1, blockSize1, startIndex2, blockSize2);
+
+        const int numChanges = blockSize1 + blockSize2;
+
+        auto getChange = [&] (int i) -> const EventChange&
+        { return eventBuffer[i < blockSize1 ? startIndex1 + i : startIndex2 + i - blockSize1]; };
+
+        // The code carried over from the last read holds until the first change
+        if (numChanges == 0 || getChange (0).position != samplesRead)
+            fn (0, lastReadEventCode);
+
+        for (int i = 0; i < numChanges; ++i)
+        {
+            const EventChange& change = getChange (i);
+            const int64 offset = change.position - samplesRead;
+
+            if (offset >= numItems)
+                break;
+
+            fn ((int) offset, change.eventCode);
+        }
+    }
+
+    /** Writes the event code of each sample in a span to eventCodes */
+    void getEventCodes (const ReadSpan& span, uint64* eventCodes) const;
+
+    /** Releases a span's samples and metadata back to the writer */
+    void finishedRead (const ReadSpan& span);
+
     /** Resizes the data buffer */
     void resize (int chans, int size);
 
 private:
+    /** Metadata for one write */
+    struct BlockInfo
+    {
+        int64 sampleNumber;
+        double firstTimestamp;
+        double lastTimestamp;
+        int numSamples;
+    };
+
+    /** An event code taking effect at a sample, counted from the last clear() */
+    struct EventChange
+    {
+        int64 position;
+        uint64 eventCode;
+    };
+
+    /** Where in the sample buffer a write goes */
+    struct WriteRegion
+    {
+        int startIndex1;
+        int blockSize1;
+        int startIndex2;
+        int blockSize2;
+    };
+
+    /** Finds room for up to numItems samples, without committing them */
+    WriteRegion prepareWrite (int numItems);
+
+    /** Copies a block's samples into the region from prepareWrite() and records its
+        metadata; returns the number written */
+    int writeBlock (const float* data, int numItems, const WriteRegion& region, const BlockInfo& info);
+
+    /** Records event code changes for the samples about to be committed */
+    void writeEventCodes (const uint64* eventCodes, int numItems);
+
+    /** Records sparse event code changes for the first numItems samples about to be committed */
+    void writeEventCodeChanges (const EventCodeChange* changes, int numChanges, int numItems);
+
+    /** Records an event code taking effect at a sample of the write, if it differs from the last */
+    void writeEventCodeChange (int sampleIndex, uint64 eventCode);
+
     AbstractFifo abstractFifo;
     AudioBuffer<float> buffer;
 
-    HeapBlock<int64> sampleNumberBuffer;
-    HeapBlock<double> timestampBuffer;
-    HeapBlock<uint64> eventCodeBuffer;
+    /** Written blocks with unread samples, oldest first */
+    AbstractFifo blockFifo;
+    HeapBlock<BlockInfo> blockBuffer;
+
+    /** Event code changes at unread samples, oldest first */
+    AbstractFifo eventFifo;
+    HeapBlock<EventChange> eventBuffer;
+
+    // Writer state
+    int64 samplesWritten;
+    uint64 lastWrittenEventCode;
+
+    // Reader state
+    int64 samplesRead;
+    int headBlockOffset;
+    uint64 lastReadEventCode;
 
     int64 lastSampleNumber;
     double lastTimestamp;
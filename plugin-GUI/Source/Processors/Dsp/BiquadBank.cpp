@@ -0,0 +1,492 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BiquadBank.h"
+#include "MathSupplement.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DSP_BIQUADBANK_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DSP_BIQUADBANK_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Dsp
+{
+
+namespace
+{
+
+// Samples per channel moved through the transposed tile at a time
+const int TileSamples = 64;
+
+// A vector of doubles with the widest type available. The kernels are written
+// once against these few operations; without SIMD the compiler gets a plain loop.
+#if defined(__AVX__)
+struct Vec
+{
+    static const int Width = 4;
+    __m256d v;
+
+    static Vec load (const double* p) { return { _mm256_loadu_pd (p) }; }
+    static Vec set (double x) { return { _mm256_set1_pd (x) }; }
+    void store (double* p) const { _mm256_storeu_pd (p, v); }
+
+    friend Vec operator+ (Vec a, Vec b) { return { _mm256_add_pd (a.v, b.v) }; }
+    friend Vec operator- (Vec a, Vec b) { return { _mm256_sub_pd (a.v, b.v) }; }
+    friend Vec operator* (Vec a, Vec b) { return { _mm256_mul_pd (a.v, b.v) }; }
+};
+#elif DSP_BIQUADBANK_USE_SSE2
+struct Vec
+{
+    static const int Width = 2;
+    __m128d v;
+
+    static Vec load (const double* p) { return { _mm_loadu_pd (p) }; }
+    static Vec set (double x) { return { _mm_set1_pd (x) }; }
+    void store (double* p) const { _mm_storeu_pd (p, v); }
+
+    friend Vec operator+ (Vec a, Vec b) { return { _mm_add_pd (a.v, b.v) }; }
+    friend Vec operator- (Vec a, Vec b) { return { _mm_sub_pd (a.v, b.v) }; }
+    friend Vec operator* (Vec a, Vec b) { return { _mm_mul_pd (a.v, b.v) }; }
+};
+#elif DSP_BIQUADBANK_USE_NEON
+struct Vec
+{
+    static const int Width = 2;
+    float64x2_t v;
+
+    static Vec load (const double* p) { return { vld1q_f64 (p) }; }
+    static Vec set (double x) { return { vdupq_n_f64 (x) }; }
+    void store (double* p) const { vst1q_f64 (p, v); }
+
+    friend Vec operator+ (Vec a, Vec b) { return { vaddq_f64 (a.v, b.v) }; }
+    friend Vec operator- (Vec a, Vec b) { return { vsubq_f64 (a.v, b.v) }; }
+    friend Vec operator* (Vec a, Vec b) { return { vmulq_f64 (a.v, b.v) }; }
+};
+#else
+struct Vec
+{
+    static const int Width = 1;
+    double v;
+
+    static Vec load (const double* p) { return { *p }; }
+    static Vec set (double x) { return { x }; }
+    void store (double* p) const { *p = v; }
+
+    friend Vec operator+ (Vec a, Vec b) { return { a.v + b.v }; }
+    friend Vec operator- (Vec a, Vec b) { return { a.v - b.v }; }
+    friend Vec operator* (Vec a, Vec b) { return { a.v * b.v }; }
+};
+#endif
+
+const int VecsPerGroup = BiquadBank::GroupSize / Vec::Width;
+
+// Runs one Direct Form II stage over a tile of numSamples x GroupSize.
+// The expressions are ordered as in DirectFormII::process1 so the results
+// are identical to the per-channel path. Each sample step updates all the
+// vectors of the group together, so their recurrences overlap in the pipeline.
+void processStage (BiquadBank::GroupStage& s, double* tile, int numSamples, const double* vsa)
+{
+    Vec b0[VecsPerGroup], b1[VecsPerGroup], b2[VecsPerGroup], a1[VecsPerGroup], a2[VecsPerGroup];
+    Vec v1[VecsPerGroup], v2[VecsPerGroup];
+
+    for (int k = 0; k < VecsPerGroup; ++k)
+    {
+        const int lane = k * Vec::Width;
+
+        b0[k] = Vec::load (s.b0 + lane);
+        b1[k] = Vec::load (s.b1 + lane);
+        b2[k] = Vec::load (s.b2 + lane);
+        a1[k] = Vec::load (s.a1 + lane);
+        a2[k] = Vec::load (s.a2 + lane);
+        v1[k] = Vec::load (s.v1 + lane);
+        v2[k] = Vec::load (s.v2 + lane);
+    }
+
+    double* x = tile;
+
+    for (int n = 0; n < numSamples; ++n, x += BiquadBank::GroupSize)
+    {
+        const Vec offset = Vec::set (vsa[n]);
+
+        for (int k = 0; k < VecsPerGroup; ++k)
+        {
+            const Vec w = Vec::load (x + k * Vec::Width) - a1[k] * v1[k] - a2[k] * v2[k] + offset;
+            const Vec out = b0[k] * w + b1[k] * v1[k] + b2[k] * v2[k];
+
+            v2[k] = v1[k];
+            v1[k] = w;
+
+            out.store (x + k * Vec::Width);
+        }
+    }
+
+    for (int k = 0; k < VecsPerGroup; ++k)
+    {
+        v1[k].store (s.v1 + k * Vec::Width);
+        v2[k].store (s.v2 + k * Vec::Width);
+    }
+}
+
+// As processStage, but first moves the coefficients 1 / remaining of the way
+// to the target before each of the first numSamples samples, in the same
+// order as Biquad::smoothProcess1. The ramp ends exactly on the target.
+void processStageRamp (BiquadBank::GroupStage& s, const BiquadBank::GroupStage& target, double* tile, int numSamples, int remaining, const double* vsa)
+{
+    Vec b0[VecsPerGroup], b1[VecsPerGroup], b2[VecsPerGroup], a1[VecsPerGroup], a2[VecsPerGroup];
+    Vec db0[VecsPerGroup], db1[VecsPerGroup], db2[VecsPerGroup], da1[VecsPerGroup], da2[VecsPerGroup];
+    Vec v1[VecsPerGroup], v2[VecsPerGroup];
+
+    const Vec t = Vec::set (1. / remaining);
+
+    for (int k = 0; k < VecsPerGroup; ++k)
+    {
+        const int lane = k * Vec::Width;
+
+        b0[k] = Vec::load (s.b0 + lane);
+        b1[k] = Vec::load (s.b1 + lane);
+        b2[k] = Vec::load (s.b2 + lane);
+        a1[k] = Vec::load (s.a1 + lane);
+        a2[k] = Vec::load (s.a2 + lane);
+        v1[k] = Vec::load (s.v1 + lane);
+        v2[k] = Vec::load (s.v2 + lane);
+
+        db0[k] = (Vec::load (target.b0 + lane) - b0[k]) * t;
+        db1[k] = (Vec::load (target.b1 + lane) - b1[k]) * t;
+        db2[k] = (Vec::load (target.b2 + lane) - b2[k]) * t;
+        da1[k] = (Vec::load (target.a1 + lane) - a1[k]) * t;
+        da2[k] = (Vec::load (target.a2 + lane) - a2[k]) * t;
+    }
+
+    double* x = tile;
+
+    for (int n = 0; n < numSamples; ++n, x += BiquadBank::GroupSize)
+    {
+        const Vec offset = Vec::set (vsa[n]);
+
+        for (int k = 0; k < VecsPerGroup; ++k)
+        {
+            a1[k] = a1[k] + da1[k];
+            a2[k] = a2[k] + da2[k];
+            b0[k] = b0[k] + db0[k];
+            b1[k] = b1[k] + db1[k];
+            b2[k] = b2[k] + db2[k];
+
+            const Vec w = Vec::load (x + k * Vec::Width) - a1[k] * v1[k] - a2[k] * v2[k] + offset;
+            const Vec out = b0[k] * w + b1[k] * v1[k] + b2[k] * v2[k];
+
+            v2[k] = v1[k];
+            v1[k] = w;
+
+            out.store (x + k * Vec::Width);
+        }
+    }
+
+    for (int k = 0; k < VecsPerGroup; ++k)
+    {
+        v1[k].store (s.v1 + k * Vec::Width);
+        v2[k].store (s.v2 + k * Vec::Width);
+    }
+
+    if (numSamples == remaining)
+    {
+        // Land on the target rather than on its rounded approximation
+        std::copy (target.b0, target.b0 + BiquadBank::GroupSize, s.b0);
+        std::copy (target.b1, target.b1 + BiquadBank::GroupSize, s.b1);
+        std::copy (target.b2, target.b2 + BiquadBank::GroupSize, s.b2);
+        std::copy (target.a1, target.a1 + BiquadBank::GroupSize, s.a1);
+        std::copy (target.a2, target.a2 + BiquadBank::GroupSize, s.a2);
+    }
+    else
+    {
+        for (int k = 0; k < VecsPerGroup; ++k)
+        {
+            const int lane = k * Vec::Width;
+
+            b0[k].store (s.b0 + lane);
+            b1[k].store (s.b1 + lane);
+            b2[k].store (s.b2 + lane);
+            a1[k].store (s.a1 + lane);
+            a2[k].store (s.a2 + lane);
+        }
+    }
+}
+
+} // namespace
+
+BiquadBank::BiquadBank()
+    : m_numChannels (0), m_numStages (0), m_numGroups (0)
+{
+}
+
+void BiquadBank::setup (int numChannels, int numStages)
+{
+    m_numChannels = numChannels;
+    m_numStages = numStages;
+    m_numGroups = (numChannels + GroupSize - 1) / GroupSize;
+
+    GroupStage identity;
+
+    for (int lane = 0; lane < GroupSize; ++lane)
+    {
+        identity.b0[lane] = 1;
+        identity.b1[lane] = 0;
+        identity.b2[lane] = 0;
+        identity.a1[lane] = 0;
+        identity.a2[lane] = 0;
+        identity.v1[lane] = 0;
+        identity.v2[lane] = 0;
+    }
+
+    m_stages.assign ((size_t) m_numGroups * m_numStages, identity);
+    m_targets = m_stages;
+    m_rampRemaining.assign (m_numGroups, 0);
+    m_vsa.assign (m_numGroups, anti_denormal_vsa);
+}
+
+void BiquadBank::setCoefficients (int channel, int stage, const BiquadBase& biquad)
+{
+    assert (channel >= 0 && channel < m_numChannels);
+    assert (stage >= 0 && stage < m_numStages);
+
+    // The target too, so a later ramp does not move the channel back
+    const int lane = channel % GroupSize;
+
+    for (GroupStage* s : { &getStage (channel / GroupSize, stage), &getTarget (channel / GroupSize, stage) })
+    {
+        s->b0[lane] = biquad.m_b0;
+        s->b1[lane] = biquad.m_b1;
+        s->b2[lane] = biquad.m_b2;
+        s->a1[lane] = biquad.m_a1;
+        s->a2[lane] = biquad.m_a2;
+    }
+}
+
+void BiquadBank::setCoefficients (int channel, const Cascade& cascade)
+{
+    assert (cascade.getNumStages() <= m_numStages);
+
+    // Stages beyond the cascade's own pass samples through
+    Biquad identity;
+    identity.m_a0 = identity.m_b0 = 1;
+    identity.m_a1 = identity.m_a2 = identity.m_b1 = identity.m_b2 = 0;
+
+    for (int stage = 0; stage < m_numStages; ++stage)
+    {
+        if (stage < cascade.getNumStages())
+            setCoefficients (channel, stage, cascade[stage]);
+        else
+            setCoefficients (channel, stage, identity);
+    }
+}
+
+void BiquadBank::setCoefficients (const Cascade& cascade)
+{
+    for (int channel = 0; channel < m_numChannels; ++channel)
+        setCoefficients (channel, cascade);
+}
+
+void BiquadBank::setTargetCoefficients (int channel, int stage, const BiquadBase& biquad)
+{
+    assert (channel >= 0 && channel < m_numChannels);
+    assert (stage >= 0 && stage < m_numStages);
+
+    GroupStage& s = getTarget (channel / GroupSize, stage);
+    const int lane = channel % GroupSize;
+
+    s.b0[lane] = biquad.m_b0;
+    s.b1[lane] = biquad.m_b1;
+    s.b2[lane] = biquad.m_b2;
+    s.a1[lane] = biquad.m_a1;
+    s.a2[lane] = biquad.m_a2;
+}
+
+void BiquadBank::rampToTargets (int numSamples)
+{
+    if (numSamples > 0)
+    {
+        std::fill (m_rampRemaining.begin(), m_rampRemaining.end(), numSamples);
+        return;
+    }
+
+    std::fill (m_rampRemaining.begin(), m_rampRemaining.end(), 0);
+
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        GroupStage& s = m_stages[i];
+        const GroupStage& target = m_targets[i];
+
+        std::copy (target.b0, target.b0 + GroupSize, s.b0);
+        std::copy (target.b1, target.b1 + GroupSize, s.b1);
+        std::copy (target.b2, target.b2 + GroupSize, s.b2);
+        std::copy (target.a1, target.a1 + GroupSize, s.a1);
+        std::copy (target.a2, target.a2 + GroupSize, s.a2);
+    }
+}
+
+void BiquadBank::reset()
+{
+    for (auto& s : m_stages)
+    {
+        std::fill (s.v1, s.v1 + GroupSize, 0.0);
+        std::fill (s.v2, s.v2 + GroupSize, 0.0);
+    }
+
+    std::fill (m_vsa.begin(), m_vsa.end(), anti_denormal_vsa);
+}
+
+void BiquadBank::process (int numSamples, float* const* channels, int firstChannel, int numChannels)
+{
+    processGroups (numSamples, channels, firstChannel, numChannels);
+}
+
+void BiquadBank::process (int numSamples, double* const* channels, int firstChannel, int numChannels)
+{
+    processGroups (numSamples, channels, firstChannel, numChannels);
+}
+
+template <typename Sample>
+void BiquadBank::processGroups (int numSamples, Sample* const* channels, int firstChannel, int numChannels)
+{
+    assert (firstChannel % GroupSize == 0);
+
+    if (numChannels < 0)
+        numChannels = m_numChannels - firstChannel;
+
+    assert (firstChannel + numChannels <= m_numChannels);
+
+    alignas (32) double tile[TileSamples * GroupSize];
+    double vsa[TileSamples];
+
+    for (int first = 0; first < numChannels; first += GroupSize)
+    {
+        const int group = (firstChannel + first) / GroupSize;
+        const int lanes = std::min (GroupSize, numChannels - first);
+        Sample* const* groupChannels = channels + first;
+
+        // Channels that are missing or skipped keep their state
+        double savedV1[GroupSize];
+        double savedV2[GroupSize];
+        bool skipped[GroupSize];
+        bool anySkipped = false;
+        bool allSkipped = true;
+
+        for (int lane = 0; lane < GroupSize; ++lane)
+        {
+            skipped[lane] = lane >= lanes || groupChannels[lane] == nullptr;
+            anySkipped = anySkipped || skipped[lane];
+            allSkipped = allSkipped && skipped[lane];
+        }
+
+        if (allSkipped)
+            continue;
+
+        for (int n0 = 0; n0 < numSamples; n0 += TileSamples)
+        {
+            const int count = std::min (TileSamples, numSamples - n0);
+
+            // Transpose the group's channels into the tile
+            for (int lane = 0; lane < GroupSize; ++lane)
+            {
+                double* t = tile + lane;
+
+                if (skipped[lane])
+                {
+                    for (int n = 0; n < count; ++n, t += GroupSize)
+                        *t = 0;
+                }
+                else
+                {
+                    const Sample* src = groupChannels[lane] + n0;
+
+                    for (int n = 0; n < count; ++n, t += GroupSize)
+                        *t = src[n];
+                }
+            }
+
+            // Only the first stage gets the alternating anti-denormal offset
+            double v = m_vsa[group];
+            for (int n = 0; n < count; ++n)
+                vsa[n] = v = -v;
+            m_vsa[group] = v;
+
+            // Samples of this tile that still move the coefficients to their targets
+            const int remaining = m_rampRemaining[group];
+            const int ramp = std::min (count, remaining);
+
+            for (int stage = 0; stage < m_numStages; ++stage)
+            {
+                GroupStage& s = getStage (group, stage);
+
+                if (anySkipped)
+                {
+                    std::copy (s.v1, s.v1 + GroupSize, savedV1);
+                    std::copy (s.v2, s.v2 + GroupSize, savedV2);
+                }
+
+                if (ramp > 0)
+                    processStageRamp (s, getTarget (group, stage), tile, ramp, remaining, vsa);
+
+                processStage (s, tile + ramp * GroupSize, count - ramp, vsa + ramp);
+
+                if (anySkipped)
+                {
+                    for (int lane = 0; lane < GroupSize; ++lane)
+                    {
+                        if (skipped[lane])
+                        {
+                            s.v1[lane] = savedV1[lane];
+                            s.v2[lane] = savedV2[lane];
+                        }
+                    }
+                }
+
+                if (stage == 0)
+                    std::fill (vsa, vsa + count, 0.0);
+            }
+
+            m_rampRemaining[group] = remaining - ramp;
+
+            // And back out to the channels
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                if (skipped[lane])
+                    continue;
+
+                Sample* dest = groupChannels[lane] + n0;
+                const double* t = tile + lane;
+
+                for (int n = 0; n < count; ++n, t += GroupSize)
+                    dest[n] = static_cast<Sample> (*t);
+            }
+        }
+    }
+}
+
+} // namespace Dsp
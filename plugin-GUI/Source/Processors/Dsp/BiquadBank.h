@@ -0,0 +1,150 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DSPFILTERS_BIQUADBANK_H
+#define DSPFILTERS_BIQUADBANK_H
+
+#include "Biquad.h"
+#include "Cascade.h"
+#include "Common.h"
+
+namespace Dsp
+{
+
+/*
+ * BiquadBank
+ *
+ * Runs a cascade of second order sections over many channels at once.
+ *
+ * Channels are split into groups of GroupSize. The coefficients and
+ * Direct Form II state of every channel in a group are stored side by
+ * side (structure of arrays), so one step of the cascade advances the
+ * whole group with vector instructions (AVX, SSE2 or NEON) instead of
+ * one channel at a time. Samples are moved through a small transposed
+ * tile so both the channel buffers and the state stay in cache.
+ *
+ * Every channel may have its own coefficients. The arithmetic matches
+ * Cascade processed with DirectFormII state, so a channel gives the same
+ * output here as through a FilterDesign or SmoothedFilterDesign.
+ *
+ * setCoefficients() changes coefficients at once. To change them while
+ * filtering without a click, set targets with setTargetCoefficients()
+ * and call rampToTargets() between blocks: the coefficients then move
+ * linearly to the targets over the next samples processed, as
+ * Biquad::smoothProcess1 does. Every point on the way between two stable
+ * second order sections is itself stable.
+ *
+ */
+class PLUGIN_API BiquadBank
+{
+public:
+    // Channels per group: process() ranges must start on a multiple of this
+    static const int GroupSize = 8;
+
+    BiquadBank();
+
+    // Sizes the bank and clears its state; every stage starts as a pass-through
+    void setup (int numChannels, int numStages);
+
+    int getNumChannels() const
+    {
+        return m_numChannels;
+    }
+
+    int getNumStages() const
+    {
+        return m_numStages;
+    }
+
+    // Copies one stage's coefficients into a channel
+    void setCoefficients (int channel, int stage, const BiquadBase& biquad);
+
+    // Copies a designed cascade (e.g. Butterworth::BandPass) into a channel;
+    // stages beyond the cascade's own pass samples through
+    void setCoefficients (int channel, const Cascade& cascade);
+
+    // Copies a designed cascade into every channel
+    void setCoefficients (const Cascade& cascade);
+
+    // Sets the coefficients one stage of a channel moves to on the next rampToTargets()
+    void setTargetCoefficients (int channel, int stage, const BiquadBase& biquad);
+
+    // Starts moving every channel from its current coefficients to its targets
+    // over the next numSamples samples processed; numSamples <= 0 jumps there.
+    // Must not be called while process() is running.
+    void rampToTargets (int numSamples);
+
+    // Clears the state of every channel
+    void reset();
+
+    // Filters numChannels buffers in place, where channels[i] belongs to
+    // bank channel firstChannel + i. A null pointer leaves that channel's
+    // state untouched. firstChannel must be a multiple of GroupSize.
+    void process (int numSamples, float* const* channels, int firstChannel = 0, int numChannels = -1);
+    void process (int numSamples, double* const* channels, int firstChannel = 0, int numChannels = -1);
+
+    // One stage for one group, GroupSize lanes of each coefficient and state
+    struct GroupStage
+    {
+        double b0[GroupSize];
+        double b1[GroupSize];
+        double b2[GroupSize];
+        double a1[GroupSize];
+        double a2[GroupSize];
+        double v1[GroupSize];
+        double v2[GroupSize];
+    };
+
+private:
+    template <typename Sample>
+    void processGroups (int numSamples, Sample* const* channels, int firstChannel, int numChannels);
+
+    GroupStage& getStage (int group, int stage)
+    {
+        return m_stages[(size_t) group * m_numStages + stage];
+    }
+
+    GroupStage& getTarget (int group, int stage)
+    {
+        return m_targets[(size_t) group * m_numStages + stage];
+    }
+
+    int m_numChannels;
+    int m_numStages;
+    int m_numGroups;
+
+    std::vector<GroupStage> m_stages;
+
+    // Coefficients each stage is ramping to (the state fields are unused)
+    std::vector<GroupStage> m_targets;
+
+    // Samples left in each group's ramp to its targets
+    std::vector<int> m_rampRemaining;
+
+    // Anti-denormal offset for the next sample of each group, as DenormalPrevention
+    std::vector<double> m_vsa;
+};
+
+} // namespace Dsp
+
+#endif
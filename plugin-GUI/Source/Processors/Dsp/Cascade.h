@@ -104,7 +104,7 @@ public:
         return m_numStages;
     }
 
-    const Stage& operator[] (int index)
+    const Stage& operator[] (int index) const
     {
         assert (index >= 0 && index <= m_numStages);
         return m_stageArray[index];
@@ -43,6 +43,7 @@ THE SOFTWARE.
 #include "Common.h"
 
 #include "Biquad.h"
+#include "BiquadBank.h"
 #include "Cascade.h"
 #include "Filter.h"
 #include "PoleFilter.h"
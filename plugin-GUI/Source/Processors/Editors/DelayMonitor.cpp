@@ -40,6 +40,11 @@ void DelayMonitor::setDelay (float delayMs)
     delay = delayMs;
 }
 
+void DelayMonitor::setParallelEfficiency (float efficiency)
+{
+    parallelEfficiency = efficiency;
+}
+
 void DelayMonitor::setEnabled (bool state)
 {
     isEnabled = state;
@@ -72,6 +77,15 @@ void DelayMonitor::paint (Graphics& g)
     g.setColour (findColour (ThemeColours::defaultText));
     g.setFont (FontOptions ("Fira Sans", "SemiBold", 12));
     g.drawText (String (delay, 2) + " ms", 0, 0, 60, 20, Justification::centredLeft);
+
+    if (parallelEfficiency >= 0.0f)
+    {
+        g.setColour (findColour (ThemeColours::defaultText).withAlpha (0.3f));
+        g.fillRect (0.0f, (float) getHeight() - 2.0f, (float) getWidth(), 2.0f);
+
+        g.setColour (findColour (ThemeColours::defaultText));
+        g.fillRect (0.0f, (float) getHeight() - 2.0f, (float) getWidth() * parallelEfficiency, 2.0f);
+    }
 }
 
 void DelayMonitor::handleCommandMessage (int commandId)
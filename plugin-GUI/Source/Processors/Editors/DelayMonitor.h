@@ -52,6 +52,10 @@ public:
     /** Sets the most recent delay (in ms)*/
     void setDelay (float delayMs);
 
+    /** Sets the fraction of time the processor's worker threads spent working,
+        shown as a bar under the delay; negative hides it */
+    void setParallelEfficiency (float efficiency);
+
     /** Enable or disable this component*/
     void setEnabled (bool isEnabled);
 
@@ -74,6 +78,7 @@ private:
     bool isEnabled;
     Colour colour;
     float delay;
+    float parallelEfficiency = -1.0f;
     bool canRepaint = true;
 };
 
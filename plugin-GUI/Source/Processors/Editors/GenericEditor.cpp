@@ -694,6 +694,15 @@ void GenericEditor::setMeanLatencyMs (uint16 streamId, float latencyMs)
     }
 }
 
+void GenericEditor::setParallelEfficiency (float efficiency)
+{
+    for (auto& entry : delayMonitors)
+    {
+        if (entry.second != nullptr)
+            entry.second->setParallelEfficiency (efficiency);
+    }
+}
+
 bool GenericEditor::getCollapsedState()
 {
     return isCollapsed;
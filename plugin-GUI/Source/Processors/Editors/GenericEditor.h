@@ -274,6 +274,9 @@ public:
     /** Updates the mean latency for a particular data stream (called by LatencyMeter class)*/
     void setMeanLatencyMs (uint16 streamId, float latencyMs);
 
+    /** Updates the parallel efficiency shown with each stream's latency (called by LatencyMeter class)*/
+    void setParallelEfficiency (float efficiency);
+
     /** Returns the total width of the editor in it's current state. */
     virtual int getTotalWidth();
 
@@ -97,12 +97,38 @@ void LatencyMeter::setLatestLatency (std::map<uint16, juce::int64>& processStart
                     latestLatencies[entry.first] = totalLatency;
                 }
             }
+
+            if (efficiencyCount > 0)
+            {
+                const float meanEfficiency = efficiencySum / static_cast<float> (efficiencyCount);
+
+                efficiencySum = 0.0f;
+                efficiencyCount = 0;
+
+                if (! headlessMode)
+                    processor->getEditor()->setParallelEfficiency (meanEfficiency);
+
+                std::lock_guard<std::mutex> lock (latencyMutex);
+                latestEfficiency = meanEfficiency;
+            }
         }
     }
 
     counter++;
 }
 
+void LatencyMeter::addParallelEfficiency (float efficiency)
+{
+    efficiencySum += efficiency;
+    efficiencyCount++;
+}
+
+float LatencyMeter::getParallelEfficiency()
+{
+    std::lock_guard<std::mutex> lock (latencyMutex);
+    return latestEfficiency;
+}
+
 float LatencyMeter::getLatestLatency (uint16 key)
 {
     std::lock_guard<std::mutex> lock (latencyMutex);
@@ -1246,6 +1272,14 @@ uint32 GenericProcessor::getNumSamplesInBlock (uint16 streamId) const
     return numSamplesInBlock.at (streamId);
 }
 
+void GenericProcessor::setNumWorkerThreads (int numThreads)
+{
+    if (numThreads <= 1)
+        workerPool.reset();
+    else if (workerPool == nullptr || workerPool->getNumThreads() != numThreads)
+        workerPool = std::make_unique<WorkerPool> (getName() + " Worker", numThreads);
+}
+
 int64 GenericProcessor::getFirstSampleNumberForBlock (uint16 streamId) const
 {
     return startSamplesForBlock.at (streamId);
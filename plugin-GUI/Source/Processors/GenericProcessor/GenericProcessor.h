@@ -27,6 +27,7 @@
 #include <JuceHeader.h>
 
 #include "GenericProcessorBase.h"
+#include "WorkerPool.h"
 
 #include "../../CoreServices.h"
 #include "../../Processors/Dsp/LinearSmoothedValueAtomic.h"
@@ -85,9 +86,19 @@ public:
     /** Updates the available data streams */
     void update(const Array<const DataStream*>& dataStreams);
 
+    /** Records the parallel efficiency of one block's parallelFor() call */
+    void addParallelEfficiency (float efficiency);
+
+    /** Returns the mean parallel efficiency, or -1 if the processor does not use worker threads */
+    float getParallelEfficiency();
+
 private:
     int counter;
 
+    float efficiencySum = 0.0f;
+    int efficiencyCount = 0;
+    float latestEfficiency = -1.0f;
+
     std::map<uint16, std::vector<int>> latencies;
     std::map<uint16, float> latestLatencies;
     GenericProcessor* processor;
@@ -595,6 +606,10 @@ public:
     /** Returns the most recent latency measurement for a given stream in this processor */
     double getLatency (uint16 streamId) const { return latencyMeter->getLatestLatency (streamId); }
 
+    /** Returns the mean fraction of parallelFor() time the worker threads spent working,
+        or -1 if this processor does not use worker threads */
+    float getParallelEfficiency() const { return latencyMeter->getParallelEfficiency(); }
+
     /** Returns the plugin specific recording directory derived from the global recording path */
     File getPluginRecordingDirectory();
 
@@ -608,6 +623,40 @@ protected:
     /** Used to get the number of samples available in a current block, for a given stream */
     uint32 getNumSamplesInBlock (uint16 streamId) const;
 
+    // --------------------------------------------
+    //     WORKER THREADS
+    // --------------------------------------------
+
+    /** Sets how many threads parallelFor() spreads work over, including the processing thread.
+        Must not be called while process() may be running (e.g. from a parameter that is
+        disabled during acquisition). */
+    void setNumWorkerThreads (int numThreads);
+
+    /** Returns the number of threads used by parallelFor() */
+    int getNumWorkerThreads() const { return workerPool != nullptr ? workerPool->getNumThreads() : 1; }
+
+    /** Calls task (partition) for every partition in [0, numPartitions), spread over
+        the processor's worker threads, and returns once all of them have finished.
+
+        Partition p runs on the same thread from block to block unless that thread
+        falls behind, so per-channel state stays in one core's cache. Does not
+        allocate, so it can be called from process(). The block's parallel
+        efficiency is reported with the processor's latency. */
+    template <typename Task>
+    void parallelFor (int numPartitions, Task&& task)
+    {
+        if (workerPool == nullptr)
+        {
+            for (int p = 0; p < numPartitions; p++)
+                task (p);
+
+            return;
+        }
+
+        workerPool->run (numPartitions, task);
+        latencyMeter->addParallelEfficiency (workerPool->getLastEfficiency());
+    }
+
     /** Used to get the current sample number for a given stream */
     int64 getFirstSampleNumberForBlock (uint16 streamId) const;
 
@@ -831,6 +880,8 @@ private:
 
     std::unique_ptr<LatencyMeter> latencyMeter;
 
+    std::unique_ptr<WorkerPool> workerPool;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GenericProcessor);
 };
 
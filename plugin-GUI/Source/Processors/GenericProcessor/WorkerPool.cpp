@@ -0,0 +1,250 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "WorkerPool.h"
+
+#include <thread>
+
+#if JUCE_INTEL
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+/** How long a thread spins waiting for the next block, or for the workers to finish, before sleeping */
+const double spinSeconds = 50.0e-6;
+
+inline void cpuRelax()
+{
+#if JUCE_INTEL
+    _mm_pause();
+#elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+    asm volatile ("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/** Spins until condition() is true or the spin time runs out; returns the last result */
+template <typename Condition>
+bool spinUntil (Condition condition)
+{
+    const int64 end = Time::getHighResolutionTicks() + Time::secondsToHighResolutionTicks (spinSeconds);
+
+    do
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            if (condition())
+                return true;
+
+            cpuRelax();
+        }
+    } while (Time::getHighResolutionTicks() < end);
+
+    return condition();
+}
+} // namespace
+
+class WorkerPool::Worker : public Thread
+{
+public:
+    Worker (WorkerPool& pool_, const String& name, int index_, int core_)
+        : Thread (name),
+          pool (pool_),
+          index (index_),
+          core (core_),
+          seenGeneration (pool_.generation.load())
+    {
+    }
+
+    void run() override
+    {
+        if (core >= 0)
+            Thread::setCurrentThreadAffinityMask (1u << core);
+
+        while (! threadShouldExit())
+        {
+            const bool hasWork = spinUntil ([this]
+                                            { return pool.generation.load (std::memory_order_acquire) != seenGeneration
+                                                     || threadShouldExit(); });
+
+            if (! hasWork)
+            {
+                // Sleep until run() or the destructor sees the flag and wakes us
+                parked.store (true);
+
+                if (pool.generation.load() == seenGeneration && ! threadShouldExit())
+                    wake.wait (-1);
+
+                parked.store (false);
+                continue;
+            }
+
+            if (threadShouldExit())
+                break;
+
+            seenGeneration = pool.generation.load (std::memory_order_acquire);
+
+            pool.processPartitions (index, seenGeneration);
+
+            if (pool.remainingWorkers.fetch_sub (1) == 1 && pool.callerParked.load())
+                pool.callerWake.signal();
+        }
+    }
+
+    /** Wakes the thread if it has gone to sleep */
+    void wakeUp()
+    {
+        if (parked.load())
+            wake.signal();
+    }
+
+    /** Asks the thread to exit, waking it if needed */
+    void stop()
+    {
+        signalThreadShouldExit();
+        wake.signal();
+    }
+
+private:
+    WorkerPool& pool;
+    const int index;
+    const int core;
+
+    uint32 seenGeneration;
+
+    std::atomic<bool> parked { false };
+    WaitableEvent wake;
+};
+
+WorkerPool::WorkerPool (const String& name, int numThreads)
+{
+    numThreads = jmax (1, numThreads);
+
+    // Leave the scheduler alone if the workers would share cores
+    const bool pinThreads = numThreads <= SystemStats::getNumCpus() && numThreads <= 32;
+
+    for (int i = 1; i < numThreads; i++)
+    {
+        auto* worker = workers.add (new Worker (*this, name + " " + String (i), i, pinThreads ? i : -1));
+        worker->startThread (Thread::Priority::high);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    for (auto* worker : workers)
+        worker->stop();
+
+    for (auto* worker : workers)
+        worker->waitForThreadToExit (-1);
+}
+
+void WorkerPool::runPartitions (int numPartitions_, void* context, TaskFunction function)
+{
+    if (numPartitions_ <= 0)
+        return;
+
+    if (workers.isEmpty() || numPartitions_ == 1)
+    {
+        for (int p = 0; p < numPartitions_; p++)
+            function (context, p);
+
+        lastEfficiency = 1.0f / (float) getNumThreads();
+        return;
+    }
+
+    if (numPartitions_ > numClaims)
+    {
+        // Only grows, so this allocates on the first few blocks at most
+        claims.reset (new std::atomic<uint32>[numPartitions_]);
+
+        for (int p = 0; p < numPartitions_; p++)
+            claims[p].store (generation.load());
+
+        numClaims = numPartitions_;
+    }
+
+    taskContext = context;
+    taskFunction = function;
+    numPartitions = numPartitions_;
+
+    busyTicks.store (0, std::memory_order_relaxed);
+    remainingWorkers.store (workers.size(), std::memory_order_relaxed);
+
+    const int64 start = Time::getHighResolutionTicks();
+
+    // Publishes the task to the workers
+    const uint32 blockGeneration = generation.fetch_add (1) + 1;
+
+    for (auto* worker : workers)
+        worker->wakeUp();
+
+    processPartitions (0, blockGeneration);
+
+    if (! spinUntil ([this]
+                     { return remainingWorkers.load (std::memory_order_acquire) == 0; }))
+    {
+        callerParked.store (true);
+
+        while (remainingWorkers.load() != 0)
+            callerWake.wait (-1);
+
+        callerParked.store (false);
+    }
+
+    const int64 elapsed = Time::getHighResolutionTicks() - start;
+
+    if (elapsed > 0)
+        lastEfficiency = jlimit (0.0f, 1.0f, (float) busyTicks.load() / ((float) elapsed * (float) getNumThreads()));
+}
+
+void WorkerPool::processPartitions (int thread, uint32 blockGeneration)
+{
+    const int64 start = Time::getHighResolutionTicks();
+    const int numThreads = getNumThreads();
+
+    for (int p = thread; p < numPartitions; p += numThreads)
+    {
+        if (claim (p, blockGeneration))
+            taskFunction (taskContext, p);
+    }
+
+    // Help with whatever the other threads have not started
+    for (int p = 0; p < numPartitions; p++)
+    {
+        if (claim (p, blockGeneration))
+            taskFunction (taskContext, p);
+    }
+
+    busyTicks.fetch_add (Time::getHighResolutionTicks() - start, std::memory_order_relaxed);
+}
+
+bool WorkerPool::claim (int partition, uint32 blockGeneration)
+{
+    std::atomic<uint32>& c = claims[partition];
+
+    return c.load (std::memory_order_relaxed) != blockGeneration
+           && c.exchange (blockGeneration, std::memory_order_acq_rel) != blockGeneration;
+}
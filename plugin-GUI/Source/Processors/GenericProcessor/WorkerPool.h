@@ -0,0 +1,114 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __WORKERPOOL_H_5C3A91E2__
+#define __WORKERPOOL_H_5C3A91E2__
+
+#include <JuceHeader.h>
+
+#include "../PluginManager/OpenEphysPlugin.h"
+
+#include <atomic>
+#include <memory>
+
+/**
+    A fixed set of threads that split one processing block's work between them.
+
+    Work is described as a number of partitions (e.g. ranges of channels) and
+    a task that is called once per partition. The calling thread takes part,
+    and run() returns once every partition has been processed.
+
+    Partition p is offered first to thread p % getNumThreads() on every block,
+    so the same channels (and their filter state) stay on the same core.
+    Threads that finish their own partitions early take any that have not
+    been started yet.
+
+    Workers are pinned to cores when there are enough of them, and stay alive
+    between blocks. A new block is handed over through atomics; workers and
+    the caller spin briefly before sleeping, so back-to-back blocks do not go
+    through the scheduler.
+
+    @see GenericProcessor::parallelFor
+*/
+class PLUGIN_API WorkerPool
+{
+public:
+    /** Creates a pool with numThreads threads in total, including the caller of run() */
+    WorkerPool (const String& name, int numThreads);
+
+    /** Stops the worker threads */
+    ~WorkerPool();
+
+    /** Returns the number of threads that run partitions, including the caller */
+    int getNumThreads() const { return workers.size() + 1; }
+
+    /** Calls task (partition) for every partition in [0, numPartitions) and waits for all of them.
+        Must only be called from one thread at a time. */
+    template <typename Task>
+    void run (int numPartitions, Task& task)
+    {
+        runPartitions (numPartitions, &task, [] (void* context, int partition)
+                       { (*static_cast<Task*> (context)) (partition); });
+    }
+
+    /** Returns the fraction of the last run() the threads spent inside the task,
+        from 1.0 (perfectly balanced) down to 1 / getNumThreads() (serial) */
+    float getLastEfficiency() const { return lastEfficiency; }
+
+private:
+    class Worker;
+
+    typedef void (*TaskFunction) (void*, int);
+
+    /** Hands a block of work to the workers and processes the caller's share */
+    void runPartitions (int numPartitions, void* context, TaskFunction function);
+
+    /** Runs this thread's own partitions, then any that are still unclaimed */
+    void processPartitions (int thread, uint32 generation);
+
+    /** Claims a partition for the given generation; false if another thread has it */
+    bool claim (int partition, uint32 generation);
+
+    OwnedArray<Worker> workers;
+
+    void* taskContext = nullptr;
+    TaskFunction taskFunction = nullptr;
+    int numPartitions = 0;
+
+    // Generation of the block each partition was last claimed for
+    std::unique_ptr<std::atomic<uint32>[]> claims;
+    int numClaims = 0;
+
+    std::atomic<uint32> generation { 0 };
+    std::atomic<int> remainingWorkers { 0 };
+    std::atomic<int64> busyTicks { 0 };
+
+    std::atomic<bool> callerParked { false };
+    WaitableEvent callerWake;
+
+    float lastEfficiency = 1.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool);
+};
+
+#endif // __WORKERPOOL_H_5C3A91E2__
@@ -62,6 +62,7 @@ void BinaryRecording::openFiles (File rootFolder, int experimentNumber, int reco
 {
     m_recordingNum = recordingNumber;
     m_experimentNum = experimentNumber;
+    m_writeFailed = false;
 
     String basepath = rootFolder.getFullPathName() + rootFolder.getSeparatorString() + "experiment" + String (experimentNumber)
                       + File::getSeparatorString() + "recording" + String (recordingNumber + 1) + File::getSeparatorString();
@@ -159,10 +160,14 @@ void BinaryRecording::openFiles (File rootFolder, int experimentNumber, int reco
 
         ScopedPointer<SequentialBlockFile> bFile = new SequentialBlockFile (channelCounts[streamIndex], samplesPerBlock);
 
-        if (bFile->openFile (filename))
-            m_continuousFiles.add (bFile.release());
-        else
-            m_continuousFiles.add (nullptr);
+        {
+            const ScopedLock lock (m_continuousFilesLock);
+
+            if (bFile->openFile (filename))
+                m_continuousFiles.add (bFile.release());
+            else
+                m_continuousFiles.add (nullptr);
+        }
 
         fileJSON->setProperty ("channels", multiStreamJSON.getReference (streamIndex));
 
@@ -477,7 +482,25 @@ void BinaryRecording::createChannelMetadata (const MetadataObject* channel, Dyna
 
 void BinaryRecording::closeFiles()
 {
-    m_continuousFiles.clear();
+    for (auto* file : m_continuousFiles)
+    {
+        if (file == nullptr)
+            continue;
+
+        file->close();
+
+        const BlockFileWriter::Stats stats = file->getWriterStats();
+        LOGD ("Continuous file: wrote ", stats.bytesWritten, " bytes in ", stats.blocksWritten, " blocks at ",
+              stats.getThroughput(), " MB/s; latency mean ", stats.meanLatencyMs, " ms, max ", stats.maxLatencyMs,
+              " ms; max queue ", stats.maxQueueDepth, ", pool ", stats.poolSize, " of ", stats.maxPoolSize, " blocks, full ", stats.poolExhausted,
+              " times, ", stats.bytesDropped, " bytes dropped; direct I/O ", stats.directIO ? "on" : "off", stats.failed ? ", FAILED" : "");
+    }
+
+    {
+        const ScopedLock lock (m_continuousFilesLock);
+        m_lastWriteStats = combineWriteStats();
+        m_continuousFiles.clear();
+    }
     m_eventFiles.clear();
     m_spikeFiles.clear();
 
@@ -550,38 +573,158 @@ void BinaryRecording::writeContinuousData (int writeChannel,
     int fileIndex = m_fileIndexes[writeChannel];
 
     /* Write the data to that file */
-    m_continuousFiles[fileIndex]->writeChannel (
-        m_samplesWritten[writeChannel],
-        m_channelIndexes[writeChannel],
-        m_intBuffer.getData(),
-        size);
+    if (! m_continuousFiles[fileIndex]->writeChannel (
+            m_samplesWritten[writeChannel],
+            m_channelIndexes[writeChannel],
+            m_intBuffer.getData(),
+            size))
+        stopOnWriteFailure (fileIndex);
 
     m_samplesWritten.set (writeChannel, m_samplesWritten[writeChannel] + size);
 
     /* If is first channel in subprocessor */
     if (m_channelIndexes[writeChannel] == 0)
+        writeSampleNumbers (writeChannel, realChannel, fileIndex, timestampBuffer, size);
+}
+
+void BinaryRecording::writeContinuousBlock (int firstWriteChannel,
+                                            const int* realChannels,
+                                            const float* const* dataBuffers,
+                                            const double* timestampBuffer,
+                                            int numChannels,
+                                            int size)
+{
+    if (! size)
+        return;
+
+    /* Same float to int scaling as writeContinuousData, per channel */
+    m_channelGains.resize (numChannels);
+    for (int i = 0; i < numChannels; i++)
+        m_channelGains.set (i, 1 / (float (0x7fff) * getContinuousChannel (realChannels[i])->getBitVolts()));
+
+    int first = 0;
+    while (first < numChannels)
     {
-        int64 baseSampleNumber = getLatestSampleNumber (writeChannel);
+        int writeChannel = firstWriteChannel + first;
+        int fileIndex = m_fileIndexes[writeChannel];
+
+        /* Batch the channels that sit next to each other in the same file */
+        int last = first + 1;
+        while (last < numChannels
+               && m_fileIndexes[firstWriteChannel + last] == fileIndex
+               && m_channelIndexes[firstWriteChannel + last] == m_channelIndexes[writeChannel] + (unsigned int) (last - first)
+               && m_samplesWritten[firstWriteChannel + last] == m_samplesWritten[writeChannel])
+            last++;
+
+        if (! m_continuousFiles[fileIndex]->writeChannels (
+                m_samplesWritten[writeChannel],
+                m_channelIndexes[writeChannel],
+                last - first,
+                dataBuffers + first,
+                0,
+                m_channelGains.getRawDataPointer() + first,
+                size))
+            stopOnWriteFailure (fileIndex);
+
+        for (int i = first; i < last; i++)
+            m_samplesWritten.set (firstWriteChannel + i, m_samplesWritten[firstWriteChannel + i] + size);
+
+        if (m_channelIndexes[writeChannel] == 0)
+            writeSampleNumbers (writeChannel, realChannels[first], fileIndex, timestampBuffer, size);
+
+        first = last;
+    }
+}
 
-        uint32 streamId = getContinuousChannel (realChannel)->getStreamId();
+void BinaryRecording::stopOnWriteFailure (int fileIndex)
+{
+    if (m_writeFailed)
+        return;
 
-        if (! wroteFirstSampleNumber[streamId] )
-        {
-            firstSampleNumber[streamId] = baseSampleNumber;
-            wroteFirstSampleNumber[streamId] = true;
-        }
+    m_writeFailed = true;
 
-        for (int i = 0; i < size; i++)
-            /* Generate int sample number */
-            m_sampleNumberBuffer[i] = baseSampleNumber + i;
+    LOGE ("Unable to write continuous data file ", fileIndex, "; stopping recording");
 
-        /* Write int timestamps to disc */
-        m_dataTimestampFiles[fileIndex]->writeData (m_sampleNumberBuffer, size * sizeof (int64));
-        m_dataTimestampFiles[fileIndex]->increaseRecordCount (size);
+    MessageManager::callAsync ([]
+                               {
+                                   CoreServices::setRecordingStatus (false);
+                                   CoreServices::sendStatusMessage ("Recording stopped: unable to write continuous data");
+                               });
+}
 
-        m_dataSyncTimestampFiles[fileIndex]->writeData (timestampBuffer, size * sizeof (double));
-        m_dataSyncTimestampFiles[fileIndex]->increaseRecordCount (size);
+BlockFileWriter::Stats BinaryRecording::getWriteStats() const
+{
+    const ScopedLock lock (m_continuousFilesLock);
+
+    if (m_continuousFiles.isEmpty())
+        return m_lastWriteStats;
+
+    return combineWriteStats();
+}
+
+BlockFileWriter::Stats BinaryRecording::combineWriteStats() const
+{
+    BlockFileWriter::Stats total;
+    total.directIO = true;
+
+    for (auto* file : m_continuousFiles)
+    {
+        if (file == nullptr)
+            continue;
+
+        const BlockFileWriter::Stats stats = file->getWriterStats();
+
+        if (stats.blocksWritten > 0)
+            total.meanLatencyMs += (stats.meanLatencyMs - total.meanLatencyMs) * (double) stats.blocksWritten / (double) (total.blocksWritten + stats.blocksWritten);
+
+        total.bytesWritten += stats.bytesWritten;
+        total.blocksWritten += stats.blocksWritten;
+        total.writeSeconds += stats.writeSeconds;
+        total.maxLatencyMs = jmax (total.maxLatencyMs, stats.maxLatencyMs);
+        total.maxQueueDepth = jmax (total.maxQueueDepth, stats.maxQueueDepth);
+        total.poolSize += stats.poolSize;
+        total.maxPoolSize += stats.maxPoolSize;
+        total.poolExhausted += stats.poolExhausted;
+        total.bytesDropped += stats.bytesDropped;
+        total.directIO = total.directIO && stats.directIO;
+        total.failed = total.failed || stats.failed;
     }
+
+    return total;
+}
+
+void BinaryRecording::writeSampleNumbers (int writeChannel, int realChannel, int fileIndex, const double* timestampBuffer, int size)
+{
+    /* The batch path skips writeContinuousData's buffer check */
+    if (size > m_bufferSize)
+    {
+        LOGE ("BinaryRecording::writeSampleNumbers: Write buffer overrun, resizing from: ", m_bufferSize, " to: ", size);
+        m_scaledBuffer.malloc (size);
+        m_intBuffer.malloc (size);
+        m_sampleNumberBuffer.malloc (size);
+        m_bufferSize = size;
+    }
+
+    int64 baseSampleNumber = getLatestSampleNumber (writeChannel);
+
+    uint32 streamId = getContinuousChannel (realChannel)->getStreamId();
+
+    if (! wroteFirstSampleNumber[streamId] )
+    {
+        firstSampleNumber[streamId] = baseSampleNumber;
+        wroteFirstSampleNumber[streamId] = true;
+    }
+
+    for (int i = 0; i < size; i++)
+        /* Generate int sample number */
+        m_sampleNumberBuffer[i] = baseSampleNumber + i;
+
+    /* Write int timestamps to disc */
+    m_dataTimestampFiles[fileIndex]->writeData (m_sampleNumberBuffer, size * sizeof (int64));
+    m_dataTimestampFiles[fileIndex]->increaseRecordCount (size);
+
+    m_dataSyncTimestampFiles[fileIndex]->writeData (timestampBuffer, size * sizeof (double));
+    m_dataSyncTimestampFiles[fileIndex]->increaseRecordCount (size);
 }
 
 void BinaryRecording::writeEvent (int eventIndex, const EventPacket& event)
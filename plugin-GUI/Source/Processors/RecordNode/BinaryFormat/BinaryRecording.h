@@ -62,6 +62,14 @@ public:
                               const double* timestampBuffer,
                               int size);
 
+    /** Writes a block of continuous data for consecutive channels of a stream, interleaving them in one pass */
+    void writeContinuousBlock (int firstWriteChannel,
+                               const int* realChannels,
+                               const float* const* dataBuffers,
+                               const double* timestampBuffer,
+                               int numChannels,
+                               int size) override;
+
     /** Writes an event to disk */
     void writeEvent (int eventIndex, const EventPacket& packet);
 
@@ -74,6 +82,12 @@ public:
     /** Sets an engine parameter (in this case TTL word writing bool) */
     void setParameter (EngineParameter& parameter);
 
+    /**
+        Returns the write statistics of all continuous files being recorded, or of the last
+        recording once its files are closed. Can be called from any thread.
+     */
+    BlockFileWriter::Stats getWriteStats() const;
+
 private:
     class EventRecording
     {
@@ -89,12 +103,21 @@ private:
     void createChannelMetadata (const MetadataObject* channel, DynamicObject* jsonObject);
     void writeEventMetadata (const MetadataEvent* event, NpyFile* file);
     void increaseEventCounts (EventRecording* rec);
+    void writeSampleNumbers (int writeChannel, int realChannel, int fileIndex, const double* timestampBuffer, int size);
+
+    /** Logs the first failed continuous write of a recording and stops recording */
+    void stopOnWriteFailure (int fileIndex);
+
+    /** Adds up the write statistics of the open continuous files (m_continuousFilesLock must be held) */
+    BlockFileWriter::Stats combineWriteStats() const;
 
     bool m_saveTTLWords { true };
+    bool m_writeFailed { false };
 
     HeapBlock<float> m_scaledBuffer;
     HeapBlock<int16> m_intBuffer;
     HeapBlock<int64> m_sampleNumberBuffer;
+    Array<float> m_channelGains;
     int m_bufferSize;
     int m_syncTimestampBufferSize;
 
@@ -102,6 +125,8 @@ private:
     Array<unsigned int> m_fileIndexes;
 
     OwnedArray<SequentialBlockFile> m_continuousFiles;
+    BlockFileWriter::Stats m_lastWriteStats;
+    CriticalSection m_continuousFilesLock;
     OwnedArray<EventRecording> m_eventFiles;
     OwnedArray<EventRecording> m_spikeFiles;
 
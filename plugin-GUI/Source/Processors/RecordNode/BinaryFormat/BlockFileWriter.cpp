@@ -0,0 +1,348 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BlockFileWriter.h"
+
+#include "../../../Utils/Utils.h"
+
+#if ! JUCE_WINDOWS
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+BlockFileWriter::BlockFileWriter (int nChannels, int samplesPerBlock, int maxPoolSize) : Thread ("Binary Block Writer"),
+                                                                                         m_nChannels (nChannels),
+                                                                                         m_blockSize (nChannels * samplesPerBlock),
+                                                                                         m_maxPoolSize (jmax (2, maxPoolSize))
+{
+    for (int i = 0; i < initialPoolSize; i++)
+        m_freeBlocks.add (m_blocks.add (new FileBlock (m_blockSize)));
+}
+
+BlockFileWriter::~BlockFileWriter()
+{
+    close();
+}
+
+bool BlockFileWriter::open (const File& file)
+{
+    close();
+
+    m_directIO = false;
+
+    const size_t blockBytes = (size_t) m_blockSize * sizeof (int16);
+
+#if ! JUCE_WINDOWS
+    const String path = file.getFullPathName();
+
+#if JUCE_LINUX
+    // Direct I/O needs every write to be a whole number of aligned pages
+    if (blockBytes % FileBlock::alignment == 0)
+    {
+        m_fd = ::open (path.toRawUTF8(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        m_directIO = m_fd >= 0;
+    }
+#endif
+
+    if (m_fd < 0)
+        m_fd = ::open (path.toRawUTF8(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (m_fd < 0)
+    {
+        LOGE ("Unable to open ", path, " for writing: ", strerror (errno));
+        return false;
+    }
+
+#if JUCE_MAC
+    m_directIO = fcntl (m_fd, F_NOCACHE, 1) == 0 && blockBytes % FileBlock::alignment == 0;
+#endif
+#else
+    ignoreUnused (blockBytes);
+
+    m_stream = file.createOutputStream (0);
+
+    if (m_stream == nullptr || ! m_stream->setPosition (0) || m_stream->truncate().failed())
+    {
+        LOGE ("Unable to open ", file.getFullPathName(), " for writing");
+        m_stream.reset();
+        return false;
+    }
+#endif
+
+    m_fileSize = 0;
+    m_minimumSize = 0;
+    m_allocatedSize = 0;
+    m_canPreallocate = true;
+    m_failed = false;
+
+    {
+        const ScopedLock lock (m_statsLock);
+        m_stats = Stats();
+    }
+
+    m_isOpen = true;
+    startThread();
+    return true;
+}
+
+void BlockFileWriter::close()
+{
+    if (! m_isOpen)
+        return;
+
+    signalThreadShouldExit();
+    notify();
+    waitForThreadToExit (-1);
+
+    // Anything queued after the thread's last pass
+    writeQueuedBlocks();
+
+    const int64 finalSize = jmax (m_fileSize, m_minimumSize);
+
+#if ! JUCE_WINDOWS
+    // Direct writes pad the last block to a whole page; trim it, along with any preallocated
+    // space. Growing the file instead fills dropped samples at its end with zeros.
+    if (ftruncate (m_fd, (off_t) finalSize) != 0)
+        LOGE ("Unable to set the size of a binary data file: ", strerror (errno));
+
+    ::close (m_fd);
+    m_fd = -1;
+#else
+    if (finalSize > m_fileSize && m_stream->setPosition (m_fileSize))
+        m_stream->writeRepeatedByte (0, (size_t) (finalSize - m_fileSize));
+
+    m_stream->flush();
+    m_stream.reset();
+#endif
+
+    m_isOpen = false;
+}
+
+FileBlock* BlockFileWriter::acquireBlock (uint64 offset)
+{
+    FileBlock* block = nullptr;
+
+    {
+        const ScopedLock lock (m_poolLock);
+
+        if (! m_freeBlocks.isEmpty())
+            block = m_freeBlocks.removeAndReturn (m_freeBlocks.size() - 1);
+        else if (m_blocks.size() < m_maxPoolSize)
+            block = m_blocks.add (new FileBlock (m_blockSize));
+    }
+
+    if (block == nullptr)
+    {
+        // Every block is being filled or waiting for the disk. Waiting for one here would
+        // stall the record thread, so the caller drops the samples instead.
+        notify();
+
+        const ScopedLock lock (m_statsLock);
+        m_stats.poolExhausted++;
+        return nullptr;
+    }
+
+    block->reset (offset);
+    return block;
+}
+
+void BlockFileWriter::addDroppedBytes (int64 numBytes)
+{
+    bool first;
+
+    {
+        const ScopedLock lock (m_statsLock);
+        first = m_stats.bytesDropped == 0;
+        m_stats.bytesDropped += numBytes;
+    }
+
+    if (first)
+        LOGE ("The disk is not keeping up with a binary data file; samples are being dropped");
+}
+
+void BlockFileWriter::queueBlock (FileBlock* block)
+{
+    {
+        const ScopedLock lock (m_queueLock);
+
+        m_queue.add (block);
+        m_queueTicks.add (Time::getHighResolutionTicks());
+
+        const ScopedLock statsLock (m_statsLock);
+        m_stats.maxQueueDepth = jmax (m_stats.maxQueueDepth, m_queue.size());
+    }
+
+    notify();
+}
+
+BlockFileWriter::Stats BlockFileWriter::getStats() const
+{
+    Stats stats;
+
+    {
+        const ScopedLock lock (m_statsLock);
+        stats = m_stats;
+    }
+
+    {
+        const ScopedLock lock (m_poolLock);
+        stats.poolSize = m_blocks.size();
+    }
+
+    stats.maxPoolSize = m_maxPoolSize;
+    stats.directIO = m_directIO;
+    stats.failed = m_failed;
+    return stats;
+}
+
+void BlockFileWriter::run()
+{
+    while (! threadShouldExit())
+    {
+        writeQueuedBlocks();
+        wait (100);
+    }
+}
+
+void BlockFileWriter::writeQueuedBlocks()
+{
+    {
+        const ScopedLock lock (m_queueLock);
+        m_writing.swapWith (m_queue);
+        m_writingTicks.swapWith (m_queueTicks);
+    }
+
+    for (int i = 0; i < m_writing.size(); i++)
+    {
+        FileBlock* block = m_writing.getUnchecked (i);
+
+        const int64 start = Time::getHighResolutionTicks();
+        const bool written = writeBlock (block);
+        const int64 end = Time::getHighResolutionTicks();
+
+        if (written)
+        {
+            const double latencyMs = Time::highResolutionTicksToSeconds (end - m_writingTicks.getUnchecked (i)) * 1000.0;
+
+            const ScopedLock lock (m_statsLock);
+            m_stats.bytesWritten += (int64) block->getFlushBytes();
+            m_stats.writeSeconds += Time::highResolutionTicksToSeconds (end - start);
+            m_stats.maxLatencyMs = jmax (m_stats.maxLatencyMs, latencyMs);
+            m_stats.meanLatencyMs += (latencyMs - m_stats.meanLatencyMs) / (double) ++m_stats.blocksWritten;
+        }
+
+        block->clear();
+
+        const ScopedLock lock (m_poolLock);
+        m_freeBlocks.add (block);
+    }
+
+    m_writing.clearQuick();
+    m_writingTicks.clearQuick();
+}
+
+bool BlockFileWriter::writeBlock (FileBlock* block)
+{
+    const size_t flushBytes = block->getFlushBytes();
+
+    if (flushBytes == 0)
+        return true;
+
+    const int64 position = (int64) block->getOffset() * m_nChannels * (int64) sizeof (int16);
+    const size_t alignedBytes = (flushBytes + FileBlock::alignment - 1) & ~(FileBlock::alignment - 1);
+
+    preallocate (position, alignedBytes);
+
+    bool written = writeAt (block->getData(), m_directIO ? alignedBytes : flushBytes, position);
+
+#if JUCE_LINUX
+    // Some filesystems accept O_DIRECT when opening but reject the writes
+    if (! written && m_directIO && errno == EINVAL)
+    {
+        LOGD ("Direct I/O is not supported for this file, falling back to buffered writes");
+
+        fcntl (m_fd, F_SETFL, fcntl (m_fd, F_GETFL) & ~O_DIRECT);
+        m_directIO = false;
+        written = writeAt (block->getData(), flushBytes, position);
+    }
+#endif
+
+    if (! written)
+    {
+        if (! m_failed.exchange (true))
+            LOGE ("Failed to write a block of binary data at byte ", position);
+
+        return false;
+    }
+
+    m_fileSize = jmax (m_fileSize, position + (int64) flushBytes);
+    return true;
+}
+
+bool BlockFileWriter::writeAt (const void* data, size_t size, int64 position)
+{
+#if ! JUCE_WINDOWS
+    const char* bytes = static_cast<const char*> (data);
+
+    while (size > 0)
+    {
+        const ssize_t written = pwrite (m_fd, bytes, size, (off_t) position);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        bytes += written;
+        size -= (size_t) written;
+        position += written;
+    }
+
+    return true;
+#else
+    return m_stream->setPosition (position) && m_stream->write (data, size);
+#endif
+}
+
+void BlockFileWriter::preallocate (int64 position, size_t size)
+{
+#if JUCE_LINUX
+    if (! m_canPreallocate || position + (int64) size <= m_allocatedSize)
+        return;
+
+    // Reserve well ahead so the file is laid out in a few large extents
+    const int64 step = jmax (minPreallocateBytes, (int64) preallocateBlocks * m_blockSize * (int64) sizeof (int16));
+    const int64 target = jmax (m_allocatedSize, position) + jmax (step, (int64) size);
+
+    if (fallocate (m_fd, FALLOC_FL_KEEP_SIZE, m_allocatedSize, target - m_allocatedSize) == 0)
+        m_allocatedSize = target;
+    else
+        m_canPreallocate = false;
+#else
+    ignoreUnused (position, size);
+#endif
+}
@@ -0,0 +1,182 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BLOCKFILEWRITER_H
+#define BLOCKFILEWRITER_H
+
+#include "FileMemoryBlock.h"
+
+#include "../../PluginManager/PluginClass.h"
+
+typedef FileMemoryBlock<int16> FileBlock;
+
+/**
+
+    Writes the blocks of a SequentialBlockFile on a background thread
+
+    The record thread fills blocks taken from a pool and queues them once
+    every channel has moved past them; this thread writes each one at its
+    position in the file and returns it to the pool. While one block is
+    being written the next can be filled, so the record thread never waits
+    on the disk. If the disk falls behind by a whole pool of blocks, no
+    block is handed out and the samples that needed one are dropped and
+    counted; they read as zeros in the file. That bounds the memory held
+    for a stalled disk.
+
+    On Linux the file is opened with O_DIRECT and preallocated with
+    fallocate, so large recordings bypass the page cache and do not
+    fragment. macOS uses F_NOCACHE instead. Elsewhere, or if the
+    filesystem refuses direct I/O, blocks are written through a plain
+    FileOutputStream.
+
+ */
+
+class PLUGIN_API BlockFileWriter : public Thread
+{
+public:
+    /** Write statistics, readable while the file is being written */
+    struct Stats
+    {
+        int64 bytesWritten = 0;
+        int64 blocksWritten = 0;
+
+        /** Time spent inside write calls (seconds) */
+        double writeSeconds = 0;
+
+        /** Time from a block being queued until it was on disk (milliseconds) */
+        double meanLatencyMs = 0;
+        double maxLatencyMs = 0;
+
+        int maxQueueDepth = 0;
+        int poolSize = 0;
+        int maxPoolSize = 0;
+
+        /** Times acquireBlock() found every block in use */
+        int64 poolExhausted = 0;
+
+        /** Bytes of samples dropped because no block was free for them */
+        int64 bytesDropped = 0;
+
+        bool directIO = false;
+
+        /** True once a block could not be written */
+        bool failed = false;
+
+        /** Bytes written per second spent writing, in MB/s */
+        double getThroughput() const { return writeSeconds > 0 ? bytesWritten / writeSeconds / 1.0e6 : 0; }
+    };
+
+    /**
+        Creates a writer for blocks of nChannels x samplesPerBlock int16s, holding at most
+        maxPoolSize of them. At least two are held, so one can be filled while the other is
+        written, and a write that straddles two blocks has both.
+     */
+    BlockFileWriter (int nChannels, int samplesPerBlock, int maxPoolSize = defaultMaxPoolSize);
+
+    /** Writes any queued blocks and closes the file */
+    ~BlockFileWriter();
+
+    /** Opens the file for writing, replacing its contents, and starts the thread */
+    bool open (const File& file);
+
+    /** Writes every queued block, trims the file to its final size and closes it */
+    void close();
+
+    /** Makes the file at least numBytes long when it is closed, so samples dropped at its end still take their place */
+    void setMinimumSize (int64 numBytes) { m_minimumSize = jmax (m_minimumSize, numBytes); }
+
+    bool isOpen() const { return m_isOpen; }
+
+    /** True once any data could not be written; the file is incomplete */
+    bool hasFailed() const { return m_failed; }
+
+    /**
+        Takes a zeroed block from the pool and sets its offset. Allocates a new block if
+        none is free and the pool is below its maximum size. Returns nullptr, without
+        waiting, if every block is in use.
+     */
+    FileBlock* acquireBlock (uint64 offset);
+
+    /** Counts samples that were dropped because acquireBlock() had no block for them */
+    void addDroppedBytes (int64 numBytes);
+
+    /** Hands a filled block to the writer thread; the block returns to the pool once written */
+    void queueBlock (FileBlock* block);
+
+    /** Returns a snapshot of the write statistics */
+    Stats getStats() const;
+
+    /** Writes queued blocks until the thread is stopped */
+    void run() override;
+
+    /** Blocks held by default: with 1024 channels and 4096-sample blocks, 128 MB, or about 2 s at 30 kHz */
+    static constexpr int defaultMaxPoolSize = 16;
+
+private:
+    /** Writes all queued blocks, in order */
+    void writeQueuedBlocks();
+
+    /** Writes one block at its position in the file */
+    bool writeBlock (FileBlock* block);
+
+    /** Writes size bytes at position, retrying short writes */
+    bool writeAt (const void* data, size_t size, int64 position);
+
+    /** Reserves disk space ahead of position + size */
+    void preallocate (int64 position, size_t size);
+
+    const int m_nChannels;
+    const int m_blockSize;
+    const int m_maxPoolSize;
+
+    int m_fd { -1 };
+    std::unique_ptr<FileOutputStream> m_stream;
+    bool m_isOpen { false };
+    std::atomic<bool> m_directIO { false };
+    std::atomic<bool> m_failed { false };
+
+    int64 m_fileSize { 0 };
+    int64 m_minimumSize { 0 };
+    int64 m_allocatedSize { 0 };
+    bool m_canPreallocate { true };
+
+    OwnedArray<FileBlock> m_blocks;
+    Array<FileBlock*> m_freeBlocks;
+    CriticalSection m_poolLock;
+
+    Array<FileBlock*> m_queue;
+    Array<int64> m_queueTicks;
+    Array<FileBlock*> m_writing;
+    Array<int64> m_writingTicks;
+    CriticalSection m_queueLock;
+
+    Stats m_stats;
+    CriticalSection m_statsLock;
+
+    /** Compile-time params */
+    const int initialPoolSize { 2 };
+    const int64 minPreallocateBytes { 64 << 20 };
+    const int preallocateBlocks { 16 };
+};
+
+#endif // BLOCKFILEWRITER_H
@@ -21,39 +21,69 @@
 
 */
 
+#ifndef FILEMEMORYBLOCK_H
+#define FILEMEMORYBLOCK_H
+
 #include "../../../../JuceLibraryCode/JuceHeader.h"
 
+/**
+    One block of a SequentialBlockFile, held in memory until every channel
+    has moved past it.
+
+    Blocks are recycled through a BlockFileWriter's pool rather than freed,
+    and their memory is aligned so they can be written with direct I/O.
+ */
 template <class StorageType = int16>
 class FileMemoryBlock
 {
 public:
-    FileMemoryBlock (std::shared_ptr<FileOutputStream> file, int blockSize, uint64 offset) : m_data (blockSize, true),
-                                                                                             m_file (file),
-                                                                                             m_blockSize (blockSize),
-                                                                                             m_offset (offset),
-                                                                                             m_finalFlushSamples (blockSize) {};
+    /** Memory alignment, and the granularity of direct I/O writes */
+    static constexpr size_t alignment = 4096;
+
+    /** Allocates a zeroed block of blockSize samples */
+    FileMemoryBlock (int blockSize) : m_memory (blockSize * sizeof (StorageType) + alignment, true),
+                                      m_blockSize (blockSize)
+    {
+        const auto address = reinterpret_cast<uintptr_t> (m_memory.getData());
+        m_data = reinterpret_cast<StorageType*> ((address + alignment - 1) & ~(uintptr_t) (alignment - 1));
+    }
+
+    /** Readies a cleared block for reuse at a new offset (in samples per channel) */
+    void reset (uint64 offset)
+    {
+        m_offset = offset;
+        m_finalFlushSamples = m_blockSize;
+    }
 
-    ~FileMemoryBlock()
+    /** Zeroes the block once it has been written, so it can be reused */
+    void clear()
     {
-        if (!m_flushed)
-        {
-            m_file->write (m_data, m_finalFlushSamples * sizeof (StorageType));
-        }
-    };
-
-    inline uint64 getOffset() { return m_offset; }
-    inline StorageType* getData() { return m_data.getData(); }
+        zeromem (m_data, getCapacityBytes());
+    }
+
+    inline uint64 getOffset() const { return m_offset; }
+    inline StorageType* getData() { return m_data; }
+    inline const StorageType* getData() const { return m_data; }
+
+    /** Limits the bytes written to the file to the first size samples */
     void partialFlush (size_t size)
     {
         m_finalFlushSamples = size;
     }
 
+    /** Bytes of the block that belong in the file */
+    size_t getFlushBytes() const { return m_finalFlushSamples * sizeof (StorageType); }
+
+    /** Bytes of memory in the block */
+    size_t getCapacityBytes() const { return (size_t) m_blockSize * sizeof (StorageType); }
+
 private:
-    HeapBlock<StorageType> m_data;
-    std::shared_ptr<FileOutputStream> m_file;
+    HeapBlock<char> m_memory;
+    StorageType* m_data;
     const int m_blockSize;
-    const uint64 m_offset;
-    size_t m_finalFlushSamples;
-    bool m_flushed { false };
+    uint64 m_offset { 0 };
+    size_t m_finalFlushSamples { (size_t) m_blockSize };
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileMemoryBlock);
 };
+
+#endif // FILEMEMORYBLOCK_H
@@ -0,0 +1,183 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2024 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SAMPLEINTERLEAVE_H
+#define SAMPLEINTERLEAVE_H
+
+#include "../../../../JuceLibraryCode/JuceHeader.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+#include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON && defined(__aarch64__)
+#define SAMPLE_INTERLEAVE_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+    Converts per-channel float buffers into interleaved int16 samples for
+    a flat binary file, in one pass.
+
+    Each sample is multiplied by its channel's gain and stored as a
+    fraction of 0x7fff, clamped and rounded to nearest exactly as
+    AudioDataConverters::convertFloatToInt16LE does.
+
+    Works on 4 channel x 4 sample tiles transposed in SIMD registers, and
+    walks the interleaved side in bands of samples that stay in L1 while
+    every channel group is written to them, so the strided int16 stores
+    hit cache instead of missing once per sample.
+ */
+namespace SampleInterleave
+{
+
+/** Bytes of interleaved int16 data per cache band */
+constexpr int BAND_BYTES = 16384;
+
+/** Samples per cache band for a channel count: a multiple of 4 between 8 and 256 */
+inline int getBandSamples (int numChannels) noexcept
+{
+    return jlimit (8, 256, BAND_BYTES / (int) sizeof (int16) / jmax (1, numChannels)) & ~3;
+}
+
+/** Converts one sample, as the SIMD paths do */
+inline int16 convertSample (float sample, float gain) noexcept
+{
+    const auto maxVal = (double) 0x7fff;
+    return (int16) roundToInt (jlimit (-maxVal, maxVal, maxVal * (sample * gain)));
+}
+
+#if JUCE_USE_SSE_INTRINSICS
+/** Converts 4 clamped floats to int32s, scaling by 0x7fff in double precision */
+inline __m128i convert4 (__m128 v) noexcept
+{
+    const __m128d scale = _mm_set1_pd ((double) 0x7fff);
+
+    const __m128i lo = _mm_cvtpd_epi32 (_mm_mul_pd (_mm_cvtps_pd (v), scale));
+    const __m128i hi = _mm_cvtpd_epi32 (_mm_mul_pd (_mm_cvtps_pd (_mm_movehl_ps (v, v)), scale));
+
+    return _mm_unpacklo_epi64 (lo, hi);
+}
+#elif SAMPLE_INTERLEAVE_USE_NEON
+/** Converts 4 clamped floats to int16s, scaling by 0x7fff in double precision */
+inline int16x4_t convert4 (float32x4_t v) noexcept
+{
+    const int64x2_t lo = vcvtnq_s64_f64 (vmulq_n_f64 (vcvt_f64_f32 (vget_low_f32 (v)), (double) 0x7fff));
+    const int64x2_t hi = vcvtnq_s64_f64 (vmulq_n_f64 (vcvt_high_f64_f32 (v), (double) 0x7fff));
+
+    return vqmovn_s32 (vcombine_s32 (vmovn_s64 (lo), vmovn_s64 (hi)));
+}
+#endif
+
+/**
+    Converts src[channel][srcOffset + sample] for numChannels x numSamples
+    into dest[sample * destStride + channel].
+ */
+inline void floatToInt16 (const float* const* src, int srcOffset, const float* gains, int numChannels, int numSamples, int16* dest, int destStride) noexcept
+{
+    const int bandSamples = getBandSamples (destStride);
+
+    for (int s0 = 0; s0 < numSamples; s0 += bandSamples)
+    {
+        const int s1 = jmin (numSamples, s0 + bandSamples);
+        int ch = 0;
+
+#if JUCE_USE_SSE_INTRINSICS || SAMPLE_INTERLEAVE_USE_NEON
+        for (; ch + 4 <= numChannels; ch += 4)
+        {
+            const float* c0 = src[ch] + srcOffset;
+            const float* c1 = src[ch + 1] + srcOffset;
+            const float* c2 = src[ch + 2] + srcOffset;
+            const float* c3 = src[ch + 3] + srcOffset;
+            int16* p = dest + (size_t) s0 * destStride + ch;
+            int s = s0;
+
+#if JUCE_USE_SSE_INTRINSICS
+            const __m128 g0 = _mm_set1_ps (gains[ch]);
+            const __m128 g1 = _mm_set1_ps (gains[ch + 1]);
+            const __m128 g2 = _mm_set1_ps (gains[ch + 2]);
+            const __m128 g3 = _mm_set1_ps (gains[ch + 3]);
+            const __m128 lower = _mm_set1_ps (-1.0f);
+            const __m128 upper = _mm_set1_ps (1.0f);
+
+            for (; s + 4 <= s1; s += 4, p += 4 * destStride)
+            {
+                __m128 a = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (c0 + s), g0), lower), upper);
+                __m128 b = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (c1 + s), g1), lower), upper);
+                __m128 c = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (c2 + s), g2), lower), upper);
+                __m128 d = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_loadu_ps (c3 + s), g3), lower), upper);
+
+                _MM_TRANSPOSE4_PS (a, b, c, d);
+
+                // Each register now holds one sample of the 4 channels
+                const __m128i ab = _mm_packs_epi32 (convert4 (a), convert4 (b));
+                const __m128i cd = _mm_packs_epi32 (convert4 (c), convert4 (d));
+
+                _mm_storel_epi64 (reinterpret_cast<__m128i*> (p), ab);
+                _mm_storel_epi64 (reinterpret_cast<__m128i*> (p + destStride), _mm_unpackhi_epi64 (ab, ab));
+                _mm_storel_epi64 (reinterpret_cast<__m128i*> (p + 2 * destStride), cd);
+                _mm_storel_epi64 (reinterpret_cast<__m128i*> (p + 3 * destStride), _mm_unpackhi_epi64 (cd, cd));
+            }
+#else
+            const float32x4_t lower = vdupq_n_f32 (-1.0f);
+            const float32x4_t upper = vdupq_n_f32 (1.0f);
+
+            for (; s + 4 <= s1; s += 4, p += 4 * destStride)
+            {
+                const float32x4_t a = vminq_f32 (vmaxq_f32 (vmulq_n_f32 (vld1q_f32 (c0 + s), gains[ch]), lower), upper);
+                const float32x4_t b = vminq_f32 (vmaxq_f32 (vmulq_n_f32 (vld1q_f32 (c1 + s), gains[ch + 1]), lower), upper);
+                const float32x4_t c = vminq_f32 (vmaxq_f32 (vmulq_n_f32 (vld1q_f32 (c2 + s), gains[ch + 2]), lower), upper);
+                const float32x4_t d = vminq_f32 (vmaxq_f32 (vmulq_n_f32 (vld1q_f32 (c3 + s), gains[ch + 3]), lower), upper);
+
+                const float32x4x2_t ab = vtrnq_f32 (a, b);
+                const float32x4x2_t cd = vtrnq_f32 (c, d);
+
+                vst1_s16 (p, convert4 (vcombine_f32 (vget_low_f32 (ab.val[0]), vget_low_f32 (cd.val[0]))));
+                vst1_s16 (p + destStride, convert4 (vcombine_f32 (vget_low_f32 (ab.val[1]), vget_low_f32 (cd.val[1]))));
+                vst1_s16 (p + 2 * destStride, convert4 (vcombine_f32 (vget_high_f32 (ab.val[0]), vget_high_f32 (cd.val[0]))));
+                vst1_s16 (p + 3 * destStride, convert4 (vcombine_f32 (vget_high_f32 (ab.val[1]), vget_high_f32 (cd.val[1]))));
+            }
+#endif
+
+            for (; s < s1; s++, p += destStride)
+            {
+                p[0] = convertSample (c0[s], gains[ch]);
+                p[1] = convertSample (c1[s], gains[ch + 1]);
+                p[2] = convertSample (c2[s], gains[ch + 2]);
+                p[3] = convertSample (c3[s], gains[ch + 3]);
+            }
+        }
+#endif
+
+        for (; ch < numChannels; ch++)
+        {
+            const float* c = src[ch] + srcOffset;
+            int16* p = dest + (size_t) s0 * destStride + ch;
+
+            for (int s = s0; s < s1; s++, p += destStride)
+                *p = convertSample (c[s], gains[ch]);
+        }
+    }
+}
+
+} // namespace SampleInterleave
+
+#endif // SAMPLEINTERLEAVE_H
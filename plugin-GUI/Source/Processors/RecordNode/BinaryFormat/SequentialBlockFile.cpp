@@ -22,12 +22,13 @@
 */
 
 #include "SequentialBlockFile.h"
+#include "SampleInterleave.h"
 
-SequentialBlockFile::SequentialBlockFile (int nChannels, int samplesPerBlock) : m_file (nullptr),
-                                                                                m_nChannels (nChannels),
-                                                                                m_samplesPerBlock (samplesPerBlock),
-                                                                                m_blockSize (nChannels * samplesPerBlock),
-                                                                                m_lastBlockFill (0)
+SequentialBlockFile::SequentialBlockFile (int nChannels, int samplesPerBlock, int maxPoolSize) : m_writer (nChannels, samplesPerBlock, maxPoolSize),
+                                                                                                 m_nChannels (nChannels),
+                                                                                                 m_samplesPerBlock (samplesPerBlock),
+                                                                                                 m_blockSize (nChannels * samplesPerBlock),
+                                                                                                 m_lastBlockFill (0)
 {
     m_memBlocks.ensureStorageAllocated (blockArrayInitSize);
     for (int i = 0; i < nChannels; i++)
@@ -36,15 +37,23 @@ SequentialBlockFile::SequentialBlockFile (int nChannels, int samplesPerBlock) :
 
 SequentialBlockFile::~SequentialBlockFile()
 {
-    //Ensure that all remaining blocks are flushed in order. Keep the last one
-    int n = m_memBlocks.size();
-    for (int i = 0; i < n - 1; i++)
-    {
-        m_memBlocks.remove (0);
-    }
+    close();
+}
+
+void SequentialBlockFile::close()
+{
+    if (m_memBlocks.isEmpty())
+        return;
 
     //manually flush the last one to avoid trailing zeroes
-    m_memBlocks[0]->partialFlush (m_lastBlockFill * m_nChannels);
+    m_memBlocks.getLast()->partialFlush (m_lastBlockFill * m_nChannels);
+
+    //Ensure that all remaining blocks are flushed in order
+    for (auto* block : m_memBlocks)
+        m_writer.queueBlock (block);
+
+    m_memBlocks.clear();
+    m_writer.close();
 }
 
 bool SequentialBlockFile::openFile (String filename)
@@ -59,58 +68,41 @@ bool SequentialBlockFile::openFile (String filename)
         LOGD ("Re-creating file: ", filename);
     }
 
-    m_file = file.createOutputStream (streamBufferSize);
-    if (! m_file)
+    if (! m_writer.open (file))
     {
         LOGD ("Unable to create output stream!");
         return false;
     }
 
     LOGDD ("Added new FileBlock");
-    m_memBlocks.add (new FileBlock (m_file, m_blockSize, 0));
+    m_memBlocks.add (m_writer.acquireBlock (0));
     return true;
 }
 
-bool SequentialBlockFile::writeChannel (uint64 startPos, int channel, int16* data, int nSamples)
+template <typename WriteRun>
+bool SequentialBlockFile::writeSamples (uint64 startPos, int firstChannel, int numChannels, int nSamples, WriteRun&& writeRun)
 {
-    if (! m_file)
-    {
-        printf ("[RN]SequentialBlockFile::writeChannel returned false: (!m_file)\n");
+    if (! m_writer.isOpen() || m_writer.hasFailed())
         return false;
-    }
 
-    int bIndex = m_memBlocks.size() - 1;
-    if ((bIndex < 0) || (m_memBlocks[bIndex]->getOffset() + m_samplesPerBlock) < (startPos + nSamples))
-        allocateBlocks (startPos, nSamples);
-
-    for (bIndex = m_memBlocks.size() - 1; bIndex >= 0; bIndex--)
-    {
-        if (m_memBlocks[bIndex]->getOffset() <= startPos)
-            break;
-    }
+    int bIndex = findBlock (startPos, nSamples);
     if (bIndex < 0)
-    {
-        //LOGE("Memory block unloaded ahead of time for chan", channel, " start ", startPos, " ns ", nSamples);
-        //for (int i = 0; i < m_nChannels; i++)
-        //	LOGE("CH: ", i, " last block ", m_currentBlock[i]);
         return false;
-    }
+
     int writtenSamples = 0;
-    uint64 startIdx = startPos - m_memBlocks[bIndex]->getOffset();
-    uint64 startMemPos = startIdx * m_nChannels;
-    int dataIdx = 0;
     int lastBlockIdx = m_memBlocks.size() - 1;
 
-    while (writtenSamples < nSamples)
+    while (writtenSamples < nSamples && bIndex <= lastBlockIdx)
     {
-        int16* blockPtr = m_memBlocks[bIndex]->getData();
-        int samplesToWrite = jmin ((nSamples - writtenSamples), (m_samplesPerBlock - int(startIdx)));
+        // Stop at a gap left by dropped blocks: the next block starts after this sample, so the difference wraps around
+        uint64 startIdx = startPos + writtenSamples - m_memBlocks[bIndex]->getOffset();
+        if (startIdx >= (uint64) m_samplesPerBlock)
+            break;
 
-        for (int i = 0; i < samplesToWrite; i++)
-        {
-            *(blockPtr + startMemPos + channel + i * m_nChannels) = *(data + dataIdx);
-            dataIdx++;
-        }
+        int16* blockPtr = m_memBlocks[bIndex]->getData() + startIdx * m_nChannels + firstChannel;
+        int samplesToWrite = jmin ((nSamples - writtenSamples), (m_samplesPerBlock - int (startIdx)));
+
+        writeRun (blockPtr, writtenSamples, samplesToWrite);
         writtenSamples += samplesToWrite;
 
         //Update the last block fill index
@@ -120,14 +112,59 @@ bool SequentialBlockFile::writeChannel (uint64 startPos, int channel, int16* dat
             m_lastBlockFill = samplePos;
         }
 
-        startIdx = 0;
-        startMemPos = 0;
         bIndex++;
     }
-    m_currentBlock.set (channel, bIndex - 1); //store the last block a channel was written in
+
+    if (writtenSamples < nSamples)
+    {
+        m_writer.addDroppedBytes ((int64) (nSamples - writtenSamples) * numChannels * (int64) sizeof (int16));
+
+        // These channels will not write anywhere before the dropped samples again
+        bIndex = lastBlockIdx + 1;
+    }
+
+    for (int channel = firstChannel; channel < firstChannel + numChannels; channel++)
+        m_currentBlock.set (channel, bIndex - 1); //store the last block a channel was written in
+
+    m_writer.setMinimumSize ((int64) (startPos + nSamples) * m_nChannels * (int64) sizeof (int16));
     return true;
 }
 
+bool SequentialBlockFile::writeChannel (uint64 startPos, int channel, int16* data, int nSamples)
+{
+    return writeSamples (startPos, channel, 1, nSamples, [this, data] (int16* blockPtr, int dataIdx, int samplesToWrite)
+                         {
+                             for (int i = 0; i < samplesToWrite; i++)
+                                 blockPtr[i * m_nChannels] = data[dataIdx + i];
+                         });
+}
+
+bool SequentialBlockFile::writeChannels (uint64 startPos, int firstChannel, int numChannels, const float* const* data, int srcOffset, const float* gains, int nSamples)
+{
+    return writeSamples (startPos, firstChannel, numChannels, nSamples, [&] (int16* blockPtr, int dataIdx, int samplesToWrite)
+                         { SampleInterleave::floatToInt16 (data, srcOffset + dataIdx, gains, numChannels, samplesToWrite, blockPtr, m_nChannels); });
+}
+
+int SequentialBlockFile::findBlock (uint64 startPos, int nSamples)
+{
+    int bIndex = m_memBlocks.size() - 1;
+    if ((bIndex < 0) || (m_memBlocks[bIndex]->getOffset() + m_samplesPerBlock) < (startPos + nSamples))
+    {
+        allocateBlocks (startPos, nSamples);
+    }
+
+    for (bIndex = m_memBlocks.size() - 1; bIndex >= 0; bIndex--)
+    {
+        if (m_memBlocks[bIndex]->getOffset() <= startPos)
+            break;
+    }
+
+    if (bIndex >= 0 && startPos >= m_memBlocks[bIndex]->getOffset() + m_samplesPerBlock)
+        return m_memBlocks.size();
+
+    return bIndex;
+}
+
 void SequentialBlockFile::allocateBlocks (uint64 startIndex, int numSamples)
 {
     //First deallocate full blocks
@@ -145,19 +182,27 @@ void SequentialBlockFile::allocateBlocks (uint64 startIndex, int numSamples)
         m_currentBlock.set (i, m_currentBlock[i] - minBlock);
     }
 
-    m_memBlocks.removeRange (0, minBlock);
+    //Hand the blocks every channel has moved past to the writer thread
+    const int numReleased = (int) jmin (minBlock, (unsigned int) m_memBlocks.size());
+    for (int i = 0; i < numReleased; i++)
+        m_writer.queueBlock (m_memBlocks[i]);
 
-    //Look for the last available position and calculate needed space
-    uint64 lastOffset = m_memBlocks.getLast()->getOffset();
-    uint64 maxAddr = lastOffset + m_samplesPerBlock - 1;
-    uint64 newSpaceNeeded = numSamples - (maxAddr - startIndex);
-    uint64 newBlocks = (newSpaceNeeded + m_samplesPerBlock - 1) / m_samplesPerBlock; //Fast ceiling division
+    m_memBlocks.removeRange (0, numReleased);
 
-    for (int i = 0; i < newBlocks; i++)
+    //Continue after the last block, or skip ahead to the block holding startIndex if samples were dropped in between
+    uint64 nextOffset = startIndex - startIndex % m_samplesPerBlock;
+    if (! m_memBlocks.isEmpty())
+        nextOffset = jmax (nextOffset, m_memBlocks.getLast()->getOffset() + m_samplesPerBlock);
+
+    while (nextOffset < startIndex + numSamples)
     {
-        lastOffset += m_samplesPerBlock;
-        m_memBlocks.add (new FileBlock (m_file, m_blockSize, lastOffset));
+        FileBlock* block = m_writer.acquireBlock (nextOffset);
+
+        if (block == nullptr)
+            return;
+
+        m_memBlocks.add (block);
+        m_lastBlockFill = 0; //we've added a new block, so the last one is empty
+        nextOffset += m_samplesPerBlock;
     }
-    if (newBlocks > 0)
-        m_lastBlockFill = 0; //we've added some new blocks, so the last one will be empty
 }
@@ -25,12 +25,10 @@
 #define SEQUENTIALBLOCKFILE_H
 
 #include "../../../Utils/Utils.h"
-#include "FileMemoryBlock.h"
+#include "BlockFileWriter.h"
 
 #include "../../PluginManager/PluginClass.h"
 
-typedef FileMemoryBlock<int16> FileBlock;
-
 /**
  
     Writes data to a flat binary file of int16s
@@ -49,37 +47,69 @@ typedef FileMemoryBlock<int16> FileBlock;
     ...
     <Channel N Sample M>
 
+    Blocks are filled in memory and handed to a BlockFileWriter once every
+    channel has moved past them, so the disk is never touched on the
+    record thread. Samples for which the writer has no block to spare are
+    dropped, and read as zeros in the file.
+
  */
 
 class PLUGIN_API SequentialBlockFile
 {
 public:
-    /** Creates a file with nChannels */
-    SequentialBlockFile (int nChannels, int samplesPerBlock = 4096);
+    /** Creates a file with nChannels, holding at most maxPoolSize blocks in memory */
+    SequentialBlockFile (int nChannels, int samplesPerBlock = 4096, int maxPoolSize = BlockFileWriter::defaultMaxPoolSize);
 
-    /** Destructor */
+    /** Destructor; closes the file if it is still open */
     ~SequentialBlockFile();
 
     /** Opens the file at the requested path */
     bool openFile (String filename);
 
-    /** Writes nSamples of data for a particular channel */
+    /**
+        Writes nSamples of data for a particular channel. Returns false if the file is not
+        open, has failed, or startPos has already been written.
+     */
     bool writeChannel (uint64 startPos, int channel, int16* data, int nSamples);
 
+    /**
+        Writes nSamples for numChannels consecutive channels starting at firstChannel,
+        converting data[i][srcOffset...] to int16 with gains[i] as SampleInterleave does.
+        Returns false as writeChannel() does.
+     */
+    bool writeChannels (uint64 startPos, int firstChannel, int numChannels, const float* const* data, int srcOffset, const float* gains, int nSamples);
+
+    /** Writes the remaining blocks, trimming the last one to the samples written, and closes the file */
+    void close();
+
+    /** Returns the write statistics for this file */
+    BlockFileWriter::Stats getWriterStats() const { return m_writer.getStats(); }
+
 private:
-    std::shared_ptr<FileOutputStream> m_file;
+    BlockFileWriter m_writer;
     const int m_nChannels;
     const int m_samplesPerBlock;
     const int m_blockSize;
-    OwnedArray<FileBlock> m_memBlocks;
+    Array<FileBlock*> m_memBlocks;
     Array<int> m_currentBlock;
     size_t m_lastBlockFill;
 
-    /** Allocates data for a startIndex / numSamples combination */
+    /**
+        Writes nSamples from startPos for numChannels channels from firstChannel, calling
+        writeRun (dest, sampleOffset, numSamples) for each run of samples that lies within one
+        block. Samples that no block holds are dropped and counted.
+     */
+    template <typename WriteRun>
+    bool writeSamples (uint64 startPos, int firstChannel, int numChannels, int nSamples, WriteRun&& writeRun);
+
+    /** Allocates data for a startIndex / numSamples combination, as far as the writer has blocks to spare */
     void allocateBlocks (uint64 startIndex, int numSamples);
 
+    /** Allocates blocks if needed and returns the index of the block holding startPos, -1 if it was already
+        written, or the number of blocks if no block holds it */
+    int findBlock (uint64 startPos, int nSamples);
+
     /** Compile-time params */
-    const int streamBufferSize { 0 };
     const int blockArrayInitSize { 128 };
 };
 #endif // !SEQUENTIALBLOCKFILE_H
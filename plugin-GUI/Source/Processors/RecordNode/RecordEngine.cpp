@@ -75,6 +75,17 @@ String RecordEngine::generateDateString() const
     return recordNode->generateDateString();
 }
 
+void RecordEngine::writeContinuousBlock (int firstWriteChannel,
+                                         const int* realChannels,
+                                         const float* const* dataBuffers,
+                                         const double* timestampBuffer,
+                                         int numChannels,
+                                         int size)
+{
+    for (int i = 0; i < numChannels; i++)
+        writeContinuousData (firstWriteChannel + i, realChannels[i], dataBuffers[i], timestampBuffer, size);
+}
+
 void RecordEngine::updateLatestSampleNumbers (const Array<int64>& num, int channel)
 {
     if (channel < 0)
@@ -115,6 +115,19 @@ public:
     /** Called by configureEngine() */
     virtual void setParameter (EngineParameter& parameter) {}
 
+    /**
+        Write continuous data for numChannels consecutive recorded channels of one stream,
+        starting at firstWriteChannel, which share sample numbers and timestamps.
+        dataBuffers[i] holds the samples of write channel firstWriteChannel + i, whose real
+        channel is realChannels[i]. By default, calls writeContinuousData() for each channel.
+     */
+    virtual void writeContinuousBlock (int firstWriteChannel,
+                                       const int* realChannels,
+                                       const float* const* dataBuffers,
+                                       const double* timestampBuffer,
+                                       int numChannels,
+                                       int size);
+
     // ------------------------------------------------------------
     //                    OTHER METHODS
     // ------------------------------------------------------------
@@ -476,6 +476,17 @@ String RecordNode::getEngineId()
     return recordEngine->getEngineId();
 }
 
+bool RecordNode::getWriteStats (BlockFileWriter::Stats& stats)
+{
+    auto* binaryRecording = dynamic_cast<BinaryRecording*> (recordEngine.get());
+
+    if (binaryRecording == nullptr)
+        return false;
+
+    stats = binaryRecording->getWriteStats();
+    return true;
+}
+
 void RecordNode::setEngine (String id)
 {
     availableEngines = getAvailableRecordEngines();
@@ -35,6 +35,7 @@
 #include "../../Utils/Utils.h"
 #include "../GenericProcessor/GenericProcessor.h"
 #include "../Synchronizer/Synchronizer.h"
+#include "BinaryFormat/BlockFileWriter.h"
 #include "DataQueue.h"
 #include "RecordNodeEditor.h"
 #include "RecordThread.h"
@@ -170,6 +171,9 @@ public:
     /** Sets the engine ID for this record node */
     void setEngine (String engineId);
 
+    /** Gets the continuous data write statistics of the current or last recording; returns false if the engine is not the binary format */
+    bool getWriteStats (BlockFileWriter::Stats& stats);
+
     /** Turns event recording on or off*/
     void setRecordEvents (bool);
 
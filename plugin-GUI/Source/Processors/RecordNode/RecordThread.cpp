@@ -105,6 +105,8 @@ void RecordThread::run()
         dataBufferIdxs.push_back (CircularBufferIndexes());
     }
 
+    channelPointers.assign (m_numChannels, nullptr);
+
     for (int stream = 0; stream < recordNode->getNumDataStreams(); ++stream)
     {
         timestampBufferIdxs.push_back (CircularBufferIndexes());
@@ -167,64 +169,56 @@ void RecordThread::writeData (const AudioBuffer<float>& dataBuffer,
     {
         m_engine->updateLatestSampleNumbers (sampleNumbers);
 
-        /* Copy data to record engine */
-        for (int chan = 0; chan < m_numChannels; ++chan)
+        /* Copy data to record engine, a run of channels that share a stream's timestamps at a time */
+        int chan = 0;
+        while (chan < m_numChannels)
         {
-            if (dataBufferIdxs[chan].size1 > 0)
+            const CircularBufferIndexes& idx = dataBufferIdxs[chan];
+            const int timestampChannel = m_timestampBufferChannelArray[chan];
+
+            int end = chan + 1;
+            while (end < m_numChannels
+                   && m_timestampBufferChannelArray[end] == timestampChannel
+                   && sampleNumbers[end] == sampleNumbers[chan]
+                   && dataBufferIdxs[end].index1 == idx.index1
+                   && dataBufferIdxs[end].size1 == idx.size1
+                   && dataBufferIdxs[end].index2 == idx.index2
+                   && dataBufferIdxs[end].size2 == idx.size2)
+                end++;
+
+            if (idx.size1 > 0)
             {
-                const double* r = timestampBuffer.getReadPointer (m_timestampBufferChannelArray[chan],
-                                                                  dataBufferIdxs[chan].index1);
-
-                //if (chan == 0)
-                //  std::cout << "Writing " << dataBufferIdxs[chan].size1 << " samples for channel 0"
-                //            << std::endl;
-
-                m_engine->writeContinuousData (
-                    chan, // write channel (index among all recorded channels)
-                    m_channelArray[chan], // real channel (index within processor)
-                    dataBuffer.getReadPointer (chan, dataBufferIdxs[chan].index1), // pointer to float
-                    r, // pointer to float
-                    dataBufferIdxs[chan].size1); // integer
-
-                /*if (chan == 0)
-			{
-
-				std::cout << chan << " " << m_channelArray[chan] <<
-					" " << dataBufferIdxs[chan].index1 <<
-					" " << dataBufferIdxs[chan].size1 <<
-					" " << dataBufferIdxs[chan].index2 <<
-					" " << dataBufferIdxs[chan].size2
-					<< " "
-					<< *r << std::endl;
-
-				std::cout << chan << " " << m_timestampBufferChannelArray[chan] <<
-					" " << timestampBufferIdxs[m_timestampBufferChannelArray[chan]].index1 <<
-					" " << timestampBufferIdxs[m_timestampBufferChannelArray[chan]].size1 <<
-					" " << timestampBufferIdxs[m_timestampBufferChannelArray[chan]].index2 <<
-					" " << timestampBufferIdxs[m_timestampBufferChannelArray[chan]].size2
-					<< " "
-					<< *r << std::endl;
-			}*/
-
-                //samplesWritten += dataBufferIdxs[chan].size1;
-
-                if (dataBufferIdxs[chan].size2 > 0)
+                for (int i = chan; i < end; i++)
+                    channelPointers[i] = dataBuffer.getReadPointer (i, idx.index1);
+
+                m_engine->writeContinuousBlock (
+                    chan, // first write channel (index among all recorded channels)
+                    m_channelArray.getRawDataPointer() + chan, // real channels (index within processor)
+                    channelPointers.data() + chan, // pointers to float
+                    timestampBuffer.getReadPointer (timestampChannel, idx.index1), // pointer to double
+                    end - chan, // number of channels
+                    idx.size1); // integer
+
+                if (idx.size2 > 0)
                 {
-                    sampleNumbers.set (chan, sampleNumbers[chan] + dataBufferIdxs[chan].size1);
-
-                    m_engine->updateLatestSampleNumbers (sampleNumbers, chan);
-
-                    m_engine->writeContinuousData (
-                        chan, // write channel (index among all recorded channels)
-                        m_channelArray[chan], // real channel (index within processor)
-                        dataBuffer.getReadPointer (chan, dataBufferIdxs[chan].index2), // pointer to float
-                        timestampBuffer.getReadPointer (m_timestampBufferChannelArray[chan],
-                                                        dataBufferIdxs[chan].index2), // pointer to float
-                        dataBufferIdxs[chan].size2); // integer
-
-                    //samplesWritten += dataBufferIdxs[chan].size2;
+                    for (int i = chan; i < end; i++)
+                    {
+                        sampleNumbers.set (i, sampleNumbers[i] + idx.size1);
+                        m_engine->updateLatestSampleNumbers (sampleNumbers, i);
+                        channelPointers[i] = dataBuffer.getReadPointer (i, idx.index2);
+                    }
+
+                    m_engine->writeContinuousBlock (
+                        chan,
+                        m_channelArray.getRawDataPointer() + chan,
+                        channelPointers.data() + chan,
+                        timestampBuffer.getReadPointer (timestampChannel, idx.index2),
+                        end - chan,
+                        idx.size2);
                 }
             }
+
+            chan = end;
         }
 
         m_dataQueue->stopRead();
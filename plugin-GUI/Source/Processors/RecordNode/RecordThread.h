@@ -101,6 +101,7 @@ private:
     Array<int64> sampleNumbers;
     std::vector<CircularBufferIndexes> dataBufferIdxs;
     std::vector<CircularBufferIndexes> timestampBufferIdxs;
+    std::vector<const float*> channelPointers;
 
     int spikesReceived;
     int spikesWritten;
@@ -45,6 +45,38 @@ public:
     virtual Array<float>& getThresholds() = 0;
 
     virtual bool checkSample (int channel, float sample) = 0;
+
+    /** Checks samples startSample to endSample - 1 the way a series of checkSample() calls
+        would (sample by sample and, within a sample, channel by channel) and stops at the
+        first one that should trigger a spike.
+
+        channels[i] points at sample 0 of channel i, and channels whose active flag is false
+        are not checked. Returns the sample that triggered a spike and sets channel, or
+        returns endSample if none did.
+
+        Thresholders can override this to check many samples at once, as long as the
+        result and their state afterwards match the checkSample() calls. */
+    virtual int findCrossing (const float* const* channels,
+                              const bool* active,
+                              int numChannels,
+                              int startSample,
+                              int endSample,
+                              int& channel)
+    {
+        for (int sample = startSample; sample < endSample; ++sample)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                if (active[ch] && checkSample (ch, channels[ch][sample]))
+                {
+                    channel = ch;
+                    return sample;
+                }
+            }
+        }
+
+        return endSample;
+    }
 };
 
 class PLUGIN_API SpikeChannel : public ChannelInfoObject,
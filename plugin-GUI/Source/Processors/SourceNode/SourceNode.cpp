@@ -80,7 +80,6 @@ DataThread* SourceNode::getThread() const
 void SourceNode::resizeBuffers()
 {
     inputBuffers.clear();
-    eventCodeBuffers.clear();
     eventStates.clear();
 
     if (dataThread != nullptr)
@@ -90,7 +89,6 @@ void SourceNode::resizeBuffers()
         for (int i = 0; i < dataStreams.size(); i++)
         {
             inputBuffers.add (dataThread->getBufferAddress (i));
-            eventCodeBuffers.add (new MemoryBlock (10000 * sizeof (uint64)));
             eventStates.add (0);
         }
     }
@@ -301,15 +299,15 @@ void SourceNode::process (AudioBuffer<float>& buffer)
 
     for (int streamIdx = 0; streamIdx < inputBuffers.size(); streamIdx++)
     {
+        DataBuffer* inputBuffer = inputBuffers[streamIdx];
         int channelsToCopy = getNumOutputsForStream (streamIdx);
 
-        int nSamples = inputBuffers[streamIdx]->readAllFromBuffer (buffer,
-                                                                   &sampleNumber,
-                                                                   &timestamp,
-                                                                   static_cast<uint64*> (eventCodeBuffers[streamIdx]->getData()),
-                                                                   buffer.getNumSamples(),
-                                                                   copiedChannels,
-                                                                   channelsToCopy);
+        const DataBuffer::ReadSpan span = inputBuffer->prepareToRead (buffer.getNumSamples());
+        inputBuffer->copySpan (span, buffer, copiedChannels, channelsToCopy);
+
+        int nSamples = span.getNumSamples();
+        sampleNumber = span.sampleNumber;
+        timestamp = span.timestamp;
 
         copiedChannels += channelsToCopy;
 
@@ -320,28 +318,28 @@ void SourceNode::process (AudioBuffer<float>& buffer)
 
         if (eventChannels[streamIdx])
         {
-            int maxTTLBits = eventChannels[streamIdx]->getMaxTTLBits();
-
             uint64 lastCode = eventStates[streamIdx];
 
-            for (int sample = 0; sample < nSamples; ++sample)
-            {
-                uint64 currentCode = *(static_cast<uint64*> (eventCodeBuffers[streamIdx]->getData()) + sample);
+            // The buffer keeps only TTL transitions, so this costs one call per change rather than per sample
+            inputBuffer->forEachEventCodeChange (span,
+                                                 [&] (int sample, uint64 currentCode)
+                                                 {
+                                                     if (lastCode != currentCode)
+                                                     {
+                                                         Array<TTLEventPtr> events = TTLEvent::createTTLEvent (eventChannels[streamIdx],
+                                                                                                               sampleNumber + sample,
+                                                                                                               currentCode);
 
-                //If there has been no change to the TTL word, avoid doing anything at all here
-                if (lastCode != currentCode)
-                {
-                    Array<TTLEventPtr> events = TTLEvent::createTTLEvent (eventChannels[streamIdx],
-                                                                          sampleNumber + sample,
-                                                                          currentCode);
+                                                         for (auto& event : events)
+                                                             addEvent (event, sample);
 
-                    for (auto& event : events)
-                        addEvent (event, sample);
+                                                         lastCode = currentCode;
+                                                     }
+                                                 });
 
-                    lastCode = currentCode;
-                }
-            }
             eventStates.set (streamIdx, lastCode);
         }
+
+        inputBuffer->finishedRead (span);
     }
 }
@@ -130,7 +130,6 @@ private:
     int64 sampleNumber = 0;
     double timestamp = -1.0;
 
-    OwnedArray<MemoryBlock> eventCodeBuffers;
     Array<uint64> eventStates;
     Array<EventChannel*> ttlChannels;
 
@@ -41,4 +41,246 @@ TEST(DataBufferTest, CopyToAudioBuffer)
         for (int sample = 0; sample < audioBuffer.getNumSamples(); ++sample)
             EXPECT_EQ(audioBuffer.getSample(channel, sample), sample);
     }
-}
\ No newline at end of file
+}
+
+/*
+Sample numbers and timestamps are stored once per written block.
+A read that starts part way into a block derives them from the block's first sample,
+spacing timestamps evenly up to the block's last timestamp.
+*/
+TEST(DataBufferTest, BlockMetadataAcrossPartialReads)
+{
+    DataBuffer dataBuffer(2, 64);
+
+    float data[2 * 10];
+    for (int i = 0; i < 10; ++i)
+    {
+        data[i] = (float) i;
+        data[10 + i] = (float) -i;
+    }
+
+    EXPECT_EQ(dataBuffer.addToBuffer(data, 100, 1.0, 1.9, 0, 10), 10);
+    EXPECT_EQ(dataBuffer.addToBuffer(data, 110, 2.0, 2.9, 0, 10), 10);
+
+    AudioBuffer<float> audioBuffer(2, 20);
+    int64 sampleNumber;
+    double timestamp;
+    uint64 eventCodes[20];
+
+    EXPECT_EQ(dataBuffer.readAllFromBuffer(audioBuffer, &sampleNumber, &timestamp, eventCodes, 4), 4);
+    EXPECT_EQ(sampleNumber, 100);
+    EXPECT_DOUBLE_EQ(timestamp, 1.0);
+    EXPECT_EQ(audioBuffer.getSample(1, 3), -3.0f);
+
+    EXPECT_EQ(dataBuffer.readAllFromBuffer(audioBuffer, &sampleNumber, &timestamp, eventCodes, 10), 10);
+    EXPECT_EQ(sampleNumber, 104);
+    EXPECT_DOUBLE_EQ(timestamp, 1.4);
+    EXPECT_EQ(audioBuffer.getSample(0, 6), 0.0f);
+
+    EXPECT_EQ(dataBuffer.readAllFromBuffer(audioBuffer, &sampleNumber, &timestamp, eventCodes, 20), 6);
+    EXPECT_EQ(sampleNumber, 114);
+    EXPECT_DOUBLE_EQ(timestamp, 2.4);
+
+    // With nothing left, the last block's metadata is repeated
+    EXPECT_EQ(dataBuffer.readAllFromBuffer(audioBuffer, &sampleNumber, &timestamp, eventCodes, 20), 0);
+    EXPECT_EQ(sampleNumber, 114);
+    EXPECT_DOUBLE_EQ(timestamp, 2.4);
+}
+
+/*
+Event codes are stored only where they change, and expanded back to one code per sample when read.
+This test writes per-sample codes through a small buffer so that reads and writes wrap around the ring.
+*/
+TEST(DataBufferTest, SparseEventCodesWrapAround)
+{
+    constexpr int bufferSize = 16;
+    DataBuffer dataBuffer(1, bufferSize);
+
+    AudioBuffer<float> audioBuffer(1, bufferSize);
+    int64 nextSampleNumber = 0;
+    int64 nextExpected = 0;
+
+    auto codeFor = [](int64 sample) -> uint64 { return (uint64) ((sample / 3) % 4); };
+
+    for (int round = 0; round < 20; ++round)
+    {
+        const int numItems = 1 + round % 7;
+
+        float data[bufferSize];
+        int64 sampleNumbers[bufferSize];
+        double timestamps[bufferSize];
+        uint64 codes[bufferSize];
+
+        for (int i = 0; i < numItems; ++i)
+        {
+            data[i] = (float) (nextSampleNumber + i);
+            sampleNumbers[i] = nextSampleNumber + i;
+            timestamps[i] = (nextSampleNumber + i) * 0.001;
+            codes[i] = codeFor(nextSampleNumber + i);
+        }
+
+        nextSampleNumber += dataBuffer.addToBuffer(data, sampleNumbers, timestamps, codes, numItems);
+
+        int64 sampleNumber;
+        double timestamp;
+        uint64 eventCodes[bufferSize];
+
+        const int numRead = dataBuffer.readAllFromBuffer(audioBuffer, &sampleNumber, &timestamp, eventCodes, 1 + round % 5);
+
+        if (numRead > 0)
+        {
+            EXPECT_EQ(sampleNumber, nextExpected);
+            EXPECT_DOUBLE_EQ(timestamp, nextExpected * 0.001);
+        }
+
+        for (int i = 0; i < numRead; ++i)
+        {
+            EXPECT_EQ(audioBuffer.getSample(0, i), (float) (nextExpected + i));
+            EXPECT_EQ(eventCodes[i], codeFor(nextExpected + i));
+        }
+
+        nextExpected += numRead;
+    }
+}
+
+/*
+A reader can access samples in place through a ReadSpan.
+Nothing is consumed until finishedRead() is called.
+*/
+TEST(DataBufferTest, ReadSpanInPlace)
+{
+    DataBuffer dataBuffer(1, 8);
+
+    float data[6] = { 0, 1, 2, 3, 4, 5 };
+    dataBuffer.addToBuffer(data, 0, 0.0, 0.5, 3, 6);
+
+    DataBuffer::ReadSpan span = dataBuffer.prepareToRead(4);
+    EXPECT_EQ(span.getNumSamples(), 4);
+    EXPECT_EQ(dataBuffer.getNumSamples(), 6);
+    EXPECT_EQ(dataBuffer.getReadPointer(0, span.startIndex1)[2], 2.0f);
+
+    uint64 eventCodes[4];
+    dataBuffer.getEventCodes(span, eventCodes);
+    for (auto code : eventCodes)
+        EXPECT_EQ(code, 3u);
+
+    dataBuffer.finishedRead(span);
+    EXPECT_EQ(dataBuffer.getNumSamples(), 2);
+
+    // The second write wraps around the end of the ring
+    dataBuffer.addToBuffer(data, 6, 0.6, 1.0, 0, 5);
+
+    span = dataBuffer.prepareToRead(7);
+    EXPECT_EQ(span.getNumSamples(), 7);
+    EXPECT_EQ(span.sampleNumber, 4);
+    EXPECT_GT(span.blockSize2, 0);
+
+    for (int i = 0; i < span.getNumSamples(); ++i)
+    {
+        const float sample = i < span.blockSize1 ? dataBuffer.getReadPointer(0, span.startIndex1)[i]
+                                                 : dataBuffer.getReadPointer(0, span.startIndex2)[i - span.blockSize1];
+        EXPECT_EQ(sample, i < 2 ? (float) (4 + i) : (float) (i - 2));
+    }
+
+    uint64 wrappedCodes[7];
+    dataBuffer.getEventCodes(span, wrappedCodes);
+    EXPECT_EQ(wrappedCodes[1], 3u);
+    EXPECT_EQ(wrappedCodes[2], 0u);
+
+    dataBuffer.finishedRead(span);
+    EXPECT_EQ(dataBuffer.getNumSamples(), 0);
+}
+
+/*
+Dense event codes are scanned for changes several at a time.
+This test places a single differing code at every position of arrays of various lengths,
+so that it falls both inside the vectorized loop and in the scalar tail.
+*/
+TEST(DataBufferTest, FindEventCodeChange)
+{
+    const uint64 code = 0x0123456789abcdefULL;
+
+    for (int numItems = 0; numItems < 20; ++numItems)
+    {
+        std::vector<uint64> codes(numItems, code);
+        EXPECT_EQ(DataBuffer::findEventCodeChange(codes.data(), numItems, code), numItems);
+
+        for (int position = 0; position < numItems; ++position)
+        {
+            // Differ in one 32-bit half only
+            codes[position] = code ^ (position % 2 == 0 ? 1ULL : 1ULL << 40);
+            EXPECT_EQ(DataBuffer::findEventCodeChange(codes.data(), numItems, code), position);
+            codes[position] = code;
+        }
+    }
+}
+
+/*
+DataThreads can push TTL transitions as a sparse list.
+A reader is then called once for the code carried into each read and once per transition within it,
+however many samples the read covers.
+*/
+TEST(DataBufferTest, SparseEventCodeChanges)
+{
+    DataBuffer dataBuffer(1, 256);
+
+    std::vector<float> data(100, 0.0f);
+
+    // Two changes at sample 40 collapse into the last of them; a repeated code is not a change
+    const DataBuffer::EventCodeChange changes[] = { { 10, 1 }, { 40, 2 }, { 40, 3 }, { 70, 3 }, { 90, 0 } };
+    EXPECT_EQ(dataBuffer.addToBuffer(data.data(), 0, 0.0, 0.099, changes, 5, 100), 100);
+    EXPECT_EQ(dataBuffer.addToBuffer(data.data(), 100, 0.1, 0.199, 4, 100), 100);
+
+    std::vector<std::pair<int, uint64>> calls;
+    auto record = [&calls](int sample, uint64 code) { calls.emplace_back(sample, code); };
+
+    DataBuffer::ReadSpan span = dataBuffer.prepareToRead(50);
+    dataBuffer.forEachEventCodeChange(span, record);
+    dataBuffer.finishedRead(span);
+
+    std::vector<std::pair<int, uint64>> expected = { { 0, 0 }, { 10, 1 }, { 40, 3 } };
+    EXPECT_EQ(calls, expected);
+
+    calls.clear();
+    span = dataBuffer.prepareToRead(150);
+    EXPECT_EQ(span.sampleNumber, 50);
+    dataBuffer.forEachEventCodeChange(span, record);
+
+    expected = { { 0, 3 }, { 40, 0 }, { 50, 4 } };
+    EXPECT_EQ(calls, expected);
+
+    uint64 eventCodes[150];
+    dataBuffer.getEventCodes(span, eventCodes);
+    EXPECT_EQ(eventCodes[39], 3u);
+    EXPECT_EQ(eventCodes[40], 0u);
+    EXPECT_EQ(eventCodes[149], 4u);
+
+    dataBuffer.finishedRead(span);
+}
+
+/*
+Changes dated before a block take effect at its first sample, and only the last of them is kept.
+*/
+TEST(DataBufferTest, EventCodeChangesBeforeTheBlock)
+{
+    DataBuffer dataBuffer(1, 256);
+
+    std::vector<float> data(20, 0.0f);
+
+    const DataBuffer::EventCodeChange first[] = { { -5, 1 }, { -2, 2 }, { 0, 3 }, { 10, 4 } };
+    EXPECT_EQ(dataBuffer.addToBuffer(data.data(), 0, 0.0, 0.019, first, 4, 20), 20);
+
+    const DataBuffer::EventCodeChange second[] = { { -3, 5 }, { -1, 6 }, { 5, 7 } };
+    EXPECT_EQ(dataBuffer.addToBuffer(data.data(), 20, 0.02, 0.039, second, 3, 20), 20);
+
+    std::vector<std::pair<int, uint64>> calls;
+    auto record = [&calls](int sample, uint64 code) { calls.emplace_back(sample, code); };
+
+    DataBuffer::ReadSpan span = dataBuffer.prepareToRead(40);
+    dataBuffer.forEachEventCodeChange(span, record);
+
+    std::vector<std::pair<int, uint64>> expected = { { 0, 3 }, { 10, 4 }, { 20, 6 }, { 25, 7 } };
+    EXPECT_EQ(calls, expected);
+
+    dataBuffer.finishedRead(span);
+}
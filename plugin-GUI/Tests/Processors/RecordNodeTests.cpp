@@ -3,6 +3,7 @@
 #include "gtest/gtest.h"
 
 #include <Processors/RecordNode/RecordNode.h>
+#include <Processors/RecordNode/BinaryFormat/SequentialBlockFile.h>
 #include <ModelProcessors.h>
 #include <ModelApplication.h>
 #include <TestFixtures.h>
@@ -522,3 +523,74 @@ TEST_F(RecordNodeTests, Test_PersistsEvents) {
         "20202020202020202020202020202020200a0400000000000000";
     compareBinaryFilesHex("full_words.npy", fullWordsBin, expectedFullWordsHex);
 }
+
+/*
+Converts float channels the way BinaryRecording::writeContinuousData does before handing them to writeChannel.
+*/
+static void writeChannelsSeparately(SequentialBlockFile& blockFile, uint64 startPos, int numChannels, const float* const* data, const float* gains, int nSamples, HeapBlock<float>& scaled, HeapBlock<int16>& converted)
+{
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        FloatVectorOperations::copyWithMultiply(scaled.getData(), data[ch], gains[ch], nSamples);
+        AudioDataConverters::convertFloatToInt16LE(scaled.getData(), converted.getData(), nSamples);
+        blockFile.writeChannel(startPos, ch, converted.getData(), nSamples);
+    }
+}
+
+/*
+Benchmark: samples per second converted and handed to the file by the record thread,
+one channel at a time versus all channels of a stream in one batch.
+The disk writes happen on the writer thread and are not timed.
+*/
+TEST(RecordNodeBenchmark, InterleaveThroughput)
+{
+    constexpr int numSamples = 16384;
+    constexpr int chunkSize = 1024;
+
+    for (int numChannels : { 64, 384, 1024 })
+    {
+        AudioBuffer<float> input(numChannels, chunkSize);
+        std::vector<float> gains(numChannels, 1 / (float(0x7fff) * 0.195f));
+        std::vector<const float*> pointers(numChannels);
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            for (int i = 0; i < chunkSize; i++)
+                input.setSample(ch, i, 100.0f * std::sin(0.01f * i + ch));
+
+            pointers[ch] = input.getReadPointer(ch);
+        }
+
+        HeapBlock<float> scaled(chunkSize);
+        HeapBlock<int16> converted(chunkSize);
+        double seconds[2];
+
+        for (int batch = 0; batch < 2; batch++)
+        {
+            File file = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("continuous", ".dat");
+
+            {
+                SequentialBlockFile blockFile(numChannels);
+                ASSERT_TRUE(blockFile.openFile(file.getFullPathName()));
+
+                const int64 start = Time::getHighResolutionTicks();
+
+                for (int pos = 0; pos < numSamples; pos += chunkSize)
+                {
+                    if (batch)
+                        blockFile.writeChannels(pos, 0, numChannels, pointers.data(), 0, gains.data(), chunkSize);
+                    else
+                        writeChannelsSeparately(blockFile, pos, numChannels, pointers.data(), gains.data(), chunkSize, scaled, converted);
+                }
+
+                seconds[batch] = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+            }
+
+            file.deleteFile();
+        }
+
+        const double samples = (double) numChannels * numSamples;
+        printf("[ BENCH    ] %4d channels: per channel %7.1f Msamples/s, batch %7.1f Msamples/s (%.1fx)\n",
+               numChannels, samples / seconds[0] / 1.0e6, samples / seconds[1] / 1.0e6, seconds[0] / seconds[1]);
+    }
+}
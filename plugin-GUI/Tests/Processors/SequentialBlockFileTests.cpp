@@ -0,0 +1,246 @@
+#include "gtest/gtest.h"
+
+#include <Processors/RecordNode/BinaryFormat/SequentialBlockFile.h>
+
+/*
+Writes a ramp on every channel in uneven chunks, so writes straddle block boundaries
+and the last block is only partly filled, then checks the file holds exactly the
+interleaved samples that were written. Samples dropped because the pool was full
+must read as zeros, and be counted.
+*/
+static void writeAndVerify(int numChannels, int samplesPerBlock, int numSamples, int chunkSize, int maxPoolSize = BlockFileWriter::defaultMaxPoolSize, BlockFileWriter::Stats* statsOut = nullptr)
+{
+    BlockFileWriter::Stats stats;
+
+    File file = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("continuous", ".dat");
+
+    {
+        SequentialBlockFile blockFile(numChannels, samplesPerBlock, maxPoolSize);
+        ASSERT_TRUE(blockFile.openFile(file.getFullPathName()));
+
+        HeapBlock<int16> data(chunkSize);
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int n = jmin(chunkSize, numSamples - start);
+
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                for (int i = 0; i < n; i++)
+                    data[i] = (int16) ((start + i) * numChannels + ch);
+
+                EXPECT_TRUE(blockFile.writeChannel(start, ch, data, n));
+            }
+        }
+
+        blockFile.close();
+
+        stats = blockFile.getWriterStats();
+        EXPECT_LE(stats.poolSize, maxPoolSize);
+        EXPECT_FALSE(stats.failed);
+
+        if (stats.bytesDropped == 0)
+        {
+            EXPECT_EQ(stats.bytesWritten, (int64) numSamples * numChannels * sizeof(int16));
+            EXPECT_EQ(stats.blocksWritten, (numSamples + samplesPerBlock - 1) / samplesPerBlock);
+        }
+    }
+
+    MemoryBlock contents;
+    ASSERT_TRUE(file.loadFileAsData(contents));
+    ASSERT_EQ(contents.getSize(), (size_t) numSamples * numChannels * sizeof(int16));
+
+    const int16* samples = static_cast<const int16*>(contents.getData());
+    int64 bytesZeroed = 0;
+
+    for (int i = 0; i < numSamples * numChannels; i++)
+    {
+        if (samples[i] != (int16) i)
+        {
+            ASSERT_EQ(samples[i], 0) << "at " << i;
+            bytesZeroed += sizeof(int16);
+        }
+    }
+
+    EXPECT_EQ(bytesZeroed, stats.bytesDropped);
+
+    if (statsOut != nullptr)
+        *statsOut = stats;
+
+    file.deleteFile();
+}
+
+TEST(SequentialBlockFileTest, WritesUnalignedBlocks)
+{
+    writeAndVerify(3, 8, 101, 5);
+}
+
+TEST(SequentialBlockFileTest, WritesPageAlignedBlocks)
+{
+    writeAndVerify(4, 4096, 3 * 4096 + 1000, 700);
+}
+
+/*
+Channel 1 holds the first block while channel 0 runs two blocks ahead, so with a pool of two
+blocks there is none for channel 0's third block. The record thread must not wait for one:
+those samples are dropped and counted, and read as zeros once the file is closed.
+*/
+TEST(SequentialBlockFileTest, DropsSamplesWhenThePoolIsFull)
+{
+    File file = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("continuous", ".dat");
+
+    {
+        SequentialBlockFile blockFile(2, 8, 2);
+        ASSERT_TRUE(blockFile.openFile(file.getFullPathName()));
+
+        int16 data[24];
+
+        for (int i = 0; i < 24; i++)
+            data[i] = (int16) (100 + i);
+
+        EXPECT_TRUE(blockFile.writeChannel(0, 1, data, 4));
+        EXPECT_TRUE(blockFile.writeChannel(0, 0, data, 24));
+        EXPECT_TRUE(blockFile.writeChannel(4, 1, data + 4, 20));
+
+        blockFile.close();
+
+        const BlockFileWriter::Stats stats = blockFile.getWriterStats();
+        EXPECT_EQ(stats.poolExhausted, 2);
+        EXPECT_EQ(stats.bytesDropped, 2 * 8 * (int64) sizeof(int16));
+        EXPECT_EQ(stats.blocksWritten, 2);
+        EXPECT_FALSE(stats.failed);
+    }
+
+    MemoryBlock contents;
+    ASSERT_TRUE(file.loadFileAsData(contents));
+    ASSERT_EQ(contents.getSize(), 2 * 24 * sizeof(int16));
+
+    const int16* samples = static_cast<const int16*>(contents.getData());
+
+    for (int i = 0; i < 24; i++)
+    {
+        for (int ch = 0; ch < 2; ch++)
+            EXPECT_EQ(samples[i * 2 + ch], i < 16 ? 100 + i : 0) << "sample " << i << ", channel " << ch;
+    }
+
+    file.deleteFile();
+}
+
+/*
+Blocks are returned to the pool once written, so a long recording reuses a handful of them
+and the pool never grows past its cap, however far the writer falls behind.
+*/
+TEST(SequentialBlockFileTest, ReusesPooledBlocks)
+{
+    BlockFileWriter::Stats stats;
+    writeAndVerify(2, 64, 64 * 200, 32, 3, &stats);
+
+    EXPECT_EQ(stats.maxPoolSize, 3);
+    EXPECT_LE(stats.poolSize, 3);
+}
+
+#if JUCE_LINUX
+/*
+Every write to /dev/full fails. Once the writer has seen that, the record thread's writes
+return false so the recording can be stopped.
+*/
+TEST(SequentialBlockFileTest, ReportsFailedWrites)
+{
+    SequentialBlockFile blockFile(2, 64);
+    ASSERT_TRUE(blockFile.openFile("/dev/full"));
+
+    HeapBlock<int16> data(32, true);
+    bool writeFailed = false;
+
+    for (int start = 0; start < 64 * 1000 && ! writeFailed; start += 32)
+    {
+        for (int ch = 0; ch < 2; ch++)
+            writeFailed = ! blockFile.writeChannel(start, ch, data, 32) || writeFailed;
+
+        if (start % 640 == 0)
+            Thread::sleep(1);
+    }
+
+    EXPECT_TRUE(writeFailed);
+    EXPECT_TRUE(blockFile.getWriterStats().failed);
+
+    blockFile.close();
+}
+#endif
+
+/*
+Converts float channels the way BinaryRecording::writeContinuousData does before handing them to writeChannel.
+*/
+static void writeChannelsSeparately(SequentialBlockFile& blockFile, uint64 startPos, int numChannels, const float* const* data, const float* gains, int nSamples, HeapBlock<float>& scaled, HeapBlock<int16>& converted)
+{
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        FloatVectorOperations::copyWithMultiply(scaled.getData(), data[ch], gains[ch], nSamples);
+        AudioDataConverters::convertFloatToInt16LE(scaled.getData(), converted.getData(), nSamples);
+        blockFile.writeChannel(startPos, ch, converted.getData(), nSamples);
+    }
+}
+
+/*
+The batch path converts and interleaves every channel in one pass.
+It must produce the same file as converting each channel and writing it on its own,
+including samples that clip and samples that sit halfway between two integers.
+*/
+TEST(SequentialBlockFileTest, WriteChannelsMatchesWriteChannel)
+{
+    constexpr int numChannels = 7;
+    constexpr int numSamples = 301;
+
+    AudioBuffer<float> input(numChannels, numSamples);
+    float gains[numChannels];
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        const float bitVolts = 0.05f + 0.1f * ch;
+        gains[ch] = 1 / (float(0x7fff) * bitVolts);
+
+        for (int i = 0; i < numSamples; i++)
+            input.setSample(ch, i, (i % 3 == 0 ? 0.5f * bitVolts * (i - 150) : 40000.0f * bitVolts * std::sin(0.1f * i + ch)));
+    }
+
+    File batchFile = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("continuous", ".dat");
+    File channelFile = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("continuous", ".dat");
+
+    {
+        SequentialBlockFile batch(numChannels, 64);
+        SequentialBlockFile separate(numChannels, 64);
+        ASSERT_TRUE(batch.openFile(batchFile.getFullPathName()));
+        ASSERT_TRUE(separate.openFile(channelFile.getFullPathName()));
+
+        HeapBlock<float> scaled(numSamples);
+        HeapBlock<int16> converted(numSamples);
+
+        for (int start = 0; start < numSamples; start += 50)
+        {
+            const int n = jmin(50, numSamples - start);
+            const float* pointers[numChannels];
+
+            for (int ch = 0; ch < numChannels; ch++)
+                pointers[ch] = input.getReadPointer(ch);
+
+            // Split the channels, so a batch can start part way into a sample
+            EXPECT_TRUE(batch.writeChannels(start, 0, 5, pointers, start, gains, n));
+            EXPECT_TRUE(batch.writeChannels(start, 5, 2, pointers + 5, start, gains + 5, n));
+
+            for (int ch = 0; ch < numChannels; ch++)
+                pointers[ch] += start;
+
+            writeChannelsSeparately(separate, start, numChannels, pointers, gains, n, scaled, converted);
+        }
+    }
+
+    MemoryBlock batchContents, channelContents;
+    ASSERT_TRUE(batchFile.loadFileAsData(batchContents));
+    ASSERT_TRUE(channelFile.loadFileAsData(channelContents));
+
+    ASSERT_EQ(batchContents.getSize(), (size_t) numChannels * numSamples * sizeof(int16));
+    EXPECT_TRUE(batchContents == channelContents);
+
+    batchFile.deleteFile();
+    channelFile.deleteFile();
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+
+#include <Processors/GenericProcessor/WorkerPool.h>
+
+#include <vector>
+
+/*
+Every partition runs exactly once per block, with blocks arriving back to back
+and after long enough gaps that the workers go to sleep.
+*/
+TEST(WorkerPoolTest, RunsEveryPartitionOnce)
+{
+    WorkerPool pool("Test Worker", 4);
+    ASSERT_EQ(pool.getNumThreads(), 4);
+
+    for (int numPartitions : { 1, 3, 4, 13, 64 })
+    {
+        std::vector<std::atomic<int>> counts(numPartitions);
+
+        for (int block = 0; block < 200; block++)
+        {
+            for (auto& count : counts)
+                count = 0;
+
+            auto task = [&](int p)
+            { counts[p]++; };
+
+            pool.run(numPartitions, task);
+
+            for (int p = 0; p < numPartitions; p++)
+                ASSERT_EQ(counts[p].load(), 1) << numPartitions << " partitions, block " << block;
+
+            if (block % 50 == 0)
+                Thread::sleep(2);
+        }
+    }
+}
+
+/*
+Idle threads pick up partitions another thread has not started.
+Partition 0 blocks until partitions 4, 8 and 12 are done. Those are offered to the same thread
+as partition 0, so unless other threads take them, the wait times out.
+*/
+TEST(WorkerPoolTest, BalancesUnevenPartitions)
+{
+    WorkerPool pool("Test Worker", 4);
+
+    std::vector<std::atomic<int>> counts(16);
+    std::vector<Thread::ThreadID> threads(16);
+    std::atomic<int> othersDone { 0 };
+    bool timedOut = false;
+
+    for (auto& count : counts)
+        count = 0;
+
+    auto task = [&](int p)
+    {
+        threads[p] = Thread::getCurrentThreadId();
+
+        if (p == 0)
+        {
+            const uint32 deadline = Time::getMillisecondCounter() + 5000;
+
+            while (othersDone.load() < 3 && Time::getMillisecondCounter() < deadline)
+                Thread::sleep(1);
+
+            timedOut = othersDone.load() < 3;
+        }
+        else if (p % 4 == 0)
+        {
+            othersDone++;
+        }
+
+        counts[p]++;
+    };
+
+    pool.run(16, task);
+
+    for (auto& count : counts)
+        EXPECT_EQ(count.load(), 1);
+
+    EXPECT_FALSE(timedOut);
+
+    for (int p : { 4, 8, 12 })
+        EXPECT_NE(threads[p], threads[0]) << "partition " << p;
+
+    EXPECT_GT(pool.getLastEfficiency(), 0.0f);
+    EXPECT_LE(pool.getLastEfficiency(), 1.0f);
+}
+
+/*
+A pool with a single thread runs everything on the caller.
+*/
+TEST(WorkerPoolTest, SingleThreadRunsInline)
+{
+    WorkerPool pool("Test Worker", 1);
+    ASSERT_EQ(pool.getNumThreads(), 1);
+
+    const Thread::ThreadID caller = Thread::getCurrentThreadId();
+    int count = 0;
+
+    auto task = [&](int)
+    {
+        EXPECT_EQ(Thread::getCurrentThreadId(), caller);
+        count++;
+    };
+
+    pool.run(10, task);
+
+    EXPECT_EQ(count, 10);
+    EXPECT_FLOAT_EQ(pool.getLastEfficiency(), 1.0f);
+}